@@ -65,30 +65,27 @@ void append_singles_asci_contributions(
     }  // Loop over single extitations
 }
 
-template <size_t N, size_t NShift>
+template <size_t N, size_t NShift, typename Rank4>
 void append_ss_doubles_asci_contributions(
     double coeff, wfn_t<2 * N> state_full, wfn_t<N> state_spin,
     const std::vector<uint32_t>& ss_occ, const std::vector<uint32_t>& vir,
-    const std::vector<uint32_t>& os_occ, const double* eps_same,
-    const double* G, size_t LDG, double h_el_tol, double root_diag, double E0,
+    const std::vector<uint32_t>& os_occ, const double* eps_same, Rank4 G,
+    double h_el_tol, double root_diag, double E0,
     HamiltonianGenerator<2 * N>& ham_gen,
     asci_contrib_container<wfn_t<2 * N>>& asci_contributions) {
   const size_t nocc = ss_occ.size();
   const size_t nvir = vir.size();
 
-  const size_t LDG2 = LDG * LDG;
   for(auto ii = 0; ii < nocc; ++ii)
     for(auto aa = 0; aa < nvir; ++aa) {
       const auto i = ss_occ[ii];
       const auto a = vir[aa];
-      const auto G_ai = G + (a + i * LDG) * LDG2;
 
       for(auto jj = ii + 1; jj < nocc; ++jj)
         for(auto bb = aa + 1; bb < nvir; ++bb) {
           const auto j = ss_occ[jj];
           const auto b = vir[bb];
-          const auto jb = b + j * LDG;
-          const auto G_aibj = G_ai[jb];
+          const auto G_aibj = G(b, j, a, i);
 
           if(std::abs(G_aibj) < h_el_tol) continue;
 
@@ -119,26 +116,22 @@ void append_ss_doubles_asci_contributions(
     }      // AI Loop
 }
 
-template <size_t N>
+template <size_t N, typename Rank4>
 void append_os_doubles_asci_contributions(
     double coeff, wfn_t<2 * N> state_full, wfn_t<N> state_alpha,
     wfn_t<N> state_beta, const std::vector<uint32_t>& occ_alpha,
     const std::vector<uint32_t>& occ_beta,
     const std::vector<uint32_t>& vir_alpha,
     const std::vector<uint32_t>& vir_beta, const double* eps_alpha,
-    const double* eps_beta, const double* V, size_t LDV, double h_el_tol,
-    double root_diag, double E0, HamiltonianGenerator<2 * N>& ham_gen,
+    const double* eps_beta, Rank4 V, double h_el_tol, double root_diag,
+    double E0, HamiltonianGenerator<2 * N>& ham_gen,
     asci_contrib_container<wfn_t<2 * N>>& asci_contributions) {
-  const size_t LDV2 = LDV * LDV;
   for(auto i : occ_alpha)
     for(auto a : vir_alpha) {
-      const auto V_ai = V + a + i * LDV;
-
       double sign_alpha = single_excitation_sign(state_alpha, a, i);
       for(auto j : occ_beta)
         for(auto b : vir_beta) {
-          const auto jb = b + j * LDV;
-          const auto V_aibj = V_ai[jb * LDV2];
+          const auto V_aibj = V(a, i, b, j);
 
           if(std::abs(V_aibj) < h_el_tol) continue;
 
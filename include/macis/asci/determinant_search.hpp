@@ -45,17 +45,20 @@ struct ASCISettings {
   bool grow_with_rot = false;
   size_t rot_size_start = 1000;
 
+  // Order the non-core determinants by alpha / beta string after the search
+  bool locality_order = false;
+
   // bool dist_triplet_random = false;
   int constraint_level = 2;  // Up To Quints
 };
 
-template <size_t N>
+template <size_t N, typename Rank4G, typename Rank4V>
 asci_contrib_container<wfn_t<N>> asci_contributions_standard(
     ASCISettings asci_settings, wavefunction_iterator_t<N> cdets_begin,
     wavefunction_iterator_t<N> cdets_end, const double E_ASCI,
     const std::vector<double>& C, size_t norb, const double* T_pq,
-    const double* G_red, const double* V_red, const double* G_pqrs,
-    const double* V_pqrs, HamiltonianGenerator<N>& ham_gen) {
+    const double* G_red, const double* V_red, Rank4G G_pqrs, Rank4V V_pqrs,
+    HamiltonianGenerator<N>& ham_gen) {
   auto logger = spdlog::get("asci_search");
 
   const size_t ncdets = std::distance(cdets_begin, cdets_end);
@@ -80,7 +83,7 @@ asci_contrib_container<wfn_t<N>> asci_contributions_standard(
     auto eps_beta = ham_gen.single_orbital_ens(norb, occ_beta, occ_alpha);
 
     // Compute base diagonal matrix element
-    double h_diag = ham_gen.matrix_element(state, state);
+    double h_diag = ham_gen.matrix_element_diag(occ_alpha, occ_beta);
 
     const double h_el_tol = asci_settings.h_el_tol;
 
@@ -100,20 +103,20 @@ asci_contrib_container<wfn_t<N>> asci_contributions_standard(
       // Doubles - AAAA
       append_ss_doubles_asci_contributions<N / 2, 0>(
           coeff, state, state_alpha, occ_alpha, vir_alpha, occ_beta,
-          eps_alpha.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI, ham_gen,
+          eps_alpha.data(), G_pqrs, h_el_tol, h_diag, E_ASCI, ham_gen,
           asci_pairs);
 
       // Doubles - BBBB
       append_ss_doubles_asci_contributions<N / 2, N / 2>(
           coeff, state, state_beta, occ_beta, vir_beta, occ_alpha,
-          eps_beta.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI, ham_gen,
+          eps_beta.data(), G_pqrs, h_el_tol, h_diag, E_ASCI, ham_gen,
           asci_pairs);
 
       // Doubles - AABB
       append_os_doubles_asci_contributions(
           coeff, state, state_alpha, state_beta, occ_alpha, occ_beta, vir_alpha,
-          vir_beta, eps_alpha.data(), eps_beta.data(), V_pqrs, norb, h_el_tol,
-          h_diag, E_ASCI, ham_gen, asci_pairs);
+          vir_beta, eps_alpha.data(), eps_beta.data(), V_pqrs, h_el_tol, h_diag,
+          E_ASCI, ham_gen, asci_pairs);
     }
 
     // Prune Down Contributions
@@ -139,13 +142,13 @@ asci_contrib_container<wfn_t<N>> asci_contributions_standard(
   return asci_pairs;
 }
 
-template <size_t N>
+template <size_t N, typename Rank4G, typename Rank4V>
 asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
     ASCISettings asci_settings, wavefunction_iterator_t<N> cdets_begin,
     wavefunction_iterator_t<N> cdets_end, const double E_ASCI,
     const std::vector<double>& C, size_t norb, const double* T_pq,
-    const double* G_red, const double* V_red, const double* G_pqrs,
-    const double* V_pqrs, HamiltonianGenerator<N>& ham_gen, MPI_Comm comm) {
+    const double* G_red, const double* V_red, Rank4G G_pqrs, Rank4V V_pqrs,
+    HamiltonianGenerator<N>& ham_gen, MPI_Comm comm) {
   using clock_type = std::chrono::high_resolution_clock;
   using duration_type = std::chrono::duration<double, std::milli>;
 
@@ -189,12 +192,12 @@ asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
       // Reduce the number of times things shift in inner loop
       beta_string = beta_shift << N / 2;
 
-      // Compute diagonal matrix element
-      h_diag = ham_gen.matrix_element(w, w);
-
       // Compute occ/vir for beta string
       bitset_to_occ_vir(norb, beta_shift, occ_beta, vir_beta);
 
+      // Compute diagonal matrix element
+      h_diag = ham_gen.matrix_element_diag(occ_alpha, occ_beta);
+
       // Precompute orbital energies
       orb_ens_alpha = ham_gen.single_orbital_ens(norb, occ_alpha, occ_beta);
       orb_ens_beta = ham_gen.single_orbital_ens(norb, occ_beta, occ_alpha);
@@ -202,13 +205,15 @@ asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
   };
 
   struct unique_alpha_data {
+    std::vector<uint32_t> occ_alpha;
     std::vector<beta_coeff_data> bcd;
   };
 
   std::vector<unique_alpha_data> uad(nuniq_alpha);
   for(auto i = 0; i < nuniq_alpha; ++i) {
     const auto wfn_a = uniq_alpha_wfn[i];
-    std::vector<uint32_t> occ_alpha, vir_alpha;
+    auto& occ_alpha = uad[i].occ_alpha;
+    std::vector<uint32_t> vir_alpha;
     bitset_to_occ_vir(norb, wfn_a, occ_alpha, vir_alpha);
     for(auto j = 0; j < ncdets; ++j) {
       const auto w = *(cdets_begin + j);
@@ -278,7 +283,7 @@ asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
     // Loop over unique alpha strings
     for(size_t i_alpha = 0; i_alpha < nuniq_alpha; ++i_alpha) {
       const auto& det = uniq_alpha_wfn[i_alpha];
-      const auto occ_alpha = bits_to_indices(det);
+      const auto& occ_alpha = uad[i_alpha].occ_alpha;
 
       // AA excitations
       for(const auto& bcd : uad[i_alpha].bcd) {
@@ -302,8 +307,8 @@ asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
         const auto& orb_ens_alpha = bcd.orb_ens_alpha;
         generate_constraint_doubles_contributions_ss(
             coeff, det, C, O, B, beta, occ_alpha, occ_beta,
-            orb_ens_alpha.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI,
-            ham_gen, asci_pairs);
+            orb_ens_alpha.data(), G_pqrs, h_el_tol, h_diag, E_ASCI, ham_gen,
+            asci_pairs);
       }
 
       // AABB excitations
@@ -317,8 +322,8 @@ asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
         const auto& orb_ens_beta = bcd.orb_ens_beta;
         generate_constraint_doubles_contributions_os(
             coeff, det, C, O, B, beta, occ_alpha, occ_beta, vir_beta,
-            orb_ens_alpha.data(), orb_ens_beta.data(), V_pqrs, norb, h_el_tol,
-            h_diag, E_ASCI, ham_gen, asci_pairs);
+            orb_ens_alpha.data(), orb_ens_beta.data(), V_pqrs, h_el_tol, h_diag,
+            E_ASCI, ham_gen, asci_pairs);
       }
 
       // If the alpha determinant satisfies the constraint,
@@ -343,7 +348,7 @@ asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
           // BBBB Excitations
           append_ss_doubles_asci_contributions<N / 2, N / 2>(
               coeff, state, state_beta, occ_beta, vir_beta, occ_alpha,
-              eps_beta.data(), G_pqrs, norb, h_el_tol, h_diag, E_ASCI, ham_gen,
+              eps_beta.data(), G_pqrs, h_el_tol, h_diag, E_ASCI, ham_gen,
               asci_pairs);
 
         }  // Beta Loop
@@ -388,14 +393,14 @@ asci_contrib_container<wfn_t<N>> asci_contributions_constraint(
   return asci_pairs;
 }
 
-template <size_t N>
+template <size_t N, typename Rank4G, typename Rank4V>
 std::vector<wfn_t<N>> asci_search(
     ASCISettings asci_settings, size_t ndets_max,
     wavefunction_iterator_t<N> cdets_begin,
     wavefunction_iterator_t<N> cdets_end, const double E_ASCI,
     const std::vector<double>& C, size_t norb, const double* T_pq,
-    const double* G_red, const double* V_red, const double* G_pqrs,
-    const double* V_pqrs, HamiltonianGenerator<N>& ham_gen, MPI_Comm comm) {
+    const double* G_red, const double* V_red, Rank4G G_pqrs, Rank4V V_pqrs,
+    HamiltonianGenerator<N>& ham_gen, MPI_Comm comm) {
   using clock_type = std::chrono::high_resolution_clock;
   using duration_type = std::chrono::duration<double>;
 
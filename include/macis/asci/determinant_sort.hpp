@@ -36,6 +36,57 @@ void reorder_ci_on_coeff(std::vector<WfnT>& dets, std::vector<double>& C) {
   dets = std::move(reorder_dets);
 }
 
+/// Orders determinants by their alpha string, then by their beta string
+template <size_t N>
+struct wfn_string_order_comparator {
+  bool operator()(wfn_t<N> x, wfn_t<N> y) const {
+    const auto x_alpha = bitset_lo_word(x);
+    const auto y_alpha = bitset_lo_word(y);
+    if(x_alpha != y_alpha) return bitset_less(x_alpha, y_alpha);
+    return bitset_less(bitset_hi_word(x), bitset_hi_word(y));
+  }
+};
+
+/**
+ *  @brief Reorder a CI expansion for locality.
+ *
+ *  Keeps the leading `nkeep` determinants in place (e.g. the coefficient
+ *  ordered core space) and sorts the remaining ones by alpha string, then by
+ *  beta string. Determinants sharing a string are strongly coupled, so this
+ *  clusters the nonzeros of the Hamiltonian around its diagonal, improving
+ *  the reuse of the input vector in SpMV and shrinking the distributed
+ *  off-diagonal tiles. Any Hamiltonian built over `dets` afterwards follows
+ *  the same permutation.
+ *
+ *  @param[in/out] dets  Determinants
+ *  @param[in/out] C     CI coefficients of `dets`, permuted consistently
+ *                       (may be empty)
+ *  @param[in]     nkeep Number of leading determinants to keep in place
+ */
+template <size_t N>
+void reorder_ci_on_strings(std::vector<wfn_t<N>>& dets, std::vector<double>& C,
+                           size_t nkeep) {
+  const size_t ndets = dets.size();
+  nkeep = std::min(nkeep, ndets);
+  assert(C.empty() or C.size() == ndets);
+
+  std::vector<uint64_t> idx(ndets);
+  std::iota(idx.begin(), idx.end(), 0);
+  wfn_string_order_comparator<N> comparator;
+  std::sort(idx.begin() + nkeep, idx.end(),
+            [&](auto i, auto j) { return comparator(dets[i], dets[j]); });
+
+  std::vector<wfn_t<N>> reorder_dets(ndets);
+  for(auto i = 0ul; i < ndets; ++i) reorder_dets[i] = dets[idx[i]];
+  dets = std::move(reorder_dets);
+
+  if(C.size()) {
+    std::vector<double> reorder_C(ndets);
+    for(auto i = 0ul; i < ndets; ++i) reorder_C[i] = C[idx[i]];
+    C = std::move(reorder_C);
+  }
+}
+
 template <typename PairIterator>
 PairIterator sort_and_accumulate_asci_pairs(PairIterator pairs_begin,
                                             PairIterator pairs_end) {
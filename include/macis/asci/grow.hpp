@@ -40,6 +40,7 @@ auto asci_grow(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
   // Grow wfn until max size, or until we get stuck
   size_t prev_size = wfn.size();
   size_t iter = 1;
+  IncrementalHamiltonian<N, index_t> H_cache(comm);
   auto grow_st = hrt_t::now();
   while(wfn.size() < asci_settings.ntdets_max) {
     size_t ndets_new =
@@ -50,7 +51,7 @@ auto asci_grow(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
     auto ai_st = hrt_t::now();
     std::tie(E, wfn, X) = asci_iter<N, index_t>(
         asci_settings, mcscf_settings, ndets_new, E0, std::move(wfn),
-        std::move(X), ham_gen, norb, comm);
+        std::move(X), ham_gen, norb, comm, &H_cache);
     auto ai_en = hrt_t::now();
     dur_t ai_dur = ai_en - ai_st;
     logger->trace("  * ASCI_ITER_DUR = {:.2e} ms", ai_dur.count());
@@ -62,21 +63,20 @@ auto asci_grow(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
        wfn.size() >= asci_settings.rot_size_start) {
       auto grow_rot_st = hrt_t::now();
 
-      // Only do rotation on root rank
+      // Form 1RDM (distributed over bras)
+      logger->trace("  * Forming 1RDM");
+      auto rdm_st = hrt_t::now();
+      std::vector<double> ordm(norb * norb, 0.0);
+      matrix_span<double> ORDM(ordm.data(), norb, norb);
+      ham_gen.form_ordm(wfn.begin(), wfn.end(), X.data(), ORDM, comm);
+      auto rdm_en = hrt_t::now();
+      dur_t rdm_dur = rdm_en - rdm_st;
+      logger->trace("    * RDM_DUR = {:.2e} ms", rdm_dur.count());
+
+      // Only do rotation on root rank (node-shared ERIs are read by the
+      // other ranks of its node until all are done forming the 1RDM)
+      ham_gen.node_comm().barrier();
       if(!world_rank) {
-        // Form RDMs: TODO Make 1RDM-only work
-        logger->trace("  * Forming RDMs");
-        auto rdm_st = hrt_t::now();
-        std::vector<double> ordm(norb * norb, 0.0),
-            trdm(norb * norb * norb * norb, 0.0);
-        matrix_span<double> ORDM(ordm.data(), norb, norb);
-        rank4_span<double> TRDM(trdm.data(), norb, norb, norb, norb);
-        ham_gen.form_rdms(wfn.begin(), wfn.end(), wfn.begin(), wfn.end(),
-                          X.data(), ORDM, TRDM);
-        auto rdm_en = hrt_t::now();
-        dur_t rdm_dur = rdm_en - rdm_st;
-        logger->trace("    * RDM_DUR = {:.2e} ms", rdm_dur.count());
-
         // Compute Natural Orbitals
         logger->trace("  * Forming Natural Orbitals");
         auto nos_st = hrt_t::now();
@@ -97,47 +97,60 @@ auto asci_grow(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
         auto rot_st = hrt_t::now();
         macis::two_index_transform(norb, norb, ham_gen.T(), norb, ordm.data(),
                                    norb, ham_gen.T(), norb);
-        macis::four_index_transform(norb, norb, ham_gen.V(), norb, ordm.data(),
-                                    norb, ham_gen.V(), norb);
+        if(ham_gen.packed_eris()) {
+          // Packed ERIs are rotated in place, without dense norb^4 scratch
+          macis::four_index_transform_packed(
+              norb, ham_gen.V_packed_.data_handle(), ordm.data(), norb);
+        } else {
+          macis::four_index_transform(norb, norb, ham_gen.V(), norb,
+                                      ordm.data(), norb, ham_gen.V(), norb);
+        }
         auto rot_en = hrt_t::now();
         dur_t rot_dur = rot_en - rot_st;
         logger->trace("    * ROT_DUR = {:.2e} ms", rot_dur.count());
       }
 
-      // Broadcast rotated integrals
+      // Broadcast rotated integrals, node-shared ERIs are only broadcast
+      // to the node leaders
       if(world_size > 1) {
         bcast(ham_gen.T(), norb * norb, 0, comm);
-        bcast(ham_gen.V(), norb * norb * norb * norb, 0, comm);
+
+        const auto& node_comm = ham_gen.node_comm();
+        MPI_Comm eri_comm = comm;
+        if(ham_gen.node_shared_eris()) eri_comm = node_comm.leaders();
+
+        if(eri_comm != MPI_COMM_NULL) {
+          if(ham_gen.packed_eris())
+            bcast(ham_gen.V_packed_.data_handle(), ham_gen.V_packed_.size(),
+                  0, eri_comm);
+          else
+            bcast(ham_gen.V(), norb * norb * norb * norb, 0, eri_comm);
+        }
+        node_comm.barrier();
       }
 
       // Regenerate intermediates
-      ham_gen.generate_integral_intermediates(ham_gen.V_pqrs_);
+      if(ham_gen.packed_eris())
+        ham_gen.generate_integral_intermediates(ham_gen.V_packed_);
+      else
+        ham_gen.generate_integral_intermediates(ham_gen.V_pqrs_);
+
+      // Stored matrix elements are invalidated by the rotation
+      H_cache.reset();
 
       logger->trace("  * Rediagonalizing");
       auto rdg_st = hrt_t::now();
       std::vector<double> X_local;
-      selected_ci_diag(wfn.begin(), wfn.end(), ham_gen,
-                       mcscf_settings.ci_matel_tol,
-                       mcscf_settings.ci_max_subspace,
-                       mcscf_settings.ci_res_tol, X_local, comm);
+      selected_ci_diag<N, index_t>(
+          wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
+          mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol, X_local,
+          comm, false, nullptr, mcscf_settings.ci_balance_nnz,
+          mcscf_settings.ci_upper_h, "", mcscf_settings.ci_direct_h,
+          mcscf_settings.ci_mixed_h, mcscf_settings.ci_compressed_h);
 
       if(world_size > 1) {
-        // Broadcast X_local to X
-        const size_t wfn_size = wfn.size();
-        const size_t local_count = wfn_size / world_size;
-        X.resize(wfn.size());
-
-        MPI_Allgather(X_local.data(), local_count, MPI_DOUBLE, X.data(),
-                      local_count, MPI_DOUBLE, comm);
-        if(wfn_size % world_size) {
-          const size_t nrem = wfn_size % world_size;
-          auto* X_rem = X.data() + world_size * local_count;
-          if(world_rank == world_size - 1) {
-            const auto* X_loc_rem = X_local.data() + local_count;
-            std::copy_n(X_loc_rem, nrem, X_rem);
-          }
-          MPI_Bcast(X_rem, nrem, MPI_DOUBLE, world_size - 1, comm);
-        }
+        // Broadcast X_local to X (local extents follow the tiling of H)
+        X = allgatherv(X_local, comm);
       } else {
         // Avoid copy
         X = std::move(X_local);
@@ -17,43 +17,45 @@ template <size_t N, typename index_t = int32_t>
 auto asci_iter(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
                size_t ndets_max, double E0, std::vector<wfn_t<N>> wfn,
                std::vector<double> X, HamiltonianGenerator<N>& ham_gen,
-               size_t norb, MPI_Comm comm) {
+               size_t norb, MPI_Comm comm,
+               IncrementalHamiltonian<N, index_t>* H_cache = nullptr) {
   // Sort wfn on coefficient weights
   if(wfn.size() > 1) reorder_ci_on_coeff(wfn, X);
 
   // Sanity check on search determinants
   size_t nkeep = std::min(asci_settings.ncdets_max, wfn.size());
 
-  // Perform the ASCI search
-  wfn = asci_search(asci_settings, ndets_max, wfn.begin(), wfn.begin() + nkeep,
-                    E0, X, norb, ham_gen.T(), ham_gen.G_red(), ham_gen.V_red(),
-                    ham_gen.G(), ham_gen.V(), ham_gen, comm);
+  // Perform the ASCI search (over the ERI storage of the generator)
+  wfn = ham_gen.visit_eris([&](auto G, auto V) {
+    return asci_search(asci_settings, ndets_max, wfn.begin(),
+                       wfn.begin() + nkeep, E0, X, norb, ham_gen.T(),
+                       ham_gen.G_red(), ham_gen.V_red(), G, V, ham_gen, comm);
+  });
 
-  // Rediagonalize
+  // Coefficient ordered CDETS (appended by the search) first, followed by
+  // the remaining determinants clustered by their strings
+  if(asci_settings.locality_order) {
+    std::rotate(wfn.begin(), wfn.end() - nkeep, wfn.end());
+    std::vector<double> no_C;
+    reorder_ci_on_strings(wfn, no_C, nkeep);
+  }
+
+  // Rediagonalize (the incremental Hamiltonian stores the full matrix)
   std::vector<double> X_local;  // Precludes guess reuse
+  if(mcscf_settings.ci_upper_h or mcscf_settings.ci_direct_h or
+     mcscf_settings.ci_mixed_h or mcscf_settings.ci_compressed_h)
+    H_cache = nullptr;
   auto E = selected_ci_diag<N, index_t>(
       wfn.begin(), wfn.end(), ham_gen, mcscf_settings.ci_matel_tol,
-      mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol, X_local, comm);
+      mcscf_settings.ci_max_subspace, mcscf_settings.ci_res_tol, X_local, comm,
+      false, H_cache, mcscf_settings.ci_balance_nnz, mcscf_settings.ci_upper_h,
+      "", mcscf_settings.ci_direct_h, mcscf_settings.ci_mixed_h,
+      mcscf_settings.ci_compressed_h);
 
   auto world_size = comm_size(comm);
-  auto world_rank = comm_rank(comm);
   if(world_size > 1) {
-    // Broadcast X_local to X
-    const size_t wfn_size = wfn.size();
-    const size_t local_count = wfn_size / world_size;
-    X.resize(wfn.size());
-
-    MPI_Allgather(X_local.data(), local_count, MPI_DOUBLE, X.data(),
-                  local_count, MPI_DOUBLE, comm);
-    if(wfn_size % world_size) {
-      const size_t nrem = wfn_size % world_size;
-      auto* X_rem = X.data() + world_size * local_count;
-      if(world_rank == world_size - 1) {
-        const auto* X_loc_rem = X_local.data() + local_count;
-        std::copy_n(X_loc_rem, nrem, X_rem);
-      }
-      MPI_Bcast(X_rem, nrem, MPI_DOUBLE, world_size - 1, comm);
-    }
+    // Broadcast X_local to X (local extents follow the tiling of H)
+    X = allgatherv(X_local, comm);
   } else {
     // Avoid copy
     X = std::move(X_local);
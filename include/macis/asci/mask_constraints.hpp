@@ -27,9 +27,7 @@ auto make_triplet(unsigned i, unsigned j, unsigned k) {
 
   con.C = 0;
   con.C.flip(i).flip(j).flip(k);
-  con.B = 1;
-  con.B <<= k;
-  con.B = con.B.to_ullong() - 1;
+  con.B = full_mask<N>(k);
   con.C_min = k;
 
   return con;
@@ -41,9 +39,7 @@ auto make_quad(unsigned i, unsigned j, unsigned k, unsigned l) {
 
   con.C = 0;
   con.C.flip(i).flip(j).flip(k).flip(l);
-  con.B = 1;
-  con.B <<= l;
-  con.B = con.B.to_ullong() - 1;
+  con.B = full_mask<N>(l);
   con.C_min = l;
 
   return con;
@@ -290,12 +286,12 @@ void generate_constraint_singles_contributions_ss(
   }
 }
 
-template <size_t N>
+template <size_t N, typename Rank4>
 void generate_constraint_doubles_contributions_ss(
     double coeff, wfn_t<N> det, wfn_t<N> T, wfn_t<N> O_mask, wfn_t<N> B,
     wfn_t<N> os_det, const std::vector<uint32_t>& occ_same,
-    const std::vector<uint32_t>& occ_othr, const double* eps, const double* G,
-    const size_t LDG, double h_el_tol, double root_diag, double E0,
+    const std::vector<uint32_t>& occ_othr, const double* eps, Rank4 G,
+    double h_el_tol, double root_diag, double E0,
     HamiltonianGenerator<N>& ham_gen,
     asci_contrib_container<wfn_t<N>>& asci_contributions) {
   auto [O, V] = generate_constraint_double_excitations(det, T, O_mask, B);
@@ -303,19 +299,17 @@ void generate_constraint_doubles_contributions_ss(
   const auto nv_pairs = V.size();
   if(!no_pairs or !nv_pairs) return;
 
-  const size_t LDG2 = LDG * LDG;
   for(int _ij = 0; _ij < no_pairs; ++_ij) {
     const auto ij = O[_ij];
     const auto i = ffs(ij) - 1;
     const auto j = fls(ij);
-    const auto G_ij = G + (j + i * LDG2) * LDG;
     const auto ex_ij = det ^ ij;
     for(int _ab = 0; _ab < nv_pairs; ++_ab) {
       const auto ab = V[_ab];
       const auto a = ffs(ab) - 1;
       const auto b = fls(ab);
 
-      const auto G_aibj = G_ij[b + a * LDG2];
+      const auto G_aibj = G(b, j, a, i);
 
       // Early Exit
       if(std::abs(coeff * G_aibj) < h_el_tol) continue;
@@ -343,14 +337,14 @@ void generate_constraint_doubles_contributions_ss(
   }
 }
 
-template <size_t N>
+template <size_t N, typename Rank4>
 void generate_constraint_doubles_contributions_os(
     double coeff, wfn_t<N> det, wfn_t<N> T, wfn_t<N> O, wfn_t<N> B,
     wfn_t<N> os_det, const std::vector<uint32_t>& occ_same,
     const std::vector<uint32_t>& occ_othr,
     const std::vector<uint32_t>& vir_othr, const double* eps_same,
-    const double* eps_othr, const double* V, const size_t LDV, double h_el_tol,
-    double root_diag, double E0, HamiltonianGenerator<N>& ham_gen,
+    const double* eps_othr, Rank4 V, double h_el_tol, double root_diag,
+    double E0, HamiltonianGenerator<N>& ham_gen,
     asci_contrib_container<wfn_t<N>>& asci_contributions) {
   // Generate Single Excitations that Satisfy the Constraint
   auto [o, v] = generate_constraint_single_excitations(det, T, O, B);
@@ -358,7 +352,6 @@ void generate_constraint_doubles_contributions_os(
   const auto nv = v.count();
   if(!no or !nv) return;
 
-  const size_t LDV2 = LDV * LDV;
   for(int ii = 0; ii < no; ++ii) {
     const auto i = fls(o);
     o.flip(i);
@@ -367,13 +360,11 @@ void generate_constraint_doubles_contributions_os(
       const auto a = fls(v_cpy);
       v_cpy.flip(a);
 
-      const auto* V_ai = V + a + i * LDV;
       double sign_same = single_excitation_sign(det, a, i);
 
       for(auto j : occ_othr)
         for(auto b : vir_othr) {
-          const auto jb = b + j * LDV;
-          const auto V_aibj = V_ai[jb * LDV2];
+          const auto V_aibj = V(a, i, b, j);
 
           // Early Exist
           if(std::abs(coeff * V_aibj) < h_el_tol) continue;
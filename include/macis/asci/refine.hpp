@@ -35,11 +35,12 @@ auto asci_refine(ASCISettings asci_settings, MCSCFSettings mcscf_settings,
   // Refinement Loop
   const size_t ndets = wfn.size();
   bool converged = false;
+  IncrementalHamiltonian<N, index_t> H_cache(comm);
   for(size_t iter = 0; iter < asci_settings.max_refine_iter; ++iter) {
     double E;
     std::tie(E, wfn, X) = asci_iter<N, index_t>(
         asci_settings, mcscf_settings, ndets, E0, std::move(wfn), std::move(X),
-        ham_gen, norb, comm);
+        ham_gen, norb, comm, &H_cache);
     if(wfn.size() != ndets)
       throw std::runtime_error("Wavefunction size can't change in refinement");
 
@@ -7,12 +7,19 @@
  */
 
 #pragma once
+#include <algorithm>
+#include <array>
 #include <bit>
 #include <cassert>
 #include <climits>
+#include <cstring>
 #include <iostream>
 #include <macis/types.hpp>
 
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 namespace macis {
 
 /**
@@ -62,35 +69,63 @@ fls(Integral i) {
   return CHAR_BIT * sizeof(Integral) - clz(i) - 1;
 }
 
+/// Number of 64-bit words in the storage of a bitset of width `N`
+template <size_t N>
+inline constexpr size_t bitset_nwords = (N + 63) / 64;
+
+/// Array of 64-bit words holding the bits of a bitset of width `N`
+template <size_t N>
+using bitset_words_t = std::array<uint64_t, bitset_nwords<N>>;
+
+/**
+ *  @brief Word-level view of a bitset
+ *
+ *  Copies the storage of `bits` into an array of 64-bit words (least
+ *  significant word first). Bits beyond `N` in the last word are zero.
+ *  The copy is elided by the compiler for the widths of interest.
+ */
+template <size_t N>
+bitset_words_t<N> bitset_to_words(const std::bitset<N>& bits) {
+  static_assert(sizeof(std::bitset<N>) == sizeof(bitset_words_t<N>),
+                "Unsupported std::bitset Layout");
+  bitset_words_t<N> words;
+  std::memcpy(words.data(), &bits, sizeof(words));
+  return words;
+}
+
+/// Construct a bitset from its 64-bit words (inverse of bitset_to_words)
+template <size_t N>
+std::bitset<N> words_to_bitset(const bitset_words_t<N>& words) {
+  static_assert(sizeof(std::bitset<N>) == sizeof(bitset_words_t<N>),
+                "Unsupported std::bitset Layout");
+  std::bitset<N> bits;
+  std::memcpy(static_cast<void*>(&bits), words.data(), sizeof(words));
+  return bits;
+}
+
 /// Fast conversion of bitset to unsigned long long
 template <size_t N>
 unsigned long long fast_to_ullong(const std::bitset<N>& bits) {
-  // Low words
-  if constexpr(N == 64 or N == 128)
-    return *reinterpret_cast<const uint64_t*>(&bits);
-  if constexpr(N == 32) return *reinterpret_cast<const uint32_t*>(&bits);
-  return bits.to_ullong();
+  // Low word
+  return bitset_to_words(bits)[0];
 }
 
 /// Fast conversion of bitset to unsigned long
 template <size_t N>
 unsigned long fast_to_ulong(const std::bitset<N>& bits) {
   // Low words
-  if constexpr(N == 32 or N == 64 or N == 128)
-    return *reinterpret_cast<const uint32_t*>(&bits);
-  return bits.to_ulong();
+  return uint32_t(bitset_to_words(bits)[0]);
 }
 
 /// Conversion of bitset to uint128
 template <size_t N>
 uint128_t to_uint128(std::bitset<N> bits) {
   static_assert(N <= 128, "N > 128");
-  if constexpr(N == 128) {
-    auto _x = reinterpret_cast<uint128_t*>(&bits);
-    return *_x;
-  } else {
-    return fast_to_ullong(bits);
-  }
+  const auto words = bitset_to_words(bits);
+  if constexpr(N > 64)
+    return (uint128_t(words[1]) << 64) | words[0];
+  else
+    return words[0];
 }
 
 /**
@@ -108,17 +143,14 @@ uint128_t to_uint128(std::bitset<N> bits) {
 template <size_t N, size_t M = N>
 std::bitset<M> full_mask() {
   static_assert(M >= N, "M < N");
-  std::bitset<M> mask(0ul);
-  if constexpr(N == M / 2) {
-    if constexpr(N == 64) {
-      reinterpret_cast<uint64_t*>(&mask)[0] = UINT64_MAX;
-    } else if constexpr(N == 32) {
-      reinterpret_cast<uint32_t*>(&mask)[0] = UINT32_MAX;
-    } else
-      mask = (~mask) >> (M - N);
-    return mask;
-  } else
+  if constexpr(N % 64 == 0) {
+    bitset_words_t<M> words = {};
+    for(size_t i = 0; i < N / 64; ++i) words[i] = UINT64_MAX;
+    return words_to_bitset<M>(words);
+  } else {
+    std::bitset<M> mask(0ul);
     return (~mask) >> (M - N);
+  }
 }
 
 /**
@@ -157,18 +189,17 @@ uint32_t ffs(std::bitset<N> bits) {
   else if constexpr(N <= 64)
     return ffsll(fast_to_ullong(bits));
   else if constexpr(N <= 128) {
-    auto as_words = reinterpret_cast<uint64_t*>(&bits);
+    const auto as_words = bitset_to_words(bits);
     if(as_words[0])
       return ffsll(as_words[0]);
     else
       return ffsll(as_words[1]) + 64;
   } else {
-    uint32_t ind = 0;
-    for(ind = 0; ind < N; ++ind)
-      if(bits[ind]) return (ind + 1);
-    return ind;
+    const auto as_words = bitset_to_words(bits);
+    for(size_t i = 0; i < as_words.size(); ++i)
+      if(as_words[i]) return ffsll(as_words[i]) + 64 * i;
+    return 0;
   }
-  abort();
 }
 
 /**
@@ -187,33 +218,76 @@ uint32_t fls(std::bitset<N> bits) {
     return fls(fast_to_ulong(bits));
   else if constexpr(N <= 64)
     return fls(fast_to_ullong(bits));
-  else if constexpr(N <= 128) {
-    auto as_words = reinterpret_cast<uint64_t*>(&bits);
-    if(as_words[1])
-      return fls(as_words[1]) + 64;
-    else
-      return fls(as_words[0]);
+  else {
+    const auto as_words = bitset_to_words(bits);
+    for(size_t i = as_words.size() - 1; i > 0; --i)
+      if(as_words[i]) return fls(as_words[i]) + 64 * i;
+    return fls(as_words[0]);
+  }
+}
+
+/**
+ *  @brief Number of set bits strictly between two indices of a bitset
+ *
+ *  Counts the set bits of `bits` in the open interval (min(p,q), max(p,q))
+ *  with word-level masks and a hardware popcount. The 64- and 128-bit paths
+ *  are branch-free, wider bitsets are processed word-by-word.
+ *
+ *  @tparam `N` Width of bitset
+ *
+ *  @param[in] bits input bitset
+ *  @param[in] p    First (exclusive) bound
+ *  @param[in] q    Second (exclusive) bound
+ *  @returns Number of set bits of `bits` between `p` and `q`
+ */
+template <size_t N>
+uint32_t popcount_between(std::bitset<N> bits, unsigned p, unsigned q) {
+  const unsigned lo = std::min(p, q);
+  const unsigned hi = std::max(p, q);
+  assert(hi < N);
+  if constexpr(N <= 64) {
+    const uint64_t x = bits.to_ullong();  // Single word read for N <= 64
+    // Bits below hi, then clear bits at or below lo. 2 << 63 wraps to 0,
+    // which yields an empty range for lo == hi == 63.
+#ifdef __BMI2__
+    const uint64_t below_hi = _bzhi_u64(x, hi);
+#else
+    const uint64_t below_hi = x & ((uint64_t(1) << hi) - 1);
+#endif
+    return __builtin_popcountll(below_hi & ~((uint64_t(2) << lo) - 1));
+  } else if constexpr(N == 128) {
+    const uint128_t x = to_uint128(bits);
+    const uint128_t mask =
+        ((uint128_t(1) << hi) - 1) & ~((uint128_t(2) << lo) - 1);
+    const uint128_t r = x & mask;
+    return __builtin_popcountll(uint64_t(r)) +
+           __builtin_popcountll(uint64_t(r >> 64));
   } else {
-    uint32_t ind = 0;
-    for(ind = N - 1; ind >= 0; ind--)
-      if(bits[ind]) return ind;
-    return ind;
+    if(hi <= lo + 1) return 0;
+    const auto words = bitset_to_words(bits);
+    // Number of set bits below index k
+    auto prefix_count = [&](unsigned k) {
+      uint32_t c = 0;
+      for(unsigned i = 0; i < k / 64; ++i) c += __builtin_popcountll(words[i]);
+      if(k % 64) {
+        const uint64_t mask = (uint64_t(1) << (k % 64)) - 1;
+        c += __builtin_popcountll(words[k / 64] & mask);
+      }
+      return c;
+    };
+    return prefix_count(hi) - prefix_count(lo + 1);
   }
-  abort();
 }
 
 /// Convert bitset to a list of indices (inplace)
 template <size_t N>
 void bits_to_indices(std::bitset<N> bits, std::vector<uint32_t>& indices) {
   indices.clear();
-  auto c = bits.count();
-  indices.resize(c);
-  if(!c) return;
-  for(int i = 0; i < c; ++i) {
-    const auto ind = ffs(bits) - 1;
-    bits.flip(ind);
-    indices[i] = ind;
-  }
+  indices.reserve(bits.count());
+  const auto words = bitset_to_words(bits);
+  for(size_t i = 0; i < words.size(); ++i)
+    for(auto w = words[i]; w; w &= w - 1)
+      indices.push_back(64 * i + __builtin_ctzll(w));
 }
 
 /// Convert bitset to a list of indices (out-of-place)
@@ -230,17 +304,11 @@ inline std::bitset<N> truncate_bitset(std::bitset<M> bits) {
   static_assert(M >= N, "M < N");
   if constexpr(M == N) return bits;
 
-  const auto mask = full_mask<N, M>();
-  if constexpr(N <= 32) {
-    return (bits & mask).to_ulong();
-  } else if constexpr(N <= 64) {
-    return (bits & mask).to_ullong();
-  } else {
-    std::bitset<N> trunc_bits = 0;
-    for(size_t i = 0; i < N; ++i)
-      if(bits[i]) trunc_bits[i] = 1;
-    return trunc_bits;
-  }
+  const auto words = bitset_to_words(bits);
+  bitset_words_t<N> trunc_words;
+  std::copy_n(words.begin(), trunc_words.size(), trunc_words.begin());
+  if constexpr(N % 64) trunc_words.back() &= (uint64_t(1) << (N % 64)) - 1;
+  return words_to_bitset<N>(trunc_words);
 }
 
 /// Expand a bitset to one of larger width
@@ -249,39 +317,37 @@ inline std::bitset<N> expand_bitset(std::bitset<M> bits) {
   static_assert(N >= M, "N < M");
   if constexpr(M == N) return bits;
 
-  if constexpr(M <= 32) {
-    return bits.to_ulong();
-  } else if constexpr(M <= 64) {
-    return bits.to_ullong();
-  } else {
-    std::bitset<N> exp_bits = 0;
-    for(size_t i = 0; i < M; ++i)
-      if(bits[i]) exp_bits[i] = 1;
-    return exp_bits;
-  }
+  const auto words = bitset_to_words(bits);
+  bitset_words_t<N> exp_words = {};
+  std::copy(words.begin(), words.end(), exp_words.begin());
+  return words_to_bitset<N>(exp_words);
 }
 
 /// Extract to lo word of a bitset of even width
 template <size_t N>
 inline std::bitset<N / 2> bitset_lo_word(std::bitset<N> bits) {
-  static_assert(N == 128 or N == 64, "Not Supported");
-  if constexpr(N == 128) {
-    return std::bitset<64>(reinterpret_cast<uint64_t*>(&bits)[0]);
-  }
+  static_assert(N == 64 or N % 128 == 0, "Not Supported");
+  const auto words = bitset_to_words(bits);
   if constexpr(N == 64) {
-    return std::bitset<32>(reinterpret_cast<uint32_t*>(&bits)[0]);
+    return std::bitset<32>(uint32_t(words[0]));
+  } else {
+    bitset_words_t<N / 2> lo;
+    std::copy_n(words.begin(), lo.size(), lo.begin());
+    return words_to_bitset<N / 2>(lo);
   }
 }
 
 /// Extract to hi word of a bitset of even width
 template <size_t N>
 inline std::bitset<N / 2> bitset_hi_word(std::bitset<N> bits) {
-  static_assert(N == 128 or N == 64, "Not Supported");
-  if constexpr(N == 128) {
-    return std::bitset<64>(reinterpret_cast<uint64_t*>(&bits)[1]);
-  }
+  static_assert(N == 64 or N % 128 == 0, "Not Supported");
+  const auto words = bitset_to_words(bits);
   if constexpr(N == 64) {
-    return std::bitset<32>(reinterpret_cast<uint32_t*>(&bits)[1]);
+    return std::bitset<32>(uint32_t(words[0] >> 32));
+  } else {
+    bitset_words_t<N / 2> hi;
+    std::copy_n(words.begin() + hi.size(), hi.size(), hi.begin());
+    return words_to_bitset<N / 2>(hi);
   }
 }
 
@@ -292,17 +358,15 @@ bool bitset_less(std::bitset<N> x, std::bitset<N> y) {
     return fast_to_ulong(x) < fast_to_ulong(y);
   else if constexpr(N <= 64)
     return fast_to_ullong(x) < fast_to_ullong(y);
-  else if constexpr(N == 128) {
-    auto _x = reinterpret_cast<uint128_t*>(&x);
-    auto _y = reinterpret_cast<uint128_t*>(&y);
-    return *_x < *_y;
-  } else {
-    for(int i = N - 1; i >= 0; i--) {
-      if(x[i] ^ y[i]) return y[i];
-    }
+  else if constexpr(N == 128)
+    return to_uint128(x) < to_uint128(y);
+  else {
+    const auto x_words = bitset_to_words(x);
+    const auto y_words = bitset_to_words(y);
+    for(size_t i = x_words.size(); i-- > 0;)
+      if(x_words[i] != y_words[i]) return x_words[i] < y_words[i];
     return false;
   }
-  abort();
 }
 
 /// Bitwise less-than comparator for bitset
@@ -7,8 +7,15 @@
  */
 
 #pragma once
+#include <cstring>
 #include <macis/hamiltonian_generator.hpp>
 #include <macis/types.hpp>
+#include <macis/util/csr_assembly.hpp>
+#include <macis/util/mpi.hpp>
+#include <macis/wfn_index_map.hpp>
+#include <optional>
+#include <sparsexx/io/dist_checkpoint.hpp>
+#include <sparsexx/matrix_types/compressed_csr_matrix.hpp>
 #include <sparsexx/matrix_types/csr_matrix.hpp>
 #include <sparsexx/matrix_types/dist_sparse_matrix.hpp>
 
@@ -31,22 +38,163 @@ sparsexx::csr_matrix<double, index_t> make_csr_hamiltonian_block(
   }
 }
 
+/**
+ *  @brief Generate (a row batch of) the off-diagonal tile of the distributed
+ *  Hamiltonian.
+ *
+ *  Couples the bras [row_st, row_en) to the remote determinants
+ *  [0, bra_st) and [bra_en, ndets), where [bra_st, bra_en) are the local
+ *  rows. The remote determinants are processed as two contiguous ket ranges
+ *  and concatenated with global column indices. Hence the local
+ *  determinants are never visited as kets.
+ */
+template <typename index_t, size_t N>
+sparsexx::csr_matrix<double, index_t> make_csr_hamiltonian_offdiag_block(
+    wavefunction_iterator_t<N> sd_begin, wavefunction_iterator_t<N> sd_end,
+    size_t row_st, size_t row_en, size_t bra_st, size_t bra_en,
+    HamiltonianGenerator<N>& ham_gen, double H_thresh) {
+  using matrix_type = sparsexx::csr_matrix<double, index_t>;
+  const size_t ndets = std::distance(sd_begin, sd_end);
+  const size_t nrow = row_en - row_st;
+
+  std::vector<matrix_type> blocks;
+  if(bra_st > 0) {
+    auto H_lo = make_csr_hamiltonian_block<index_t>(
+        sd_begin + row_st, sd_begin + row_en, sd_begin, sd_begin + bra_st,
+        ham_gen, H_thresh);
+    blocks.emplace_back(nrow, ndets, std::move(H_lo.rowptr()),
+                        std::move(H_lo.colind()), std::move(H_lo.nzval()));
+  }
+
+  if(bra_en < ndets) {
+    auto H_hi = make_csr_hamiltonian_block<index_t>(
+        sd_begin + row_st, sd_begin + row_en, sd_begin + bra_en, sd_end,
+        ham_gen, H_thresh);
+
+    // Shift to global column indices
+    for(auto& j : H_hi.colind()) j += bra_en;
+    blocks.emplace_back(nrow, ndets, std::move(H_hi.rowptr()),
+                        std::move(H_hi.colind()), std::move(H_hi.nzval()));
+  }
+
+  if(blocks.empty())
+    return matrix_type(nrow, ndets, std::vector<index_t>(nrow + 1, 0), {},
+                       {});
+  return concatenate_csr_columns(ndets, std::move(blocks));
+}
+
+/// Off-diagonal tile of the local rows [bra_st, bra_en)
+template <typename index_t, size_t N>
+sparsexx::csr_matrix<double, index_t> make_csr_hamiltonian_offdiag_block(
+    wavefunction_iterator_t<N> sd_begin, wavefunction_iterator_t<N> sd_end,
+    size_t bra_st, size_t bra_en, HamiltonianGenerator<N>& ham_gen,
+    double H_thresh) {
+  return make_csr_hamiltonian_offdiag_block<index_t>(
+      sd_begin, sd_end, bra_st, bra_en, bra_st, bra_en, ham_gen, H_thresh);
+}
+
+/**
+ *  @brief Generate a row tiling which balances the (estimated) number of
+ *  nonzeros of H across ranks.
+ *
+ *  The number of nonzeros per row is estimated by counting, for `nsample`
+ *  evenly spaced rows, the determinants within a double excitation of the
+ *  row determinant. Each sample is taken to be representative of its
+ *  contiguous segment of rows. The samples are distributed across ranks.
+ *  Each rank is assigned at least one row if there are enough rows.
+ *
+ *  @param[in] comm     MPI communicator over which H is to be distributed
+ *  @param[in] sd_begin Start of the (replicated) determinant list
+ *  @param[in] sd_end   End of the determinant list
+ *  @param[in] nsample  Number of sampled rows
+ *  @returns   Row extents of each rank
+ */
+template <typename index_t, typename WfnIterator>
+std::vector<std::pair<index_t, index_t>> make_nnz_balanced_row_tiles(
+    MPI_Comm comm, WfnIterator sd_begin, WfnIterator sd_end,
+    size_t nsample = 1024) {
+  const size_t ndets = std::distance(sd_begin, sd_end);
+  const size_t world_size = comm_size(comm);
+  const size_t world_rank = comm_rank(comm);
+  if(world_size == 1 or ndets == 0) {
+    std::vector<std::pair<index_t, index_t>> tiles(world_size, {0, 0});
+    tiles.back().second = ndets;
+    return tiles;
+  }
+
+  // Sample segments [seg_st(s), seg_st(s+1)), sampled at their midpoint
+  nsample = std::clamp<size_t>(nsample, 1, ndets);
+  auto seg_st = [&](size_t s) { return (s * ndets) / nsample; };
+
+  std::vector<double> row_nnz(nsample, 0.0);
+  for(size_t s = world_rank; s < nsample; s += world_size) {
+    const auto bra = *(sd_begin + (seg_st(s) + seg_st(s + 1)) / 2);
+    size_t nconn = 0;
+#pragma omp parallel for reduction(+ : nconn)
+    for(size_t j = 0; j < ndets; ++j)
+      nconn += (bra ^ *(sd_begin + j)).count() <= 4;
+    row_nnz[s] = nconn;
+  }
+  allreduce(row_nnz.data(), nsample, MPI_SUM, comm);
+
+  double total_nnz = 0.0;
+  for(size_t s = 0; s < nsample; ++s)
+    total_nnz += row_nnz[s] * (seg_st(s + 1) - seg_st(s));
+
+  // Place cuts at equal fractions of the cumulative nonzero count
+  std::vector<size_t> cuts(world_size + 1, 0);
+  cuts.back() = ndets;
+  double cum_nnz = 0.0;
+  size_t s = 0;
+  for(size_t k = 1; k < world_size; ++k) {
+    const double target = (k * total_nnz) / world_size;
+    while(s < nsample and
+          cum_nnz + row_nnz[s] * (seg_st(s + 1) - seg_st(s)) < target) {
+      cum_nnz += row_nnz[s] * (seg_st(s + 1) - seg_st(s));
+      ++s;
+    }
+
+    size_t cut = ndets;
+    if(s < nsample)
+      cut = seg_st(s) + std::ceil((target - cum_nnz) / row_nnz[s]);
+
+    // At least one row per rank (if possible)
+    const size_t min_cut = std::min(cuts[k - 1] + 1, ndets);
+    const size_t max_cut = ndets > world_size - k ? ndets - (world_size - k)
+                                                  : min_cut;
+    cuts[k] = std::clamp(cut, min_cut, std::max(min_cut, max_cut));
+  }
+
+  std::vector<std::pair<index_t, index_t>> tiles(world_size);
+  for(size_t k = 0; k < world_size; ++k) tiles[k] = {cuts[k], cuts[k + 1]};
+  return tiles;
+}
+
 // Base implementation of dist-CSR H construction for bitsets
 template <typename index_t, size_t N>
 sparsexx::dist_sparse_matrix<sparsexx::csr_matrix<double, index_t>>
-make_dist_csr_hamiltonian(MPI_Comm comm, wavefunction_iterator_t<N> sd_begin,
-                          wavefunction_iterator_t<N> sd_end,
-                          HamiltonianGenerator<N>& ham_gen,
-                          const double H_thresh) {
+make_dist_csr_hamiltonian(
+    MPI_Comm comm, wavefunction_iterator_t<N> sd_begin,
+    wavefunction_iterator_t<N> sd_end, HamiltonianGenerator<N>& ham_gen,
+    const double H_thresh,
+    const std::vector<std::pair<index_t, index_t>>& row_tiles = {}) {
   using namespace sparsexx;
   using namespace sparsexx::detail;
+  using matrix_type = dist_sparse_matrix<csr_matrix<double, index_t>>;
 
+  // Default to a uniform row tiling
   size_t ndets = std::distance(sd_begin, sd_end);
-  dist_sparse_matrix<csr_matrix<double, index_t>> H_dist(comm, ndets, ndets);
+  matrix_type H_dist = row_tiles.size()
+                           ? matrix_type(comm, ndets, ndets, row_tiles)
+                           : matrix_type(comm, ndets, ndets);
 
   // Get local row bounds
   auto [bra_st, bra_en] = H_dist.row_bounds(get_mpi_rank(comm));
 
+  // Share the connectivity of the local rows across the tiles
+  ham_gen.cache_connectivity(sd_begin + bra_st, sd_begin + bra_en, sd_begin,
+                             sd_end);
+
   // Build diagonal part
   H_dist.set_diagonal_tile(make_csr_hamiltonian_block<index_t>(
       sd_begin + bra_st, sd_begin + bra_en, sd_begin + bra_st,
@@ -55,17 +203,416 @@ make_dist_csr_hamiltonian(MPI_Comm comm, wavefunction_iterator_t<N> sd_begin,
   auto world_size = get_mpi_size(comm);
 
   if(world_size > 1) {
-    // Create a copy of SD's with local bra dets zero'd out
-    std::vector<std::bitset<N>> sds_offdiag(sd_begin, sd_end);
-    for(auto i = bra_st; i < bra_en; ++i) sds_offdiag[i] = 0ul;
+    // Build off-diagonal part
+    H_dist.set_off_diagonal_tile(make_csr_hamiltonian_offdiag_block<index_t>(
+        sd_begin, sd_end, bra_st, bra_en, ham_gen, H_thresh));
+  }
+
+  ham_gen.release_connectivity();
+  return H_dist;
+}
+
+/**
+ *  @brief Generate the upper triangle (including the diagonal) of the
+ *  Hamiltonian over a determinant space.
+ *
+ *  The rows are processed in `nbatch` contiguous batches, each of which is
+ *  only coupled to the determinants at and beyond its first row, such that
+ *  (for large `nbatch`) roughly half of the determinant pairs are evaluated
+ *  compared to the full matrix.
+ */
+template <typename index_t, size_t N>
+sparsexx::csr_matrix<double, index_t> make_csr_hamiltonian_upper_block(
+    wavefunction_iterator_t<N> sd_begin, wavefunction_iterator_t<N> sd_end,
+    HamiltonianGenerator<N>& ham_gen, double H_thresh, size_t nbatch = 8) {
+  const size_t ndets = std::distance(sd_begin, sd_end);
+  nbatch = std::max<size_t>(1, std::min(nbatch, ndets));
+
+  std::vector<index_t> rowptr(ndets + 1), colind;
+  std::vector<double> nzval;
+  rowptr[0] = 0;
+
+  for(size_t ib = 0; ib < nbatch; ++ib) {
+    const size_t r_st = (ib * ndets) / nbatch;
+    const size_t r_en = ((ib + 1) * ndets) / nbatch;
+
+    // Rows [r_st, r_en) against columns [r_st, ndets)
+    auto H_blk = make_csr_hamiltonian_block<index_t>(
+        sd_begin + r_st, sd_begin + r_en, sd_begin + r_st, sd_end, ham_gen,
+        H_thresh);
+
+    // Keep the upper triangle, shifted to global column indices
+    for(size_t i = 0; i < r_en - r_st; ++i) {
+      for(auto j = H_blk.rowptr()[i]; j < H_blk.rowptr()[i + 1]; ++j)
+        if(size_t(H_blk.colind()[j]) >= i) {
+          colind.emplace_back(H_blk.colind()[j] + r_st);
+          nzval.emplace_back(H_blk.nzval()[j]);
+        }
+      rowptr[r_st + i + 1] = colind.size();
+    }
+  }
+
+  colind.shrink_to_fit();
+  nzval.shrink_to_fit();
+
+  return sparsexx::csr_matrix<double, index_t>(
+      ndets, ndets, std::move(rowptr), std::move(colind), std::move(nzval));
+}
+
+/**
+ *  @brief Generate the upper triangle of the distributed Hamiltonian for use
+ *  with symmetric SpMV (sparsexx::spblas::psyspmv).
+ *
+ *  The diagonal tile holds the upper triangle of the local diagonal block and
+ *  the off-diagonal tile only the couplings to determinants beyond the local
+ *  row block, such that each coupling is evaluated and stored once.
+ */
+template <typename index_t, size_t N>
+sparsexx::dist_sparse_matrix<sparsexx::csr_matrix<double, index_t>>
+make_dist_csr_hamiltonian_upper(MPI_Comm comm,
+                                wavefunction_iterator_t<N> sd_begin,
+                                wavefunction_iterator_t<N> sd_end,
+                                HamiltonianGenerator<N>& ham_gen,
+                                const double H_thresh, size_t nbatch = 8,
+                                const std::vector<std::pair<index_t, index_t>>&
+                                    row_tiles = {}) {
+  using namespace sparsexx;
+  using namespace sparsexx::detail;
+  using matrix_type = dist_sparse_matrix<csr_matrix<double, index_t>>;
+
+  // Default to a uniform row tiling
+  size_t ndets = std::distance(sd_begin, sd_end);
+  matrix_type H_dist = row_tiles.size()
+                           ? matrix_type(comm, ndets, ndets, row_tiles)
+                           : matrix_type(comm, ndets, ndets);
+
+  // Get local row bounds
+  auto [bra_st, bra_en] = H_dist.row_bounds(get_mpi_rank(comm));
+
+  // Share the connectivity of the local rows across the row batches
+  ham_gen.cache_connectivity(sd_begin + bra_st, sd_begin + bra_en, sd_begin,
+                             sd_end);
+
+  // Build diagonal part
+  H_dist.set_diagonal_tile(make_csr_hamiltonian_upper_block<index_t>(
+      sd_begin + bra_st, sd_begin + bra_en, ham_gen, H_thresh, nbatch));
+
+  auto world_size = get_mpi_size(comm);
+
+  if(world_size > 1) {
+    // Build off-diagonal part against the trailing determinants
+    auto H_off = make_csr_hamiltonian_block<index_t>(
+        sd_begin + bra_st, sd_begin + bra_en, sd_begin + bra_en, sd_end,
+        ham_gen, H_thresh);
+
+    // Shift to global column indices
+    for(auto& j : H_off.colind()) j += bra_en;
+    H_dist.set_off_diagonal_tile(csr_matrix<double, index_t>(
+        H_off.m(), ndets, std::move(H_off.rowptr()),
+        std::move(H_off.colind()), std::move(H_off.nzval())));
+  }
+
+  ham_gen.release_connectivity();
+  return H_dist;
+}
+
+/**
+ *  @brief Generate a single-precision Hamiltonian tile with its diagonal
+ *  elements split off in double precision.
+ *
+ *  The rows of the tile are generated in `nbatch` contiguous batches, each
+ *  of which is narrowed to single precision before the next one is
+ *  generated. Hence the double-precision intermediate is bounded by a single
+ *  row batch rather than the full tile.
+ *
+ *  @param[in]  nrow       Number of rows of the tile
+ *  @param[in]  ncol       Number of columns of the tile
+ *  @param[in]  col_st     Column index of the diagonal element of the first
+ *                         row
+ *  @param[out] D          Diagonal of the tile (length nrow, may be null if
+ *                         the tile has no diagonal elements, i.e. an
+ *                         off-diagonal tile)
+ *  @param[in]  nbatch     Number of row batches
+ *  @param[in]  make_block Callable `f(r_st, r_en)` which returns the rows
+ *                         [r_st, r_en) of the tile in double precision
+ */
+template <typename index_t, typename BlockGen>
+sparsexx::csr_matrix<float, index_t> make_mixed_precision_tile(
+    size_t nrow, size_t ncol, int64_t col_st, double* D, size_t nbatch,
+    BlockGen&& make_block) {
+  nbatch = std::max<size_t>(1, std::min(nbatch, nrow));
+
+  std::vector<index_t> rowptr(nrow + 1), colind;
+  std::vector<float> nzval;
+  rowptr[0] = 0;
+
+  for(size_t ib = 0; ib < nbatch; ++ib) {
+    const size_t r_st = (ib * nrow) / nbatch;
+    const size_t r_en = ((ib + 1) * nrow) / nbatch;
+    const auto A = make_block(r_st, r_en);
+    const auto indexing = A.indexing();
+    const auto& Arp = A.rowptr();
+    const auto& Aci = A.colind();
+    const auto& Anz = A.nzval();
+
+    for(size_t i = 0; i < r_en - r_st; ++i) {
+      const int64_t i_diag = col_st + r_st + i;
+      if(D) D[r_st + i] = 0.;
+      for(auto j = Arp[i] - indexing; j < Arp[i + 1] - indexing; ++j) {
+        if(D and Aci[j] - indexing == i_diag) {
+          D[r_st + i] = Anz[j];
+        } else {
+          colind.emplace_back(Aci[j] - indexing);
+          nzval.emplace_back(Anz[j]);
+        }
+      }
+      rowptr[r_st + i + 1] = colind.size();
+    }
+  }
+
+  colind.shrink_to_fit();
+  nzval.shrink_to_fit();
+
+  return sparsexx::csr_matrix<float, index_t>(
+      nrow, ncol, std::move(rowptr), std::move(colind), std::move(nzval));
+}
+
+/**
+ *  @brief Distributed Hamiltonian with single-precision off-diagonal
+ *  elements and a double-precision diagonal.
+ *
+ *  To be used with sparsexx::spblas::mixed_pgespmv which accumulates in
+ *  double precision.
+ */
+template <typename index_t>
+struct MixedPrecisionDistHamiltonian {
+  using matrix_type =
+      sparsexx::dist_sparse_matrix<sparsexx::csr_matrix<float, index_t>>;
+
+  matrix_type H;                ///< Off-diagonal elements (float)
+  std::vector<double> D_local;  ///< Local diagonal elements (double)
+
+  inline MPI_Comm comm() const { return H.comm(); }
+  inline auto m() const { return H.m(); }
+  inline auto n() const { return H.n(); }
+  inline auto nnz() const { return H.nnz() + D_local.size(); }
+  inline auto local_row_extent() const { return H.local_row_extent(); }
+  inline auto local_row_start() const { return H.local_row_start(); }
+  inline auto mem_footprint() const {
+    return H.mem_footprint() + D_local.capacity() * sizeof(double);
+  }
+};
+
+/**
+ *  @brief Generate a mixed-precision distributed Hamiltonian.
+ *
+ *  The Hamiltonian tiles are generated in `nbatch` row batches which are
+ *  split into a single-precision off-diagonal part and a double-precision
+ *  diagonal as they are generated (see make_mixed_precision_tile), such that
+ *  no full double-precision tile is ever formed.
+ */
+template <typename index_t, size_t N>
+MixedPrecisionDistHamiltonian<index_t> make_dist_csr_hamiltonian_mixed(
+    MPI_Comm comm, wavefunction_iterator_t<N> sd_begin,
+    wavefunction_iterator_t<N> sd_end, HamiltonianGenerator<N>& ham_gen,
+    const double H_thresh, size_t nbatch = 8,
+    const std::vector<std::pair<index_t, index_t>>& row_tiles = {}) {
+  using namespace sparsexx;
+  using namespace sparsexx::detail;
+  using matrix_type = dist_sparse_matrix<csr_matrix<float, index_t>>;
+
+  // Default to a uniform row tiling
+  size_t ndets = std::distance(sd_begin, sd_end);
+  MixedPrecisionDistHamiltonian<index_t> H_mixed{
+      row_tiles.size() ? matrix_type(comm, ndets, ndets, row_tiles)
+                       : matrix_type(comm, ndets, ndets),
+      {}};
+  auto& H_dist = H_mixed.H;
+
+  // Get local row bounds
+  auto [bra_st, bra_en] = H_dist.row_bounds(get_mpi_rank(comm));
+  const size_t nbra = bra_en - bra_st;
+  H_mixed.D_local.resize(nbra);
+
+  // Share the connectivity of the local rows across the row batches
+  ham_gen.cache_connectivity(sd_begin + bra_st, sd_begin + bra_en, sd_begin,
+                             sd_end);
+
+  // Build diagonal part
+  H_dist.set_diagonal_tile(make_mixed_precision_tile<index_t>(
+      nbra, nbra, 0, H_mixed.D_local.data(), nbatch,
+      [&](size_t r_st, size_t r_en) {
+        return make_csr_hamiltonian_block<index_t>(
+            sd_begin + bra_st + r_st, sd_begin + bra_st + r_en,
+            sd_begin + bra_st, sd_begin + bra_en, ham_gen, H_thresh);
+      }));
+
+  auto world_size = get_mpi_size(comm);
+
+  if(world_size > 1) {
+    // Build off-diagonal part
+    H_dist.set_off_diagonal_tile(make_mixed_precision_tile<index_t>(
+        nbra, ndets, 0, nullptr, nbatch, [&](size_t r_st, size_t r_en) {
+          return make_csr_hamiltonian_offdiag_block<index_t>(
+              sd_begin, sd_end, bra_st + r_st, bra_st + r_en, bra_st, bra_en,
+              ham_gen, H_thresh);
+        }));
+  }
+
+  ham_gen.release_connectivity();
+  return H_mixed;
+}
+
+/**
+ *  @brief Generate a distributed Hamiltonian with compressed column indices.
+ *
+ *  Each tile is generated in standard CSR format and compressed immediately,
+ *  such that at most one uncompressed tile is held in memory at once. Column
+ *  gaps which are not representable by offset_t are escaped (see
+ *  sparsexx::compressed_csr_matrix).
+ */
+template <typename index_t, typename offset_t, size_t N>
+sparsexx::dist_sparse_matrix<
+    sparsexx::compressed_csr_matrix<double, index_t, offset_t>>
+make_dist_csr_hamiltonian_compressed(
+    MPI_Comm comm, wavefunction_iterator_t<N> sd_begin,
+    wavefunction_iterator_t<N> sd_end, HamiltonianGenerator<N>& ham_gen,
+    const double H_thresh,
+    const std::vector<std::pair<index_t, index_t>>& row_tiles = {}) {
+  using namespace sparsexx;
+  using namespace sparsexx::detail;
+  using tile_type = compressed_csr_matrix<double, index_t, offset_t>;
+  using matrix_type = dist_sparse_matrix<tile_type>;
+
+  // Default to a uniform row tiling
+  size_t ndets = std::distance(sd_begin, sd_end);
+  matrix_type H_dist = row_tiles.size()
+                           ? matrix_type(comm, ndets, ndets, row_tiles)
+                           : matrix_type(comm, ndets, ndets);
+
+  // Get local row bounds
+  auto [bra_st, bra_en] = H_dist.row_bounds(get_mpi_rank(comm));
+
+  // Share the connectivity of the local rows across the tiles
+  ham_gen.cache_connectivity(sd_begin + bra_st, sd_begin + bra_en, sd_begin,
+                             sd_end);
 
+  // Build diagonal part
+  H_dist.set_diagonal_tile(tile_type(make_csr_hamiltonian_block<index_t>(
+      sd_begin + bra_st, sd_begin + bra_en, sd_begin + bra_st,
+      sd_begin + bra_en, ham_gen, H_thresh)));
+
+  auto world_size = get_mpi_size(comm);
+
+  if(world_size > 1) {
     // Build off-diagonal part
-    H_dist.set_off_diagonal_tile(make_csr_hamiltonian_block<index_t>(
-        sd_begin + bra_st, sd_begin + bra_en, sds_offdiag.begin(),
-        sds_offdiag.end(), ham_gen, H_thresh));
+    H_dist.set_off_diagonal_tile(
+        tile_type(make_csr_hamiltonian_offdiag_block<index_t>(
+            sd_begin, sd_end, bra_st, bra_en, ham_gen, H_thresh)));
   }
 
+  ham_gen.release_connectivity();
   return H_dist;
 }
 
+namespace detail {
+
+inline uint64_t fingerprint_doubles(uint64_t h, const double* x, size_t n) {
+  for(size_t i = 0; i < n; ++i) {
+    uint64_t w;
+    std::memcpy(&w, x + i, sizeof(w));
+    h = hash_mix64(h ^ w);
+  }
+  return h;
+}
+
+}  // namespace detail
+
+/**
+ *  @brief Fingerprint of the inputs which determine a Hamiltonian: the
+ *  (ordered) determinant space, the integrals held by the generator and the
+ *  matrix element threshold.
+ *
+ *  Used to reject checkpoints of a different Hamiltonian on restart (see
+ *  make_dist_csr_hamiltonian_checkpointed).
+ */
+template <size_t N>
+uint64_t hamiltonian_fingerprint(wavefunction_iterator_t<N> sd_begin,
+                                 wavefunction_iterator_t<N> sd_end,
+                                 const HamiltonianGenerator<N>& ham_gen,
+                                 double H_thresh) {
+  const size_t norb = ham_gen.norb_;
+  uint64_t h = hash_mix64(N ^ hash_mix64(std::distance(sd_begin, sd_end)));
+  for(auto it = sd_begin; it != sd_end; ++it)
+    h = hash_mix64(h ^ wfn_hash<N>{}(*it));
+
+  h = detail::fingerprint_doubles(h, ham_gen.T(), norb * norb);
+  if(ham_gen.packed_eris())
+    h = detail::fingerprint_doubles(h, ham_gen.V_packed_.data_handle(),
+                                    ham_gen.V_packed_.size());
+  else
+    h = detail::fingerprint_doubles(h, ham_gen.V(), norb * norb * norb * norb);
+  return detail::fingerprint_doubles(h, &H_thresh, 1);
+}
+
+/**
+ *  @brief Reload the distributed Hamiltonian from a checkpoint, or generate
+ *  it and write the checkpoint if no matching checkpoint exists.
+ *
+ *  A checkpoint is only reused if it was written on the same number of
+ *  ranks with the same fingerprint (see hamiltonian_fingerprint) and row
+ *  tiling on every rank. Otherwise H is generated by
+ *  make_dist_csr_hamiltonian (or make_dist_csr_hamiltonian_upper if
+ *  `upper` is set) and written, together with its SpMV communication info,
+ *  to `<prefix>.<rank>.bin`. The (reloaded or generated) SpMV info is
+ *  returned in `spmv_info` if requested.
+ */
+template <typename index_t, size_t N>
+sparsexx::dist_sparse_matrix<sparsexx::csr_matrix<double, index_t>>
+make_dist_csr_hamiltonian_checkpointed(
+    const std::string& prefix, MPI_Comm comm,
+    wavefunction_iterator_t<N> sd_begin, wavefunction_iterator_t<N> sd_end,
+    HamiltonianGenerator<N>& ham_gen, const double H_thresh,
+    const std::vector<std::pair<index_t, index_t>>& row_tiles = {},
+    bool upper = false,
+    sparsexx::spblas::spmv_info<index_t>* spmv_info = nullptr) {
+  using matrix_type =
+      sparsexx::dist_sparse_matrix<sparsexx::csr_matrix<double, index_t>>;
+
+  const size_t ndets = std::distance(sd_begin, sd_end);
+  const auto fingerprint = hash_mix64(
+      hamiltonian_fingerprint(sd_begin, sd_end, ham_gen, H_thresh) ^ upper);
+
+  std::optional<matrix_type> H;
+  sparsexx::spblas::spmv_info<index_t> info;
+  try {
+    H.emplace(sparsexx::read_dist_checkpoint<typename matrix_type::tile_type>(
+        prefix, comm, &info, fingerprint));
+  } catch(const std::runtime_error&) {
+  }
+
+  // The reloaded row tiling must match the requested one
+  if(H) {
+    const auto tiling = row_tiles.size()
+                            ? matrix_type(comm, ndets, ndets, row_tiles)
+                            : matrix_type(comm, ndets, ndets);
+    for(int i = 0; H and i < comm_size(comm); ++i)
+      if(H->row_bounds(i) != tiling.row_bounds(i)) H.reset();
+  }
+
+  if(!allreduce(size_t(H.has_value()), MPI_MIN, comm)) {
+    H.emplace(upper ? make_dist_csr_hamiltonian_upper<index_t>(
+                          comm, sd_begin, sd_end, ham_gen, H_thresh, 8,
+                          row_tiles)
+                    : make_dist_csr_hamiltonian<index_t>(
+                          comm, sd_begin, sd_end, ham_gen, H_thresh,
+                          row_tiles));
+    info = sparsexx::spblas::generate_spmv_comm_info(*H);
+    sparsexx::write_dist_checkpoint(prefix, *H, &info, fingerprint);
+  }
+
+  if(spmv_info) *spmv_info = std::move(info);
+  return std::move(*H);
+}
+
 }  // namespace macis
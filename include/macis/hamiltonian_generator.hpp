@@ -10,6 +10,9 @@
 #include <macis/bitset_operations.hpp>
 #include <macis/sd_operations.hpp>
 #include <macis/types.hpp>
+#include <macis/util/mpi.hpp>
+#include <macis/util/packed_eris.hpp>
+#include <macis/util/packed_rdms.hpp>
 #include <sparsexx/matrix_types/csr_matrix.hpp>
 
 namespace macis {
@@ -32,6 +35,8 @@ class HamiltonianGenerator {
   using matrix_span_t = matrix_span<double>;
   using rank3_span_t = rank3_span<double>;
   using rank4_span_t = rank4_span<double>;
+  using packed_rank4_span_t = packed_rank4_span<double>;
+  using packed_eri_span_t = packed_eri_span<double>;
 
  public:
   inline spin_det_t alpha_string(full_det_t str) { return bitset_lo_word(str); }
@@ -43,10 +48,17 @@ class HamiltonianGenerator {
   matrix_span_t T_pq_;
   rank4_span_t V_pqrs_;
 
+  // Packed (ij|kl), replaces V_pqrs_ and G_pqrs_ if populated
+  packed_eri_span_t V_packed_;
+
   // G(i,j,k,l) = (ij|kl) - (il|kj)
   std::vector<double> G_pqrs_data_;
   rank4_span_t G_pqrs_;
 
+  // Node decomposition if the ERIs (and G) are held once per node
+  mpi_node_comm node_comm_;
+  mpi_shared_buffer<double> G_pqrs_shared_;
+
   // G_red(i,j,k) = G(i,j,k,k)
   std::vector<double> G_red_data_;
   rank3_span_t G_red_;
@@ -63,6 +75,20 @@ class HamiltonianGenerator {
   std::vector<double> V2_red_data_;
   matrix_span_t V2_red_;
 
+  template <typename Rank4G, typename Rank4V>
+  void generate_reduced_intermediates_(Rank4G G, Rank4V V);
+
+  /// G(p,q,r,s) from either ERI storage
+  inline double G_elem(size_t p, size_t q, size_t r, size_t s) const {
+    return packed_eris() ? V_packed_(p, q, r, s) - V_packed_(p, s, r, q)
+                         : G_pqrs_(p, q, r, s);
+  }
+
+  /// (pq|rs) from either ERI storage
+  inline double V_elem(size_t p, size_t q, size_t r, size_t s) const {
+    return packed_eris() ? V_packed_(p, q, r, s) : V_pqrs_(p, q, r, s);
+  }
+
   virtual sparse_matrix_type<int32_t> make_csr_hamiltonian_block_32bit_(
       full_det_iterator, full_det_iterator, full_det_iterator,
       full_det_iterator, double) = 0;
@@ -71,16 +97,96 @@ class HamiltonianGenerator {
       full_det_iterator, full_det_iterator, full_det_iterator,
       full_det_iterator, double) = 0;
 
+  virtual void form_rdms_(full_det_iterator, full_det_iterator,
+                          full_det_iterator, full_det_iterator,
+                          const double* C_bra, const double* C_ket,
+                          matrix_span_t ordm, rank4_span_t trdm) = 0;
+
+  virtual void form_rdms_(full_det_iterator, full_det_iterator,
+                          full_det_iterator, full_det_iterator,
+                          const double* C_bra, const double* C_ket,
+                          matrix_span_t ordm, packed_rank4_span_t trdm) = 0;
+
+  template <typename Rank4>
+  void form_rdms_dist_(full_det_iterator begin, full_det_iterator end,
+                       const double* C, matrix_span_t ordm, Rank4 trdm,
+                       MPI_Comm comm) {
+    const size_t ndets = std::distance(begin, end);
+    const size_t world_rank = comm_rank(comm);
+    const size_t world_size = comm_size(comm);
+    const size_t bra_st = (world_rank * ndets) / world_size;
+    const size_t bra_en = ((world_rank + 1) * ndets) / world_size;
+
+    std::fill_n(ordm.data_handle(), ordm.size(), 0.0);
+    if(trdm.data_handle()) std::fill_n(trdm.data_handle(), trdm.size(), 0.0);
+
+    form_rdms_(begin + bra_st, begin + bra_en, begin, end, C + bra_st, C,
+               ordm, trdm);
+
+    if(world_size > 1) {
+      allreduce(ordm.data_handle(), ordm.size(), MPI_SUM, comm);
+      if(trdm.data_handle())
+        allreduce(trdm.data_handle(), trdm.size(), MPI_SUM, comm);
+    }
+  }
+
  public:
-  HamiltonianGenerator(matrix_span_t T, rank4_span_t V);
+  /**
+   *  @brief Construct from dense ERIs.
+   *
+   *  If `node_comm` describes a node decomposition, `V` is assumed to be
+   *  held once per node (e.g. in an `mpi_shared_buffer`) and G is allocated
+   *  in a shared window, which is populated by the node leader. T and the
+   *  3-index intermediates are held per rank. `node_comm` must decompose
+   *  the communicator passed to the distributed drivers (e.g. `asci_grow`).
+   *  Collective over `node_comm.node()`.
+   */
+  HamiltonianGenerator(matrix_span_t T, rank4_span_t V,
+                       mpi_node_comm node_comm = mpi_node_comm());
+
+  /**
+   *  @brief Construct from 8-fold symmetry packed ERIs.
+   *
+   *  Neither dense ERIs nor the dense G tensor are held, such that the
+   *  4-index storage is reduced by a factor of ~16 over the dense mode.
+   *  Requires real orbitals. See above for `node_comm`.
+   */
+  HamiltonianGenerator(matrix_span_t T, packed_eri_span_t V,
+                       mpi_node_comm node_comm = mpi_node_comm());
+
   virtual ~HamiltonianGenerator() noexcept = default;
 
   void generate_integral_intermediates(rank4_span_t V);
+  void generate_integral_intermediates(packed_eri_span_t V);
+
+  /// Whether the ERIs are held in packed storage
+  inline bool packed_eris() const { return V_packed_.data_handle(); }
+
+  /// Whether the ERIs are held once per node (only leaders may modify them)
+  inline bool node_shared_eris() const { return bool(node_comm_); }
+
+  /// Node decomposition over which the ERIs are shared
+  inline const mpi_node_comm& node_comm() const { return node_comm_; }
+
+  /**
+   *  @brief Invoke `f(G, V)` with views of the antisymmetrized ERIs G and
+   *  the ERIs V of the active storage mode.
+   *
+   *  Both views are indexed as `G(p,q,r,s)`. Dense storage is passed as
+   *  `rank4_span`, packed storage as `packed_antisym_eri_view` /
+   *  `packed_eri_span`. All instantiations of `f` must share a return type.
+   */
+  template <typename Functor>
+  decltype(auto) visit_eris(Functor&& f) const {
+    if(packed_eris())
+      return f(packed_antisym_eri_view<double>(V_packed_), V_packed_);
+    return f(G_pqrs_, V_pqrs_);
+  }
 
   inline auto* T() const { return T_pq_.data_handle(); }
   inline auto* G_red() const { return G_red_data_.data(); }
   inline auto* V_red() const { return V_red_data_.data(); }
-  inline auto* G() const { return G_pqrs_data_.data(); }
+  inline auto* G() const { return G_pqrs_.data_handle(); }
   inline auto* V() const { return V_pqrs_.data_handle(); }
 
   double matrix_element_4(spin_det_t bra, spin_det_t ket, spin_det_t ex) const;
@@ -137,6 +243,18 @@ class HamiltonianGenerator {
                              uint32_t orb_paru, uint32_t orb_pard,
                              double orig_det_Hii) const;
 
+  /// Diagonal element of `det` from that of a connected (up to double)
+  /// determinant `orig_det` in O(nocc)
+  double fast_diag(full_det_t orig_det, full_det_t det,
+                   const std::vector<uint32_t>& orig_occ_alpha,
+                   const std::vector<uint32_t>& orig_occ_beta,
+                   double orig_det_Hii) const;
+
+  /// Diagonal elements of a determinant list, updated incrementally
+  /// between neighbouring determinants
+  void diagonal_elements(full_det_iterator dets_begin,
+                         full_det_iterator dets_end, double* D) const;
+
   double matrix_element(full_det_t bra, full_det_t ket) const;
 
   template <typename index_t>
@@ -155,6 +273,24 @@ class HamiltonianGenerator {
     }
   }
 
+  /**
+   *  @brief Precompute the connectivity between a bra and a ket determinant
+   *  range for reuse across blocks.
+   *
+   *  Subsequent blocks (Hamiltonian or RDM) whose bra and ket ranges lie
+   *  within the cached ranges reuse the cached connectivity rather than
+   *  regenerating it. The determinants must remain unchanged until
+   *  `release_connectivity` is called. Replaces any previous cache.
+   *  Generators which do not precompute connectivity ignore the cache.
+   */
+  virtual void cache_connectivity(full_det_iterator /*bra_begin*/,
+                                  full_det_iterator /*bra_end*/,
+                                  full_det_iterator /*ket_begin*/,
+                                  full_det_iterator /*ket_end*/) {}
+
+  /// Release the connectivity stored by `cache_connectivity`
+  virtual void release_connectivity() {}
+
   void rdm_contributions_4(spin_det_t bra, spin_det_t ket, spin_det_t ex,
                            double val, rank4_span_t trdm);
   void rdm_contributions_22(spin_det_t bra_alpha, spin_det_t ket_alpha,
@@ -176,9 +312,67 @@ class HamiltonianGenerator {
                          const std::vector<uint32_t>& bra_occ_beta, double val,
                          matrix_span_t ordm, rank4_span_t trdm);
 
-  virtual void form_rdms(full_det_iterator, full_det_iterator,
-                         full_det_iterator, full_det_iterator, double* C,
-                         matrix_span_t ordm, rank4_span_t trdm) = 0;
+  /**
+   *  @brief Accumulate the RDM contributions of a bra / ket block.
+   *
+   *  `C` is indexed by the bra and ket offsets relative to `bra_begin` and
+   *  `ket_begin`, respectively, i.e. the bra and ket ranges are assumed to
+   *  refer to the same expansion vector.
+   */
+  void form_rdms(full_det_iterator bra_begin, full_det_iterator bra_end,
+                 full_det_iterator ket_begin, full_det_iterator ket_end,
+                 double* C, matrix_span_t ordm, rank4_span_t trdm) {
+    form_rdms_(bra_begin, bra_end, ket_begin, ket_end, C, C, ordm, trdm);
+  }
+
+  /// Accumulate the RDM contributions of a bra / ket block (packed 2-RDM)
+  void form_rdms(full_det_iterator bra_begin, full_det_iterator bra_end,
+                 full_det_iterator ket_begin, full_det_iterator ket_end,
+                 double* C, matrix_span_t ordm, packed_rank4_span_t trdm) {
+    form_rdms_(bra_begin, bra_end, ket_begin, ket_end, C, C, ordm, trdm);
+  }
+
+  /**
+   *  @brief Form the RDMs of a (replicated) wave function in parallel.
+   *
+   *  The bra determinants are partitioned into contiguous blocks over the
+   *  ranks of `comm`, each of which is contracted against the full
+   *  determinant list and the partial RDMs allreduced. `ordm` / `trdm` are
+   *  overwritten on all ranks. The 2-RDM is skipped if `trdm` is null.
+   *
+   *  @param[in]  begin Start of the determinant list
+   *  @param[in]  end   End of the determinant list
+   *  @param[in]  C     Full (replicated) expansion coefficients
+   *  @param[out] ordm  1-RDM
+   *  @param[out] trdm  2-RDM (may be null)
+   *  @param[in]  comm  MPI communicator
+   */
+  void form_rdms(full_det_iterator begin, full_det_iterator end,
+                 const double* C, matrix_span_t ordm, rank4_span_t trdm,
+                 MPI_Comm comm) {
+    form_rdms_dist_(begin, end, C, ordm, trdm, comm);
+  }
+
+  /**
+   *  @brief Form the RDMs of a (replicated) wave function in parallel with
+   *  8-fold symmetry packed 2-RDM storage (see `packed_rank4_span`).
+   */
+  void form_rdms(full_det_iterator begin, full_det_iterator end,
+                 const double* C, matrix_span_t ordm,
+                 packed_rank4_span_t trdm, MPI_Comm comm) {
+    form_rdms_dist_(begin, end, C, ordm, trdm, comm);
+  }
+
+  /**
+   *  @brief Form the 1-RDM of a (replicated) wave function in parallel.
+   *
+   *  Only diagonal and singly excited determinant pairs are visited and no
+   *  2-RDM storage is required. Data distribution follows `form_rdms`.
+   */
+  void form_ordm(full_det_iterator begin, full_det_iterator end,
+                 const double* C, matrix_span_t ordm, MPI_Comm comm) {
+    form_rdms(begin, end, C, ordm, rank4_span_t(nullptr, 0, 0, 0, 0), comm);
+  }
 
   void rotate_hamiltonian_ordm(const double* ordm);
 
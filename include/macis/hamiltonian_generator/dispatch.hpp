@@ -0,0 +1,77 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <macis/hamiltonian_generator/double_loop.hpp>
+#include <macis/hamiltonian_generator/residue_arrays.hpp>
+#include <macis/hamiltonian_generator/string_factored.hpp>
+#include <macis/util/mcscf.hpp>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace macis {
+
+/// Compile-time Hamiltonian generator tag passed by
+/// `dispatch_hamiltonian_generator`
+template <typename Generator>
+struct hamiltonian_generator_t {
+  using type = Generator;
+};
+
+/**
+ *  @brief Parse a Hamiltonian generator name (DOUBLE_LOOP, STRING_FACTORED
+ *  or RESIDUE_ARRAYS).
+ *
+ *  Throws if the name is not recognized.
+ */
+inline HamiltonianGeneratorType hamiltonian_generator_type(
+    const std::string& name) {
+  static const std::map<std::string, HamiltonianGeneratorType> type_map = {
+      {"DOUBLE_LOOP", HamiltonianGeneratorType::DoubleLoop},
+      {"STRING_FACTORED", HamiltonianGeneratorType::StringFactored},
+      {"RESIDUE_ARRAYS", HamiltonianGeneratorType::ResidueArrays}};
+  auto it = type_map.find(name);
+  if(it == type_map.end())
+    throw std::runtime_error("Hamiltonian Generator Not Recognized");
+  return it->second;
+}
+
+/**
+ *  @brief Invoke a generic callable with the Hamiltonian generator type
+ *  selected at runtime, e.g.
+ *
+ *    dispatch_hamiltonian_generator<N>(type, [&](auto gen) {
+ *      using generator_t = typename decltype(gen)::type;
+ *      generator_t ham_gen(...);
+ *    });
+ *
+ *  @tparam N Determinant width in bits
+ *
+ *  @param[in] type Hamiltonian generator to select
+ *  @param[in] f    Callable invoked as
+ *                  `f(hamiltonian_generator_t<Gen<N>>{})`. All
+ *                  instantiations must share a return type.
+ *  @returns The result of `f`
+ */
+template <size_t N, typename Functor>
+decltype(auto) dispatch_hamiltonian_generator(HamiltonianGeneratorType type,
+                                              Functor&& f) {
+  switch(type) {
+    case HamiltonianGeneratorType::StringFactored:
+      return f(
+          hamiltonian_generator_t<StringFactoredHamiltonianGenerator<N>>{});
+    case HamiltonianGeneratorType::ResidueArrays:
+      return f(
+          hamiltonian_generator_t<ResidueArraysHamiltonianGenerator<N>>{});
+    default:
+      return f(hamiltonian_generator_t<DoubleLoopHamiltonianGenerator<N>>{});
+  }
+}
+
+}  // namespace macis
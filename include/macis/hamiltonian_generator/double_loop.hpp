@@ -9,6 +9,7 @@
 #pragma once
 #include <macis/hamiltonian_generator.hpp>
 #include <macis/sd_operations.hpp>
+#include <macis/util/csr_assembly.hpp>
 #include <macis/util/rdms.hpp>
 
 namespace macis {
@@ -22,6 +23,7 @@ class DoubleLoopHamiltonianGenerator : public HamiltonianGenerator<N> {
   using full_det_iterator = typename base_type::full_det_iterator;
   using matrix_span_t = typename base_type::matrix_span_t;
   using rank4_span_t = typename base_type::rank4_span_t;
+  using packed_rank4_span_t = typename base_type::packed_rank4_span_t;
 
   template <typename index_t>
   using sparse_matrix_type = sparsexx::csr_matrix<double, index_t>;
@@ -34,20 +36,16 @@ class DoubleLoopHamiltonianGenerator : public HamiltonianGenerator<N> {
     const size_t nbra_dets = std::distance(bra_begin, bra_end);
     const size_t nket_dets = std::distance(ket_begin, ket_end);
 
-    std::vector<index_t> colind, rowptr(nbra_dets + 1);
-    std::vector<double> nzval;
+    // Rows are generated in parallel into per-thread buffers and scattered
+    // into the final CSR arrays (see assemble_csr_by_rows)
+    auto make_row_gen = [&]() {
+      return [&, bra_occ_alpha = std::vector<uint32_t>(),
+              bra_occ_beta = std::vector<uint32_t>()](
+                 size_t i, std::vector<index_t>& colind,
+                 std::vector<double>& nzval) mutable {
+        const auto bra = *(bra_begin + i);
+        if(!bra.count()) return;
 
-    std::vector<uint32_t> bra_occ_alpha, bra_occ_beta;
-
-    rowptr[0] = 0;
-
-    // Loop over bra determinants
-    for(size_t i = 0; i < nbra_dets; ++i) {
-      // if( (i%1000) == 0 ) std::cout << i << ", " << rowptr[i] << std::endl;
-      const auto bra = *(bra_begin + i);
-
-      size_t nrow = 0;
-      if(bra.count()) {
         // Separate out into alpha/beta components
         spin_det_t bra_alpha = bitset_lo_word(bra);
         spin_det_t bra_beta = bitset_hi_word(bra);
@@ -74,7 +72,6 @@ class DoubleLoopHamiltonianGenerator : public HamiltonianGenerator<N> {
                   bra_occ_alpha, bra_occ_beta);
 
               if(std::abs(h_el) > H_thresh) {
-                nrow++;
                 colind.emplace_back(j);
                 nzval.emplace_back(h_el);
               }
@@ -83,18 +80,10 @@ class DoubleLoopHamiltonianGenerator : public HamiltonianGenerator<N> {
 
           }  // Non-zero ket determinant
         }    // Loop over ket determinants
+      };
+    };
 
-      }  // Non-zero bra determinant
-
-      rowptr[i + 1] = rowptr[i] + nrow;  // Update rowptr
-
-    }  // Loop over bra determinants
-
-    colind.shrink_to_fit();
-    nzval.shrink_to_fit();
-
-    return sparse_matrix_type<index_t>(nbra_dets, nket_dets, std::move(rowptr),
-                                       std::move(colind), std::move(nzval));
+    return assemble_csr_by_rows<index_t>(nbra_dets, nket_dets, make_row_gen);
   }
 
   sparse_matrix_type<int32_t> make_csr_hamiltonian_block_32bit_(
@@ -113,20 +102,35 @@ class DoubleLoopHamiltonianGenerator : public HamiltonianGenerator<N> {
                                                 ket_end, H_thresh);
   }
 
- public:
-  void form_rdms(full_det_iterator bra_begin, full_det_iterator bra_end,
-                 full_det_iterator ket_begin, full_det_iterator ket_end,
-                 double *C, matrix_span_t ordm, rank4_span_t trdm) override {
+ protected:
+  template <typename Rank4>
+  void form_rdms_impl_(full_det_iterator bra_begin, full_det_iterator bra_end,
+                       full_det_iterator ket_begin, full_det_iterator ket_end,
+                       const double *C_bra, const double *C_ket,
+                       matrix_span_t ordm, Rank4 trdm) {
     const size_t nbra_dets = std::distance(bra_begin, bra_end);
     const size_t nket_dets = std::distance(ket_begin, ket_end);
 
-    std::vector<uint32_t> bra_occ_alpha, bra_occ_beta;
+    // Doubles only contribute to the 2-RDM
+    const size_t max_ex = trdm.data_handle() ? 4 : 2;
+
+    // Rows whose largest contribution falls below the coefficient threshold
+    // are skipped before the ket scan
+    double max_c_ket = 0.0;
+    for(size_t j = 0; j < nket_dets; ++j)
+      max_c_ket = std::max(max_c_ket, std::abs(C_ket[j]));
+
+    // Bra determinants are processed in parallel into thread-private (or,
+    // beyond the buffer budget, atomically updated) RDMs (see
+    // accumulate_rdms_by_rows)
+    auto make_row_gen = [&]() {
+      return [&, bra_occ_alpha = std::vector<uint32_t>(),
+              bra_occ_beta = std::vector<uint32_t>()](
+                 size_t i, matrix_span_t ordm_loc, auto trdm_loc) mutable {
+        const auto bra = *(bra_begin + i);
+        if(!bra.count()) return;
+        if(std::abs(C_bra[i]) * max_c_ket <= 1e-16) return;
 
-    // Loop over bra determinants
-    for(size_t i = 0; i < nbra_dets; ++i) {
-      const auto bra = *(bra_begin + i);
-      // if( (i%1000) == 0 ) std::cout << i  << std::endl;
-      if(bra.count()) {
         // Separate out into alpha/beta components
         spin_det_t bra_alpha = bitset_lo_word(bra);
         spin_det_t bra_beta = bitset_hi_word(bra);
@@ -143,25 +147,42 @@ class DoubleLoopHamiltonianGenerator : public HamiltonianGenerator<N> {
             spin_det_t ket_beta = bitset_hi_word(ket);
 
             full_det_t ex_total = bra ^ ket;
-            if(ex_total.count() <= 4) {
+            if(ex_total.count() <= max_ex) {
               spin_det_t ex_alpha = bitset_lo_word(ex_total);
               spin_det_t ex_beta = bitset_hi_word(ex_total);
 
-              const double val = C[i] * C[j];
+              const double val = C_bra[i] * C_ket[j];
 
               // Compute Matrix Element
               if(std::abs(val) > 1e-16) {
                 rdm_contributions(bra_alpha, ket_alpha, ex_alpha, bra_beta,
                                   ket_beta, ex_beta, bra_occ_alpha,
-                                  bra_occ_beta, val, ordm, trdm);
+                                  bra_occ_beta, val, ordm_loc, trdm_loc);
               }
             }  // Possible non-zero connection (Hamming distance)
 
           }  // Non-zero ket determinant
         }    // Loop over ket determinants
+      };
+    };
+
+    accumulate_rdms_by_rows(nbra_dets, ordm, trdm, make_row_gen);
+  }
+
+  void form_rdms_(full_det_iterator bra_begin, full_det_iterator bra_end,
+                  full_det_iterator ket_begin, full_det_iterator ket_end,
+                  const double *C_bra, const double *C_ket, matrix_span_t ordm,
+                  rank4_span_t trdm) override {
+    form_rdms_impl_(bra_begin, bra_end, ket_begin, ket_end, C_bra, C_ket, ordm,
+                    trdm);
+  }
 
-      }  // Non-zero bra determinant
-    }    // Loop over bra determinants
+  void form_rdms_(full_det_iterator bra_begin, full_det_iterator bra_end,
+                  full_det_iterator ket_begin, full_det_iterator ket_end,
+                  const double *C_bra, const double *C_ket, matrix_span_t ordm,
+                  packed_rank4_span_t trdm) override {
+    form_rdms_impl_(bra_begin, bra_end, ket_begin, ket_end, C_bra, C_ket, ordm,
+                    trdm);
   }
 
  public:
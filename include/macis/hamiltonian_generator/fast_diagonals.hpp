@@ -125,4 +125,89 @@ double HamiltonianGenerator<N>::fast_diag_os_double(
                              orb_hold, orb_paru, orb_pard, orig_det_Hii);
 }
 
+template <size_t N>
+double HamiltonianGenerator<N>::fast_diag(
+    full_det_t orig_det, full_det_t det,
+    // These refer to original determinant
+    const std::vector<uint32_t>& occ_alpha,
+    const std::vector<uint32_t>& occ_beta, double orig_det_Hii) const {
+  const full_det_t ex = orig_det ^ det;
+  const spin_det_t ex_alpha = bitset_lo_word(ex);
+  const spin_det_t ex_beta = bitset_hi_word(ex);
+  const uint32_t ex_alpha_count = ex_alpha.count();
+  const uint32_t ex_beta_count = ex_beta.count();
+
+  // Not connected, evaluate from scratch
+  if((ex_alpha_count + ex_beta_count) > 4) return matrix_element(det, det);
+
+  // Holes (0) and particles (1) of each spin
+  const spin_det_t hol_alpha = ex_alpha & bitset_lo_word(orig_det);
+  const spin_det_t hol_beta = ex_beta & bitset_hi_word(orig_det);
+  const spin_det_t par_alpha = ex_alpha & bitset_lo_word(det);
+  const spin_det_t par_beta = ex_beta & bitset_hi_word(det);
+
+  if(ex_alpha_count == 4)
+    return fast_diag_ss_double(occ_alpha, occ_beta, ffs(hol_alpha) - 1,
+                               fls(hol_alpha), ffs(par_alpha) - 1,
+                               fls(par_alpha), orig_det_Hii);
+
+  else if(ex_beta_count == 4)
+    return fast_diag_ss_double(occ_beta, occ_alpha, ffs(hol_beta) - 1,
+                               fls(hol_beta), ffs(par_beta) - 1, fls(par_beta),
+                               orig_det_Hii);
+
+  else if(ex_alpha_count == 2 and ex_beta_count == 2)
+    return fast_diag_os_double(occ_alpha, occ_beta, ffs(hol_alpha) - 1,
+                               ffs(hol_beta) - 1, ffs(par_alpha) - 1,
+                               ffs(par_beta) - 1, orig_det_Hii);
+
+  else if(ex_alpha_count == 2)
+    return fast_diag_single(occ_alpha, occ_beta, ffs(hol_alpha) - 1,
+                            ffs(par_alpha) - 1, orig_det_Hii);
+
+  else if(ex_beta_count == 2)
+    return fast_diag_single(occ_beta, occ_alpha, ffs(hol_beta) - 1,
+                            ffs(par_beta) - 1, orig_det_Hii);
+
+  else
+    return orig_det_Hii;
+}
+
+template <size_t N>
+void HamiltonianGenerator<N>::diagonal_elements(full_det_iterator dets_begin,
+                                                full_det_iterator dets_end,
+                                                double* D) const {
+  const size_t ndets = std::distance(dets_begin, dets_end);
+
+  // Length of an incremental chain before the diagonal is reevaluated from
+  // scratch (bounds the accumulation of roundoff)
+  constexpr size_t max_chain = 32;
+
+  // Each thread processes a contiguous range of determinants, each of which
+  // is (if connected) updated from its predecessor
+#pragma omp parallel
+  {
+    std::vector<uint32_t> occ_alpha, occ_beta;
+    full_det_t prev_det = 0;
+    size_t chain = 0;
+
+#pragma omp for schedule(static)
+    for(size_t i = 0; i < ndets; ++i) {
+      const auto det = *(dets_begin + i);
+      if(chain and chain < max_chain and (prev_det ^ det).count() <= 4) {
+        D[i] = fast_diag(prev_det, det, occ_alpha, occ_beta, D[i - 1]);
+        bits_to_indices(bitset_lo_word(det), occ_alpha);
+        bits_to_indices(bitset_hi_word(det), occ_beta);
+        chain++;
+      } else {
+        bits_to_indices(bitset_lo_word(det), occ_alpha);
+        bits_to_indices(bitset_hi_word(det), occ_beta);
+        D[i] = matrix_element_diag(occ_alpha, occ_beta);
+        chain = 1;
+      }
+      prev_det = det;
+    }
+  }
+}
+
 }  // namespace macis
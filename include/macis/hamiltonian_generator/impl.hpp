@@ -13,15 +13,31 @@ namespace macis {
 
 template <size_t N>
 HamiltonianGenerator<N>::HamiltonianGenerator(matrix_span<double> T,
-                                              rank4_span_t V)
+                                              rank4_span_t V,
+                                              mpi_node_comm node_comm)
     : norb_(T.extent(0)),
       norb2_(norb_ * norb_),
       norb3_(norb2_ * norb_),
       T_pq_(T),
-      V_pqrs_(V) {
+      V_pqrs_(V),
+      node_comm_(std::move(node_comm)) {
   generate_integral_intermediates(V_pqrs_);
 }
 
+template <size_t N>
+HamiltonianGenerator<N>::HamiltonianGenerator(matrix_span<double> T,
+                                              packed_eri_span_t V,
+                                              mpi_node_comm node_comm)
+    : norb_(T.extent(0)),
+      norb2_(norb_ * norb_),
+      norb3_(norb2_ * norb_),
+      T_pq_(T),
+      V_pqrs_(nullptr, 0, 0, 0, 0),
+      V_packed_(V),
+      node_comm_(std::move(node_comm)) {
+  generate_integral_intermediates(V_packed_);
+}
+
 template <size_t N>
 void HamiltonianGenerator<N>::generate_integral_intermediates(rank4_span_t V) {
   if(V.extent(0) != norb_ or V.extent(1) != norb_ or V.extent(2) != norb_ or
@@ -29,19 +45,59 @@ void HamiltonianGenerator<N>::generate_integral_intermediates(rank4_span_t V) {
     throw std::runtime_error("V has incorrect dimensions");
 
   size_t no = norb_;
-  size_t no2 = no * no;
-  size_t no3 = no2 * no;
-  size_t no4 = no3 * no;
+
+  // Node-shared G is populated by the node leader once all ranks are
+  // done reading the previous intermediates
+  double* G_ptr = nullptr;
+  if(node_shared_eris()) {
+    node_comm_.barrier();
+    if(G_pqrs_shared_.size() != V.size())
+      G_pqrs_shared_ = mpi_shared_buffer<double>(V.size(), node_comm_);
+    G_ptr = G_pqrs_shared_.data();
+  } else {
+    G_pqrs_data_.resize(V.size());
+    G_ptr = G_pqrs_data_.data();
+  }
+  G_pqrs_ = rank4_span_t(G_ptr, no, no, no, no);
 
   // G(i,j,k,l) = V(i,j,k,l) - V(i,l,k,j)
-  G_pqrs_data_ = std::vector<double>(begin(V), end(V));
-  G_pqrs_ = rank4_span_t(G_pqrs_data_.data(), no, no, no, no);
-  for(auto i = 0ul; i < no; ++i)
-    for(auto j = 0ul; j < no; ++j)
-      for(auto k = 0ul; k < no; ++k)
-        for(auto l = 0ul; l < no; ++l) {
-          G_pqrs_(i, j, k, l) -= V(i, l, k, j);
-        }
+  if(node_comm_.is_leader()) {
+    for(auto i = 0ul; i < no; ++i)
+      for(auto j = 0ul; j < no; ++j)
+        for(auto k = 0ul; k < no; ++k)
+          for(auto l = 0ul; l < no; ++l) {
+            G_pqrs_(i, j, k, l) = V(i, j, k, l) - V(i, l, k, j);
+          }
+  }
+  node_comm_.barrier();
+
+  generate_reduced_intermediates_(G_pqrs_, V);
+}
+
+template <size_t N>
+void HamiltonianGenerator<N>::generate_integral_intermediates(
+    packed_eri_span_t V) {
+  if(V.extent(0) != norb_)
+    throw std::runtime_error("V has incorrect dimensions");
+
+  // Node-shared ERIs may have just been written by the node leader
+  node_comm_.barrier();
+
+  // G is evaluated on the fly from the packed ERIs
+  G_pqrs_data_ = std::vector<double>();
+  G_pqrs_shared_ = mpi_shared_buffer<double>();
+  G_pqrs_ = rank4_span_t(nullptr, 0, 0, 0, 0);
+
+  generate_reduced_intermediates_(packed_antisym_eri_view<double>(V), V);
+}
+
+template <size_t N>
+template <typename Rank4G, typename Rank4V>
+void HamiltonianGenerator<N>::generate_reduced_intermediates_(Rank4G G,
+                                                              Rank4V V) {
+  size_t no = norb_;
+  size_t no2 = no * no;
+  size_t no3 = no2 * no;
 
   // G_red(i,j,k) = G(i,j,k,k) = G(k,k,i,j)
   // V_red(i,j,k) = V(i,j,k,k) = V(k,k,i,j)
@@ -52,7 +108,7 @@ void HamiltonianGenerator<N>::generate_integral_intermediates(rank4_span_t V) {
   for(auto j = 0ul; j < no; ++j)
     for(auto i = 0ul; i < no; ++i)
       for(auto k = 0ul; k < no; ++k) {
-        G_red_(k, i, j) = G_pqrs_(k, k, i, j);
+        G_red_(k, i, j) = G(k, k, i, j);
         V_red_(k, i, j) = V(k, k, i, j);
       }
 
@@ -64,7 +120,7 @@ void HamiltonianGenerator<N>::generate_integral_intermediates(rank4_span_t V) {
   V2_red_ = matrix_span<double>(V2_red_data_.data(), no, no);
   for(auto j = 0ul; j < no; ++j)
     for(auto i = 0ul; i < no; ++i) {
-      G2_red_(i, j) = 0.5 * G_pqrs_(i, i, j, j);
+      G2_red_(i, j) = 0.5 * G(i, i, j, j);
       V2_red_(i, j) = V(i, i, j, j);
     }
 }
@@ -67,7 +67,7 @@ double HamiltonianGenerator<N>::matrix_element_4(spin_det_t bra, spin_det_t ket,
                                                  spin_det_t ex) const {
   auto [o1, v1, o2, v2, sign] = doubles_sign_indices(bra, ket, ex);
 
-  return sign * G_pqrs_(v1, o1, v2, o2);
+  return sign * G_elem(v1, o1, v2, o2);
 }
 
 template <size_t N>
@@ -80,7 +80,7 @@ double HamiltonianGenerator<N>::matrix_element_22(
       single_excitation_sign_indices(bra_beta, ket_beta, ex_beta);
   auto sign = sign_a * sign_b;
 
-  return sign * V_pqrs_(v1, o1, v2, o2);
+  return sign * V_elem(v1, o1, v2, o2);
 }
 
 template <size_t N>
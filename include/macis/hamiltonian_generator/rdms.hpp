@@ -44,58 +44,76 @@ void HamiltonianGenerator<N>::rotate_hamiltonian_ordm(const double* ordm) {
   }
 #endif
 
-  std::vector<double> tmp(norb3_ * norb_), tmp2(norb3_ * norb_);
-
   // Transform T
   // T <- N**H * T * N
+  std::vector<double> T_tmp(norb2_);
   auto* T_pq_ptr = T_pq_.data_handle();
   blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::NoTrans,
              norb_, norb_, norb_, 1., T_pq_ptr, norb_, natural_orbitals.data(),
-             norb_, 0., tmp.data(), norb_);
+             norb_, 0., T_tmp.data(), norb_);
   blas::gemm(blas::Layout::ColMajor, blas::Op::Trans, blas::Op::NoTrans, norb_,
-             norb_, norb_, 1., natural_orbitals.data(), norb_, tmp.data(),
+             norb_, norb_, 1., natural_orbitals.data(), norb_, T_tmp.data(),
              norb_, 0., T_pq_ptr, norb_);
 
   // Transorm V
+  // Node-shared ERIs are only transformed by the node leader, once all
+  // ranks of the node are done reading them
+  node_comm_.barrier();
+  if(node_comm_.is_leader()) {
+    std::vector<double> tmp(norb3_ * norb_), tmp2(norb3_ * norb_);
 
-  // 1st Quarter
-  // (pj|kl) = N(i,p) (ij|kl)
-  // W(p,jkl) = N(i,p) * V(i,jkl)
-  blas::gemm(blas::Layout::ColMajor, blas::Op::Trans, blas::Op::NoTrans, norb_,
-             norb3_, norb_, 1., natural_orbitals.data(), norb_,
-             V_pqrs_.data_handle(), norb_, 0., tmp.data(), norb_);
+    // Packed ERIs are transformed in dense scratch space (tmp2 is free
+    // before the 2nd and after the 3rd quarter)
+    auto* V_ptr = V_pqrs_.data_handle();
+    if(packed_eris()) {
+      unpack_eris(norb_, V_packed_.data_handle(), tmp2.data(), norb_);
+      V_ptr = tmp2.data();
+    }
 
-  // 2nd Quarter
-  // (pq|kl) = N(j,q) (pj|kl)
-  // W_kl(p,q) = V_kl(p,j) N(j,q)
-  for(auto kl = 0; kl < norb2_; ++kl) {
-    auto* V_kl = tmp.data() + kl * norb2_;
-    auto* W_kl = tmp2.data() + kl * norb2_;
-    blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::NoTrans,
-               norb_, norb_, norb_, 1., V_kl, norb_, natural_orbitals.data(),
-               norb_, 0., W_kl, norb_);
-  }
+    // 1st Quarter
+    // (pj|kl) = N(i,p) (ij|kl)
+    // W(p,jkl) = N(i,p) * V(i,jkl)
+    blas::gemm(blas::Layout::ColMajor, blas::Op::Trans, blas::Op::NoTrans,
+               norb_, norb3_, norb_, 1., natural_orbitals.data(), norb_, V_ptr,
+               norb_, 0., tmp.data(), norb_);
 
-  // 3rd Quarter
-  // (pq|rl) = N(k,r) (pq|kl)
-  // W_l(pq,r) = V_l(pq,k) N(k,r)
-  for(auto l = 0; l < norb_; ++l) {
-    auto* V_l = tmp2.data() + l * norb3_;
-    auto* W_l = tmp.data() + l * norb3_;
+    // 2nd Quarter
+    // (pq|kl) = N(j,q) (pj|kl)
+    // W_kl(p,q) = V_kl(p,j) N(j,q)
+    for(size_t kl = 0; kl < norb2_; ++kl) {
+      auto* V_kl = tmp.data() + kl * norb2_;
+      auto* W_kl = tmp2.data() + kl * norb2_;
+      blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::NoTrans,
+                 norb_, norb_, norb_, 1., V_kl, norb_, natural_orbitals.data(),
+                 norb_, 0., W_kl, norb_);
+    }
+
+    // 3rd Quarter
+    // (pq|rl) = N(k,r) (pq|kl)
+    // W_l(pq,r) = V_l(pq,k) N(k,r)
+    for(size_t l = 0; l < norb_; ++l) {
+      auto* V_l = tmp2.data() + l * norb3_;
+      auto* W_l = tmp.data() + l * norb3_;
+      blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::NoTrans,
+                 norb2_, norb_, norb_, 1., V_l, norb2_, natural_orbitals.data(),
+                 norb_, 0., W_l, norb2_);
+    }
+
+    // 4th Quarter
+    // (pq|rs) = N(l,s) (pq|rl)
+    // W(pqr,s) = V(pqr,l) N(l,s)
     blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::NoTrans,
-               norb2_, norb_, norb_, 1., V_l, norb2_, natural_orbitals.data(),
-               norb_, 0., W_l, norb2_);
+               norb3_, norb_, norb_, 1., tmp.data(), norb3_,
+               natural_orbitals.data(), norb_, 0., V_ptr, norb3_);
+    if(packed_eris()) pack_eris(norb_, V_ptr, norb_, V_packed_.data_handle());
   }
 
-  // 4th Quarter
-  // (pq|rs) = N(l,s) (pq|rl)
-  // W(pqr,s) = V(pqr,l) N(l,s)
-  blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::NoTrans,
-             norb3_, norb_, norb_, 1., tmp.data(), norb3_,
-             natural_orbitals.data(), norb_, 0., V_pqrs_.data_handle(), norb3_);
-
   // Regenerate intermediates
-  generate_integral_intermediates(V_pqrs_);
+  if(packed_eris()) {
+    generate_integral_intermediates(V_packed_);
+  } else {
+    generate_integral_intermediates(V_pqrs_);
+  }
 }
 
 }  // namespace macis
@@ -0,0 +1,412 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <macis/hamiltonian_generator.hpp>
+#include <macis/sd_operations.hpp>
+#include <macis/util/csr_assembly.hpp>
+#include <macis/util/rdms.hpp>
+#include <macis/wfn_index_map.hpp>
+#include <optional>
+
+namespace macis {
+
+/**
+ *  @brief Hamiltonian generator which determines connected determinant pairs
+ *  through shared (N-2)-electron residues.
+ *
+ *  Two determinants with the same number of electrons differ by at most a
+ *  double excitation iff they share at least one residue obtained by removing
+ *  two electrons. The ket determinants are grouped by residue in a hashed
+ *  residue array which is probed with the residues of each bra determinant,
+ *  such that the build cost scales with the number of connected pairs rather
+ *  than with the product of the bra and ket spaces.
+ *
+ *  The ket space is processed in batches whose residue arrays contain at most
+ *  `max_residues()` entries to bound the memory footprint. Rows of each
+ *  batch are generated in parallel. A ket range which fits in a single batch
+ *  may be cached with `cache_connectivity` for reuse across blocks.
+ */
+template <size_t N>
+class ResidueArraysHamiltonianGenerator : public HamiltonianGenerator<N> {
+ public:
+  using base_type = HamiltonianGenerator<N>;
+  using full_det_t = typename base_type::full_det_t;
+  using spin_det_t = typename base_type::spin_det_t;
+  using full_det_iterator = typename base_type::full_det_iterator;
+  using matrix_span_t = typename base_type::matrix_span_t;
+  using rank4_span_t = typename base_type::rank4_span_t;
+  using packed_rank4_span_t = typename base_type::packed_rank4_span_t;
+
+  template <typename index_t>
+  using sparse_matrix_type = sparsexx::csr_matrix<double, index_t>;
+
+ protected:
+  struct residue_state_pair {
+    full_det_t residue;
+    size_t state_idx;
+  };
+
+  /// Kets of a batch grouped by their residues. The kets sharing
+  /// residues[k] are kets[offsets[k]:offsets[k+1]]
+  struct residue_array_type {
+    std::vector<full_det_t> residues;
+    std::vector<size_t> offsets;
+    std::vector<size_t> kets;
+    wfn_index_map<N> index;  // residue -> position in residues
+  };
+
+  // Max number of (residue, state) pairs held in memory at once
+  size_t max_residues_ = 1ul << 24;
+
+  // Residue array of the ket range stored by cache_connectivity
+  std::optional<residue_array_type> res_cache_;
+  full_det_iterator res_cache_begin_;
+  size_t res_cache_ndets_ = 0;
+
+  /// Generate the (N-2)-electron residues of a determinant
+  static void append_residues(full_det_t state, std::vector<full_det_t>& res) {
+    const auto nel = state.count();
+    if(nel >= 2)
+      generate_residues(state, res);
+    else if(nel == 1)
+      res.emplace_back(0);  // Single electron dets are all connected
+  }
+
+  static size_t num_residues(size_t nel) {
+    return nel >= 2 ? nel * (nel - 1) / 2 : nel;
+  }
+
+  /// Partition the ket space into batches with bounded residue arrays
+  std::vector<size_t> ket_batches(full_det_iterator ket_begin,
+                                  full_det_iterator ket_end) const {
+    const size_t nket_dets = std::distance(ket_begin, ket_end);
+    std::vector<size_t> batches = {0};
+    size_t nres = 0;
+    for(size_t j = 0; j < nket_dets; ++j) {
+      const auto nres_j = num_residues((ket_begin + j)->count());
+      if(nres and nres + nres_j > max_residues_) {
+        batches.emplace_back(j);
+        nres = 0;
+      }
+      nres += nres_j;
+    }
+    batches.emplace_back(nket_dets);
+    return batches;
+  }
+
+  /// Generate the residue array for kets [ket_st, ket_en)
+  residue_array_type make_residue_array(full_det_iterator ket_begin,
+                                        size_t ket_st, size_t ket_en) const {
+    const size_t nket = ket_en - ket_st;
+    std::vector<size_t> offsets(nket + 1, 0);
+    for(size_t j = 0; j < nket; ++j)
+      offsets[j + 1] =
+          offsets[j] + num_residues((ket_begin + ket_st + j)->count());
+
+    std::vector<residue_state_pair> res_pairs(offsets.back());
+#pragma omp parallel
+    {
+      std::vector<full_det_t> residues;
+#pragma omp for schedule(dynamic, 256)
+      for(size_t j = 0; j < nket; ++j) {
+        residues.clear();
+        append_residues(*(ket_begin + ket_st + j), residues);
+        for(size_t r = 0; r < residues.size(); ++r)
+          res_pairs[offsets[j] + r] =
+              residue_state_pair{residues[r], ket_st + j};
+      }
+    }
+
+    std::sort(res_pairs.begin(), res_pairs.end(),
+              [](const auto& x, const auto& y) {
+                if(x.residue == y.residue) return x.state_idx < y.state_idx;
+                return bitset_less(x.residue, y.residue);
+              });
+
+    // Group kets by residue and hash the unique residues
+    residue_array_type res_arr;
+    res_arr.kets.resize(res_pairs.size());
+    for(size_t k = 0; k < res_pairs.size(); ++k) {
+      if(!k or res_pairs[k].residue != res_pairs[k - 1].residue) {
+        res_arr.residues.emplace_back(res_pairs[k].residue);
+        res_arr.offsets.emplace_back(k);
+      }
+      res_arr.kets[k] = res_pairs[k].state_idx;
+    }
+    res_arr.offsets.emplace_back(res_pairs.size());
+    res_arr.index = wfn_index_map<N>(res_arr.residues);
+
+    return res_arr;
+  }
+
+  /**
+   *  @brief Offset of [ket_begin, ket_end) within the cached residue array
+   *
+   *  @returns Whether the cached residue array covers the ket range
+   */
+  bool cached_ket_offset(full_det_iterator ket_begin, full_det_iterator ket_end,
+                         size_t& ket_st) const {
+    const size_t n = std::distance(ket_begin, ket_end);
+    if(!res_cache_ or !n) return false;
+
+    const full_det_t* base = &*res_cache_begin_;
+    const full_det_t* first = &*ket_begin;
+    std::less_equal<const full_det_t*> le;
+    if(!le(base, first) or !le(first + n, base + res_cache_ndets_))
+      return false;
+    ket_st = first - base;
+    return true;
+  }
+
+  /**
+   *  @brief Determine the kets in a residue array which are connected to a
+   *  bra determinant.
+   *
+   *  @param[in]  bra      Bra determinant
+   *  @param[in]  res_arr  Residue array of the ket space
+   *  @param[in]  ket_st   Start of the ket range within the residue array
+   *  @param[in]  ket_en   End of the ket range within the residue array
+   *  @param[out] residues Scratch space for the residues of `bra`
+   *  @param[out] kets     Sorted, unique indices of the connected kets
+   *                       relative to `ket_st`
+   */
+  static void connected_kets(full_det_t bra, const residue_array_type& res_arr,
+                             size_t ket_st, size_t ket_en,
+                             std::vector<full_det_t>& residues,
+                             std::vector<size_t>& kets) {
+    residues.clear();
+    kets.clear();
+    append_residues(bra, residues);
+
+    for(const auto& res : residues) {
+      const auto k = res_arr.index.find(res);
+      if(k == res_arr.index.npos) continue;
+      for(auto p = res_arr.offsets[k]; p < res_arr.offsets[k + 1]; ++p) {
+        const auto j = res_arr.kets[p];
+        if(j >= ket_st and j < ket_en) kets.emplace_back(j - ket_st);
+      }
+    }
+
+    std::sort(kets.begin(), kets.end());
+    kets.erase(std::unique(kets.begin(), kets.end()), kets.end());
+  }
+
+  template <typename index_t>
+  sparse_matrix_type<index_t> make_csr_hamiltonian_block_(
+      full_det_iterator bra_begin, full_det_iterator bra_end,
+      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh) {
+    const size_t nbra_dets = std::distance(bra_begin, bra_end);
+    const size_t nket_dets = std::distance(ket_begin, ket_end);
+
+    // A single batch if the ket range is covered by the cached residues
+    size_t ket_st = 0;
+    const bool cached = cached_ket_offset(ket_begin, ket_end, ket_st);
+    const auto batches = cached ? std::vector<size_t>{0, nket_dets}
+                                : ket_batches(ket_begin, ket_end);
+    const size_t nbatch = batches.size() - 1;
+
+    std::vector<sparse_matrix_type<index_t>> blocks;
+    for(size_t ib = 0; ib < nbatch; ++ib) {
+      std::optional<residue_array_type> res_batch;
+      if(!cached)
+        res_batch.emplace(
+            make_residue_array(ket_begin, batches[ib], batches[ib + 1]));
+      const auto& res_arr = cached ? *res_cache_ : *res_batch;
+
+      auto make_row_gen = [&]() {
+        return [&, residues = std::vector<full_det_t>(),
+                kets = std::vector<size_t>(),
+                bra_occ_alpha = std::vector<uint32_t>(),
+                bra_occ_beta = std::vector<uint32_t>()](
+                   size_t i, std::vector<index_t>& colind,
+                   std::vector<double>& nzval) mutable {
+          const auto bra = *(bra_begin + i);
+          if(!bra.count()) return;
+
+          connected_kets(bra, res_arr, ket_st, ket_st + nket_dets, residues,
+                         kets);
+          if(kets.empty()) return;
+
+          // Separate out into alpha/beta components
+          spin_det_t bra_alpha = bitset_lo_word(bra);
+          spin_det_t bra_beta = bitset_hi_word(bra);
+
+          // Get occupied indices
+          bits_to_indices(bra_alpha, bra_occ_alpha);
+          bits_to_indices(bra_beta, bra_occ_beta);
+
+          // Loop over connected kets
+          for(auto j : kets) {
+            const auto ket = *(ket_begin + j);
+            spin_det_t ket_alpha = bitset_lo_word(ket);
+            spin_det_t ket_beta = bitset_hi_word(ket);
+
+            full_det_t ex_total = bra ^ ket;
+            if(ex_total.count() <= 4) {
+              spin_det_t ex_alpha = bitset_lo_word(ex_total);
+              spin_det_t ex_beta = bitset_hi_word(ex_total);
+
+              // Compute Matrix Element
+              const auto h_el = this->matrix_element(
+                  bra_alpha, ket_alpha, ex_alpha, bra_beta, ket_beta, ex_beta,
+                  bra_occ_alpha, bra_occ_beta);
+
+              if(std::abs(h_el) > H_thresh) {
+                colind.emplace_back(j);
+                nzval.emplace_back(h_el);
+              }
+            }  // Possible non-zero connection (Hamming distance)
+          }    // Loop over connected kets
+        };
+      };
+
+      blocks.emplace_back(
+          assemble_csr_by_rows<index_t>(nbra_dets, nket_dets, make_row_gen));
+    }
+
+    return concatenate_csr_columns(nket_dets, std::move(blocks));
+  }
+
+  sparse_matrix_type<int32_t> make_csr_hamiltonian_block_32bit_(
+      full_det_iterator bra_begin, full_det_iterator bra_end,
+      full_det_iterator ket_begin, full_det_iterator ket_end,
+      double H_thresh) override {
+    return make_csr_hamiltonian_block_<int32_t>(bra_begin, bra_end, ket_begin,
+                                                ket_end, H_thresh);
+  }
+
+  sparse_matrix_type<int64_t> make_csr_hamiltonian_block_64bit_(
+      full_det_iterator bra_begin, full_det_iterator bra_end,
+      full_det_iterator ket_begin, full_det_iterator ket_end,
+      double H_thresh) override {
+    return make_csr_hamiltonian_block_<int64_t>(bra_begin, bra_end, ket_begin,
+                                                ket_end, H_thresh);
+  }
+
+ public:
+  /// Caches the residue array of the ket range if it does not exceed
+  /// `max_residues()` entries. Bra residues are generated on the fly.
+  void cache_connectivity(full_det_iterator /*bra_begin*/,
+                          full_det_iterator /*bra_end*/,
+                          full_det_iterator ket_begin,
+                          full_det_iterator ket_end) override {
+    release_connectivity();
+    const size_t nket_dets = std::distance(ket_begin, ket_end);
+    if(!nket_dets or ket_batches(ket_begin, ket_end).size() > 2) return;
+
+    res_cache_.emplace(make_residue_array(ket_begin, 0, nket_dets));
+    res_cache_begin_ = ket_begin;
+    res_cache_ndets_ = nket_dets;
+  }
+
+  void release_connectivity() override {
+    res_cache_.reset();
+    res_cache_ndets_ = 0;
+  }
+
+ protected:
+  template <typename Rank4>
+  void form_rdms_impl_(full_det_iterator bra_begin, full_det_iterator bra_end,
+                       full_det_iterator ket_begin, full_det_iterator ket_end,
+                       const double *C_bra, const double *C_ket,
+                       matrix_span_t ordm, Rank4 trdm) {
+    const size_t nbra_dets = std::distance(bra_begin, bra_end);
+
+    // Doubles only contribute to the 2-RDM
+    const size_t max_ex = trdm.data_handle() ? 4 : 2;
+
+    // A single batch if the ket range is covered by the cached residues
+    const size_t nket_dets = std::distance(ket_begin, ket_end);
+    size_t ket_st = 0;
+    const bool cached = cached_ket_offset(ket_begin, ket_end, ket_st);
+    const auto batches = cached ? std::vector<size_t>{0, nket_dets}
+                                : ket_batches(ket_begin, ket_end);
+    for(size_t ib = 0; ib < batches.size() - 1; ++ib) {
+      std::optional<residue_array_type> res_batch;
+      if(!cached)
+        res_batch.emplace(
+            make_residue_array(ket_begin, batches[ib], batches[ib + 1]));
+      const auto& res_arr = cached ? *res_cache_ : *res_batch;
+
+      auto make_row_gen = [&]() {
+        return [&, residues = std::vector<full_det_t>(),
+                kets = std::vector<size_t>(),
+                bra_occ_alpha = std::vector<uint32_t>(),
+                bra_occ_beta = std::vector<uint32_t>()](
+                   size_t i, matrix_span_t ordm_loc, auto trdm_loc) mutable {
+          const auto bra = *(bra_begin + i);
+          if(!bra.count()) return;
+
+          connected_kets(bra, res_arr, ket_st, ket_st + nket_dets, residues,
+                         kets);
+          if(kets.empty()) return;
+
+          // Separate out into alpha/beta components
+          spin_det_t bra_alpha = bitset_lo_word(bra);
+          spin_det_t bra_beta = bitset_hi_word(bra);
+
+          // Get occupied indices
+          bits_to_indices(bra_alpha, bra_occ_alpha);
+          bits_to_indices(bra_beta, bra_occ_beta);
+
+          // Loop over connected kets
+          for(auto j : kets) {
+            const auto ket = *(ket_begin + j);
+            spin_det_t ket_alpha = bitset_lo_word(ket);
+            spin_det_t ket_beta = bitset_hi_word(ket);
+
+            full_det_t ex_total = bra ^ ket;
+            if(ex_total.count() <= max_ex) {
+              spin_det_t ex_alpha = bitset_lo_word(ex_total);
+              spin_det_t ex_beta = bitset_hi_word(ex_total);
+
+              const double val = C_bra[i] * C_ket[j];
+
+              if(std::abs(val) > 1e-16) {
+                rdm_contributions(bra_alpha, ket_alpha, ex_alpha, bra_beta,
+                                  ket_beta, ex_beta, bra_occ_alpha,
+                                  bra_occ_beta, val, ordm_loc, trdm_loc);
+              }
+            }  // Possible non-zero connection (Hamming distance)
+          }    // Loop over connected kets
+        };
+      };
+
+      accumulate_rdms_by_rows(nbra_dets, ordm, trdm, make_row_gen);
+    }  // Loop over ket batches
+  }
+
+  void form_rdms_(full_det_iterator bra_begin, full_det_iterator bra_end,
+                  full_det_iterator ket_begin, full_det_iterator ket_end,
+                  const double *C_bra, const double *C_ket, matrix_span_t ordm,
+                  rank4_span_t trdm) override {
+    form_rdms_impl_(bra_begin, bra_end, ket_begin, ket_end, C_bra, C_ket, ordm,
+                    trdm);
+  }
+
+  void form_rdms_(full_det_iterator bra_begin, full_det_iterator bra_end,
+                  full_det_iterator ket_begin, full_det_iterator ket_end,
+                  const double *C_bra, const double *C_ket, matrix_span_t ordm,
+                  packed_rank4_span_t trdm) override {
+    form_rdms_impl_(bra_begin, bra_end, ket_begin, ket_end, C_bra, C_ket, ordm,
+                    trdm);
+  }
+
+ public:
+  /// Max number of (residue, state) pairs held in memory at once
+  size_t max_residues() const { return max_residues_; }
+  void set_max_residues(size_t n) { max_residues_ = std::max<size_t>(n, 1); }
+
+ public:
+  template <typename... Args>
+  ResidueArraysHamiltonianGenerator(Args &&...args)
+      : HamiltonianGenerator<N>(std::forward<Args>(args)...) {}
+};
+
+}  // namespace macis
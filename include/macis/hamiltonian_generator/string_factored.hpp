@@ -0,0 +1,547 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <limits>
+#include <macis/hamiltonian_generator.hpp>
+#include <macis/sd_operations.hpp>
+#include <macis/util/csr_assembly.hpp>
+#include <macis/util/rdms.hpp>
+#include <macis/wfn_index_map.hpp>
+#include <memory>
+#include <optional>
+
+namespace macis {
+
+/**
+ *  @brief Hamiltonian generator which factors determinants into their unique
+ *  alpha and beta strings.
+ *
+ *  The connectivity (up to double excitations) between the unique bra and
+ *  ket strings of each spin is generated through shared string residues.
+ *  Kets are grouped by alpha string, such that the connected kets of a bra
+ *  determinant are obtained by traversing the alpha string connections and
+ *  intersecting each ket group with the beta string connections of the bra.
+ *  This covers the alpha-only, beta-only and mixed (product of singles)
+ *  excitations without testing all bra/ket pairs.
+ *
+ *  The connectivity is generated per block unless it has been cached for
+ *  enclosing bra and ket ranges with `cache_connectivity`.
+ */
+template <size_t N>
+class StringFactoredHamiltonianGenerator : public HamiltonianGenerator<N> {
+ public:
+  using base_type = HamiltonianGenerator<N>;
+  using full_det_t = typename base_type::full_det_t;
+  using spin_det_t = typename base_type::spin_det_t;
+  using full_det_iterator = typename base_type::full_det_iterator;
+  using matrix_span_t = typename base_type::matrix_span_t;
+  using rank4_span_t = typename base_type::rank4_span_t;
+  using packed_rank4_span_t = typename base_type::packed_rank4_span_t;
+
+  template <typename index_t>
+  using sparse_matrix_type = sparsexx::csr_matrix<double, index_t>;
+
+ protected:
+  /// (string index, excitation level) pair
+  using string_connection = std::pair<uint32_t, uint32_t>;
+
+  /// (beta string index, determinant index) pair
+  using ket_group_entry = std::pair<uint32_t, size_t>;
+
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  /// Sorted unique strings of one spin and their occupied orbitals
+  struct string_set {
+    std::vector<spin_det_t> strings;
+    std::vector<std::vector<uint32_t>> occ;
+    wfn_index_map<N / 2> index;  // string -> position in strings
+  };
+
+  /// Connections from the strings of a bra to those of a ket string set.
+  /// The connections of bra string i are conn[ptr[i]:ptr[i+1]], sorted by
+  /// ket string
+  struct string_connection_list {
+    std::vector<size_t> ptr;
+    std::vector<string_connection> conn;
+  };
+
+  /// Determinant range factored into its unique alpha and beta strings
+  struct determinant_space {
+    full_det_iterator begin;
+    size_t ndets = 0;
+    string_set alpha;
+    string_set beta;
+
+    // Unique string indices of each (non-zero) determinant
+    std::vector<uint32_t> alpha_idx;
+    std::vector<uint32_t> beta_idx;
+
+    // Non-zero determinants grouped by alpha string, sorted by beta string
+    std::vector<size_t> group_ptr;
+    std::vector<ket_group_entry> groups;
+  };
+
+  /// Connectivity of a bra and a ket range, which may be sub-ranges of the
+  /// (cached) bra and ket spaces
+  struct string_connectivity {
+    std::shared_ptr<const determinant_space> bra;
+    std::shared_ptr<const determinant_space> ket;
+    std::shared_ptr<const string_connection_list> alpha_conn;
+    std::shared_ptr<const string_connection_list> beta_conn;
+    size_t bra_st = 0;  // Offset of the bra range in bra
+    size_t ket_st = 0;  // Ket range [ket_st, ket_en) in ket
+    size_t ket_en = 0;
+  };
+
+  // Connectivity stored by cache_connectivity
+  std::optional<string_connectivity> conn_cache_;
+
+  static bool spin_less(spin_det_t x, spin_det_t y) {
+    return bitset_less(x, y);
+  }
+
+  static void make_string_set(std::vector<spin_det_t> str, string_set& set) {
+    std::sort(str.begin(), str.end(), spin_less);
+    str.erase(std::unique(str.begin(), str.end()), str.end());
+
+    set.strings = std::move(str);
+    set.occ.resize(set.strings.size());
+#pragma omp parallel for schedule(static)
+    for(size_t k = 0; k < set.strings.size(); ++k)
+      bits_to_indices(set.strings[k], set.occ[k]);
+    set.index = wfn_index_map<N / 2>(set.strings);
+  }
+
+  static std::shared_ptr<const determinant_space> make_determinant_space(
+      full_det_iterator begin, full_det_iterator end) {
+    auto space = std::make_shared<determinant_space>();
+    const size_t ndets = std::distance(begin, end);
+    space->begin = begin;
+    space->ndets = ndets;
+
+    // Unique strings
+    std::vector<spin_det_t> alpha, beta;
+    for(auto it = begin; it != end; ++it)
+      if(it->count()) {
+        alpha.emplace_back(bitset_lo_word(*it));
+        beta.emplace_back(bitset_hi_word(*it));
+      }
+    make_string_set(std::move(alpha), space->alpha);
+    make_string_set(std::move(beta), space->beta);
+
+    // Map determinants onto their unique strings
+    space->alpha_idx.assign(ndets, 0);
+    space->beta_idx.assign(ndets, 0);
+#pragma omp parallel for schedule(static)
+    for(size_t j = 0; j < ndets; ++j) {
+      const auto det = *(begin + j);
+      if(!det.count()) continue;
+      space->alpha_idx[j] = space->alpha.index.find(bitset_lo_word(det));
+      space->beta_idx[j] = space->beta.index.find(bitset_hi_word(det));
+    }
+
+    // Group determinants by alpha string
+    const size_t nalpha = space->alpha.strings.size();
+    auto& group_ptr = space->group_ptr;
+    group_ptr.assign(nalpha + 1, 0);
+    for(size_t j = 0; j < ndets; ++j)
+      if((begin + j)->count()) group_ptr[space->alpha_idx[j] + 1]++;
+    std::partial_sum(group_ptr.begin(), group_ptr.end(), group_ptr.begin());
+
+    auto& groups = space->groups;
+    groups.resize(group_ptr.back());
+    auto group_pos = group_ptr;
+    for(size_t j = 0; j < ndets; ++j)
+      if((begin + j)->count())
+        groups[group_pos[space->alpha_idx[j]]++] = {space->beta_idx[j], j};
+#pragma omp parallel for schedule(dynamic, 64)
+    for(size_t ka = 0; ka < nalpha; ++ka)
+      std::sort(groups.begin() + group_ptr[ka],
+                groups.begin() + group_ptr[ka + 1]);
+
+    return space;
+  }
+
+  /// (n-2)-electron residues of a string (the empty string if n < 2)
+  static void string_residues(spin_det_t str, const std::vector<uint32_t>& occ,
+                              std::vector<spin_det_t>& res) {
+    res.clear();
+    if(occ.size() < 2) {
+      res.emplace_back(0);
+      return;
+    }
+
+    const spin_det_t one = 1;
+    for(size_t p = 0; p < occ.size(); ++p)
+      for(size_t q = p + 1; q < occ.size(); ++q)
+        res.emplace_back(str & ~((one << occ[p]) | (one << occ[q])));
+  }
+
+  /**
+   *  @brief Connections between strings which differ by at most a double
+   *  excitation.
+   *
+   *  Two strings with the same number of electrons are connected iff they
+   *  share an (n-2)-electron residue. The ket strings are grouped by residue
+   *  in a hash map which is probed with the residues of each bra string,
+   *  such that the cost scales with the number of connections rather than
+   *  with the product of the bra and ket string counts.
+   */
+  static std::shared_ptr<const string_connection_list> connect_strings(
+      const string_set& bra, const string_set& ket) {
+    const size_t nbra = bra.strings.size();
+    const size_t nket = ket.strings.size();
+
+    // Residues of the ket strings
+    std::vector<size_t> offsets(nket + 1, 0);
+    for(size_t k = 0; k < nket; ++k) {
+      const size_t nel = ket.occ[k].size();
+      offsets[k + 1] = offsets[k] + (nel >= 2 ? nel * (nel - 1) / 2 : 1);
+    }
+
+    using residue_string_pair = std::pair<spin_det_t, uint32_t>;
+    std::vector<residue_string_pair> res_pairs(offsets.back());
+#pragma omp parallel
+    {
+      std::vector<spin_det_t> res;
+#pragma omp for schedule(dynamic, 256)
+      for(size_t k = 0; k < nket; ++k) {
+        string_residues(ket.strings[k], ket.occ[k], res);
+        for(size_t r = 0; r < res.size(); ++r)
+          res_pairs[offsets[k] + r] = {res[r], k};
+      }
+    }
+    std::sort(res_pairs.begin(), res_pairs.end(),
+              [](const auto& x, const auto& y) {
+                if(x.first == y.first) return x.second < y.second;
+                return spin_less(x.first, y.first);
+              });
+
+    // Group the ket strings by residue. The ket strings sharing
+    // residues[u] are res_strings[res_ptr[u]:res_ptr[u+1]]
+    std::vector<spin_det_t> residues;
+    std::vector<size_t> res_ptr;
+    std::vector<uint32_t> res_strings(res_pairs.size());
+    for(size_t k = 0; k < res_pairs.size(); ++k) {
+      if(!k or res_pairs[k].first != res_pairs[k - 1].first) {
+        residues.emplace_back(res_pairs[k].first);
+        res_ptr.emplace_back(k);
+      }
+      res_strings[k] = res_pairs[k].second;
+    }
+    res_ptr.emplace_back(res_pairs.size());
+    const wfn_index_map<N / 2> res_index(residues);
+
+    // Probe with the residues of each bra string
+    std::vector<std::vector<string_connection>> conn_local(nbra);
+#pragma omp parallel
+    {
+      std::vector<spin_det_t> res;
+#pragma omp for schedule(dynamic, 16)
+      for(size_t i = 0; i < nbra; ++i) {
+        const auto bra_str = bra.strings[i];
+        const size_t nel = bra.occ[i].size();
+        auto& conn_i = conn_local[i];
+
+        string_residues(bra_str, bra.occ[i], res);
+        for(const auto& r : res) {
+          const auto u = res_index.find(r);
+          if(u == res_index.npos) continue;
+          for(auto p = res_ptr[u]; p < res_ptr[u + 1]; ++p) {
+            const auto k = res_strings[p];
+            if(ket.occ[k].size() != nel) continue;
+            conn_i.emplace_back(k, (bra_str ^ ket.strings[k]).count() / 2);
+          }
+        }
+
+        std::sort(conn_i.begin(), conn_i.end());
+        conn_i.erase(std::unique(conn_i.begin(), conn_i.end()), conn_i.end());
+      }
+    }
+
+    auto list = std::make_shared<string_connection_list>();
+    list->ptr.resize(nbra + 1);
+    list->ptr[0] = 0;
+    for(size_t i = 0; i < nbra; ++i)
+      list->ptr[i + 1] = list->ptr[i] + conn_local[i].size();
+
+    list->conn.resize(list->ptr[nbra]);
+    for(size_t i = 0; i < nbra; ++i)
+      std::copy(conn_local[i].begin(), conn_local[i].end(),
+                list->conn.begin() + list->ptr[i]);
+
+    return list;
+  }
+
+  /// Offset of [begin, end) within a determinant space (npos if the range is
+  /// empty or not contained in the space)
+  static size_t range_offset(const determinant_space& space,
+                             full_det_iterator begin, full_det_iterator end) {
+    const size_t n = std::distance(begin, end);
+    if(!n or !space.ndets) return npos;
+
+    const full_det_t* base = &*space.begin;
+    const full_det_t* first = &*begin;
+    std::less_equal<const full_det_t*> le;
+    if(!le(base, first) or !le(first + n, base + space.ndets)) return npos;
+    return first - base;
+  }
+
+  string_connectivity make_string_connectivity(full_det_iterator bra_begin,
+                                               full_det_iterator bra_end,
+                                               full_det_iterator ket_begin,
+                                               full_det_iterator ket_end) const {
+    const size_t nket_dets = std::distance(ket_begin, ket_end);
+
+    // Reuse the cached connectivity if it covers both ranges
+    if(conn_cache_) {
+      const auto bra_st = range_offset(*conn_cache_->bra, bra_begin, bra_end);
+      const auto ket_st = range_offset(*conn_cache_->ket, ket_begin, ket_end);
+      if(bra_st != npos and ket_st != npos) {
+        auto conn = *conn_cache_;
+        conn.bra_st = bra_st;
+        conn.ket_st = ket_st;
+        conn.ket_en = ket_st + nket_dets;
+        return conn;
+      }
+    }
+
+    string_connectivity conn;
+    conn.bra = make_determinant_space(bra_begin, bra_end);
+    conn.ket = (bra_begin == ket_begin and bra_end == ket_end)
+                   ? conn.bra
+                   : make_determinant_space(ket_begin, ket_end);
+    conn.alpha_conn = connect_strings(conn.bra->alpha, conn.ket->alpha);
+    conn.beta_conn = connect_strings(conn.bra->beta, conn.ket->beta);
+    conn.ket_en = nket_dets;
+    return conn;
+  }
+
+  /// Occupied orbitals of the alpha / beta string of bra i
+  static auto bra_occupations(const string_connectivity& conn, size_t i) {
+    const auto& bra = *conn.bra;
+    const size_t ib = conn.bra_st + i;
+    return std::tie(bra.alpha.occ[bra.alpha_idx[ib]],
+                    bra.beta.occ[bra.beta_idx[ib]]);
+  }
+
+  /**
+   *  @brief Determine the kets which are connected to a bra determinant.
+   *
+   *  @param[in]  conn String connectivity of the bra / ket ranges
+   *  @param[in]  i    Index of the (non-zero) bra determinant
+   *  @param[out] kets Sorted indices of the connected kets
+   */
+  static void connected_kets(const string_connectivity& conn, size_t i,
+                             std::vector<size_t>& kets) {
+    kets.clear();
+
+    const auto& bra = *conn.bra;
+    const auto& ket = *conn.ket;
+    const auto& alpha_conn = *conn.alpha_conn;
+    const auto& beta_conn = *conn.beta_conn;
+    const auto ua = bra.alpha_idx[conn.bra_st + i];
+    const auto ub = bra.beta_idx[conn.bra_st + i];
+    auto b_begin = beta_conn.conn.begin() + beta_conn.ptr[ub];
+    auto b_end = beta_conn.conn.begin() + beta_conn.ptr[ub + 1];
+    const size_t nb = std::distance(b_begin, b_end);
+
+    auto conn_less = [](const auto& x, uint32_t y) { return x.first < y; };
+    auto add_ket = [&](size_t j) {
+      if(j >= conn.ket_st and j < conn.ket_en)
+        kets.emplace_back(j - conn.ket_st);
+    };
+
+    // Loop over connected alpha strings
+    for(auto a_it = alpha_conn.conn.begin() + alpha_conn.ptr[ua];
+        a_it != alpha_conn.conn.begin() + alpha_conn.ptr[ua + 1]; ++a_it) {
+      const auto [ka, nex_alpha] = *a_it;
+      auto g_begin = ket.groups.begin() + ket.group_ptr[ka];
+      auto g_end = ket.groups.begin() + ket.group_ptr[ka + 1];
+      const size_t ng = std::distance(g_begin, g_end);
+
+      // Intersect the ket group with the beta connections of the bra,
+      // searching in the larger of the two sorted lists
+      if(ng <= nb) {
+        for(auto g_it = g_begin; g_it != g_end; ++g_it) {
+          auto b_it = std::lower_bound(b_begin, b_end, g_it->first, conn_less);
+          if(b_it != b_end and b_it->first == g_it->first and
+             nex_alpha + b_it->second <= 2)
+            add_ket(g_it->second);
+        }
+      } else {
+        for(auto b_it = b_begin; b_it != b_end; ++b_it) {
+          if(nex_alpha + b_it->second > 2) continue;
+          auto g_it = std::lower_bound(g_begin, g_end, b_it->first, conn_less);
+          if(g_it != g_end and g_it->first == b_it->first)
+            add_ket(g_it->second);
+        }
+      }
+    }  // Loop over connected alpha strings
+
+    std::sort(kets.begin(), kets.end());
+  }
+
+  template <typename index_t>
+  sparse_matrix_type<index_t> make_csr_hamiltonian_block_(
+      full_det_iterator bra_begin, full_det_iterator bra_end,
+      full_det_iterator ket_begin, full_det_iterator ket_end, double H_thresh) {
+    const size_t nbra_dets = std::distance(bra_begin, bra_end);
+    const size_t nket_dets = std::distance(ket_begin, ket_end);
+
+    const auto conn =
+        make_string_connectivity(bra_begin, bra_end, ket_begin, ket_end);
+
+    auto make_row_gen = [&]() {
+      return [&, kets = std::vector<size_t>()](
+                 size_t i, std::vector<index_t>& colind,
+                 std::vector<double>& nzval) mutable {
+        const auto bra = *(bra_begin + i);
+        if(!bra.count()) return;
+
+        // Separate out into alpha/beta components
+        spin_det_t bra_alpha = bitset_lo_word(bra);
+        spin_det_t bra_beta = bitset_hi_word(bra);
+
+        // Cached occupied indices
+        const auto [bra_occ_alpha, bra_occ_beta] = bra_occupations(conn, i);
+
+        // Loop over connected kets
+        connected_kets(conn, i, kets);
+        for(auto j : kets) {
+          const auto ket = *(ket_begin + j);
+          spin_det_t ket_alpha = bitset_lo_word(ket);
+          spin_det_t ket_beta = bitset_hi_word(ket);
+
+          full_det_t ex_total = bra ^ ket;
+          spin_det_t ex_alpha = bitset_lo_word(ex_total);
+          spin_det_t ex_beta = bitset_hi_word(ex_total);
+
+          // Compute Matrix Element
+          const auto h_el = this->matrix_element(bra_alpha, ket_alpha,
+                                                 ex_alpha, bra_beta, ket_beta,
+                                                 ex_beta, bra_occ_alpha,
+                                                 bra_occ_beta);
+
+          if(std::abs(h_el) > H_thresh) {
+            colind.emplace_back(j);
+            nzval.emplace_back(h_el);
+          }
+        }  // Loop over connected kets
+      };
+    };
+
+    return assemble_csr_by_rows<index_t>(nbra_dets, nket_dets, make_row_gen);
+  }
+
+  sparse_matrix_type<int32_t> make_csr_hamiltonian_block_32bit_(
+      full_det_iterator bra_begin, full_det_iterator bra_end,
+      full_det_iterator ket_begin, full_det_iterator ket_end,
+      double H_thresh) override {
+    return make_csr_hamiltonian_block_<int32_t>(bra_begin, bra_end, ket_begin,
+                                                ket_end, H_thresh);
+  }
+
+  sparse_matrix_type<int64_t> make_csr_hamiltonian_block_64bit_(
+      full_det_iterator bra_begin, full_det_iterator bra_end,
+      full_det_iterator ket_begin, full_det_iterator ket_end,
+      double H_thresh) override {
+    return make_csr_hamiltonian_block_<int64_t>(bra_begin, bra_end, ket_begin,
+                                                ket_end, H_thresh);
+  }
+
+ public:
+  void cache_connectivity(full_det_iterator bra_begin,
+                          full_det_iterator bra_end,
+                          full_det_iterator ket_begin,
+                          full_det_iterator ket_end) override {
+    conn_cache_.reset();
+    conn_cache_ =
+        make_string_connectivity(bra_begin, bra_end, ket_begin, ket_end);
+  }
+
+  void release_connectivity() override { conn_cache_.reset(); }
+
+ protected:
+  template <typename Rank4>
+  void form_rdms_impl_(full_det_iterator bra_begin, full_det_iterator bra_end,
+                       full_det_iterator ket_begin, full_det_iterator ket_end,
+                       const double *C_bra, const double *C_ket,
+                       matrix_span_t ordm, Rank4 trdm) {
+    const size_t nbra_dets = std::distance(bra_begin, bra_end);
+
+    const auto conn =
+        make_string_connectivity(bra_begin, bra_end, ket_begin, ket_end);
+
+    // Doubles only contribute to the 2-RDM
+    const size_t max_ex = trdm.data_handle() ? 4 : 2;
+
+    auto make_row_gen = [&]() {
+      return [&, kets = std::vector<size_t>()](
+                 size_t i, matrix_span_t ordm_loc, auto trdm_loc) mutable {
+        const auto bra = *(bra_begin + i);
+        if(!bra.count()) return;
+
+        // Separate out into alpha/beta components
+        spin_det_t bra_alpha = bitset_lo_word(bra);
+        spin_det_t bra_beta = bitset_hi_word(bra);
+
+        // Cached occupied indices
+        const auto [bra_occ_alpha, bra_occ_beta] = bra_occupations(conn, i);
+
+        // Loop over connected kets
+        connected_kets(conn, i, kets);
+        for(auto j : kets) {
+          const auto ket = *(ket_begin + j);
+          spin_det_t ket_alpha = bitset_lo_word(ket);
+          spin_det_t ket_beta = bitset_hi_word(ket);
+
+          full_det_t ex_total = bra ^ ket;
+          if(ex_total.count() > max_ex) continue;
+
+          spin_det_t ex_alpha = bitset_lo_word(ex_total);
+          spin_det_t ex_beta = bitset_hi_word(ex_total);
+
+          const double val = C_bra[i] * C_ket[j];
+
+          if(std::abs(val) > 1e-16) {
+            rdm_contributions(bra_alpha, ket_alpha, ex_alpha, bra_beta,
+                              ket_beta, ex_beta, bra_occ_alpha, bra_occ_beta,
+                              val, ordm_loc, trdm_loc);
+          }
+        }  // Loop over connected kets
+      };
+    };
+
+    accumulate_rdms_by_rows(nbra_dets, ordm, trdm, make_row_gen);
+  }
+
+  void form_rdms_(full_det_iterator bra_begin, full_det_iterator bra_end,
+                  full_det_iterator ket_begin, full_det_iterator ket_end,
+                  const double *C_bra, const double *C_ket, matrix_span_t ordm,
+                  rank4_span_t trdm) override {
+    form_rdms_impl_(bra_begin, bra_end, ket_begin, ket_end, C_bra, C_ket, ordm,
+                    trdm);
+  }
+
+  void form_rdms_(full_det_iterator bra_begin, full_det_iterator bra_end,
+                  full_det_iterator ket_begin, full_det_iterator ket_end,
+                  const double *C_bra, const double *C_ket, matrix_span_t ordm,
+                  packed_rank4_span_t trdm) override {
+    form_rdms_impl_(bra_begin, bra_end, ket_begin, ket_end, C_bra, C_ket, ordm,
+                    trdm);
+  }
+
+ public:
+  template <typename... Args>
+  StringFactoredHamiltonianGenerator(Args &&...args)
+      : HamiltonianGenerator<N>(std::forward<Args>(args)...) {}
+};
+
+}  // namespace macis
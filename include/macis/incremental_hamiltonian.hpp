@@ -0,0 +1,384 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <macis/csr_hamiltonian.hpp>
+#include <macis/hamiltonian_generator.hpp>
+#include <macis/types.hpp>
+#include <macis/util/csr_assembly.hpp>
+#include <macis/util/mpi.hpp>
+#include <macis/wfn_index_map.hpp>
+#include <memory>
+
+namespace macis {
+
+/**
+ *  @brief Distributed CSR Hamiltonian which is updated incrementally as the
+ *  determinant space changes (e.g. across ASCI iterations).
+ *
+ *  On update, the determinants of the new space are matched against those
+ *  of the previous one through a determinant -> index map. The rows of
+ *  surviving determinants are reused from the previous Hamiltonian (fetched
+ *  from their previous owner rank and reindexed into the new space, dropping
+ *  couplings to determinants which have been removed), such that only the
+ *  (survivor, new) and (new, all) couplings are evaluated. The result is
+ *  identical to a full rebuild with make_dist_csr_hamiltonian.
+ *
+ *  The stored elements are only valid for the integrals with which they were
+ *  generated: reset() must be called whenever the integrals of the
+ *  Hamiltonian generator change (e.g. orbital rotations).
+ */
+template <size_t N, typename index_t = int32_t>
+class IncrementalHamiltonian {
+ public:
+  using det_type = wfn_t<N>;
+  using det_iterator = wavefunction_iterator_t<N>;
+  using tile_type = sparsexx::csr_matrix<double, index_t>;
+  using matrix_type = sparsexx::dist_sparse_matrix<tile_type>;
+
+ protected:
+  MPI_Comm comm_;
+  std::vector<det_type> dets_;      ///< Determinants of the current H
+  std::unique_ptr<matrix_type> H_;  ///< Current Hamiltonian
+  double H_thresh_ = 0.0;           ///< Threshold of the current H
+
+  size_t nreused_rows_ = 0;  ///< Rows reused in the last update (global)
+  size_t nnew_dets_ = 0;     ///< New determinants in the last update
+
+  /// Rows of H with global column indices
+  struct row_buffer {
+    std::vector<size_t> rowptr = {0};
+    std::vector<size_t> colind;
+    std::vector<double> nzval;
+  };
+
+  /// Append the locally owned row `r` of the current H (global indices)
+  void append_local_row(size_t r, std::vector<size_t>& colind,
+                        std::vector<double>& nzval) const {
+    const size_t row_st = H_->local_row_start();
+    const size_t i = r - row_st;
+
+    const auto& A = H_->diagonal_tile();
+    for(auto j = A.rowptr()[i]; j < A.rowptr()[i + 1]; ++j) {
+      colind.emplace_back(A.colind()[j] + row_st);
+      nzval.emplace_back(A.nzval()[j]);
+    }
+
+    if(H_->off_diagonal_tile_ptr()) {
+      const auto& B = H_->off_diagonal_tile();
+      for(auto j = B.rowptr()[i]; j < B.rowptr()[i + 1]; ++j) {
+        colind.emplace_back(B.colind()[j]);
+        nzval.emplace_back(B.nzval()[j]);
+      }
+    }
+  }
+
+  /**
+   *  @brief Fetch rows of the current H from their owner ranks.
+   *
+   *  Collective over the communicator.
+   *
+   *  @param[in] rows Global row indices (current H) required on this rank
+   *  @returns   Requested rows (in order) with global column indices
+   */
+  row_buffer fetch_rows(const std::vector<size_t>& rows) const {
+    const int world_size = comm_size(comm_);
+    auto owner = [&](size_t r) {
+      int p = 0;
+      while(r >= size_t(H_->row_bounds(p).second)) ++p;
+      return p;
+    };
+
+    auto exclusive_scan = [](const std::vector<int>& counts) {
+      std::vector<int> displs(counts.size(), 0);
+      for(size_t p = 1; p < counts.size(); ++p)
+        displs[p] = displs[p - 1] + counts[p - 1];
+      return displs;
+    };
+
+    // Pack requests by owner rank
+    std::vector<int> req_counts(world_size, 0);
+    std::vector<int> row_owner(rows.size());
+    for(size_t k = 0; k < rows.size(); ++k) {
+      row_owner[k] = owner(rows[k]);
+      req_counts[row_owner[k]]++;
+    }
+    auto req_displs = exclusive_scan(req_counts);
+
+    std::vector<size_t> req(rows.size()), req_pos(rows.size());
+    {
+      auto fill = req_displs;
+      for(size_t k = 0; k < rows.size(); ++k) {
+        req_pos[k] = fill[row_owner[k]]++;
+        req[req_pos[k]] = rows[k];
+      }
+    }
+
+    // Exchange requests
+    std::vector<int> srv_counts(world_size);
+    MPI_Alltoall(req_counts.data(), 1, MPI_INT, srv_counts.data(), 1, MPI_INT,
+                 comm_);
+    auto srv_displs = exclusive_scan(srv_counts);
+    std::vector<size_t> srv(srv_displs.back() + srv_counts.back());
+    MPI_Alltoallv(req.data(), req_counts.data(), req_displs.data(),
+                  MPI_UINT64_T, srv.data(), srv_counts.data(),
+                  srv_displs.data(), MPI_UINT64_T, comm_);
+
+    // Serve requested rows
+    std::vector<size_t> srv_len(srv.size()), srv_colind;
+    std::vector<double> srv_nzval;
+    std::vector<int> srv_data_counts(world_size, 0);
+    for(int p = 0; p < world_size; ++p)
+      for(int k = srv_displs[p]; k < srv_displs[p] + srv_counts[p]; ++k) {
+        const auto nnz_st = srv_colind.size();
+        append_local_row(srv[k], srv_colind, srv_nzval);
+        srv_len[k] = srv_colind.size() - nnz_st;
+        srv_data_counts[p] += srv_len[k];
+      }
+    auto srv_data_displs = exclusive_scan(srv_data_counts);
+
+    // Return row lengths and row data
+    std::vector<size_t> req_len(rows.size());
+    MPI_Alltoallv(srv_len.data(), srv_counts.data(), srv_displs.data(),
+                  MPI_UINT64_T, req_len.data(), req_counts.data(),
+                  req_displs.data(), MPI_UINT64_T, comm_);
+
+    std::vector<int> req_data_counts(world_size, 0);
+    for(int p = 0; p < world_size; ++p)
+      for(int k = req_displs[p]; k < req_displs[p] + req_counts[p]; ++k)
+        req_data_counts[p] += req_len[k];
+    auto req_data_displs = exclusive_scan(req_data_counts);
+    const size_t nreq_data = req_data_displs.back() + req_data_counts.back();
+
+    std::vector<size_t> req_colind(nreq_data);
+    std::vector<double> req_nzval(nreq_data);
+    MPI_Alltoallv(srv_colind.data(), srv_data_counts.data(),
+                  srv_data_displs.data(), MPI_UINT64_T, req_colind.data(),
+                  req_data_counts.data(), req_data_displs.data(), MPI_UINT64_T,
+                  comm_);
+    MPI_Alltoallv(srv_nzval.data(), srv_data_counts.data(),
+                  srv_data_displs.data(), MPI_DOUBLE, req_nzval.data(),
+                  req_data_counts.data(), req_data_displs.data(), MPI_DOUBLE,
+                  comm_);
+
+    // Unpack into request order
+    std::vector<size_t> req_ptr(rows.size() + 1, 0);
+    std::partial_sum(req_len.begin(), req_len.end(), req_ptr.begin() + 1);
+
+    row_buffer out;
+    out.rowptr.resize(rows.size() + 1);
+    out.colind.reserve(nreq_data);
+    out.nzval.reserve(nreq_data);
+    for(size_t k = 0; k < rows.size(); ++k) {
+      const auto j_st = req_ptr[req_pos[k]];
+      const auto j_en = req_ptr[req_pos[k] + 1];
+      out.colind.insert(out.colind.end(), req_colind.begin() + j_st,
+                        req_colind.begin() + j_en);
+      out.nzval.insert(out.nzval.end(), req_nzval.begin() + j_st,
+                       req_nzval.begin() + j_en);
+      out.rowptr[k + 1] = out.colind.size();
+    }
+
+    return out;
+  }
+
+  /// Split local rows (global column indices) into diagonal / off-diagonal
+  /// tiles
+  static std::pair<tile_type, tile_type> split_local_rows(
+      const tile_type& A, size_t row_st, size_t row_en) {
+    const size_t nlocal = A.m();
+    const auto& Arp = A.rowptr();
+    const auto& Aci = A.colind();
+    const auto& Anz = A.nzval();
+
+    std::vector<index_t> diag_rp(nlocal + 1, 0), off_rp(nlocal + 1, 0);
+    std::vector<index_t> diag_ci, off_ci;
+    std::vector<double> diag_nz, off_nz;
+    for(size_t i = 0; i < nlocal; ++i) {
+      for(auto j = Arp[i]; j < Arp[i + 1]; ++j) {
+        const size_t c = Aci[j];
+        if(c >= row_st and c < row_en) {
+          diag_ci.emplace_back(c - row_st);
+          diag_nz.emplace_back(Anz[j]);
+        } else {
+          off_ci.emplace_back(c);
+          off_nz.emplace_back(Anz[j]);
+        }
+      }
+      diag_rp[i + 1] = diag_ci.size();
+      off_rp[i + 1] = off_ci.size();
+    }
+
+    return std::make_pair(
+        tile_type(nlocal, nlocal, std::move(diag_rp), std::move(diag_ci),
+                  std::move(diag_nz)),
+        tile_type(nlocal, A.n(), std::move(off_rp), std::move(off_ci),
+                  std::move(off_nz)));
+  }
+
+ public:
+  IncrementalHamiltonian(MPI_Comm comm) : comm_(comm) {}
+
+  /// Whether a Hamiltonian is currently stored
+  inline bool empty() const { return !H_; }
+
+  /// Discard the stored Hamiltonian (e.g. after the integrals changed)
+  inline void reset() {
+    H_.reset();
+    dets_.clear();
+  }
+
+  inline const matrix_type& hamiltonian() const { return *H_; }
+  inline size_t nreused_rows() const { return nreused_rows_; }
+  inline size_t nnew_dets() const { return nnew_dets_; }
+
+  /**
+   *  @brief Update the Hamiltonian to a new determinant space.
+   *
+   *  Collective over the communicator.
+   *
+   *  @param[in] dets_begin Start of the (replicated) determinant list
+   *  @param[in] dets_end   End of the determinant list
+   *  @param[in] ham_gen    Hamiltonian generator
+   *  @param[in] H_thresh   Threshold below which matrix elements are dropped
+   *  @param[in] row_tiles  Row extents of each rank (optional, defaults to a
+   *                        uniform tiling)
+   *  @returns   The Hamiltonian over [dets_begin, dets_end)
+   */
+  const matrix_type& update(
+      det_iterator dets_begin, det_iterator dets_end,
+      HamiltonianGenerator<N>& ham_gen, double H_thresh,
+      const std::vector<typename matrix_type::extent_type>& row_tiles = {}) {
+    // Elements screened with a different threshold can not be reused
+    if(H_ and H_thresh != H_thresh_) reset();
+
+    const size_t ndets = std::distance(dets_begin, dets_end);
+    auto H_new = row_tiles.size()
+                     ? std::make_unique<matrix_type>(comm_, ndets, ndets,
+                                                     row_tiles)
+                     : std::make_unique<matrix_type>(comm_, ndets, ndets);
+    const auto [row_st, row_en] = H_new->row_bounds(comm_rank(comm_));
+    const size_t nlocal = row_en - row_st;
+
+    // Map the new determinants onto the previous ones
+    std::vector<int64_t> new_to_old(ndets, -1);
+    std::vector<int64_t> old_to_new(dets_.size(), -1);
+    if(H_) {
+      wfn_index_map<N> old_index(dets_);
+#pragma omp parallel for schedule(static)
+      for(size_t i = 0; i < ndets; ++i) {
+        const auto old_i = old_index.find(*(dets_begin + i));
+        if(old_i != old_index.npos) {
+          new_to_old[i] = old_i;
+          old_to_new[old_i] = i;
+        }
+      }
+    }
+
+    // Determinants which are not in the previous space
+    std::vector<size_t> fresh_idx;
+    std::vector<det_type> fresh_dets;
+    for(size_t i = 0; i < ndets; ++i)
+      if(new_to_old[i] < 0) {
+        fresh_idx.emplace_back(i);
+        fresh_dets.emplace_back(*(dets_begin + i));
+      }
+
+    // Classify local rows: reused (survivor) vs generated (fresh)
+    std::vector<int64_t> row_slot(nlocal);
+    std::vector<size_t> surv_old_rows;
+    std::vector<det_type> surv_dets, fresh_bra_dets;
+    for(size_t i = 0; i < nlocal; ++i) {
+      const auto old_i = new_to_old[row_st + i];
+      if(old_i >= 0) {
+        row_slot[i] = surv_old_rows.size();
+        surv_old_rows.emplace_back(old_i);
+        surv_dets.emplace_back(*(dets_begin + row_st + i));
+      } else {
+        row_slot[i] = -int64_t(fresh_bra_dets.size()) - 1;
+        fresh_bra_dets.emplace_back(*(dets_begin + row_st + i));
+      }
+    }
+
+    // Fetch the previous rows of the survivors
+    row_buffer surv_rows;
+    if(H_) surv_rows = fetch_rows(surv_old_rows);
+
+    // (survivor, fresh) couplings
+    tile_type H_sf;
+    const bool has_sf = surv_dets.size() and fresh_dets.size();
+    if(has_sf)
+      H_sf = make_csr_hamiltonian_block<index_t>(
+          surv_dets.begin(), surv_dets.end(), fresh_dets.begin(),
+          fresh_dets.end(), ham_gen, H_thresh);
+
+    // (fresh, all) couplings
+    tile_type H_fa;
+    if(fresh_bra_dets.size())
+      H_fa = make_csr_hamiltonian_block<index_t>(
+          fresh_bra_dets.begin(), fresh_bra_dets.end(), dets_begin, dets_end,
+          ham_gen, H_thresh);
+
+    // Assemble local rows with global column indices
+    auto make_row_gen = [&]() {
+      return [&, row = std::vector<std::pair<index_t, double>>()](
+                 size_t i, std::vector<index_t>& colind,
+                 std::vector<double>& nzval) mutable {
+        const auto slot = row_slot[i];
+        if(slot < 0) {
+          // Fresh row, generated against the full space
+          const auto k = -(slot + 1);
+          const auto& rp = H_fa.rowptr();
+          colind.insert(colind.end(), H_fa.colind().begin() + rp[k],
+                        H_fa.colind().begin() + rp[k + 1]);
+          nzval.insert(nzval.end(), H_fa.nzval().begin() + rp[k],
+                       H_fa.nzval().begin() + rp[k + 1]);
+          return;
+        }
+
+        // Reindex the previous row, drop removed determinants
+        row.clear();
+        for(auto j = surv_rows.rowptr[slot]; j < surv_rows.rowptr[slot + 1];
+            ++j) {
+          const auto c = old_to_new[surv_rows.colind[j]];
+          if(c >= 0) row.emplace_back(c, surv_rows.nzval[j]);
+        }
+
+        // Couplings to the fresh determinants
+        if(has_sf) {
+          const auto& rp = H_sf.rowptr();
+          for(auto j = rp[slot]; j < rp[slot + 1]; ++j)
+            row.emplace_back(fresh_idx[H_sf.colind()[j]], H_sf.nzval()[j]);
+        }
+
+        std::sort(row.begin(), row.end(), [](const auto& a, const auto& b) {
+          return a.first < b.first;
+        });
+        for(auto [c, v] : row) {
+          colind.emplace_back(c);
+          nzval.emplace_back(v);
+        }
+      };
+    };
+
+    auto H_loc = assemble_csr_by_rows<index_t>(nlocal, ndets, make_row_gen);
+    auto [H_diag, H_off] = split_local_rows(H_loc, row_st, row_en);
+    H_new->set_diagonal_tile(std::move(H_diag));
+    if(comm_size(comm_) > 1) H_new->set_off_diagonal_tile(std::move(H_off));
+
+    nreused_rows_ = allreduce(surv_old_rows.size(), MPI_SUM, comm_);
+    nnew_dets_ = fresh_idx.size();
+
+    H_ = std::move(H_new);
+    H_thresh_ = H_thresh;
+    dets_.assign(dets_begin, dets_end);
+    return *H_;
+  }
+};
+
+}  // namespace macis
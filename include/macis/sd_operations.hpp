@@ -498,17 +498,22 @@ uint32_t first_occupied_flipped(std::bitset<N> state, std::bitset<N> ex) {
   return ffs(state & ex) - 1u;
 }
 
-// TODO: Test this function
+/**
+ *  @brief Parity of the single excitation p <-> q acting on `state`
+ *
+ *  @returns 0 (even) or 1 (odd) permutation parity
+ */
 template <size_t N>
-double single_excitation_sign(std::bitset<N> state, unsigned p, unsigned q) {
-  std::bitset<N> mask = 0ul;
+inline uint32_t single_excitation_parity(std::bitset<N> state, unsigned p,
+                                         unsigned q) {
+  return popcount_between(state, p, q) & 1u;
+}
 
-  if(p > q) {
-    mask = state & (full_mask<N>(p) ^ full_mask<N>(q + 1));
-  } else {
-    mask = state & (full_mask<N>(q) ^ full_mask<N>(p + 1));
-  }
-  return (mask.count() % 2) ? -1. : 1.;
+/// Fermionic sign of the single excitation p <-> q acting on `state`
+template <size_t N>
+inline double single_excitation_sign(std::bitset<N> state, unsigned p,
+                                     unsigned q) {
+  return 1. - 2. * single_excitation_parity(state, p, q);
 }
 
 // TODO: Test this function
@@ -529,15 +534,16 @@ inline auto doubles_sign_indices(std::bitset<N> bra, std::bitset<N> ket,
                                  std::bitset<N> ex) {
   const auto o1 = first_occupied_flipped(ket, ex);
   const auto v1 = first_occupied_flipped(bra, ex);
-  auto sign = single_excitation_sign(ket, v1, o1);
+  auto parity = single_excitation_parity(ket, v1, o1);
 
   ket.flip(o1).flip(v1);
   ex.flip(o1).flip(v1);
 
   const auto o2 = first_occupied_flipped(ket, ex);
   const auto v2 = first_occupied_flipped(bra, ex);
-  sign *= single_excitation_sign(ket, v2, o2);
+  parity ^= single_excitation_parity(ket, v2, o2);
 
+  const double sign = 1. - 2. * parity;
   return std::make_tuple(o1, v1, o2, v2, sign);
 }
 
@@ -30,9 +30,14 @@ class SparseMatrixOperator {
   sparsexx::spblas::spmv_info<index_type> m_spmv_info_;
 
  public:
-  SparseMatrixOperator(const SpMatType& m) : m_matrix_(m) {
+  /// Reuses `info` (e.g. from a checkpoint) if provided
+  SparseMatrixOperator(
+      const SpMatType& m,
+      const sparsexx::spblas::spmv_info<index_type>* info = nullptr)
+      : m_matrix_(m) {
     if constexpr(sparsexx::is_dist_sparse_matrix_v<SpMatType>) {
-      m_spmv_info_ = sparsexx::spblas::generate_spmv_comm_info(m);
+      m_spmv_info_ =
+          info ? *info : sparsexx::spblas::generate_spmv_comm_info(m);
     }
   }
 
@@ -46,6 +51,73 @@ class SparseMatrixOperator {
   }
 };
 
+/**
+ *  @brief Davidson operator for a symmetric sparse matrix of which only the
+ *  upper triangle is stored (e.g. make_dist_csr_hamiltonian_upper).
+ */
+template <typename SpMatType>
+class SymmetricSparseMatrixOperator {
+  using index_type = typename SpMatType::index_type;
+
+  const SpMatType& m_matrix_;
+  sparsexx::spblas::spmv_info<index_type> m_spmv_info_;
+
+ public:
+  /// Reuses `info` (e.g. from a checkpoint) if provided
+  SymmetricSparseMatrixOperator(
+      const SpMatType& m,
+      const sparsexx::spblas::spmv_info<index_type>* info = nullptr)
+      : m_matrix_(m) {
+    if constexpr(sparsexx::is_dist_sparse_matrix_v<SpMatType>) {
+      m_spmv_info_ =
+          info ? *info : sparsexx::spblas::generate_spmv_comm_info(m);
+    }
+  }
+
+  void operator_action(size_t m, double alpha, const double* V, size_t LDV,
+                       double beta, double* AV, size_t LDAV) const {
+    if constexpr(sparsexx::is_dist_sparse_matrix_v<SpMatType>) {
+      sparsexx::spblas::psyspmv(alpha, m_matrix_, V, beta, AV, m_spmv_info_);
+    } else {
+      sparsexx::spblas::syspmbv(m, alpha, m_matrix_, V, LDV, beta, AV, LDAV);
+    }
+  }
+};
+
+/**
+ *  @brief Davidson operator for a mixed-precision sparse matrix, i.e. a
+ *  (distributed) sparse matrix stored in reduced precision together with an
+ *  explicit double-precision diagonal (e.g. make_dist_csr_hamiltonian_mixed).
+ *  Products are accumulated in double precision.
+ */
+template <typename SpMatType>
+class MixedPrecisionSparseMatrixOperator {
+  using index_type = typename SpMatType::index_type;
+
+  const SpMatType& m_matrix_;
+  const double* m_diagonal_;
+  sparsexx::spblas::spmv_info<index_type> m_spmv_info_;
+
+ public:
+  MixedPrecisionSparseMatrixOperator(const SpMatType& m, const double* D)
+      : m_matrix_(m), m_diagonal_(D) {
+    if constexpr(sparsexx::is_dist_sparse_matrix_v<SpMatType>) {
+      m_spmv_info_ = sparsexx::spblas::generate_spmv_comm_info(m);
+    }
+  }
+
+  void operator_action(size_t m, double alpha, const double* V, size_t LDV,
+                       double beta, double* AV, size_t LDAV) const {
+    if constexpr(sparsexx::is_dist_sparse_matrix_v<SpMatType>) {
+      sparsexx::spblas::mixed_pgespmv(alpha, m_matrix_, m_diagonal_, V, beta,
+                                      AV, m_spmv_info_);
+    } else {
+      sparsexx::spblas::mixed_gespmbv<SpMatType, double>(
+          m, alpha, m_matrix_, m_diagonal_, V, LDV, beta, AV, LDAV);
+    }
+  }
+};
+
 template <typename SpMatType>
 void diagonal_guess(size_t N, const SpMatType& A, double* X) {
   // Extract diagonal and setup guess
@@ -94,6 +166,29 @@ void p_diagonal_guess(size_t N_local, const SpMatType& A, double* X) {
   }
 }
 
+inline void p_diagonal_guess(size_t N_local, const double* D_local, double* X,
+                             MPI_Comm comm) {
+  // Determine local min
+  struct {
+    double val;
+    int rank;
+  } local_min, global_min;
+
+  auto D_min = std::min_element(D_local, D_local + N_local);
+  local_min.val = N_local ? *D_min : std::numeric_limits<double>::infinity();
+  local_min.rank = comm_rank(comm);
+
+  // Determine owner rank of the global min
+  MPI_Allreduce(&local_min, &global_min, 1, MPI_DOUBLE_INT, MPI_MINLOC, comm);
+
+  // Zero out guess
+  for(size_t i = 0; i < N_local; ++i) X[i] = 0.;
+
+  if(global_min.rank == local_min.rank) {
+    X[std::distance(D_local, D_min)] = 1.;
+  }
+}
+
 inline void gram_schmidt(int64_t N, int64_t K, const double* V_old, int64_t LDV,
                          double* V_new) {
   std::vector<double> inner(K);
@@ -264,10 +359,12 @@ inline void p_rayleigh_ritz(int64_t N_local, int64_t K, const double* X,
   MPI_Bcast(C, K * K, MPI_DOUBLE, 0, comm);
 }
 
+// If require_convergence is false, exhausting the subspace returns the
+// current Ritz pair (with iter == max_m) rather than throwing
 template <typename Functor>
 auto p_davidson(int64_t N_local, int64_t max_m, const Functor& op,
                 const double* D_local, double tol, double* X_local,
-                MPI_Comm comm) {
+                MPI_Comm comm, bool require_convergence = true) {
   using hrt_t = std::chrono::high_resolution_clock;
   using dur_t = std::chrono::duration<double, std::milli>;
 
@@ -372,8 +469,13 @@ auto p_davidson(int64_t N_local, int64_t max_m, const Functor& op,
 
   }  // Davidson iterations
 
-  if(!converged) throw std::runtime_error("Davidson Did Not Converge!");
-  logger->info("Davidson Converged!");
+  if(!converged) {
+    if(require_convergence)
+      throw std::runtime_error("Davidson Did Not Converge!");
+    logger->info("Davidson Subspace Exhausted");
+  } else {
+    logger->info("Davidson Converged!");
+  }
 
   return std::make_pair(iter, LAM[0]);
 }
@@ -0,0 +1,189 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <macis/csr_hamiltonian.hpp>
+#include <macis/hamiltonian_generator.hpp>
+#include <macis/types.hpp>
+#include <macis/util/mpi.hpp>
+#include <sparsexx/spblas/spmbv.hpp>
+
+namespace macis {
+
+/**
+ *  @brief Matrix-free (direct) Hamiltonian operator for Davidson.
+ *
+ *  Rather than storing the (distributed) CSR Hamiltonian, the action of H on
+ *  a set of vectors is recomputed from the determinant list and integrals at
+ *  each application. The locally owned rows are processed in batches of
+ *  `row_batch_size` rows, for each of which a transient CSR block of H
+ *  against the full determinant space is generated by the Hamiltonian
+ *  generator and immediately contracted with the (gathered) input vectors.
+ *  The memory footprint is thus bounded by a single row batch rather than
+ *  the full local Hamiltonian. The connectivity of the local rows with the
+ *  full determinant space is cached by the generator (see
+ *  `HamiltonianGenerator::cache_connectivity`) for the lifetime of the
+ *  operator, such that only the matrix elements are recomputed.
+ *
+ *  Rows are distributed in contiguous tiles across the ranks of the
+ *  communicator, by default following the partitioning of
+ *  sparsexx::dist_sparse_matrix.
+ *
+ *  Satisfies the operator_action interface of p_davidson.
+ */
+template <size_t N, typename index_t = int32_t>
+class DirectHamiltonianOperator {
+ public:
+  using det_iterator = wavefunction_iterator_t<N>;
+  using extent_type = std::pair<size_t, size_t>;
+
+ protected:
+  MPI_Comm comm_;
+  det_iterator dets_begin_;
+  det_iterator dets_end_;
+  HamiltonianGenerator<N>& ham_gen_;
+  double H_thresh_;
+  size_t row_batch_size_;
+
+  std::vector<extent_type> row_tiles_;
+  size_t local_row_st_;
+  size_t local_row_en_;
+
+  std::vector<double> diag_cache_;      ///< Cached local diagonal (optional)
+  mutable std::vector<double> X_full_;  ///< Gathered input vectors
+
+  static std::vector<extent_type> default_row_tiles(size_t ndets,
+                                                    MPI_Comm comm) {
+    const size_t world_size = comm_size(comm);
+    const size_t nrow_per_rank = ndets / world_size;
+    std::vector<extent_type> tiles(world_size);
+    for(size_t i = 0; i < world_size; ++i)
+      tiles[i] = {i * nrow_per_rank, (i + 1) * nrow_per_rank};
+    tiles.back().second += ndets % world_size;  // Last rank gets carry-over
+    return tiles;
+  }
+
+  std::vector<double> compute_diagonal() const {
+    const size_t nlocal = local_row_extent();
+    std::vector<double> D(nlocal);
+    auto local_begin = dets_begin_ + local_row_st_;
+    ham_gen_.diagonal_elements(local_begin, local_begin + nlocal, D.data());
+    return D;
+  }
+
+ public:
+  /**
+   *  @param[in] comm           MPI communicator over which rows are
+   *                            distributed
+   *  @param[in] dets_begin     Start of the (replicated) determinant list
+   *  @param[in] dets_end       End of the determinant list
+   *  @param[in] ham_gen        Hamiltonian generator
+   *  @param[in] H_thresh       Threshold below which matrix elements are
+   *                            dropped
+   *  @param[in] cache_diagonal Whether to store the local diagonal of H
+   *  @param[in] row_batch_size Number of rows of H generated at once
+   *  @param[in] row_tiles      Row extents of each rank (optional)
+   */
+  DirectHamiltonianOperator(MPI_Comm comm, det_iterator dets_begin,
+                            det_iterator dets_end,
+                            HamiltonianGenerator<N>& ham_gen, double H_thresh,
+                            bool cache_diagonal = true,
+                            size_t row_batch_size = 4096,
+                            std::vector<extent_type> row_tiles = {})
+      : comm_(comm),
+        dets_begin_(dets_begin),
+        dets_end_(dets_end),
+        ham_gen_(ham_gen),
+        H_thresh_(H_thresh),
+        row_batch_size_(std::max<size_t>(row_batch_size, 1)),
+        row_tiles_(std::move(row_tiles)) {
+    const size_t ndets = std::distance(dets_begin, dets_end);
+    if(row_tiles_.empty()) row_tiles_ = default_row_tiles(ndets, comm);
+    if(row_tiles_.size() != size_t(comm_size(comm)))
+      throw std::runtime_error("Incorrect Row Tile Size");
+    if(row_tiles_.front().first != 0 or row_tiles_.back().second != ndets)
+      throw std::runtime_error("Invalid Row Tile Bounds");
+
+    std::tie(local_row_st_, local_row_en_) = row_tiles_[comm_rank(comm)];
+    if(cache_diagonal) diag_cache_ = compute_diagonal();
+
+    ham_gen_.cache_connectivity(dets_begin_ + local_row_st_,
+                                dets_begin_ + local_row_en_, dets_begin_,
+                                dets_end_);
+  }
+
+  // The connectivity cache of the generator is owned by the operator
+  DirectHamiltonianOperator(const DirectHamiltonianOperator&) = delete;
+  DirectHamiltonianOperator& operator=(const DirectHamiltonianOperator&) =
+      delete;
+
+  ~DirectHamiltonianOperator() noexcept { ham_gen_.release_connectivity(); }
+
+  inline MPI_Comm comm() const { return comm_; }
+  inline size_t m() const { return std::distance(dets_begin_, dets_end_); }
+  inline size_t n() const { return m(); }
+  inline const auto& row_tiles() const { return row_tiles_; }
+  inline size_t local_row_start() const { return local_row_st_; }
+  inline size_t local_row_extent() const {
+    return local_row_en_ - local_row_st_;
+  }
+
+  /// Local diagonal of H (from the cache if available)
+  std::vector<double> diagonal() const {
+    return diag_cache_.size() ? diag_cache_ : compute_diagonal();
+  }
+
+  /**
+   *  @brief AV = ALPHA * H * V + BETA * AV for the locally owned rows.
+   *
+   *  @param[in]     m     Number of vectors
+   *  @param[in]     alpha First scaling factor
+   *  @param[in]     V     Local rows of the input vectors
+   *  @param[in]     LDV   Leading dimension of V
+   *  @param[in]     beta  Second scaling factor
+   *  @param[in/out] AV    Local rows of the output vectors
+   *  @param[in]     LDAV  Leading dimension of AV
+   */
+  void operator_action(size_t m, double alpha, const double* V, size_t LDV,
+                       double beta, double* AV, size_t LDAV) const {
+    const size_t ndets = this->m();
+    const size_t nlocal = local_row_extent();
+    const int world_size = comm_size(comm_);
+
+    // Gather the full input vectors
+    std::vector<int> counts(world_size), displs(world_size);
+    for(int i = 0; i < world_size; ++i) {
+      counts[i] = row_tiles_[i].second - row_tiles_[i].first;
+      displs[i] = row_tiles_[i].first;
+    }
+
+    X_full_.resize(ndets * m);
+    for(size_t k = 0; k < m; ++k) {
+      if(world_size > 1) {
+        MPI_Allgatherv(V + k * LDV, nlocal, MPI_DOUBLE,
+                       X_full_.data() + k * ndets, counts.data(),
+                       displs.data(), MPI_DOUBLE, comm_);
+      } else {
+        std::copy_n(V + k * LDV, nlocal, X_full_.data() + k * ndets);
+      }
+    }
+
+    // Generate H in row batches and contract
+    for(size_t r_st = 0; r_st < nlocal; r_st += row_batch_size_) {
+      const size_t r_en = std::min(r_st + row_batch_size_, nlocal);
+      auto bra_begin = dets_begin_ + local_row_st_ + r_st;
+      auto bra_end = dets_begin_ + local_row_st_ + r_en;
+      auto H_blk = make_csr_hamiltonian_block<index_t>(
+          bra_begin, bra_end, dets_begin_, dets_end_, ham_gen_, H_thresh_);
+      sparsexx::spblas::gespmbv(m, alpha, H_blk, X_full_.data(), ndets, beta,
+                                AV + r_st, LDAV);
+    }
+  }
+};
+
+}  // namespace macis
@@ -8,23 +8,39 @@
 
 #pragma once
 #include <chrono>
+#include <optional>
 #include <macis/csr_hamiltonian.hpp>
 #include <macis/hamiltonian_generator.hpp>
+#include <macis/incremental_hamiltonian.hpp>
 #include <macis/solvers/davidson.hpp>
+#include <macis/solvers/direct_hamiltonian_operator.hpp>
 #include <macis/types.hpp>
 #include <macis/util/mpi.hpp>
 #include <sparsexx/matrix_types/dense_conversions.hpp>
 
 namespace macis {
 
+/**
+ *  @brief Solve for the lowest eigenpair of a (distributed) sparse
+ *  Hamiltonian.
+ *
+ *  If `upper` is set, only the upper triangle of H is stored (see
+ *  make_dist_csr_hamiltonian_upper) and products are formed by symmetric
+ *  SpMV. The SpMV communication info of H is generated unless `spmv_info`
+ *  is provided (e.g. by make_dist_csr_hamiltonian_checkpointed).
+ */
 template <typename SpMatType>
-double selected_ci_diag(const SpMatType& H, size_t davidson_max_m,
-                        double davidson_res_tol, std::vector<double>& C_local,
-                        MPI_Comm comm) {
+double selected_ci_diag(
+    const SpMatType& H, size_t davidson_max_m, double davidson_res_tol,
+    std::vector<double>& C_local, MPI_Comm comm, const bool quiet = false,
+    const bool upper = false,
+    const sparsexx::spblas::spmv_info<typename SpMatType::index_type>*
+        spmv_info = nullptr) {
   auto logger = spdlog::get("ci_solver");
   if(!logger) {
     logger = spdlog::stdout_color_mt("ci_solver");
   }
+  const auto log_level = quiet ? spdlog::level::debug : spdlog::level::info;
 
   using clock_type = std::chrono::high_resolution_clock;
   using duration_type = std::chrono::duration<double, std::milli>;
@@ -42,29 +58,233 @@ double selected_ci_diag(const SpMatType& H, size_t davidson_max_m,
   max_c = std::abs(max_c);
 
   if(max_c > (1. / C_local.size())) {
-    logger->info("  * Will use passed vector as guess");
+    logger->log(log_level, "  * Will use passed vector as guess");
   } else {
-    logger->info("  * Will generate identity guess");
+    logger->log(log_level, "  * Will generate identity guess");
     p_diagonal_guess(C_local.size(), H, C_local.data());
   }
 
-  // Setup Davidson Functor
-  SparseMatrixOperator op(H);
+  // Solve EVP
+  MPI_Barrier(comm);
+  auto dav_st = clock_type::now();
+
+  auto davidson = [&](const auto& op) {
+    return p_davidson(H.local_row_extent(), davidson_max_m, op, D_local.data(),
+                      davidson_res_tol, C_local.data(), H.comm());
+  };
+  auto [niter, E] = [&]() {
+    // Symmetric SpMV is only available for CSR tiles
+    using tile_type = typename SpMatType::tile_type;
+    if constexpr(sparsexx::detail::is_csr_matrix_v<tile_type>) {
+      if(upper) return davidson(SymmetricSparseMatrixOperator(H, spmv_info));
+    }
+    return davidson(SparseMatrixOperator(H, spmv_info));
+  }();
+
+  MPI_Barrier(comm);
+  auto dav_en = clock_type::now();
+
+  logger->log(log_level, "  {} = {:4}, {} = {:.6e} Eh, {} = {:.5e} ms",
+              "DAV_NITER", niter, "E0", E, "DAVIDSON_DUR",
+              duration_type(dav_en - dav_st).count());
+
+  return E;
+}
+
+/**
+ *  @brief Solve for the lowest eigenpair of the Hamiltonian over a
+ *  determinant space without storing H (see DirectHamiltonianOperator).
+ *
+ *  H is regenerated in batches of `row_batch_size` rows for each product.
+ *  Rows are tiled uniformly unless `balance_nnz` is set, in which case
+ *  the tiling of make_nnz_balanced_row_tiles is used. The eigenvector
+ *  (C_local) follows the row tiling.
+ */
+template <size_t N, typename index_t = int32_t>
+double selected_ci_diag_direct(wavefunction_iterator_t<N> dets_begin,
+                               wavefunction_iterator_t<N> dets_end,
+                               HamiltonianGenerator<N>& ham_gen,
+                               double h_el_tol, size_t davidson_max_m,
+                               double davidson_res_tol,
+                               std::vector<double>& C_local, MPI_Comm comm,
+                               const bool quiet = false,
+                               const bool balance_nnz = false,
+                               size_t row_batch_size = 4096) {
+  auto logger = spdlog::get("ci_solver");
+  if(!logger) {
+    logger = spdlog::stdout_color_mt("ci_solver");
+  }
+  const auto log_level = quiet ? spdlog::level::debug : spdlog::level::info;
+
+  logger->log(log_level, "[Selected CI Solver (Direct)]:");
+  logger->log(log_level, "  {} = {:6}, {} = {:.5e}, {} = {:.5e}, {} = {:4}",
+              "NDETS", std::distance(dets_begin, dets_end), "MATEL_TOL",
+              h_el_tol, "RES_TOL", davidson_res_tol, "MAX_SUB",
+              davidson_max_m);
+
+  using clock_type = std::chrono::high_resolution_clock;
+  using duration_type = std::chrono::duration<double, std::milli>;
+  using operator_type = DirectHamiltonianOperator<N, index_t>;
+
+  std::vector<typename operator_type::extent_type> row_tiles;
+  if(balance_nnz)
+    for(auto [st, en] :
+        make_nnz_balanced_row_tiles<index_t>(comm, dets_begin, dets_end))
+      row_tiles.emplace_back(st, en);
+
+  // Setup direct operator (caches the diagonal)
+  operator_type op(comm, dets_begin, dets_end, ham_gen, h_el_tol, true,
+                   row_batch_size, std::move(row_tiles));
+  const auto D_local = op.diagonal();
+
+  // Resize eigenvector size
+  const size_t N_local = op.local_row_extent();
+  C_local.resize(N_local, 0);
+
+  // Setup guess
+  auto max_c = *std::max_element(
+      C_local.begin(), C_local.end(),
+      [](auto a, auto b) { return std::abs(a) < std::abs(b); });
+  max_c = std::abs(max_c);
+
+  if(max_c > (1. / C_local.size())) {
+    logger->log(log_level, "  * Will use passed vector as guess");
+  } else {
+    logger->log(log_level, "  * Will generate identity guess");
+    p_diagonal_guess(N_local, D_local.data(), C_local.data(), comm);
+  }
 
   // Solve EVP
   MPI_Barrier(comm);
   auto dav_st = clock_type::now();
 
-  auto [niter, E] =
-      p_davidson(H.local_row_extent(), davidson_max_m, op, D_local.data(),
-                 davidson_res_tol, C_local.data(), H.comm());
+  auto [niter, E] = p_davidson(N_local, davidson_max_m, op, D_local.data(),
+                               davidson_res_tol, C_local.data(), comm);
 
   MPI_Barrier(comm);
   auto dav_en = clock_type::now();
 
-  logger->info("  {} = {:4}, {} = {:.6e} Eh, {} = {:.5e} ms", "DAV_NITER",
-               niter, "E0", E, "DAVIDSON_DUR",
-               duration_type(dav_en - dav_st).count());
+  logger->log(log_level, "  {} = {:4}, {} = {:.6e} Eh, {} = {:.5e} ms",
+              "DAV_NITER", niter, "E0", E, "DAVIDSON_DUR",
+              duration_type(dav_en - dav_st).count());
+
+  return E;
+}
+
+/**
+ *  @brief Solve for the lowest eigenpair of the Hamiltonian over a
+ *  determinant space with single-precision storage of H (see
+ *  make_dist_csr_hamiltonian_mixed).
+ *
+ *  The mixed-precision eigenvector is refined with up to `nrefine`
+ *  iterations of the matrix-free double-precision Hamiltonian. Rows are
+ *  tiled as in selected_ci_diag_direct.
+ */
+template <size_t N, typename index_t = int32_t>
+double selected_ci_diag_mixed(wavefunction_iterator_t<N> dets_begin,
+                              wavefunction_iterator_t<N> dets_end,
+                              HamiltonianGenerator<N>& ham_gen,
+                              double h_el_tol, size_t davidson_max_m,
+                              double davidson_res_tol,
+                              std::vector<double>& C_local, MPI_Comm comm,
+                              const bool quiet = false,
+                              const bool balance_nnz = false,
+                              size_t nrefine = 4) {
+  auto logger = spdlog::get("ci_solver");
+  if(!logger) {
+    logger = spdlog::stdout_color_mt("ci_solver");
+  }
+  const auto log_level = quiet ? spdlog::level::debug : spdlog::level::info;
+
+  logger->log(log_level, "[Selected CI Solver (Mixed Precision)]:");
+  logger->log(log_level, "  {} = {:6}, {} = {:.5e}, {} = {:.5e}, {} = {:4}",
+              "NDETS", std::distance(dets_begin, dets_end), "MATEL_TOL",
+              h_el_tol, "RES_TOL", davidson_res_tol, "MAX_SUB",
+              davidson_max_m);
+
+  using clock_type = std::chrono::high_resolution_clock;
+  using duration_type = std::chrono::duration<double, std::milli>;
+
+  // Generate Hamiltonian
+  MPI_Barrier(comm);
+  auto H_st = clock_type::now();
+
+  std::vector<std::pair<index_t, index_t>> row_tiles;
+  if(balance_nnz)
+    row_tiles = make_nnz_balanced_row_tiles<index_t>(comm, dets_begin,
+                                                     dets_end);
+  auto H = make_dist_csr_hamiltonian_mixed<index_t>(
+      comm, dets_begin, dets_end, ham_gen, h_el_tol, 8, row_tiles);
+
+  auto H_en = clock_type::now();
+  MPI_Barrier(comm);
+
+  size_t local_nnz = H.nnz();
+  size_t total_nnz = allreduce(local_nnz, MPI_SUM, comm);
+  logger->log(log_level, "  {}   = {:6}, {}     = {:.5e} ms", "NNZ",
+              total_nnz, "H_DUR", duration_type(H_en - H_st).count());
+  logger->log(log_level, "  {} = {:.2e} GiB", "HMEM_LOC",
+              H.mem_footprint() / 1073741824.);
+
+  // Resize eigenvector size
+  const size_t N_local = H.local_row_extent();
+  C_local.resize(N_local, 0);
+
+  // Setup guess
+  auto max_c = *std::max_element(
+      C_local.begin(), C_local.end(),
+      [](auto a, auto b) { return std::abs(a) < std::abs(b); });
+  max_c = std::abs(max_c);
+
+  if(max_c > (1. / C_local.size())) {
+    logger->log(log_level, "  * Will use passed vector as guess");
+  } else {
+    logger->log(log_level, "  * Will generate identity guess");
+    p_diagonal_guess(N_local, H.D_local.data(), C_local.data(), comm);
+  }
+
+  // Solve EVP in mixed precision
+  MPI_Barrier(comm);
+  auto dav_st = clock_type::now();
+
+  MixedPrecisionSparseMatrixOperator op(H.H, H.D_local.data());
+  auto [niter, E] = p_davidson(N_local, davidson_max_m, op, H.D_local.data(),
+                               davidson_res_tol, C_local.data(), comm);
+
+  MPI_Barrier(comm);
+  auto dav_en = clock_type::now();
+
+  logger->log(log_level, "  {} = {:4}, {} = {:.6e} Eh, {} = {:.5e} ms",
+              "DAV_NITER", niter, "E0", E, "DAVIDSON_DUR",
+              duration_type(dav_en - dav_st).count());
+
+  // Refine the mixed-precision solution with a few iterations of the
+  // (matrix-free) double precision Hamiltonian, starting from the mixed
+  // precision eigenvector (on the row tiling of H)
+  if(nrefine) {
+    auto ref_st = clock_type::now();
+
+    using operator_type = DirectHamiltonianOperator<N, index_t>;
+    std::vector<typename operator_type::extent_type> op_tiles;
+    for(int i = 0; i < comm_size(comm); ++i)
+      op_tiles.emplace_back(H.H.row_bounds(i));
+    operator_type op_dp(comm, dets_begin, dets_end, ham_gen, h_el_tol, false,
+                        4096, std::move(op_tiles));
+    const int64_t max_m = nrefine + 1;
+    std::tie(niter, E) =
+        p_davidson(N_local, max_m, op_dp, H.D_local.data(), davidson_res_tol,
+                   C_local.data(), comm, false);
+
+    MPI_Barrier(comm);
+    auto ref_en = clock_type::now();
+
+    logger->log(log_level, "  {} = {:4}, {} = {:.6e} Eh, {} = {:.5e} ms",
+                "REF_NITER", niter, "E0", E, "REFINE_DUR",
+                duration_type(ref_en - ref_st).count());
+    if(niter == max_m)
+      logger->warn("  * Refinement did not reach RES_TOL in {} iterations",
+                   nrefine);
+  }
 
   return E;
 }
@@ -75,16 +295,46 @@ double selected_ci_diag(wavefunction_iterator_t<N> dets_begin,
                         HamiltonianGenerator<N>& ham_gen, double h_el_tol,
                         size_t davidson_max_m, double davidson_res_tol,
                         std::vector<double>& C_local, MPI_Comm comm,
-                        const bool quiet = false) {
+                        const bool quiet = false,
+                        IncrementalHamiltonian<N, index_t>* H_cache = nullptr,
+                        const bool balance_nnz = false,
+                        const bool upper = false,
+                        const std::string& h_checkpoint = "",
+                        const bool direct = false, const bool mixed = false,
+                        const bool compressed = false) {
+  // At most one alternative storage of H, of which only the upper triangle
+  // can be checkpointed and none can be cached incrementally
+  if(int(upper) + int(direct) + int(mixed) + int(compressed) > 1)
+    throw std::runtime_error(
+        "selected_ci_diag: Upper, Direct, Mixed Precision and Compressed H "
+        "are Exclusive");
+  if((direct or mixed or compressed) and (H_cache or h_checkpoint.size()))
+    throw std::runtime_error(
+        "selected_ci_diag: Direct, Mixed Precision and Compressed H Require "
+        "H_cache == nullptr and no H Checkpoint");
+
+  // The matrix-free and mixed-precision solvers generate their own H
+  if(direct)
+    return selected_ci_diag_direct<N, index_t>(
+        dets_begin, dets_end, ham_gen, h_el_tol, davidson_max_m,
+        davidson_res_tol, C_local, comm, quiet, balance_nnz);
+  if(mixed)
+    return selected_ci_diag_mixed<N, index_t>(
+        dets_begin, dets_end, ham_gen, h_el_tol, davidson_max_m,
+        davidson_res_tol, C_local, comm, quiet, balance_nnz);
+
   auto logger = spdlog::get("ci_solver");
   if(!logger) {
     logger = spdlog::stdout_color_mt("ci_solver");
   }
+  // Quiet solves (e.g. CASSCF micro-iterations) only report at debug level
+  const auto log_level = quiet ? spdlog::level::debug : spdlog::level::info;
 
-  logger->info("[Selected CI Solver]:");
-  logger->info("  {} = {:6}, {} = {:.5e}, {} = {:.5e}, {} = {:4}", "NDETS",
-               std::distance(dets_begin, dets_end), "MATEL_TOL", h_el_tol,
-               "RES_TOL", davidson_res_tol, "MAX_SUB", davidson_max_m);
+  logger->log(log_level, "[Selected CI Solver]:");
+  logger->log(log_level, "  {} = {:6}, {} = {:.5e}, {} = {:.5e}, {} = {:4}",
+              "NDETS", std::distance(dets_begin, dets_end), "MATEL_TOL",
+              h_el_tol, "RES_TOL", davidson_res_tol, "MAX_SUB",
+              davidson_max_m);
 
   using clock_type = std::chrono::high_resolution_clock;
   using duration_type = std::chrono::duration<double, std::milli>;
@@ -93,43 +343,93 @@ double selected_ci_diag(wavefunction_iterator_t<N> dets_begin,
   MPI_Barrier(comm);
   auto H_st = clock_type::now();
 
-  auto H = make_dist_csr_hamiltonian<index_t>(comm, dets_begin, dets_end,
-                                              ham_gen, h_el_tol);
+  // Rows are tiled uniformly unless nonzero balancing is requested. The
+  // eigenvector (C_local) follows the tiling of H
+  std::vector<std::pair<index_t, index_t>> row_tiles;
+  if(balance_nnz)
+    row_tiles = make_nnz_balanced_row_tiles<index_t>(comm, dets_begin,
+                                                     dets_end);
+
+  // Reuse the previous Hamiltonian if an incremental cache is provided.
+  // Otherwise only the upper triangle (or H with 16 bit column gaps) is
+  // generated if requested, and H is reloaded from (or written to) a
+  // checkpoint if a prefix is given
+  if(H_cache and upper)
+    throw std::runtime_error(
+        "selected_ci_diag: Upper Triangular H Requires H_cache == nullptr");
+  if(H_cache and h_checkpoint.size())
+    throw std::runtime_error(
+        "selected_ci_diag: H Checkpoint Requires H_cache == nullptr");
+  std::optional<typename IncrementalHamiltonian<N, index_t>::matrix_type>
+      H_full;
+  std::optional<sparsexx::dist_sparse_matrix<
+      sparsexx::compressed_csr_matrix<double, index_t, uint16_t>>>
+      H_compressed;
+  sparsexx::spblas::spmv_info<index_t> H_info;  // Checkpointed SpMV info
+  if(compressed)
+    H_compressed.emplace(
+        make_dist_csr_hamiltonian_compressed<index_t, uint16_t>(
+            comm, dets_begin, dets_end, ham_gen, h_el_tol, row_tiles));
+  else if(h_checkpoint.size())
+    H_full.emplace(make_dist_csr_hamiltonian_checkpointed<index_t>(
+        h_checkpoint, comm, dets_begin, dets_end, ham_gen, h_el_tol,
+        row_tiles, upper, &H_info));
+  else if(!H_cache and upper)
+    H_full.emplace(make_dist_csr_hamiltonian_upper<index_t>(
+        comm, dets_begin, dets_end, ham_gen, h_el_tol, 8, row_tiles));
+  else if(!H_cache)
+    H_full.emplace(make_dist_csr_hamiltonian<index_t>(
+        comm, dets_begin, dets_end, ham_gen, h_el_tol, row_tiles));
+  const auto* H_csr = H_full ? &*H_full : nullptr;
+  if(H_cache)
+    H_csr = &H_cache->update(dets_begin, dets_end, ham_gen, h_el_tol,
+                             row_tiles);
 
   auto H_en = clock_type::now();
   MPI_Barrier(comm);
 
-  // Get total NNZ
-  size_t local_nnz = H.nnz();
-  size_t total_nnz = allreduce(local_nnz, MPI_SUM, comm);
-  size_t max_nnz = allreduce(local_nnz, MPI_MAX, comm);
-  size_t min_nnz = allreduce(local_nnz, MPI_MIN, comm);
-  logger->info("  {}   = {:6}, {}     = {:.5e} ms", "NNZ", total_nnz, "H_DUR",
-               duration_type(H_en - H_st).count());
-  auto world_size = comm_size(comm);
-  if(world_size > 1) {
-    double local_hdur = duration_type(H_en - H_st).count();
-    double max_hdur = allreduce(local_hdur, MPI_MAX, comm);
-    double min_hdur = allreduce(local_hdur, MPI_MIN, comm);
-    double avg_hdur = allreduce(local_hdur, MPI_SUM, comm);
-    avg_hdur /= world_size;
-    logger->info(
-        "  H_DUR_MAX = {:.2e} ms, H_DUR_MIN = {:.2e} ms, H_DUR_AVG = {:.2e} ms",
-        max_hdur, min_hdur, avg_hdur);
-  }
-  logger->info("  {} = {:.2e} GiB", "HMEM_LOC",
-               H.mem_footprint() / 1073741824.);
-  logger->info("  {} = {:.2f}%", "H_SPARSE",
-               total_nnz / double(H.n() * H.n()) * 100);
-  if(world_size > 1) {
-    logger->info("  NNZ_MAX = {}, NNZ_MIN = {}, NNZ_AVG = {}", max_nnz, min_nnz,
-                 total_nnz / double(world_size));
+  if(H_cache) {
+    logger->log(log_level, "  {} = {:6}, {} = {:6}", "H_REUSED_ROWS",
+                H_cache->nreused_rows(), "H_NEW_DETS", H_cache->nnew_dets());
   }
 
-  // Solve EVP
-  auto E = selected_ci_diag(H, davidson_max_m, davidson_res_tol, C_local, comm);
+  auto report_and_solve = [&](const auto& H) {
+    // Get total NNZ
+    size_t local_nnz = H.nnz();
+    size_t total_nnz = allreduce(local_nnz, MPI_SUM, comm);
+    size_t max_nnz = allreduce(local_nnz, MPI_MAX, comm);
+    size_t min_nnz = allreduce(local_nnz, MPI_MIN, comm);
+    logger->log(log_level, "  {}   = {:6}, {}     = {:.5e} ms", "NNZ",
+                total_nnz, "H_DUR", duration_type(H_en - H_st).count());
+    auto world_size = comm_size(comm);
+    if(world_size > 1) {
+      double local_hdur = duration_type(H_en - H_st).count();
+      double max_hdur = allreduce(local_hdur, MPI_MAX, comm);
+      double min_hdur = allreduce(local_hdur, MPI_MIN, comm);
+      double avg_hdur = allreduce(local_hdur, MPI_SUM, comm);
+      avg_hdur /= world_size;
+      logger->log(log_level,
+                  "  H_DUR_MAX = {:.2e} ms, H_DUR_MIN = {:.2e} ms, "
+                  "H_DUR_AVG = {:.2e} ms",
+                  max_hdur, min_hdur, avg_hdur);
+    }
+    logger->log(log_level, "  {} = {:.2e} GiB", "HMEM_LOC",
+                H.mem_footprint() / 1073741824.);
+    logger->log(log_level, "  {} = {:.2f}%", "H_SPARSE",
+                total_nnz / double(H.n() * H.n()) * 100);
+    if(world_size > 1) {
+      logger->log(log_level, "  NNZ_MAX = {}, NNZ_MIN = {}, NNZ_AVG = {}",
+                  max_nnz, min_nnz, total_nnz / double(world_size));
+    }
 
-  return E;
+    // Solve EVP
+    return selected_ci_diag(H, davidson_max_m, davidson_res_tol, C_local, comm,
+                            quiet, upper,
+                            h_checkpoint.size() ? &H_info : nullptr);
+  };
+
+  return H_compressed ? report_and_solve(*H_compressed)
+                      : report_and_solve(*H_csr);
 }
 
 }  // namespace macis
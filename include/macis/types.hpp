@@ -85,5 +85,6 @@ using NumOrbital = NamedType<size_t, struct norb_type>;
 using NumActive = NamedType<size_t, struct nactive_type>;
 using NumInactive = NamedType<size_t, struct ninactive_type>;
 using NumVirtual = NamedType<size_t, struct nvirtual_type>;
+using NumCholeskyVector = NamedType<size_t, struct ncholesky_type>;
 
 }  // namespace macis
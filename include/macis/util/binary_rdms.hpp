@@ -16,4 +16,14 @@ void read_rdms_binary(std::string fname, size_t norb, double* ORDM, size_t LDD1,
 void write_rdms_binary(std::string fname, size_t norb, const double* ORDM,
                        size_t LDD1, const double* TRDM, size_t LDD2);
 
+/// Write RDMs in the dense binary format from a packed 2-RDM (see
+/// `packed_rank4_span`). The packed storage only retains the average of
+/// each element over its 8 index permutations, so the 2-RDM written here is
+/// that permutation-averaged tensor rather than the element-wise 2-RDM
+/// written by `write_rdms_binary`. Contractions with real, 8-fold symmetric
+/// integrals (energies, generalized Fock matrices) are unaffected.
+void write_rdms_binary_packed(std::string fname, size_t norb,
+                              const double* ORDM, size_t LDD1,
+                              const double* TRDM);
+
 }  // namespace macis
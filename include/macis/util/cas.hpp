@@ -10,9 +10,46 @@
 #include <macis/solvers/selected_ci_diag.hpp>
 #include <macis/types.hpp>
 #include <macis/util/mcscf.hpp>
+#include <macis/util/mpi.hpp>
+#include <macis/util/packed_rdms.hpp>
 
 namespace macis {
 
+namespace detail {
+
+template <typename HamGen, typename Rank4>
+double compute_casci_rdms(MCSCFSettings settings, NumOrbital norb,
+                          size_t nalpha, size_t nbeta, double* T, double* V,
+                          double* ORDM, Rank4 TRDM, std::vector<double>& C,
+                          MPI_Comm comm) {
+  constexpr auto nbits = HamGen::nbits;
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  // Hamiltonian Matrix Element Generator
+  size_t no = norb.get();
+  HamGen ham_gen(matrix_span<double>(T, no, no),
+                 rank4_span<double>(V, no, no, no, no));
+
+  // Compute Lowest Energy Eigenvalue (ED)
+  auto dets = generate_hilbert_space<nbits>(norb.get(), nalpha, nbeta);
+  double E0 = selected_ci_diag<nbits, int32_t>(
+      dets.begin(), dets.end(), ham_gen, settings.ci_matel_tol,
+      settings.ci_max_subspace, settings.ci_res_tol, C, comm, true, nullptr,
+      settings.ci_balance_nnz, settings.ci_upper_h, settings.ci_h_checkpoint,
+      settings.ci_direct_h, settings.ci_mixed_h, settings.ci_compressed_h);
+
+  // Compute RDMs (C follows the row tiling of H)
+  const auto C_full = comm_size(comm) > 1 ? allgatherv(C, comm) : C;
+  ham_gen.form_rdms(dets.begin(), dets.end(), C_full.data(),
+                    matrix_span<double>(ORDM, no, no), TRDM, comm);
+
+  return E0;
+}
+
+}  // namespace detail
+
 /**
  *  @brief Compute the CAS-CI 1- and 2-RDMs
  *
@@ -34,28 +71,25 @@ double compute_casci_rdms(MCSCFSettings settings, NumOrbital norb,
                           size_t nalpha, size_t nbeta, double* T, double* V,
                           double* ORDM, double* TRDM, std::vector<double>& C,
                           MPI_Comm comm) {
-  constexpr auto nbits = HamGen::nbits;
-
-  int rank;
-  MPI_Comm_rank(comm, &rank);
-
-  // Hamiltonian Matrix Element Generator
-  size_t no = norb.get();
-  HamGen ham_gen(matrix_span<double>(T, no, no),
-                 rank4_span<double>(V, no, no, no, no));
-
-  // Compute Lowest Energy Eigenvalue (ED)
-  auto dets = generate_hilbert_space<nbits>(norb.get(), nalpha, nbeta);
-  double E0 = selected_ci_diag(dets.begin(), dets.end(), ham_gen,
-                               settings.ci_matel_tol, settings.ci_max_subspace,
-                               settings.ci_res_tol, C, comm, true);
-
-  // Compute RDMs
-  ham_gen.form_rdms(dets.begin(), dets.end(), dets.begin(), dets.end(),
-                    C.data(), matrix_span<double>(ORDM, no, no),
-                    rank4_span<double>(TRDM, no, no, no, no));
+  const size_t no = norb.get();
+  return detail::compute_casci_rdms<HamGen>(
+      settings, norb, nalpha, nbeta, T, V, ORDM,
+      rank4_span<double>(TRDM, no, no, no, no), C, comm);
+}
 
-  return E0;
+/**
+ *  @brief Compute the CAS-CI 1-RDM and the 8-fold symmetry packed 2-RDM
+ *  (see `packed_rank4_span`)
+ *
+ *  Same as `compute_casci_rdms`, with O(norb^4 / 8) 2-RDM storage.
+ */
+template <typename HamGen>
+double compute_casci_rdms(MCSCFSettings settings, NumOrbital norb,
+                          size_t nalpha, size_t nbeta, double* T, double* V,
+                          double* ORDM, packed_rank4_span<double> TRDM,
+                          std::vector<double>& C, MPI_Comm comm) {
+  return detail::compute_casci_rdms<HamGen>(settings, norb, nalpha, nbeta, T,
+                                            V, ORDM, TRDM, C, comm);
 }
 
 /// Functor wraper around `compute_casci_rdms`
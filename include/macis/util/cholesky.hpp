@@ -0,0 +1,85 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <macis/types.hpp>
+#include <vector>
+
+namespace macis {
+
+/**
+ *  @brief Pivoted (incomplete) Cholesky decomposition of dense ERIs.
+ *
+ *  Decomposes the (pq|rs) supermatrix as
+ *
+ *  (pq|rs) ~ \sum_P L(p,q,P) * L(r,s,P)
+ *
+ *  such that the largest error on the diagonal is below `tol`. Columns of
+ *  the supermatrix are only formed for the selected pivots, and only the
+ *  unique (p>=q) pairs are decomposed.
+ *
+ *  @param[in]  norb Number of orbitals
+ *  @param[in]  V    Dense ERIs (column major)
+ *  @param[in]  LDV  The (single index) leading dimension of `V`
+ *  @param[in]  tol  Decomposition threshold
+ *
+ *  @returns The Cholesky vectors L as a [norb, norb, naux] column major
+ *  tensor, i.e. naux = size() / norb^2.
+ */
+std::vector<double> cholesky_decompose_eris(NumOrbital norb, const double* V,
+                                            size_t LDV, double tol);
+
+/**
+ *  @brief Pivoted Cholesky decomposition of 8-fold symmetry packed ERIs.
+ *
+ *  Same as `cholesky_decompose_eris`, but takes ERIs in the layout of
+ *  `packed_eri_span`, e.g. as read by `read_fcidump_2body_packed`.
+ *
+ *  @param[in]  norb Number of orbitals
+ *  @param[in]  V    Packed ERIs of size `packed_rank4_size(norb)`
+ *  @param[in]  tol  Decomposition threshold
+ *
+ *  @returns The Cholesky vectors L as a [norb, norb, naux] column major
+ *  tensor.
+ */
+std::vector<double> cholesky_decompose_packed_eris(NumOrbital norb,
+                                                   const double* V,
+                                                   double tol);
+
+/**
+ *  @brief Expand Cholesky vectors into dense ERIs.
+ *
+ *  V(p,q,r,s) = \sum_P L(p,q,P) * L(r,s,P)
+ *
+ *  @param[in]  norb Number of orbitals
+ *  @param[in]  naux Number of Cholesky vectors
+ *  @param[in]  L    Cholesky vectors
+ *  @param[in]  LDL  The (single index) leading dimension of `L`
+ *  @param[out] V    Dense ERIs
+ *  @param[in]  LDV  The (single index) leading dimension of `V`
+ */
+void cholesky_to_eris(NumOrbital norb, NumCholeskyVector naux, const double* L,
+                      size_t LDL, double* V, size_t LDV);
+
+/**
+ *  @brief Expand Cholesky vectors into 8-fold symmetry packed ERIs.
+ *
+ *  Same as `cholesky_to_eris`, with the ERIs stored as in `packed_eri_span`.
+ *  A sub-block of the orbitals may be expanded by offsetting `L` (e.g. the
+ *  active space with L + ninact * (LDL + 1)).
+ *
+ *  @param[in]  norb Number of orbitals
+ *  @param[in]  naux Number of Cholesky vectors
+ *  @param[in]  L    Cholesky vectors
+ *  @param[in]  LDL  The (single index) leading dimension of `L`
+ *  @param[out] P    Packed ERIs of size `packed_rank4_size(norb)`
+ */
+void cholesky_to_packed_eris(NumOrbital norb, NumCholeskyVector naux,
+                             const double* L, size_t LDL, double* P);
+
+}  // namespace macis
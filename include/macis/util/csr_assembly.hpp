@@ -0,0 +1,152 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <algorithm>
+#include <numeric>
+#include <sparsexx/matrix_types/csr_matrix.hpp>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace macis {
+
+namespace detail {
+
+inline size_t csr_assembly_max_threads() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+}  // namespace detail
+
+/**
+ *  @brief Assemble a CSR matrix row-by-row in parallel.
+ *
+ *  Rows are partitioned into contiguous blocks which are generated
+ *  concurrently into block-local buffers. The per-row nonzero counts are
+ *  then prefix-summed and the block buffers scattered into the final CSR
+ *  arrays. As each row is generated by exactly one call to the row functor,
+ *  the resulting matrix is bitwise identical to a serial row-by-row build
+ *  regardless of the number of threads.
+ *
+ *  @param[in] nrow         Number of rows of the matrix
+ *  @param[in] ncol         Number of columns of the matrix
+ *  @param[in] make_row_gen Callable invoked once per thread which returns a
+ *                          (possibly stateful) row generator `f(i, colind,
+ *                          nzval)` which appends the nonzero entries of row
+ *                          `i` to `colind` / `nzval`.
+ */
+template <typename index_t, typename RowGenFactory>
+sparsexx::csr_matrix<double, index_t> assemble_csr_by_rows(
+    size_t nrow, size_t ncol, RowGenFactory&& make_row_gen) {
+  const size_t nthreads = detail::csr_assembly_max_threads();
+  const size_t nblocks = std::min(nrow, 16 * nthreads);
+  auto block_st = [&](size_t b) { return (b * nrow) / nblocks; };
+
+  std::vector<std::vector<index_t>> colind_blocks(nblocks);
+  std::vector<std::vector<double>> nzval_blocks(nblocks);
+  std::vector<index_t> rowptr(nrow + 1, 0);
+
+  // Generate rows into block-local buffers, rowptr[i+1] <- row count
+#pragma omp parallel
+  {
+    auto row_gen = make_row_gen();
+#pragma omp for schedule(dynamic)
+    for(size_t b = 0; b < nblocks; ++b) {
+      auto& colind = colind_blocks[b];
+      auto& nzval = nzval_blocks[b];
+      for(size_t i = block_st(b); i < block_st(b + 1); ++i) {
+        const size_t nnz_st = colind.size();
+        row_gen(i, colind, nzval);
+        rowptr[i + 1] = colind.size() - nnz_st;
+      }
+    }
+  }
+
+  // Row counts -> row pointers
+  std::partial_sum(rowptr.begin(), rowptr.end(), rowptr.begin());
+  const size_t nnz = rowptr[nrow];
+
+  // Scatter block buffers into the final CSR arrays
+  std::vector<index_t> colind(nnz);
+  std::vector<double> nzval(nnz);
+#pragma omp parallel for schedule(dynamic)
+  for(size_t b = 0; b < nblocks; ++b) {
+    const size_t offset = rowptr[block_st(b)];
+    std::copy(colind_blocks[b].begin(), colind_blocks[b].end(),
+              colind.begin() + offset);
+    std::copy(nzval_blocks[b].begin(), nzval_blocks[b].end(),
+              nzval.begin() + offset);
+    std::vector<index_t>().swap(colind_blocks[b]);
+    std::vector<double>().swap(nzval_blocks[b]);
+  }
+
+  return sparsexx::csr_matrix<double, index_t>(
+      nrow, ncol, std::move(rowptr), std::move(colind), std::move(nzval));
+}
+
+/**
+ *  @brief Concatenate CSR matrices which share a row space along columns.
+ *
+ *  The blocks are assumed to be stored with global column indices and to
+ *  span increasing, non-overlapping column ranges such that the rows of the
+ *  result remain sorted.
+ *
+ *  @param[in] ncol   Number of columns of the result
+ *  @param[in] blocks CSR blocks to concatenate (consumed)
+ */
+template <typename index_t>
+sparsexx::csr_matrix<double, index_t> concatenate_csr_columns(
+    size_t ncol, std::vector<sparsexx::csr_matrix<double, index_t>>&& blocks) {
+  if(blocks.size() == 0)
+    throw std::runtime_error("concatenate_csr_columns: No Blocks");
+  if(blocks.size() == 1) return std::move(blocks[0]);
+
+  const size_t nrow = blocks[0].m();
+  for(auto& blk : blocks)
+    if(size_t(blk.m()) != nrow)
+      throw std::runtime_error("concatenate_csr_columns: Row Mismatch");
+
+  std::vector<index_t> rowptr(nrow + 1, 0);
+  for(auto& blk : blocks) {
+    const auto& blk_rowptr = blk.rowptr();
+    for(size_t i = 0; i < nrow; ++i)
+      rowptr[i + 1] += blk_rowptr[i + 1] - blk_rowptr[i];
+  }
+  std::partial_sum(rowptr.begin(), rowptr.end(), rowptr.begin());
+
+  const size_t nnz = rowptr[nrow];
+  std::vector<index_t> colind(nnz);
+  std::vector<double> nzval(nnz);
+
+#pragma omp parallel for
+  for(size_t i = 0; i < nrow; ++i) {
+    auto offset = rowptr[i];
+    for(auto& blk : blocks) {
+      const auto row_st = blk.rowptr()[i];
+      const auto row_en = blk.rowptr()[i + 1];
+      std::copy(blk.colind().begin() + row_st, blk.colind().begin() + row_en,
+                colind.begin() + offset);
+      std::copy(blk.nzval().begin() + row_st, blk.nzval().begin() + row_en,
+                nzval.begin() + offset);
+      offset += row_en - row_st;
+    }
+  }
+
+  return sparsexx::csr_matrix<double, index_t>(
+      nrow, ncol, std::move(rowptr), std::move(colind), std::move(nzval));
+}
+
+}  // namespace macis
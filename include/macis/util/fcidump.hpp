@@ -8,10 +8,29 @@
 
 #pragma once
 #include <macis/types.hpp>
+#include <macis/util/packed_eris.hpp>
 #include <string>
 
 namespace macis {
 
+/// Data of the (optional) &FCI namelist of a FCIDUMP file
+struct FCIDumpHeader {
+  size_t norb = 0;   ///< Number of orbitals (NORB)
+  size_t nelec = 0;  ///< Number of electrons (NELEC), 0 if not present
+  int ms2 = 0;       ///< Twice the spin projection (MS2)
+};
+
+/**
+ *  @brief Extract the header data from a FCIDUMP file
+ *
+ *  If NORB is not present, the number of orbitals is taken as the largest
+ *  orbital index, which requires a scan over all integrals.
+ *
+ *  @param[in] fname Filename of FCIDUMP file
+ *  @returns The header data of `fname`
+ */
+FCIDumpHeader read_fcidump_header(std::string fname);
+
 /**
  *  @brief Extract the number of orbitals from a FCIDUMP file
  *
@@ -70,6 +89,48 @@ void read_fcidump_1body(std::string fname, col_major_span<double, 2> T);
  */
 void read_fcidump_2body(std::string fname, col_major_span<double, 4> V);
 
+/**
+ *  @brief Extract the two-body Hamiltonian from a FCIDUMP file
+ *
+ *  8-fold symmetry packed variant, requires norb^4 / 8 storage
+ *
+ *  @param[in]  fname Filename of FCIDUMP file
+ *  @param[out] V The two-body Hamiltonian contained in `filename`
+ */
+void read_fcidump_2body(std::string fname, packed_eri_span<double> V);
+
+/**
+ *  @brief Extract the "core" energy, the one-body and the two-body
+ *  Hamiltonian from a FCIDUMP file in a single pass
+ *
+ *  All FCIDUMP readers memory-map the file and parse it in chunks of lines
+ *  across threads, this variant fills all integrals at once.
+ *
+ *  @param[in]  fname Filename of FCIDUMP file
+ *  @param[out] T The one-body Hamiltonian contained in `filename` (col major)
+ *  @param[in]  LDT The leading dimension of `T`
+ *  @param[out] V The two-body Hamiltonian contained in `filename` (col major)
+ *  @param[in]  LDV The leading dimension of `V`
+ *  @returns The "core" energy of the Hamiltonian in `fname`
+ */
+double read_fcidump(std::string fname, double* T, size_t LDT, double* V,
+                    size_t LDV);
+
+/**
+ *  @brief Extract the "core" energy, the one-body and the two-body
+ *  Hamiltonian from a FCIDUMP file in a single pass
+ *
+ *  8-fold symmetry packed variant of the above
+ *
+ *  @param[in]  fname Filename of FCIDUMP file
+ *  @param[out] T The one-body Hamiltonian contained in `filename` (col major)
+ *  @param[in]  LDT The leading dimension of `T`
+ *  @param[out] V The two-body Hamiltonian contained in `filename`
+ *  @returns The "core" energy of the Hamiltonian in `fname`
+ */
+double read_fcidump(std::string fname, double* T, size_t LDT,
+                    packed_eri_span<double> V);
+
 /**
  *  @brief Write an FCIDUMP file from a 2-body hamiltonian
  *
@@ -172,6 +172,160 @@ void aux_q_matrix(NumActive nact, NumOrbital norb, NumInactive ninact,
                   const double* V, size_t LDV, const double* A2RDM, size_t LDD,
                   double* Q, size_t LDQ);
 
+/** @brief Compute the auxillary Q matrix from a packed active 2-RDM.
+ *
+ *  Same as `aux_q_matrix`, but takes the 8-fold symmetry packed active 2-RDM
+ *  (see `packed_rank4_span`). The contraction over the symmetric (x,y) pair
+ *  is performed as one GEMM over [xy] per active index w, such that only
+ *  O(norb * nact^2) scratch is required.
+ *
+ *  @param[in]  nact   Number of active orbitals
+ *  @param[in]  norb   Number of total orbitals
+ *  @param[in]  ninact Number if inactive orbitals
+ *  @param[in]  V      The MO 2-body hamiltonian
+ *  @param[in]  LDV    The (single index) leading dimension of `V`
+ *  @param[in]  A2RDM  Packed active 2-RDM
+ *  @param[out] Q      The Q matrix.
+ *  @param[in]  LDQ    The leading dimension of `Q`
+ */
+void aux_q_matrix_packed(NumActive nact, NumOrbital norb, NumInactive ninact,
+                         const double* V, size_t LDV, const double* A2RDM,
+                         double* Q, size_t LDQ);
+
+/** @brief Compute the inactive fock matrix from Cholesky vectors.
+ *
+ *  Same as `inactive_fock_matrix`, with the MO 2-body hamiltonian given
+ *  as (pq|rs) = \sum_P L(p,q,P) * L(r,s,P) (see `cholesky_decompose_eris`).
+ *
+ *  @param[in]  norb   Number of total orbitals
+ *  @param[in]  ninact Number of inactive orbitals
+ *  @param[in]  naux   Number of Cholesky vectors
+ *  @param[in]  T      The MO 1-body hamiltonian
+ *  @param[in]  LDT    The leading dimension of `T`
+ *  @param[in]  L      The MO Cholesky vectors
+ *  @param[in]  LDL    The (single index) leading dimension of `L`
+ *  @param[out] Fi     The inactive fock matrix.
+ *  @param[in]  LDFi   The leading dimension of `Fi`
+ */
+void inactive_fock_matrix_cholesky(NumOrbital norb, NumInactive ninact,
+                                   NumCholeskyVector naux, const double* T,
+                                   size_t LDT, const double* L, size_t LDL,
+                                   double* Fi, size_t LDF);
+
+/** @brief Expand the all-active subblock of Cholesky factored ERIs.
+ *
+ *  V_sub(x,y,z,w) = \sum_P L(x',y',P) * L(z',w',P), x' = x + ninact
+ *
+ *  Only the active-active block of the Cholesky vectors is accessed.
+ *
+ *  @param[in]  nact   Number of active orbitals
+ *  @param[in]  ninact Number if inactive orbitals
+ *  @param[in]  naux   Number of Cholesky vectors
+ *  @param[in]  L      The MO Cholesky vectors
+ *  @param[in]  LDL    The (single index) leading dimension of `L`
+ *  @param[out] V_sub  All-active ERIs
+ *  @param[in]  LDVS   Single index leading dimension of `V_sub`
+ */
+void active_subtensor_2body_cholesky(NumActive nact, NumInactive ninact,
+                                     NumCholeskyVector naux, const double* L,
+                                     size_t LDL, double* V_sub, size_t LDVS);
+
+/** @brief Compute the active-space hamiltonian from Cholesky vectors.
+ *
+ *  Same as `active_hamiltonian`, with the full MO 2-body hamiltonian
+ *  given as Cholesky vectors. Only the all-active ERIs are expanded.
+ *
+ *  @param[in]  norb   Number of total orbitals
+ *  @param[in]  nact   Number of active orbitals
+ *  @param[in]  ninact Number if inactive orbitals
+ *  @param[in]  naux   Number of Cholesky vectors
+ *  @param[in]  T_full The full MO 1-body hamiltonian
+ *  @param[in]  LDTF   The leading dimension of `T_full`
+ *  @param[in]  L      The full MO Cholesky vectors
+ *  @param[in]  LDL    The (single index) leading dimension of `L`
+ *  @param[out] Fi     The full MO inactive fock matrix.
+ *  @param[in]  LDFi   The leading dimension of `Fi`
+ *  @param[out] T_act  The act MO 1-body hamiltonian
+ *  @param[in]  LDTF   The leading dimension of `T_act`
+ *  @param[out] V_act  The act MO 2-body hamiltonian
+ *  @param[in]  LDVF   The (single index) leading dimension of `V_act`
+ */
+void active_hamiltonian_cholesky(NumOrbital norb, NumActive nact,
+                                 NumInactive ninact, NumCholeskyVector naux,
+                                 const double* T_full, size_t LDTF,
+                                 const double* L, size_t LDL, double* Fi,
+                                 size_t LDFi, double* T_act, size_t LDTA,
+                                 double* V_act, size_t LDVA);
+
+/** @brief Compute the active Fock matrix from Cholesky vectors.
+ *
+ *  Same as `active_fock_matrix`, with the MO 2-body hamiltonian given as
+ *  Cholesky vectors. The exchange term is evaluated as a single GEMM over
+ *  the compound (w,P) index.
+ *
+ *  @param[in]  norb   Number of total orbitals
+ *  @param[in]  ninact Number if inactive orbitals
+ *  @param[in]  nact   Number of active orbitals
+ *  @param[in]  naux   Number of Cholesky vectors
+ *  @param[in]  L      The MO Cholesky vectors
+ *  @param[in]  LDL    The (single index) leading dimension of `L`
+ *  @param[in]  A1RDM  Active 1-RDM
+ *  @param[in]  LDD    Leading dimention of `A1RDM`
+ *  @param[out] Fa     The active fock matrix.
+ *  @param[in]  LDFa   The leading dimension of `Fa`
+ */
+void active_fock_matrix_cholesky(NumOrbital norb, NumInactive ninact,
+                                 NumActive nact, NumCholeskyVector naux,
+                                 const double* L, size_t LDL,
+                                 const double* A1RDM, size_t LDD, double* Fa,
+                                 size_t LDF);
+
+/** @brief Compute the auxillary Q matrix from Cholesky vectors.
+ *
+ *  Same as `aux_q_matrix`, with the MO 2-body hamiltonian given as
+ *  Cholesky vectors:
+ *
+ *  M(v,w,P) = \sum_{xy} \Gamma^A(v,w,x,y) * L(x,y,P)
+ *  Q(v,p)   = 2 * \sum_{wP} M(v,w,P) * L(p,w,P)
+ *
+ *  @param[in]  nact   Number of active orbitals
+ *  @param[in]  norb   Number of total orbitals
+ *  @param[in]  ninact Number if inactive orbitals
+ *  @param[in]  naux   Number of Cholesky vectors
+ *  @param[in]  L      The MO Cholesky vectors
+ *  @param[in]  LDL    The (single index) leading dimension of `L`
+ *  @param[in]  A2RDM  Active 2-RDM
+ *  @param[in]  LDD    Leading dimention of `A2RDM`
+ *  @param[out] Q      The Q matrix.
+ *  @param[in]  LDQ    The leading dimension of `Q`
+ */
+void aux_q_matrix_cholesky(NumActive nact, NumOrbital norb, NumInactive ninact,
+                           NumCholeskyVector naux, const double* L, size_t LDL,
+                           const double* A2RDM, size_t LDD, double* Q,
+                           size_t LDQ);
+
+/** @brief Compute the auxillary Q matrix from Cholesky vectors and a packed
+ *  active 2-RDM.
+ *
+ *  Same as `aux_q_matrix_cholesky`, but takes the 8-fold symmetry packed
+ *  active 2-RDM (see `packed_rank4_span`). M(v,w,P) is formed one active
+ *  index w at a time.
+ *
+ *  @param[in]  nact   Number of active orbitals
+ *  @param[in]  norb   Number of total orbitals
+ *  @param[in]  ninact Number if inactive orbitals
+ *  @param[in]  naux   Number of Cholesky vectors
+ *  @param[in]  L      The MO Cholesky vectors
+ *  @param[in]  LDL    The (single index) leading dimension of `L`
+ *  @param[in]  A2RDM  Packed active 2-RDM
+ *  @param[out] Q      The Q matrix.
+ *  @param[in]  LDQ    The leading dimension of `Q`
+ */
+void aux_q_matrix_cholesky_packed(NumActive nact, NumOrbital norb,
+                                  NumInactive ninact, NumCholeskyVector naux,
+                                  const double* L, size_t LDL,
+                                  const double* A2RDM, double* Q, size_t LDQ);
+
 /** @brief Compute the generalized Fock given pre-computed contributions.
  *
  *  Compute the generalized Fock matrix given all pre-computed Fock
@@ -282,4 +436,28 @@ double energy_from_generalized_fock(NumInactive ninact, NumActive nact,
                                     const double* A1RDM, size_t LDD,
                                     const double* F, size_t LDF);
 
+/** @brief Compute the active space energy from a packed 2-RDM.
+ *
+ *  E = \sum_{xy} \gamma(x,y) * T(x,y) + \sum_{xyzw} \Gamma(x,y,z,w) *
+ *  V(x,y,z,w)
+ *
+ *  Only the unique elements of the 8-fold symmetric `V` and the packed
+ *  2-RDM (see `packed_rank4_span`) are visited.
+ *
+ *  @param[in] nact   Number of active orbitals
+ *  @param[in] T      The active 1-body hamiltonian
+ *  @param[in] LDT    The leading dimension of `T`
+ *  @param[in] V      The active 2-body hamiltonian
+ *  @param[in] LDV    The (single index) leading dimension of `V`
+ *  @param[in] A1RDM  Active 1-RDM
+ *  @param[in] LDD    Leading dimention of `A1RDM`
+ *  @param[in] A2RDM  Packed active 2-RDM
+ *
+ *  @returns The active space energy
+ */
+double energy_from_packed_rdms(NumActive nact, const double* T, size_t LDT,
+                               const double* V, size_t LDV,
+                               const double* A1RDM, size_t LDD,
+                               const double* A2RDM);
+
 }  // namespace macis
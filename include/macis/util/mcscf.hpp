@@ -10,9 +10,18 @@
 #include <mpi.h>
 
 #include <macis/types.hpp>
+#include <string>
 
 namespace macis {
 
+/// Hamiltonian generators selectable for the CI (see
+/// dispatch_hamiltonian_generator)
+enum class HamiltonianGeneratorType {
+  DoubleLoop,
+  StringFactored,
+  ResidueArrays
+};
+
 struct MCSCFSettings {
   size_t max_macro_iter = 100;
   double max_orbital_step = 0.5;
@@ -28,12 +37,45 @@ struct MCSCFSettings {
   double ci_res_tol = 1e-8;
   size_t ci_max_subspace = 20;
   double ci_matel_tol = std::numeric_limits<double>::epsilon();
+  bool ci_balance_nnz = false;   // Balance H nonzeros (not rows) across ranks
+  bool ci_upper_h = false;       // Store only the upper triangle of H
+  std::string ci_h_checkpoint;   // Prefix of a reusable H checkpoint (if any)
+  bool ci_direct_h = false;      // Regenerate H on the fly (never stored)
+  bool ci_mixed_h = false;       // Store H in single precision
+  bool ci_compressed_h = false;  // Store H with 16 bit column gaps
+  HamiltonianGeneratorType ci_ham_gen = HamiltonianGeneratorType::DoubleLoop;
 };
 
+/**
+ *  @brief CASSCF with DIIS accelerated orbital optimization.
+ *
+ *  The active 2-RDM is held in 8-fold symmetry packed storage (see
+ *  `packed_rank4_span`) throughout the optimization and only unpacked into
+ *  `A2RDM` on exit. The returned 2-RDM is therefore the average of each
+ *  element over its 8 index permutations, which gives the same energy and
+ *  generalized Fock matrix as the element-wise 2-RDM.
+ */
 double casscf_diis(MCSCFSettings settings, NumElectron nalpha,
                    NumElectron nbeta, NumOrbital norb, NumInactive ninact,
                    NumActive nact, NumVirtual nvirt, double E_core, double* T,
                    size_t LDT, double* V, size_t LDV, double* A1RDM,
                    size_t LDD1, double* A2RDM, size_t LDD2, MPI_Comm comm);
 
+/**
+ *  @brief CASSCF with Cholesky factored two-electron integrals.
+ *
+ *  Same as `casscf_diis`, with (pq|rs) = \sum_P L(p,q,P) * L(r,s,P) (see
+ *  `cholesky_decompose_eris`). The full-space integrals are never formed:
+ *  orbital rotations transform the Cholesky vectors and only the all-active
+ *  ERIs are expanded. The returned 2-RDM is permutation-averaged as in
+ *  `casscf_diis`.
+ */
+double casscf_diis_cholesky(MCSCFSettings settings, NumElectron nalpha,
+                            NumElectron nbeta, NumOrbital norb,
+                            NumInactive ninact, NumActive nact,
+                            NumVirtual nvirt, double E_core, double* T,
+                            size_t LDT, NumCholeskyVector naux, double* L,
+                            size_t LDL, double* A1RDM, size_t LDD1,
+                            double* A2RDM, size_t LDD2, MPI_Comm comm);
+
 }  // namespace macis
@@ -15,19 +15,158 @@
 #include <macis/util/orbital_hessian.hpp>
 #include <macis/util/orbital_rotation_utilities.hpp>
 #include <macis/util/orbital_steps.hpp>
+#include <macis/util/packed_rdms.hpp>
 #include <macis/util/transform.hpp>
 
 // #include <ceres/ceres.h>
 
 namespace macis {
 
-template <typename Functor>
+/**
+ *  @brief Dense (norb^4) MO integrals for `mcscf_impl`.
+ *
+ *  Holds the integrals in the current MO basis and provides the
+ *  integral-dependent kernels of the MCSCF iterations.
+ */
+class DenseMCSCFIntegrals {
+  size_t norb_;
+  const double *T_, *V_;  // Original MO basis
+  size_t LDT_, LDV_;
+
+  const double *cur_T_, *cur_V_;  // Current MO basis
+  size_t cur_LDT_, cur_LDV_;
+  std::vector<double> transT_, transV_;
+
+ public:
+  DenseMCSCFIntegrals(NumOrbital norb, const double* T, size_t LDT,
+                      const double* V, size_t LDV)
+      : norb_(norb.get()),
+        T_(T),
+        V_(V),
+        LDT_(LDT),
+        LDV_(LDV),
+        cur_T_(T),
+        cur_V_(V),
+        cur_LDT_(LDT),
+        cur_LDV_(LDV) {}
+
+  /// Transform the original integrals into the MO basis given by `U`
+  void transform(const double* U, size_t LDU) {
+    const size_t no = norb_;
+    transT_.resize(no * no);
+    transV_.resize(no * no * no * no);
+    two_index_transform(no, no, T_, LDT_, U, LDU, transT_.data(), no);
+    four_index_transform(no, no, V_, LDV_, U, LDU, transV_.data(), no);
+    cur_T_ = transT_.data();
+    cur_V_ = transV_.data();
+    cur_LDT_ = no;
+    cur_LDV_ = no;
+  }
+
+  const double* T() const { return cur_T_; }
+  size_t LDT() const { return cur_LDT_; }
+
+  void active_hamiltonian(NumActive nact, NumInactive ninact, double* Fi,
+                          size_t LDFi, double* T_act, size_t LDTA,
+                          double* V_act, size_t LDVA) const {
+    macis::active_hamiltonian(NumOrbital(norb_), nact, ninact, cur_T_,
+                              cur_LDT_, cur_V_, cur_LDV_, Fi, LDFi, T_act,
+                              LDTA, V_act, LDVA);
+  }
+
+  void active_fock_matrix(NumInactive ninact, NumActive nact,
+                          const double* A1RDM, size_t LDD, double* Fa,
+                          size_t LDF) const {
+    macis::active_fock_matrix(NumOrbital(norb_), ninact, nact, cur_V_,
+                              cur_LDV_, A1RDM, LDD, Fa, LDF);
+  }
+
+  /// Q matrix from the packed active 2-RDM (see `packed_rank4_span`)
+  void aux_q_matrix(NumActive nact, NumInactive ninact, const double* A2RDM,
+                    double* Q, size_t LDQ) const {
+    aux_q_matrix_packed(nact, NumOrbital(norb_), ninact, cur_V_, cur_LDV_,
+                        A2RDM, Q, LDQ);
+  }
+};
+
+/**
+ *  @brief Cholesky factored MO integrals for `mcscf_impl`.
+ *
+ *  Same interface as `DenseMCSCFIntegrals`. Orbital rotations transform
+ *  the Cholesky vectors (O(norb^3 * naux)) and only the all-active ERIs
+ *  are expanded.
+ */
+class CholeskyMCSCFIntegrals {
+  size_t norb_, naux_;
+  const double *T_, *L_;  // Original MO basis
+  size_t LDT_, LDL_;
+
+  const double *cur_T_, *cur_L_;  // Current MO basis
+  size_t cur_LDT_, cur_LDL_;
+  std::vector<double> transT_, transL_;
+
+ public:
+  CholeskyMCSCFIntegrals(NumOrbital norb, const double* T, size_t LDT,
+                         NumCholeskyVector naux, const double* L, size_t LDL)
+      : norb_(norb.get()),
+        naux_(naux.get()),
+        T_(T),
+        L_(L),
+        LDT_(LDT),
+        LDL_(LDL),
+        cur_T_(T),
+        cur_L_(L),
+        cur_LDT_(LDT),
+        cur_LDL_(LDL) {}
+
+  /// Transform the original integrals into the MO basis given by `U`
+  void transform(const double* U, size_t LDU) {
+    const size_t no = norb_;
+    transT_.resize(no * no);
+    transL_.resize(no * no * naux_);
+    two_index_transform(no, no, T_, LDT_, U, LDU, transT_.data(), no);
+    cholesky_transform(no, no, naux_, L_, LDL_, U, LDU, transL_.data(), no);
+    cur_T_ = transT_.data();
+    cur_L_ = transL_.data();
+    cur_LDT_ = no;
+    cur_LDL_ = no;
+  }
+
+  const double* T() const { return cur_T_; }
+  size_t LDT() const { return cur_LDT_; }
+
+  void active_hamiltonian(NumActive nact, NumInactive ninact, double* Fi,
+                          size_t LDFi, double* T_act, size_t LDTA,
+                          double* V_act, size_t LDVA) const {
+    active_hamiltonian_cholesky(NumOrbital(norb_), nact, ninact,
+                                NumCholeskyVector(naux_), cur_T_, cur_LDT_,
+                                cur_L_, cur_LDL_, Fi, LDFi, T_act, LDTA, V_act,
+                                LDVA);
+  }
+
+  void active_fock_matrix(NumInactive ninact, NumActive nact,
+                          const double* A1RDM, size_t LDD, double* Fa,
+                          size_t LDF) const {
+    active_fock_matrix_cholesky(NumOrbital(norb_), ninact, nact,
+                                NumCholeskyVector(naux_), cur_L_, cur_LDL_,
+                                A1RDM, LDD, Fa, LDF);
+  }
+
+  /// Q matrix from the packed active 2-RDM (see `packed_rank4_span`)
+  void aux_q_matrix(NumActive nact, NumInactive ninact, const double* A2RDM,
+                    double* Q, size_t LDQ) const {
+    aux_q_matrix_cholesky_packed(nact, NumOrbital(norb_), ninact,
+                                 NumCholeskyVector(naux_), cur_L_, cur_LDL_,
+                                 A2RDM, Q, LDQ);
+  }
+};
+
+template <typename Functor, typename Integrals>
 double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
                   NumElectron nalpha, NumElectron nbeta, NumOrbital norb,
                   NumInactive ninact, NumActive nact, NumVirtual nvirt,
-                  double E_core, double* T, size_t LDT, double* V, size_t LDV,
-                  double* A1RDM, size_t LDD1, double* A2RDM, size_t LDD2,
-                  MPI_Comm comm) {
+                  double E_core, Integrals& ints, double* A1RDM, size_t LDD1,
+                  double* A2RDM, size_t LDD2, MPI_Comm comm) {
   /******************************************************************
    *  Top of MCSCF Routine - Setup and print header info to logger  *
    ******************************************************************/
@@ -68,7 +207,6 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
                nv = nvirt.get();
 
   const size_t no2 = no * no;
-  const size_t no4 = no2 * no2;
   const size_t na2 = na * na;
   const size_t na4 = na2 * na2;
 
@@ -90,6 +228,10 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
   // Storage for active space Hamitonian
   std::vector<double> T_active(na2), V_active(na4);
 
+  // 8-fold symmetry packed active 2-RDM, only unpacked into A2RDM on exit
+  std::vector<double> A2RDM_packed(packed_rank4_size(na));
+  packed_rank4_span<double> A2RDM_span(A2RDM_packed.data(), na);
+
   // CI vector - will be resized on first CI call
   std::vector<double> X_CI;
 
@@ -97,9 +239,6 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
   std::vector<double> F(no2), OG(orb_rot_sz), F_inactive(no2), F_active(no2),
       Q(na * no);
 
-  // Storage for transformed integrals
-  std::vector<double> transT(T, T + no2), transV(V, V + no4);
-
   // Storage for total transformation
   std::vector<double> U_total(no2, 0.0), K_total(no2, 0.0);
 
@@ -115,11 +254,12 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
    **************************************************************/
 
   // Compute Active Space Hamiltonian and Inactive Fock Matrix
-  active_hamiltonian(norb, nact, ninact, T, LDT, V, LDV, F_inactive.data(), no,
-                     T_active.data(), na, V_active.data(), na);
+  ints.active_hamiltonian(nact, ninact, F_inactive.data(), no, T_active.data(),
+                          na, V_active.data(), na);
 
   // Compute Inactive Energy
-  E_inactive = inactive_energy(ninact, T, LDT, F_inactive.data(), no);
+  E_inactive = inactive_energy(ninact, ints.T(), ints.LDT(),
+                               F_inactive.data(), no);
   E_inactive += E_core;
 
   /**************************************************************
@@ -139,12 +279,13 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
     // Compute active RDMs
     logger->info("Computing Initial RDMs");
     std::fill_n(A1RDM, na2, 0.0);
-    std::fill_n(A2RDM, na4, 0.0);
     rdm_op.rdms(settings, NumOrbital(na), nalpha.get(), nbeta.get(),
-                T_active.data(), V_active.data(), A1RDM, A2RDM, X_CI, comm) +
+                T_active.data(), V_active.data(), A1RDM, A2RDM_span, X_CI,
+                comm) +
         E_inactive;
   } else {
     logger->info("Using Passed RDMs");
+    pack_rank4(na, A2RDM, LDD2, A2RDM_packed.data());
   }
 
   /***************************************************************
@@ -154,7 +295,10 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
 
   // Compute Energy from RDMs
   double E_1RDM = blas::dot(na2, A1RDM, 1, T_active.data(), 1);
-  double E_2RDM = blas::dot(na4, A2RDM, 1, V_active.data(), 1);
+  double E_2RDM =
+      energy_from_packed_rdms(nact, T_active.data(), na, V_active.data(), na,
+                              A1RDM, LDD1, A2RDM_packed.data()) -
+      E_1RDM;
 
   E0 = E_1RDM + E_2RDM + E_inactive;
   logger->info("{:8} = {:20.12f}", "E(1RDM)", E_1RDM);
@@ -162,9 +306,8 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
   logger->info("{:8} = {:20.12f}", "E(CI)", E0);
 
   // Compute initial Fock and gradient
-  active_fock_matrix(norb, ninact, nact, V, LDV, A1RDM, LDD1, F_active.data(),
-                     no);
-  aux_q_matrix(nact, norb, ninact, V, LDV, A2RDM, LDD2, Q.data(), na);
+  ints.active_fock_matrix(ninact, nact, A1RDM, LDD1, F_active.data(), no);
+  ints.aux_q_matrix(nact, ninact, A2RDM_packed.data(), Q.data(), na);
   generalized_fock_matrix(norb, ninact, nact, F_inactive.data(), no,
                           F_active.data(), no, A1RDM, LDD1, Q.data(), na,
                           F.data(), no);
@@ -265,8 +408,7 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
     /************************************************************
      *          Transform Hamiltonian into new MO basis         *
      ************************************************************/
-    two_index_transform(no, no, T, LDT, U_total.data(), no, transT.data(), no);
-    four_index_transform(no, no, V, LDV, U_total.data(), no, transV.data(), no);
+    ints.transform(U_total.data(), no);
 
     /************************************************************
      *      Compute Active Space Hamiltonian and associated     *
@@ -274,23 +416,21 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
      ************************************************************/
 
     // Compute Active Space Hamiltonian + inactive Fock
-    active_hamiltonian(norb, nact, ninact, transT.data(), no, transV.data(), no,
-                       F_inactive.data(), no, T_active.data(), na,
-                       V_active.data(), na);
+    ints.active_hamiltonian(nact, ninact, F_inactive.data(), no,
+                            T_active.data(), na, V_active.data(), na);
 
     // Compute Inactive Energy
-    E_inactive =
-        inactive_energy(ninact, transT.data(), no, F_inactive.data(), no) +
-        E_core;
+    E_inactive = inactive_energy(ninact, ints.T(), ints.LDT(),
+                                 F_inactive.data(), no) +
+                 E_core;
 
     /************************************************************
      *       Compute new Active Space RDMs and GS energy        *
      ************************************************************/
 
     std::fill_n(A1RDM, na2, 0.0);
-    std::fill_n(A2RDM, na4, 0.0);
     E0 = rdm_op.rdms(settings, NumOrbital(na), nalpha.get(), nbeta.get(),
-                     T_active.data(), V_active.data(), A1RDM, A2RDM, X_CI,
+                     T_active.data(), V_active.data(), A1RDM, A2RDM_span, X_CI,
                      comm) +
          E_inactive;
 
@@ -301,10 +441,8 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
     std::fill(F.begin(), F.end(), 0.0);
 
     // Update active fock + Q
-    active_fock_matrix(norb, ninact, nact, transV.data(), no, A1RDM, LDD1,
-                       F_active.data(), no);
-    aux_q_matrix(nact, norb, ninact, transV.data(), no, A2RDM, LDD2, Q.data(),
-                 na);
+    ints.active_fock_matrix(ninact, nact, A1RDM, LDD1, F_active.data(), no);
+    ints.aux_q_matrix(nact, ninact, A2RDM_packed.data(), Q.data(), na);
 
     // Compute Fock
     generalized_fock_matrix(norb, ninact, nact, F_inactive.data(), no,
@@ -320,6 +458,7 @@ double mcscf_impl(const Functor& rdm_op, MCSCFSettings settings,
   }
 
   if(converged) logger->info("MCSCF Converged");
+  unpack_rank4(na, A2RDM_packed.data(), A2RDM, LDD2);
   return E0;
 }
 
@@ -7,6 +7,7 @@
  */
 
 #pragma once
+#include <macis/util/mpi.hpp>
 #include <vector>
 
 namespace macis {
@@ -16,4 +17,10 @@ double to_gib(const std::vector<T>& x) {
   return double(x.capacity() * sizeof(T)) / 1024. / 1024. / 1024.;
 }
 
+/// Memory held by `x` per node
+template <typename T>
+double to_gib(const mpi_shared_buffer<T>& x) {
+  return double(x.size() * sizeof(T)) / 1024. / 1024. / 1024.;
+}
+
 }  // namespace macis
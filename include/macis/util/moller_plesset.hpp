@@ -63,4 +63,46 @@ void mp2_natural_orbitals(NumOrbital norb, NumCanonicalOccupied nocc,
                           const double* V, size_t LDV, double* ON, double* NO_C,
                           size_t LDC);
 
+/**
+ *  @brief Form the MP2 1-RDM from Cholesky vectors
+ *
+ *  Only the (ia|jb) block of the two-body Hamiltonian is expanded.
+ *
+ *  @param[in] norb Number of orbitals
+ *  @param[in] nocc Number of occupied orbitals
+ *  @param[in] nvir Number of virtual orbitals
+ *  @param[in] naux Number of Cholesky vectors
+ *  @param[in] T    The one-body Hamiltonian
+ *  @param[in] LDT  The leading dimension of `T`
+ *  @param[in] L    The two-body Hamiltonian as Cholesky vectors
+ *  @param[in] LDL  The (single index) leading dimension of `L`
+ *  @param[out] ORDM The MP2 1-RDM
+ *  @param[in]  LDD  The leading dimension of `ORDM`
+ */
+void mp2_1rdm_cholesky(NumOrbital norb, NumCanonicalOccupied nocc,
+                       NumCanonicalVirtual nvir, NumCholeskyVector naux,
+                       const double* T, size_t LDT, const double* L,
+                       size_t LDL, double* ORDM, size_t LDD);
+
+/**
+ *  @brief Form the MP2 Natural Orbitals from Cholesky vectors
+ *
+ *  @param[in] norb Number of orbitals
+ *  @param[in] nocc Number of occupied orbitals
+ *  @param[in] nvir Number of virtual orbitals
+ *  @param[in] naux Number of Cholesky vectors
+ *  @param[in] T    The one-body Hamiltonian
+ *  @param[in] LDT  The leading dimension of `T`
+ *  @param[in] L    The two-body Hamiltonian as Cholesky vectors
+ *  @param[in] LDL  The (single index) leading dimension of `L`
+ *  @param[out] ON   The MP2 natural orbital occupataion numbers
+ *  @param[out] NO_C The MP2 natural orbital rotation matrix
+ *  @param[in]  LDC  The leading dimension of `NO_C`
+ */
+void mp2_natural_orbitals_cholesky(NumOrbital norb, NumCanonicalOccupied nocc,
+                                   NumCanonicalVirtual nvir,
+                                   NumCholeskyVector naux, const double* T,
+                                   size_t LDT, const double* L, size_t LDL,
+                                   double* ON, double* NO_C, size_t LDC);
+
 }  // namespace macis
@@ -12,6 +12,8 @@
 #include <bitset>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
+#include <vector>
 
 namespace macis {
 
@@ -38,6 +40,26 @@ struct managed_mpi_datatype_impl : public mpi_datatype_impl {
   }
 };
 
+/// @brief Implementation class for lifetime-managed node communicators
+struct mpi_node_comm_impl {
+  MPI_Comm node = MPI_COMM_NULL;
+  MPI_Comm leaders = MPI_COMM_NULL;
+
+  ~mpi_node_comm_impl() noexcept {
+    if(node != MPI_COMM_NULL) MPI_Comm_free(&node);
+    if(leaders != MPI_COMM_NULL) MPI_Comm_free(&leaders);
+  }
+};
+
+/// @brief Implementation class for lifetime-managed shared memory windows
+struct mpi_shared_window_impl {
+  MPI_Win win = MPI_WIN_NULL;
+
+  ~mpi_shared_window_impl() noexcept {
+    if(win != MPI_WIN_NULL) MPI_Win_free(&win);
+  }
+};
+
 }  // namespace detail
 
 /**
@@ -208,6 +230,143 @@ void bcast(T* buffer, size_t count, int root, MPI_Comm comm) {
   }
 }
 
+/**
+ *  @brief Gather a row-distributed vector onto all ranks.
+ *
+ *  The local segments are concatenated in rank order, their lengths need not
+ *  be equal (e.g. non-uniform row tilings).
+ *
+ *  @param[in] local Local segment of the vector
+ *  @param[in] comm  MPI communicator over which the vector is distributed
+ *  @returns   The full vector
+ */
+template <typename T>
+std::vector<T> allgatherv(const std::vector<T>& local, MPI_Comm comm) {
+  auto dtype = mpi_traits<T>::datatype();
+  const int world_size = comm_size(comm);
+
+  int local_count = local.size();
+  std::vector<int> counts(world_size), displs(world_size, 0);
+  MPI_Allgather(&local_count, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+  for(int i = 1; i < world_size; ++i)
+    displs[i] = displs[i - 1] + counts[i - 1];
+
+  std::vector<T> full(displs.back() + counts.back());
+  MPI_Allgatherv(local.data(), local_count, dtype, full.data(), counts.data(),
+                 displs.data(), dtype, comm);
+  return full;
+}
+
+/**
+ *  @brief Lifetime managed decomposition of a communicator into
+ *  shared-memory nodes.
+ *
+ *  `node()` groups the ranks which are able to share memory, `leaders()`
+ *  groups the lowest rank of each node and is `MPI_COMM_NULL` on all other
+ *  ranks. Data held once per node is distributed by broadcasting over
+ *  `leaders()` followed by a `barrier()`.
+ *
+ *  A default constructed instance holds no communicators and denotes that
+ *  data is replicated on every rank.
+ */
+class mpi_node_comm {
+ public:
+  using pimpl_type = detail::mpi_node_comm_impl;
+  using pimpl_pointer_type = std::shared_ptr<pimpl_type>;
+
+  mpi_node_comm() = default;
+
+  /// Split `comm` into shared-memory nodes (collective over `comm`)
+  explicit mpi_node_comm(MPI_Comm comm)
+      : pimpl_(std::make_shared<pimpl_type>()) {
+    const int rank = comm_rank(comm);
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                        &pimpl_->node);
+    const bool leader = !comm_rank(pimpl_->node);
+    MPI_Comm_split(comm, leader ? 0 : MPI_UNDEFINED, rank, &pimpl_->leaders);
+  }
+
+  /// Whether this instance describes a node decomposition
+  inline explicit operator bool() const { return bool(pimpl_); }
+
+  /// Communicator over the ranks of this node
+  inline MPI_Comm node() const { return pimpl_->node; }
+
+  /// Communicator over the node leaders (`MPI_COMM_NULL` on other ranks)
+  inline MPI_Comm leaders() const { return pimpl_->leaders; }
+
+  /// Whether this rank owns (writes) the data held once per node
+  inline bool is_leader() const {
+    return !pimpl_ or pimpl_->leaders != MPI_COMM_NULL;
+  }
+
+  /// Synchronize the ranks of this node, no-op without a decomposition
+  inline void barrier() const {
+    if(pimpl_) MPI_Barrier(pimpl_->node);
+  }
+
+ private:
+  pimpl_pointer_type pimpl_;
+};
+
+/**
+ *  @brief Array held once per node in an MPI-3 shared memory window.
+ *
+ *  The storage is allocated by the node leader and mapped into the address
+ *  space of all ranks of the node. MPI offers no read-only mappings, by
+ *  convention only the node leader writes to the buffer and the writes are
+ *  published to the other ranks with `mpi_node_comm::barrier`.
+ *
+ *  Copies share the underlying window, which is freed (collectively over
+ *  the node) with the last copy.
+ *
+ *  @tparam T Trivially copyable element type
+ */
+template <typename T>
+class mpi_shared_buffer {
+ public:
+  using value_type = T;
+  using pimpl_type = detail::mpi_shared_window_impl;
+  using pimpl_pointer_type = std::shared_ptr<pimpl_type>;
+
+  mpi_shared_buffer() = default;
+
+  /**
+   *  @brief Allocate a node-shared buffer (collective over `comm.node()`)
+   *
+   *  @param[in] n    Number of elements
+   *  @param[in] comm Node decomposition over which the buffer is shared
+   */
+  mpi_shared_buffer(size_t n, const mpi_node_comm& comm)
+      : node_comm_(comm), pimpl_(std::make_shared<pimpl_type>()), size_(n) {
+    if(!comm) throw std::runtime_error("Shared Buffer Requires Node Comm");
+
+    T* base = nullptr;
+    MPI_Aint nbytes = comm.is_leader() ? n * sizeof(T) : 0;
+    MPI_Win_allocate_shared(nbytes, sizeof(T), MPI_INFO_NULL, comm.node(),
+                            &base, &pimpl_->win);
+
+    // Map the storage of the node leader
+    MPI_Aint leader_bytes;
+    int disp_unit;
+    MPI_Win_shared_query(pimpl_->win, 0, &leader_bytes, &disp_unit, &data_);
+  }
+
+  inline T* data() const { return data_; }
+  inline size_t size() const { return size_; }
+  inline T* begin() const { return data_; }
+  inline T* end() const { return data_ + size_; }
+
+  /// Node decomposition over which the buffer is shared
+  inline const mpi_node_comm& node_comm() const { return node_comm_; }
+
+ private:
+  mpi_node_comm node_comm_;
+  pimpl_pointer_type pimpl_;
+  T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
 /// MPI wrapper for `std::bitset`
 template <size_t N>
 struct mpi_traits<std::bitset<N>> {
@@ -0,0 +1,101 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <macis/util/packed_rdms.hpp>
+
+namespace macis {
+
+/**
+ *  @brief Non-owning view of 8-fold symmetry packed (real) ERIs.
+ *
+ *  Stores the unique elements of (pq|rs) under the permutations p<->q,
+ *  r<->s and (pq)<->(rs) with the same layout as `packed_rank4_span`.
+ *  Elements are read through `operator()` with the index order of the
+ *  dense `rank4_span`, such that code templated on the ERI view works
+ *  with either storage.
+ */
+template <typename T>
+class packed_eri_span {
+  T* data_ = nullptr;
+  size_t norb_ = 0;
+
+ public:
+  packed_eri_span() = default;
+  packed_eri_span(T* data, size_t norb) : data_(data), norb_(norb) {}
+
+  T* data_handle() const { return data_; }
+  size_t extent(size_t) const { return norb_; }
+  size_t size() const { return packed_rank4_size(norb_); }
+
+  static constexpr size_t index(size_t p, size_t q, size_t r, size_t s) {
+    return packed_pair_index(packed_pair_index(p, q), packed_pair_index(r, s));
+  }
+
+  T operator()(size_t p, size_t q, size_t r, size_t s) const {
+    return data_[index(p, q, r, s)];
+  }
+};
+
+/**
+ *  @brief View of the exchange antisymmetrized ERIs
+ *  G(p,q,r,s) = (pq|rs) - (ps|rq) over packed ERIs.
+ *
+ *  Evaluated on the fly in place of a dense G tensor.
+ */
+template <typename T>
+class packed_antisym_eri_view {
+  packed_eri_span<T> V_;
+
+ public:
+  packed_antisym_eri_view() = default;
+  packed_antisym_eri_view(packed_eri_span<T> V) : V_(V) {}
+
+  size_t extent(size_t i) const { return V_.extent(i); }
+
+  T operator()(size_t p, size_t q, size_t r, size_t s) const {
+    return V_(p, q, r, s) - V_(p, s, r, q);
+  }
+};
+
+/**
+ *  @brief Pack dense ERIs with 8-fold symmetry.
+ *
+ *  Unlike `pack_rank4`, the canonical element (p>=q, r>=s, (pq)>=(rs)) is
+ *  copied rather than averaged, i.e. `V` is assumed to be symmetric.
+ *
+ *  @param[in]  norb Extent of each index
+ *  @param[in]  V    Dense ERIs (column major)
+ *  @param[in]  LDV  Single index leading dimension of `V`
+ *  @param[out] P    Packed ERIs of size `packed_rank4_size(norb)`
+ */
+template <typename T>
+void pack_eris(size_t norb, const T* V, size_t LDV, T* P) {
+  const size_t LDV2 = LDV * LDV;
+  const size_t LDV3 = LDV2 * LDV;
+  for(size_t p = 0, pq = 0; p < norb; ++p)
+    for(size_t q = 0; q <= p; ++q, ++pq)
+      for(size_t r = 0, rs = 0; rs <= pq; ++r)
+        for(size_t s = 0; s <= r and rs <= pq; ++s, ++rs)
+          P[packed_pair_index(pq, rs)] = V[p + q * LDV + r * LDV2 + s * LDV3];
+}
+
+/**
+ *  @brief Unpack 8-fold symmetry packed ERIs into dense storage.
+ *
+ *  @param[in]  norb Extent of each index
+ *  @param[in]  P    Packed ERIs
+ *  @param[out] V    Dense ERIs (column major)
+ *  @param[in]  LDV  Single index leading dimension of `V`
+ */
+template <typename T>
+void unpack_eris(size_t norb, const T* P, T* V, size_t LDV) {
+  unpack_rank4(norb, P, V, LDV);
+}
+
+}  // namespace macis
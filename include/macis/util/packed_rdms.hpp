@@ -0,0 +1,212 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <cstddef>
+#include <type_traits>
+
+namespace macis {
+
+/// Index of the unordered pair (p,q) in lower triangular packed storage
+inline constexpr size_t packed_pair_index(size_t p, size_t q) {
+  return p >= q ? p * (p + 1) / 2 + q : q * (q + 1) / 2 + p;
+}
+
+/// Number of unordered pairs of `n` indices
+inline constexpr size_t packed_pair_size(size_t n) { return n * (n + 1) / 2; }
+
+/// Number of unique elements of an 8-fold symmetric rank-4 tensor
+inline constexpr size_t packed_rank4_size(size_t norb) {
+  return packed_pair_size(packed_pair_size(norb));
+}
+
+namespace detail {
+
+/// x += val, atomic with respect to concurrent OpenMP threads
+template <typename T>
+inline void atomic_add(T& x, T val) {
+#pragma omp atomic
+  x += val;
+}
+
+}  // namespace detail
+
+/**
+ *  @brief Non-owning view of an 8-fold symmetry packed rank-4 tensor.
+ *
+ *  Stores the unique elements of a real rank-4 tensor G(p,q,r,s) under the
+ *  permutations p<->q, r<->s and (pq)<->(rs), indexed by the triangular
+ *  index of the pair indices (pq) and (rs).
+ *
+ *  The spin-summed 2-RDM is only invariant under the 4-fold subgroup
+ *  generated by (pq)<->(rs) and (p<->q, r<->s). The packed element is
+ *  therefore defined as the average of the tensor over the 8 permutations,
+ *  which leaves its contraction with any 8-fold symmetric tensor (e.g. real
+ *  ERIs) unchanged. Accumulation through `operator()` applies the
+ *  corresponding weight such that code written against dense `rank4_span`
+ *  (`G(p,q,r,s) += val`) produces the symmetrized tensor. If `Atomic` is
+ *  set, the accumulation is atomic such that the view may be shared by
+ *  concurrent threads.
+ */
+template <typename T, bool Atomic = false>
+class packed_rank4_span {
+  T* data_ = nullptr;
+  size_t norb_ = 0;
+
+ public:
+  /// Proxy reference which accumulates into the symmetrized element
+  class reference {
+    T* ptr_;
+    T weight_;
+
+   public:
+    reference(T* ptr, T weight) : ptr_(ptr), weight_(weight) {}
+    reference& operator+=(T val) {
+      if constexpr(Atomic)
+        detail::atomic_add(*ptr_, weight_ * val);
+      else
+        *ptr_ += weight_ * val;
+      return *this;
+    }
+    reference& operator-=(T val) { return *this += -val; }
+    operator T() const { return *ptr_; }
+  };
+
+  packed_rank4_span() = default;
+  packed_rank4_span(T* data, size_t norb) : data_(data), norb_(norb) {}
+
+  T* data_handle() const { return data_; }
+  size_t extent(size_t) const { return norb_; }
+  size_t size() const { return packed_rank4_size(norb_); }
+
+  static constexpr size_t index(size_t p, size_t q, size_t r, size_t s) {
+    return packed_pair_index(packed_pair_index(p, q), packed_pair_index(r, s));
+  }
+
+  /// Number of distinct index tuples equivalent to (p,q,r,s)
+  static constexpr size_t orbit_size(size_t p, size_t q, size_t r, size_t s) {
+    return (p != q ? 2 : 1) * (r != s ? 2 : 1) *
+           (packed_pair_index(p, q) != packed_pair_index(r, s) ? 2 : 1);
+  }
+
+  reference operator()(size_t p, size_t q, size_t r, size_t s) const {
+    return reference(data_ + index(p, q, r, s), T(1) / orbit_size(p, q, r, s));
+  }
+};
+
+template <typename Rank4>
+struct is_packed_rank4_span : public std::false_type {};
+
+template <typename T, bool Atomic>
+struct is_packed_rank4_span<packed_rank4_span<T, Atomic>>
+    : public std::true_type {};
+
+template <typename Rank4>
+inline constexpr bool is_packed_rank4_span_v =
+    is_packed_rank4_span<Rank4>::value;
+
+/**
+ *  @brief Symmetrize and pack a dense rank-4 tensor.
+ *
+ *  @param[in]  norb Extent of each index
+ *  @param[in]  G    Dense tensor (column major)
+ *  @param[in]  LDG  Single index leading dimension of `G`
+ *  @param[out] P    Packed tensor of size `packed_rank4_size(norb)`
+ */
+template <typename T>
+void pack_rank4(size_t norb, const T* G, size_t LDG, T* P) {
+  const size_t LDG2 = LDG * LDG;
+  const size_t LDG3 = LDG2 * LDG;
+  auto g = [&](size_t p, size_t q, size_t r, size_t s) {
+    return G[p + q * LDG + r * LDG2 + s * LDG3];
+  };
+
+  for(size_t p = 0; p < norb; ++p)
+    for(size_t q = 0; q <= p; ++q)
+      for(size_t r = 0; r < norb; ++r)
+        for(size_t s = 0; s <= r; ++s) {
+          if(packed_pair_index(r, s) > packed_pair_index(p, q)) continue;
+          P[packed_rank4_span<T>::index(p, q, r, s)] =
+              (g(p, q, r, s) + g(q, p, r, s) + g(p, q, s, r) + g(q, p, s, r) +
+               g(r, s, p, q) + g(s, r, p, q) + g(r, s, q, p) + g(s, r, q, p)) /
+              8;
+        }
+}
+
+/**
+ *  @brief Unpack a packed rank-4 tensor into dense storage.
+ *
+ *  @param[in]  norb Extent of each index
+ *  @param[in]  P    Packed tensor
+ *  @param[out] G    Dense tensor (column major)
+ *  @param[in]  LDG  Single index leading dimension of `G`
+ */
+template <typename T>
+void unpack_rank4(size_t norb, const T* P, T* G, size_t LDG) {
+  const size_t LDG2 = LDG * LDG;
+  const size_t LDG3 = LDG2 * LDG;
+  for(size_t s = 0; s < norb; ++s)
+    for(size_t r = 0; r < norb; ++r)
+      for(size_t q = 0; q < norb; ++q)
+        for(size_t p = 0; p < norb; ++p)
+          G[p + q * LDG + r * LDG2 + s * LDG3] =
+              P[packed_rank4_span<T>::index(p, q, r, s)];
+}
+
+/**
+ *  @brief Unpack the leading index pair of a packed rank-4 tensor.
+ *
+ *  Generates the (norb x norb x npair) column major view
+ *  G(p,q,[rs]), [rs] = packed_pair_index(r,s), which allows contractions
+ *  over a symmetric trailing index pair to be written as a single GEMM.
+ *
+ *  @param[in]  norb Extent of each index
+ *  @param[in]  P    Packed tensor
+ *  @param[out] G    Half-packed tensor of size norb^2 * packed_pair_size(norb)
+ */
+template <typename T>
+void unpack_rank4_leading_pair(size_t norb, const T* P, T* G) {
+  const size_t norb2 = norb * norb;
+  for(size_t r = 0; r < norb; ++r)
+    for(size_t s = 0; s <= r; ++s) {
+      auto* G_rs = G + packed_pair_index(r, s) * norb2;
+      for(size_t q = 0; q < norb; ++q)
+        for(size_t p = 0; p < norb; ++p)
+          G_rs[p + q * norb] = P[packed_rank4_span<T>::index(p, q, r, s)];
+    }
+}
+
+/**
+ *  @brief Unpack the elements of a packed rank-4 tensor with a fixed second
+ *  index.
+ *
+ *  Generates the (norb x npair) column major slice B(p,[rs]) = G(p,q,r,s),
+ *  [rs] = packed_pair_index(r,s), for a single q. Contractions over a
+ *  symmetric trailing index pair may then be performed one q at a time
+ *  without expanding the full leading index pair (see
+ *  `unpack_rank4_leading_pair`).
+ *
+ *  @param[in]  norb Extent of each index
+ *  @param[in]  P    Packed tensor
+ *  @param[in]  q    Second index of the slice
+ *  @param[out] B    Slice of size norb * packed_pair_size(norb)
+ */
+template <typename T>
+void unpack_rank4_slice(size_t norb, const T* P, size_t q, T* B) {
+  const size_t npair = packed_pair_size(norb);
+  for(size_t p = 0; p < norb; ++p) {
+    // Row [pq] of the symmetric (npair x npair) matrix of pair indices
+    const size_t pq = packed_pair_index(p, q);
+    const T* row = P + packed_pair_size(pq);
+    for(size_t rs = 0; rs <= pq; ++rs) B[p + rs * norb] = row[rs];
+    for(size_t rs = pq + 1; rs < npair; ++rs)
+      B[p + rs * norb] = P[packed_pair_index(pq, rs)];
+  }
+}
+
+}  // namespace macis
@@ -9,26 +9,38 @@
 #pragma once
 #include <macis/sd_operations.hpp>
 #include <macis/types.hpp>
+#include <macis/util/packed_rdms.hpp>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace macis {
 
-template <typename T, size_t N>
+template <typename T, size_t N, typename Rank4>
 inline void rdm_contributions_4(wfn_t<N> bra, wfn_t<N> ket, wfn_t<N> ex, T val,
-                                rank4_span<T> trdm) {
+                                Rank4 trdm) {
   auto [o1, v1, o2, v2, sign] = doubles_sign_indices(bra, ket, ex);
 
   val *= sign * 0.5;
-  trdm(v1, o1, v2, o2) += val;
-  trdm(v2, o1, v1, o2) -= val;
-  trdm(v1, o2, v2, o1) -= val;
-  trdm(v2, o2, v1, o1) += val;
+  if constexpr(is_packed_rank4_span_v<Rank4>) {
+    // Pair-swapped elements coincide in packed storage
+    trdm(v1, o1, v2, o2) += 2 * val;
+    trdm(v2, o1, v1, o2) -= 2 * val;
+  } else {
+    trdm(v1, o1, v2, o2) += val;
+    trdm(v2, o1, v1, o2) -= val;
+    trdm(v1, o2, v2, o1) -= val;
+    trdm(v2, o2, v1, o1) += val;
+  }
 }
 
-template <typename T, size_t N>
+template <typename T, size_t N, typename Rank4>
 inline void rdm_contributions_22(wfn_t<N> bra_alpha, wfn_t<N> ket_alpha,
                                  wfn_t<N> ex_alpha, wfn_t<N> bra_beta,
                                  wfn_t<N> ket_beta, wfn_t<N> ex_beta, T val,
-                                 rank4_span<T> trdm) {
+                                 Rank4 trdm) {
   auto [o1, v1, sign_a] =
       single_excitation_sign_indices(bra_alpha, ket_alpha, ex_alpha);
   auto [o2, v2, sign_b] =
@@ -36,39 +48,52 @@ inline void rdm_contributions_22(wfn_t<N> bra_alpha, wfn_t<N> ket_alpha,
   auto sign = sign_a * sign_b;
 
   val *= sign * 0.5;
-  trdm(v1, o1, v2, o2) += val;
-  trdm(v2, o2, v1, o1) += val;
+  if constexpr(is_packed_rank4_span_v<Rank4>) {
+    trdm(v1, o1, v2, o2) += 2 * val;
+  } else {
+    trdm(v1, o1, v2, o2) += val;
+    trdm(v2, o2, v1, o1) += val;
+  }
 }
 
-template <typename T, size_t N, typename IndexType>
+template <typename T, size_t N, typename IndexType, typename Rank4>
 inline void rdm_contributions_2(wfn_t<N> bra, wfn_t<N> ket, wfn_t<N> ex,
                                 const IndexType& bra_occ_alpha,
                                 const IndexType& bra_occ_beta, T val,
-                                matrix_span<T> ordm, rank4_span<T> trdm) {
+                                matrix_span<T> ordm, Rank4 trdm) {
   auto [o1, v1, sign] = single_excitation_sign_indices(bra, ket, ex);
 
   ordm(v1, o1) += sign * val;
 
   if(trdm.data_handle()) {
     val *= sign * 0.5;
-    for(auto p : bra_occ_alpha) {
-      trdm(v1, o1, p, p) += val;
-      trdm(p, p, v1, o1) += val;
-      trdm(v1, p, p, o1) -= val;
-      trdm(p, o1, v1, p) -= val;
-    }
+    if constexpr(is_packed_rank4_span_v<Rank4>) {
+      for(auto p : bra_occ_alpha) {
+        trdm(v1, o1, p, p) += 2 * val;
+        trdm(v1, p, p, o1) -= 2 * val;
+      }
+
+      for(auto p : bra_occ_beta) trdm(v1, o1, p, p) += 2 * val;
+    } else {
+      for(auto p : bra_occ_alpha) {
+        trdm(v1, o1, p, p) += val;
+        trdm(p, p, v1, o1) += val;
+        trdm(v1, p, p, o1) -= val;
+        trdm(p, o1, v1, p) -= val;
+      }
 
-    for(auto p : bra_occ_beta) {
-      trdm(v1, o1, p, p) += val;
-      trdm(p, p, v1, o1) += val;
+      for(auto p : bra_occ_beta) {
+        trdm(v1, o1, p, p) += val;
+        trdm(p, p, v1, o1) += val;
+      }
     }
   }
 }
 
-template <typename T, typename IndexType>
+template <typename T, typename IndexType, typename Rank4>
 inline void rdm_contributions_diag(const IndexType& occ_alpha,
                                    const IndexType& occ_beta, T val,
-                                   matrix_span<T> ordm, rank4_span<T> trdm) {
+                                   matrix_span<T> ordm, Rank4 trdm) {
   // One-electron piece
   for(auto p : occ_alpha) ordm(p, p) += val;
   for(auto p : occ_beta) ordm(p, p) += val;
@@ -88,34 +113,41 @@ inline void rdm_contributions_diag(const IndexType& occ_alpha,
       }
 
     // Opposite-spin two-body term
-    for(auto q : occ_beta)
-      for(auto p : occ_alpha) {
-        trdm(p, p, q, q) += val;
-        trdm(q, q, p, p) += val;
-      }
+    if constexpr(is_packed_rank4_span_v<Rank4>) {
+      for(auto q : occ_beta)
+        for(auto p : occ_alpha) trdm(p, p, q, q) += 2 * val;
+    } else {
+      for(auto q : occ_beta)
+        for(auto p : occ_alpha) {
+          trdm(p, p, q, q) += val;
+          trdm(q, q, p, p) += val;
+        }
+    }
   }
 }
 
-template <typename T, size_t N, typename IndexType>
+template <typename T, size_t N, typename IndexType, typename Rank4>
 inline void rdm_contributions(wfn_t<N> bra_alpha, wfn_t<N> ket_alpha,
                               wfn_t<N> ex_alpha, wfn_t<N> bra_beta,
                               wfn_t<N> ket_beta, wfn_t<N> ex_beta,
                               const IndexType& bra_occ_alpha,
                               const IndexType& bra_occ_beta, T val,
-                              matrix_span<T> ordm, rank4_span<T> trdm) {
+                              matrix_span<T> ordm, Rank4 trdm) {
   const uint32_t ex_alpha_count = ex_alpha.count();
   const uint32_t ex_beta_count = ex_beta.count();
 
   if((ex_alpha_count + ex_beta_count) > 4) return;
 
-  const auto trdm_ptr = trdm.data_handle();
-  if(ex_alpha_count == 4 and trdm_ptr)
+  // Doubles only contribute to the 2-RDM
+  if(!trdm.data_handle() and (ex_alpha_count + ex_beta_count) > 2) return;
+
+  if(ex_alpha_count == 4)
     rdm_contributions_4(bra_alpha, ket_alpha, ex_alpha, val, trdm);
 
-  else if(ex_beta_count == 4 and trdm_ptr)
+  else if(ex_beta_count == 4)
     rdm_contributions_4(bra_beta, ket_beta, ex_beta, val, trdm);
 
-  else if(ex_alpha_count == 2 and ex_beta_count == 2 and trdm_ptr)
+  else if(ex_alpha_count == 2 and ex_beta_count == 2)
     rdm_contributions_22(bra_alpha, ket_alpha, ex_alpha, bra_beta, ket_beta,
                          ex_beta, val, trdm);
 
@@ -131,4 +163,158 @@ inline void rdm_contributions(wfn_t<N> bra_alpha, wfn_t<N> ket_alpha,
     rdm_contributions_diag(bra_occ_alpha, bra_occ_beta, val, ordm, trdm);
 }
 
+namespace detail {
+
+/// View of the same shape as `trdm` over different storage
+inline rank4_span<double> rebind_rank4(rank4_span<double> trdm, double* ptr) {
+  return rank4_span<double>(ptr, trdm.extent(0), trdm.extent(1),
+                            trdm.extent(2), trdm.extent(3));
+}
+
+inline packed_rank4_span<double> rebind_rank4(packed_rank4_span<double> trdm,
+                                              double* ptr) {
+  return packed_rank4_span<double>(ptr, trdm.extent(0));
+}
+
+/// Dense rank-4 view whose elements are accumulated atomically, such that
+/// it may be shared by concurrent threads
+template <typename T>
+class atomic_rank4_span {
+  T* data_ = nullptr;
+  size_t extent_[4] = {};
+  size_t stride_[4] = {};
+
+ public:
+  class reference {
+    T* ptr_;
+
+   public:
+    reference(T* ptr) : ptr_(ptr) {}
+    reference& operator+=(T val) {
+      atomic_add(*ptr_, val);
+      return *this;
+    }
+    reference& operator-=(T val) { return *this += -val; }
+    operator T() const { return *ptr_; }
+  };
+
+  atomic_rank4_span(rank4_span<T> x) : data_(x.data_handle()) {
+    for(size_t k = 0; k < 4; ++k) {
+      extent_[k] = x.extent(k);
+      stride_[k] = x.stride(k);
+    }
+  }
+
+  T* data_handle() const { return data_; }
+  size_t extent(size_t k) const { return extent_[k]; }
+
+  reference operator()(size_t p, size_t q, size_t r, size_t s) const {
+    return reference(data_ + p * stride_[0] + q * stride_[1] +
+                     r * stride_[2] + s * stride_[3]);
+  }
+};
+
+/// View of `trdm` which may be accumulated into by concurrent threads
+inline auto atomic_rank4(rank4_span<double> trdm) {
+  return atomic_rank4_span<double>(trdm);
+}
+
+inline auto atomic_rank4(packed_rank4_span<double> trdm) {
+  return packed_rank4_span<double, true>(trdm.data_handle(), trdm.extent(0));
+}
+
+}  // namespace detail
+
+/// Memory (in bytes) beyond which the thread-private 2-RDM buffers of
+/// accumulate_rdms_by_rows are replaced by atomic accumulation
+inline constexpr size_t rdm_thread_buffer_max_bytes = size_t(1) << 30;
+
+/**
+ *  @brief Accumulate RDM contributions row-by-row in parallel.
+ *
+ *  Rows (bra determinants) are distributed dynamically over threads, each of
+ *  which accumulates into a private 1-RDM buffer. The 2-RDM is accumulated
+ *  into thread-private buffers as well if their total size does not exceed
+ *  `max_buffer_bytes`, and otherwise atomically into `trdm` itself, such
+ *  that the memory is bounded for large active spaces. The thread-private
+ *  buffers are summed into `ordm` / `trdm` at the end. The 2-RDM is only
+ *  accumulated if `trdm` is non-null. `trdm` may either be a dense
+ *  `rank4_span` or a `packed_rank4_span`.
+ *
+ *  @param[in]     nrow             Number of rows
+ *  @param[in/out] ordm             1-RDM to accumulate into
+ *  @param[in/out] trdm             2-RDM to accumulate into (may be null)
+ *  @param[in]     make_row_gen     Callable invoked once per thread which
+ *                                  returns a (possibly stateful) row functor
+ *                                  `f(i, ordm, trdm)` which accumulates the
+ *                                  contributions of row `i`. The functor
+ *                                  must accept both `trdm` and its atomic
+ *                                  view (see detail::atomic_rank4).
+ *  @param[in]     max_buffer_bytes Bound on the total size of the
+ *                                  thread-private 2-RDM buffers
+ */
+template <typename Rank4, typename RowGenFactory>
+void accumulate_rdms_by_rows(
+    size_t nrow, matrix_span<double> ordm, Rank4 trdm,
+    RowGenFactory&& make_row_gen,
+    size_t max_buffer_bytes = rdm_thread_buffer_max_bytes) {
+#ifdef _OPENMP
+  const size_t nthreads = omp_get_max_threads();
+#else
+  const size_t nthreads = 1;
+#endif
+
+  if(nthreads == 1 or nrow < 2) {
+    auto row_gen = make_row_gen();
+    for(size_t i = 0; i < nrow; ++i) row_gen(i, ordm, trdm);
+    return;
+  }
+
+  const size_t ordm_sz = ordm.size();
+  const size_t trdm_sz = trdm.data_handle() ? trdm.size() : 0;
+  const bool private_trdm =
+      nthreads * trdm_sz * sizeof(double) <= max_buffer_bytes;
+  std::vector<std::vector<double>> ordm_t(nthreads), trdm_t(nthreads);
+
+#pragma omp parallel
+  {
+#ifdef _OPENMP
+    const size_t tid = omp_get_thread_num();
+#else
+    const size_t tid = 0;
+#endif
+    ordm_t[tid].assign(ordm_sz, 0.0);
+    matrix_span<double> ordm_loc(ordm_t[tid].data(), ordm.extent(0),
+                                 ordm.extent(1));
+
+    auto row_gen = make_row_gen();
+    if(private_trdm) {
+      trdm_t[tid].assign(trdm_sz, 0.0);
+      auto trdm_loc =
+          detail::rebind_rank4(trdm, trdm_sz ? trdm_t[tid].data() : nullptr);
+#pragma omp for schedule(dynamic, 16)
+      for(size_t i = 0; i < nrow; ++i) row_gen(i, ordm_loc, trdm_loc);
+    } else {
+      auto trdm_atomic = detail::atomic_rank4(trdm);
+#pragma omp for schedule(dynamic, 16)
+      for(size_t i = 0; i < nrow; ++i) row_gen(i, ordm_loc, trdm_atomic);
+    }
+
+    // Reduce thread-private buffers (implicit barrier above)
+    auto* ordm_ptr = ordm.data_handle();
+#pragma omp for schedule(static)
+    for(size_t k = 0; k < ordm_sz; ++k)
+      for(const auto& buf : ordm_t)
+        if(buf.size()) ordm_ptr[k] += buf[k];
+
+    if(private_trdm) {
+      auto* trdm_ptr = trdm.data_handle();
+#pragma omp for schedule(static)
+      for(size_t k = 0; k < trdm_sz; ++k)
+        for(const auto& buf : trdm_t)
+          if(buf.size()) trdm_ptr[k] += buf[k];
+    }
+  }
+}
+
 }  // namespace macis
@@ -27,4 +27,21 @@ void four_index_transform(size_t norb_old, size_t norb_new, const double* X,
                           size_t LDX, const double* C, size_t LDC, double* Y,
                           size_t LDY);
 
+// P(p,q,r,s) <- P(i,j,k,l) * C(i,p) * C(j,q) * C(k,r) * C(l,s)
+// P <- 8-fold symmetry packed ERIs (see `packed_eri_span`), transformed in
+//      place with O(npair^2) scratch, npair = norb * (norb + 1) / 2
+// C <- [norb, norb]
+void four_index_transform_packed(size_t norb, double* P, const double* C,
+                                 size_t LDC);
+
+// Y(p,q,P) = X(i,j,P) * C(i,p) * C(j,q)
+// X <- [norb_old, norb_old, naux]
+// Y <- [norb_new, norb_new, naux]
+// C <- [norb_old, norb_new]
+// LDX / LDY are single index leading dimensions, Y may alias X if
+// norb_old == norb_new and LDX == LDY
+void cholesky_transform(size_t norb_old, size_t norb_new, size_t naux,
+                        const double* X, size_t LDX, const double* C,
+                        size_t LDC, double* Y, size_t LDY);
+
 }  // namespace macis
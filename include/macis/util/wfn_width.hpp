@@ -0,0 +1,77 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace macis {
+
+/// Determinant widths (in bits) for which the drivers are instantiated
+using wfn_widths_t = std::index_sequence<64, 128, 256, 512>;
+
+/// Compile-time determinant width tag passed by `dispatch_wfn_width`
+template <size_t N>
+using wfn_width_t = std::integral_constant<size_t, N>;
+
+/**
+ *  @brief Smallest instantiated determinant width which can hold a given
+ *  number of spatial orbitals (one bit per spin orbital).
+ *
+ *  Throws if `norb` exceeds the widest instantiated width.
+ *
+ *  @param[in] norb Number of (active) spatial orbitals
+ *  @returns Determinant width in bits
+ */
+inline size_t select_wfn_width(size_t norb) {
+  for(size_t nbits : {64, 128, 256, 512})
+    if(2 * norb <= nbits) return nbits;
+  throw std::runtime_error("Not Enough Bits");
+}
+
+namespace detail {
+
+template <typename Functor, size_t N, size_t... Ns>
+decltype(auto) dispatch_wfn_width(size_t nbits, Functor&& f,
+                                  std::index_sequence<N, Ns...>) {
+  if constexpr(sizeof...(Ns) == 0) {
+    return f(wfn_width_t<N>{});
+  } else {
+    if(nbits == N) return f(wfn_width_t<N>{});
+    return dispatch_wfn_width(nbits, std::forward<Functor>(f),
+                              std::index_sequence<Ns...>{});
+  }
+}
+
+}  // namespace detail
+
+/**
+ *  @brief Invoke a generic callable with the smallest instantiated
+ *  determinant width which can hold a given number of spatial orbitals.
+ *
+ *  Allows drivers to select the determinant width at runtime while keeping
+ *  the 64-bit fast paths for small active spaces, e.g.
+ *
+ *    dispatch_wfn_width(nact, [&](auto w) {
+ *      constexpr size_t N = decltype(w)::value;
+ *      DoubleLoopHamiltonianGenerator<N> ham_gen(...);
+ *    });
+ *
+ *  @param[in] norb Number of (active) spatial orbitals
+ *  @param[in] f    Callable invoked as `f(wfn_width_t<N>{})`. All
+ *                  instantiations must share a return type.
+ *  @returns The result of `f`
+ */
+template <typename Functor>
+decltype(auto) dispatch_wfn_width(size_t norb, Functor&& f) {
+  return detail::dispatch_wfn_width(select_wfn_width(norb),
+                                    std::forward<Functor>(f), wfn_widths_t{});
+}
+
+}  // namespace macis
@@ -0,0 +1,138 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+#include <atomic>
+#include <iterator>
+#include <macis/bitset_operations.hpp>
+#include <macis/types.hpp>
+#include <memory>
+
+namespace macis {
+
+/// 64-bit finalizer (MurmurHash3 fmix64)
+inline uint64_t hash_mix64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+/// Word-level hash of a determinant
+template <size_t N>
+struct wfn_hash {
+  uint64_t operator()(const wfn_t<N>& det) const {
+    uint64_t h = N;
+    for(auto w : bitset_to_words(det)) h = hash_mix64(h ^ w);
+    return h;
+  }
+};
+
+/**
+ *  @brief Determinant -> index hash map over a determinant list.
+ *
+ *  Open-addressing (linear probing) table with power-of-two capacity and a
+ *  load factor of at most 1/2. Slots only store the index of a determinant
+ *  in the list the map was built over, keys are compared against the list
+ *  itself. The list must therefore outlive the map and remain unchanged.
+ *
+ *  The table is built in bulk (threaded, slots are claimed with atomic
+ *  compare-and-swap) and is read-only afterwards, such that lookups are
+ *  lock-free and may be performed concurrently from any number of threads.
+ *  If a determinant occurs several times in the list, the smallest index is
+ *  stored.
+ *
+ *  @tparam N Bitset width of the determinants
+ */
+template <size_t N>
+class wfn_index_map {
+ public:
+  using det_type = wfn_t<N>;
+  using det_iterator = typename std::vector<det_type>::const_iterator;
+
+  /// Index returned by find for absent determinants
+  static constexpr int64_t npos = -1;
+
+ private:
+  det_iterator dets_;
+  size_t ndets_ = 0;
+  size_t mask_ = 0;  // capacity - 1
+  std::unique_ptr<std::atomic<int64_t>[]> slots_;
+
+  size_t home_slot(const det_type& det) const {
+    return wfn_hash<N>{}(det) & mask_;
+  }
+
+  void insert(int64_t idx) {
+    const auto& det = *(dets_ + idx);
+    for(size_t s = home_slot(det);; s = (s + 1) & mask_) {
+      int64_t cur = npos;
+      if(slots_[s].compare_exchange_strong(cur, idx,
+                                           std::memory_order_relaxed))
+        return;
+      if(*(dets_ + cur) == det) {
+        // Duplicate determinant, keep the smallest index
+        while(idx < cur and !slots_[s].compare_exchange_weak(
+                                cur, idx, std::memory_order_relaxed));
+        return;
+      }
+    }
+  }
+
+ public:
+  wfn_index_map() = default;
+
+  /**
+   *  @brief Build the map over [dets_begin, dets_end).
+   *
+   *  @param[in] dets_begin Start of the determinant list
+   *  @param[in] dets_end   End of the determinant list
+   */
+  wfn_index_map(det_iterator dets_begin, det_iterator dets_end)
+      : dets_(dets_begin), ndets_(std::distance(dets_begin, dets_end)) {
+    size_t capacity = 16;
+    while(capacity < 2 * ndets_) capacity *= 2;
+    mask_ = capacity - 1;
+    slots_.reset(new std::atomic<int64_t>[capacity]);
+
+#pragma omp parallel
+    {
+#pragma omp for schedule(static)
+      for(size_t s = 0; s < capacity; ++s)
+        slots_[s].store(npos, std::memory_order_relaxed);
+
+#pragma omp for schedule(static)
+      for(size_t i = 0; i < ndets_; ++i) insert(i);
+    }
+  }
+
+  wfn_index_map(const std::vector<det_type>& dets)
+      : wfn_index_map(dets.cbegin(), dets.cend()) {}
+
+  /// Number of determinants in the underlying list
+  size_t size() const { return ndets_; }
+
+  /// Number of slots in the table
+  size_t capacity() const { return slots_ ? mask_ + 1 : 0; }
+
+  /// Index of `det` in the underlying list (npos if absent)
+  int64_t find(const det_type& det) const {
+    if(!slots_) return npos;
+    for(size_t s = home_slot(det);; s = (s + 1) & mask_) {
+      const auto idx = slots_[s].load(std::memory_order_relaxed);
+      if(idx == npos or *(dets_ + idx) == det) return idx;
+    }
+  }
+
+  /// Whether `det` is in the underlying list
+  bool contains(const det_type& det) const { return find(det) != npos; }
+};
+
+}  // namespace macis
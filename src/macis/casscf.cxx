@@ -6,24 +6,58 @@
  * See LICENSE.txt for details
  */
 
-#include <macis/hamiltonian_generator/double_loop.hpp>
+#include <macis/hamiltonian_generator/dispatch.hpp>
 #include <macis/util/cas.hpp>
 #include <macis/util/mcscf.hpp>
 #include <macis/util/mcscf_impl.hpp>
+#include <macis/util/wfn_width.hpp>
 
 namespace macis {
 
+namespace {
+
+template <typename Integrals>
+double casscf_diis_impl(MCSCFSettings settings, NumElectron nalpha,
+                        NumElectron nbeta, NumOrbital norb, NumInactive ninact,
+                        NumActive nact, NumVirtual nvirt, double E_core,
+                        Integrals& ints, double* A1RDM, size_t LDD1,
+                        double* A2RDM, size_t LDD2, MPI_Comm comm) {
+  // Smallest determinant width which holds the active space
+  return dispatch_wfn_width(nact.get(), [&](auto nbits) {
+    constexpr size_t N = decltype(nbits)::value;
+    return dispatch_hamiltonian_generator<N>(
+        settings.ci_ham_gen, [&](auto gen) {
+          using functor_t = CASRDMFunctor<typename decltype(gen)::type>;
+          functor_t op;
+          return mcscf_impl<functor_t>(op, settings, nalpha, nbeta, norb,
+                                       ninact, nact, nvirt, E_core, ints, A1RDM,
+                                       LDD1, A2RDM, LDD2, comm);
+        });
+  });
+}
+
+}  // namespace
+
 double casscf_diis(MCSCFSettings settings, NumElectron nalpha,
                    NumElectron nbeta, NumOrbital norb, NumInactive ninact,
                    NumActive nact, NumVirtual nvirt, double E_core, double* T,
                    size_t LDT, double* V, size_t LDV, double* A1RDM,
                    size_t LDD1, double* A2RDM, size_t LDD2, MPI_Comm comm) {
-  using generator_t = DoubleLoopHamiltonianGenerator<64>;
-  using functor_t = CASRDMFunctor<generator_t>;
-  functor_t op;
-  return mcscf_impl<functor_t>(op, settings, nalpha, nbeta, norb, ninact, nact,
-                               nvirt, E_core, T, LDT, V, LDV, A1RDM, LDD1,
-                               A2RDM, LDD2, comm);
+  DenseMCSCFIntegrals ints(norb, T, LDT, V, LDV);
+  return casscf_diis_impl(settings, nalpha, nbeta, norb, ninact, nact, nvirt,
+                          E_core, ints, A1RDM, LDD1, A2RDM, LDD2, comm);
+}
+
+double casscf_diis_cholesky(MCSCFSettings settings, NumElectron nalpha,
+                            NumElectron nbeta, NumOrbital norb,
+                            NumInactive ninact, NumActive nact,
+                            NumVirtual nvirt, double E_core, double* T,
+                            size_t LDT, NumCholeskyVector naux, double* L,
+                            size_t LDL, double* A1RDM, size_t LDD1,
+                            double* A2RDM, size_t LDD2, MPI_Comm comm) {
+  CholeskyMCSCFIntegrals ints(norb, T, LDT, naux, L, LDL);
+  return casscf_diis_impl(settings, nalpha, nbeta, norb, ninact, nact, nvirt,
+                          E_core, ints, A1RDM, LDD1, A2RDM, LDD2, comm);
 }
 
 }  // namespace macis
@@ -0,0 +1,130 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#include <algorithm>
+#include <blas.hh>
+#include <cmath>
+#include <macis/util/cholesky.hpp>
+#include <macis/util/fock_matrices.hpp>
+#include <macis/util/packed_eris.hpp>
+
+namespace macis {
+
+namespace {
+
+// Pivoted Cholesky decomposition of the (pq|rs) supermatrix over the unique
+// (p>=q) pairs. V(p,q,r,s) returns (pq|rs).
+template <typename Functor>
+std::vector<double> pivoted_cholesky(size_t norb, const Functor& V,
+                                     double tol) {
+  const size_t npair = packed_pair_size(norb);
+
+  // Unique pair -> orbital indices
+  std::vector<size_t> pair_p(npair), pair_q(npair);
+  for(size_t p = 0, pq = 0; p < norb; ++p)
+    for(size_t q = 0; q <= p; ++q, ++pq) {
+      pair_p[pq] = p;
+      pair_q[pq] = q;
+    }
+
+  // Residual diagonal D(pq) = (pq|pq) - \sum_P L(pq,P)^2
+  std::vector<double> D(npair);
+  for(size_t pq = 0; pq < npair; ++pq)
+    D[pq] = V(pair_p[pq], pair_q[pq], pair_p[pq], pair_q[pq]);
+
+  // Cholesky vectors over unique pairs LP(pq,P)
+  std::vector<double> LP;
+  size_t naux = 0;
+  while(naux < npair) {
+    const size_t J = std::max_element(D.begin(), D.end()) - D.begin();
+    const double D_max = D[J];
+    if(D_max < tol) break;
+
+    LP.resize((naux + 1) * npair);
+    auto* L_J = LP.data() + naux * npair;
+
+    // Residual column J
+    // L(pq,J) = (pq|J) - \sum_P L(pq,P) * L(J,P)
+    const size_t r = pair_p[J];
+    const size_t s = pair_q[J];
+#pragma omp parallel for
+    for(size_t pq = 0; pq < npair; ++pq)
+      L_J[pq] = V(pair_p[pq], pair_q[pq], r, s);
+    if(naux)
+      blas::gemv(blas::Layout::ColMajor, blas::Op::NoTrans, npair, naux, -1.0,
+                 LP.data(), npair, LP.data() + J, npair, 1.0, L_J, 1);
+    blas::scal(npair, 1.0 / std::sqrt(D_max), L_J, 1);
+
+    for(size_t pq = 0; pq < npair; ++pq) D[pq] -= L_J[pq] * L_J[pq];
+    D[J] = 0.0;
+    ++naux;
+  }
+
+  // Expand to L(p,q,P)
+  const size_t norb2 = norb * norb;
+  std::vector<double> L(norb2 * naux);
+  for(size_t P = 0; P < naux; ++P) {
+    auto* L_P = L.data() + P * norb2;
+    const auto* LP_P = LP.data() + P * npair;
+    for(size_t pq = 0; pq < npair; ++pq) {
+      L_P[pair_p[pq] + pair_q[pq] * norb] = LP_P[pq];
+      L_P[pair_q[pq] + pair_p[pq] * norb] = LP_P[pq];
+    }
+  }
+  return L;
+}
+
+}  // namespace
+
+std::vector<double> cholesky_decompose_eris(NumOrbital norb, const double* V,
+                                            size_t LDV, double tol) {
+  const size_t LDV2 = LDV * LDV;
+  const size_t LDV3 = LDV2 * LDV;
+  return pivoted_cholesky(
+      norb.get(),
+      [&](size_t p, size_t q, size_t r, size_t s) {
+        return V[p + q * LDV + r * LDV2 + s * LDV3];
+      },
+      tol);
+}
+
+std::vector<double> cholesky_decompose_packed_eris(NumOrbital norb,
+                                                   const double* V,
+                                                   double tol) {
+  packed_eri_span<const double> V_packed(V, norb.get());
+  return pivoted_cholesky(norb.get(), V_packed, tol);
+}
+
+void cholesky_to_eris(NumOrbital norb, NumCholeskyVector naux, const double* L,
+                      size_t LDL, double* V, size_t LDV) {
+  active_subtensor_2body_cholesky(NumActive(norb.get()), NumInactive(0), naux,
+                                  L, LDL, V, LDV);
+}
+
+void cholesky_to_packed_eris(NumOrbital norb, NumCholeskyVector naux,
+                             const double* L, size_t LDL, double* P) {
+  const size_t no = norb.get();
+  const size_t nv = naux.get();
+  const size_t npair = packed_pair_size(no);
+  const size_t LDL2 = LDL * LDL;
+
+  // LT(Q,[pq]) = L(p,q,Q), p >= q
+  std::vector<double> LT(nv * npair);
+  for(size_t p = 0, pq = 0; p < no; ++p)
+    for(size_t q = 0; q <= p; ++q, ++pq)
+      for(size_t Q = 0; Q < nv; ++Q)
+        LT[Q + pq * nv] = L[p + q * LDL + Q * LDL2];
+
+  // P([pq],[rs]) = LT(Q,[rs]) * LT(Q,[pq]), [rs] <= [pq]
+  for(size_t pq = 0; pq < npair; ++pq)
+    blas::gemv(blas::Layout::ColMajor, blas::Op::Trans, nv, pq + 1, 1.0,
+               LT.data(), nv, LT.data() + pq * nv, 1, 0.0,
+               P + packed_pair_size(pq), 1);
+}
+
+}  // namespace macis
@@ -6,129 +6,356 @@
  * See LICENSE.txt for details
  */
 
+#include <fcntl.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/spdlog.h>
-
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <macis/util/fcidump.hpp>
-#include <regex>
+#include <macis/util/packed_rdms.hpp>
 #include <string>
+#include <string_view>
 
-std::vector<std::string> split(const std::string str,
-                               const std::string regex_str) {
-  std::regex regexz(regex_str);
-  std::vector<std::string> list(
-      std::sregex_token_iterator(str.begin(), str.end(), regexz, -1),
-      std::sregex_token_iterator());
-  std::vector<std::string> clean_list;
-  std::copy_if(list.begin(), list.end(), std::back_inserter(clean_list),
-               [](auto& s) { return s.size() > 0; });
-  return clean_list;
-}
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+/// Read-only memory map of a file
+class mapped_file {
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+
+ public:
+  mapped_file(const std::string& fname) {
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if(fd < 0) throw std::runtime_error(fname + " not available");
+
+    struct stat st;
+    if(::fstat(fd, &st)) {
+      ::close(fd);
+      throw std::runtime_error(fname + " not available");
+    }
+
+    size_ = st.st_size;
+    if(size_) {
+      void* ptr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(ptr == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Could not map " + fname);
+      }
+      data_ = static_cast<const char*>(ptr);
+    }
+    ::close(fd);  // The mapping persists
+  }
+
+  ~mapped_file() noexcept {
+    if(data_) ::munmap(const_cast<char*>(data_), size_);
+  }
 
-bool is_float(const std::string& str) {
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+};
+
+inline bool is_space(char c) { return c == ' ' or c == '\t' or c == '\r'; }
+
+bool is_float(std::string_view str) {
   return std::any_of(str.begin(), str.end(),
                      [](auto c) { return std::isalpha(c) or c == '.'; });
 }
 
-auto fcidump_line(const std::vector<std::string>& tokens) {
-  auto idx_first = is_float(tokens.back());
-  auto int_first = is_float(tokens.front());
+template <typename T>
+bool parse_number(std::string_view str, T& x) {
+  if(str.size() and str.front() == '+') str.remove_prefix(1);
+  auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), x);
+  return ec == std::errc() and ptr == str.data() + str.size();
+}
 
-  if(idx_first and int_first) throw std::runtime_error("Invalid FCIDUMP Line");
+/// Floating point parsing which also accepts Fortran (D) exponents
+bool parse_float(std::string_view str, double& x) {
+  if(parse_number(str, x)) return true;
+  auto d_pos = str.find_first_of("Dd");
+  if(d_pos == std::string_view::npos) return false;
+  std::string str_e(str);
+  str_e[d_pos] = 'E';
+  return parse_number(std::string_view(str_e), x);
+}
 
+struct fcidump_entry {
   int32_t p, q, r, s;
   double integral;
-
-  if(idx_first) {
-    p = std::stoi(tokens[0]);
-    q = std::stoi(tokens[1]);
-    r = std::stoi(tokens[2]);
-    s = std::stoi(tokens[3]);
-    integral = std::stod(tokens[4]);
-  } else {
-    p = std::stoi(tokens[1]);
-    q = std::stoi(tokens[2]);
-    r = std::stoi(tokens[3]);
-    s = std::stoi(tokens[4]);
-    integral = std::stod(tokens[0]);
+};
+
+enum class LineStatus { Skip, Entry, Invalid };
+
+/// Parse "p q r s integral" or "integral p q r s"
+LineStatus fcidump_line(const char* begin, const char* end,
+                        fcidump_entry& entry) {
+  std::string_view tokens[5];
+  size_t ntokens = 0;
+  for(auto it = begin;;) {
+    while(it != end and is_space(*it)) ++it;
+    if(it == end) break;
+    auto tok_st = it;
+    while(it != end and !is_space(*it)) ++it;
+    if(ntokens == 5) return LineStatus::Skip;  // not a valid FCIDUMP line
+    tokens[ntokens++] = std::string_view(tok_st, it - tok_st);
   }
+  if(ntokens != 5) return LineStatus::Skip;  // not a valid FCIDUMP line
 
-  if(p < 0 or q < 0 or r < 0 or s < 0)
-    throw std::runtime_error("Invalid Orb Idx");
+  auto idx_first = is_float(tokens[4]);
+  auto int_first = is_float(tokens[0]);
+  if(idx_first and int_first) return LineStatus::Invalid;
 
-  return std::make_tuple(p, q, r, s, integral);
+  const size_t idx_st = idx_first ? 0 : 1;
+  const size_t int_pos = idx_first ? 4 : 0;
+  bool valid = parse_number(tokens[idx_st + 0], entry.p) and
+               parse_number(tokens[idx_st + 1], entry.q) and
+               parse_number(tokens[idx_st + 2], entry.r) and
+               parse_number(tokens[idx_st + 3], entry.s) and
+               parse_float(tokens[int_pos], entry.integral);
+  if(!valid) return LineStatus::Invalid;
+
+  if(entry.p < 0 or entry.q < 0 or entry.r < 0 or entry.s < 0)
+    return LineStatus::Invalid;
+
+  return LineStatus::Entry;
 }
 
-enum LineClassification { Core, OneBody, TwoBody };
+enum LineClassification { Core, OrbitalEnergy, OneBody, TwoBody };
 
 LineClassification line_classification(int p, int q, int r, int s) {
   if(!(p or q or r or s))
     return LineClassification::Core;
   else if(p and q and r and s)
     return LineClassification::TwoBody;
-  else
+  else if(p and q)
     return LineClassification::OneBody;
+  else
+    return LineClassification::OrbitalEnergy;
 }
 
-namespace macis {
+/// Parse the (optional) &FCI ... &END namelist, sets `body` past its end
+macis::FCIDumpHeader fcidump_header(const char* begin, const char* end,
+                                    const char*& body) {
+  macis::FCIDumpHeader header;
+  body = begin;
+
+  auto it = begin;
+  while(it != end and std::isspace(*it)) ++it;
+  if(it == end or (*it != '&' and *it != '$')) return header;
+
+  // The namelist is terminated by &END, $END or a "/" line
+  const char* header_end = nullptr;
+  for(auto line = it; line != end and !header_end;) {
+    auto eol = static_cast<const char*>(std::memchr(line, '\n', end - line));
+    if(!eol) eol = end;
+    std::string_view str(line, eol - line);
+    auto tail = str.find_last_not_of(" \t\r");
+    bool term = str.find("&END") != std::string_view::npos or
+                str.find("$END") != std::string_view::npos or
+                (tail != std::string_view::npos and str[tail] == '/');
+    line = eol == end ? end : eol + 1;
+    if(term) header_end = line;
+  }
+  if(!header_end) throw std::runtime_error("Invalid FCIDUMP Header");
+  body = header_end;
+
+  // KEY = value entries
+  std::string_view str(it, header_end - it);
+  auto header_value = [&](std::string_view key, auto& val) {
+    for(auto pos = str.find(key); pos != std::string_view::npos;
+        pos = str.find(key, pos + 1)) {
+      auto val_st = str.find_first_not_of(" \t\r\n", pos + key.size());
+      if(val_st == std::string_view::npos or str[val_st] != '=') continue;
+      val_st = str.find_first_not_of(" \t\r\n", val_st + 1);
+      if(val_st == std::string_view::npos) break;
+      std::from_chars(str.data() + val_st, str.data() + str.size(), val);
+      return;
+    }
+  };
+  header_value("NORB", header.norb);
+  header_value("NELEC", header.nelec);
+  header_value("MS2", header.ms2);
+  return header;
+}
 
-uint32_t read_fcidump_norb(std::string fname) {
-  std::ifstream file(fname);
-  std::string line;
-  int32_t max_idx = 0;
-  while(std::getline(file, line)) {
-    auto tokens = split(line, " ");
-    if(tokens.size() != 5) continue;  // not a valid FCIDUMP line
+/**
+ *  Invoke `f(entry)` for every integral line in [begin, end). The range is
+ *  split at line boundaries into chunks which are parsed concurrently into
+ *  chunk-local buffers. `f` is applied serially in file order (entries
+ *  related by symmetry may differ in the last bits, the last one wins), it
+ *  returns false for entries which are invalid for the caller (e.g. out of
+ *  range indices).
+ */
+template <typename Functor>
+void for_each_fcidump_entry(const char* begin, const char* end,
+                            const Functor& f) {
+#ifdef _OPENMP
+  const size_t nthreads = omp_get_max_threads();
+#else
+  const size_t nthreads = 1;
+#endif
+
+  // Chunk boundaries, advanced to the start of the next line
+  const size_t nbytes = end - begin;
+  const size_t min_chunk = size_t(1) << 16;
+  const size_t nchunk =
+      std::max(size_t(1), std::min(8 * nthreads, nbytes / min_chunk));
+  std::vector<const char*> bounds(nchunk + 1, end);
+  bounds[0] = begin;
+  for(size_t i = 1; i < nchunk; ++i) {
+    auto st = std::max(begin + i * (nbytes / nchunk), bounds[i - 1]);
+    auto eol = static_cast<const char*>(std::memchr(st, '\n', end - st));
+    bounds[i] = eol ? eol + 1 : end;
+  }
 
-    auto [p, q, r, s, integral] = fcidump_line(tokens);
+  bool invalid = false;
+#pragma omp parallel for ordered schedule(dynamic)
+  for(size_t i = 0; i < nchunk; ++i) {
+    bool chunk_invalid = false;
+    std::vector<fcidump_entry> entries;
+    const char* chunk_end = bounds[i + 1];
+    for(auto line = bounds[i]; line < chunk_end;) {
+      auto eol = static_cast<const char*>(
+          std::memchr(line, '\n', chunk_end - line));
+      if(!eol) eol = chunk_end;
+
+      fcidump_entry entry;
+      auto status = fcidump_line(line, eol, entry);
+      if(status == LineStatus::Entry) entries.push_back(entry);
+      if(status == LineStatus::Invalid) chunk_invalid = true;
+      line = eol + 1;
+    }
 
-    max_idx = std::max(max_idx, std::max(p, std::max(q, std::max(r, s))));
+    // Apply in chunk order, at most one chunk per thread is held
+#pragma omp ordered
+    {
+      for(const auto& entry : entries) chunk_invalid |= !f(entry);
+      invalid |= chunk_invalid;
+    }
   }
 
+  if(invalid) throw std::runtime_error("Invalid FCIDUMP Line");
+}
+
+/// Number of orbitals: NORB if present, the largest orbital index otherwise
+size_t fcidump_norb(const macis::FCIDumpHeader& header, const char* body,
+                    const char* end) {
+  if(header.norb) return header.norb;
+
+  int32_t max_idx = 0;
+  for_each_fcidump_entry(body, end, [&](const fcidump_entry& e) {
+    max_idx = std::max({max_idx, e.p, e.q, e.r, e.s});
+    return true;
+  });
   return max_idx;
 }
 
-double read_fcidump_core(std::string fname) {
-  std::ifstream file(fname);
-  std::string line;
-  while(std::getline(file, line)) {
-    auto tokens = split(line, " ");
-    if(tokens.size() != 5) continue;  // not a valid FCIDUMP line
-
-    auto [p, q, r, s, integral] = fcidump_line(tokens);
-    auto lc = line_classification(p, q, r, s);
-    if(lc == LineClassification::Core) {
-      return integral;
+/**
+ *  Single pass over a FCIDUMP file, `T(p,q,val)` and `V(p,q,r,s,val)` are
+ *  invoked with 0-based indices, the core energy is returned. Orbital
+ *  indices are checked against `norb` (and NORB if present) on the fly,
+ *  `norb = 0` disables the checks.
+ */
+template <typename OneBodyFunctor, typename TwoBodyFunctor>
+double read_fcidump_entries(std::string fname, size_t norb,
+                            const OneBodyFunctor& T,
+                            const TwoBodyFunctor& V) {
+  mapped_file file(fname);
+  const char* body;
+  auto header = fcidump_header(file.begin(), file.end(), body);
+  if(norb and header.norb and header.norb != norb)
+    throw std::runtime_error("Integrals are of improper dimension");
+
+  double E_core = 0.0;
+  for_each_fcidump_entry(body, file.end(), [&](const fcidump_entry& e) {
+    if(norb and std::max({e.p, e.q, e.r, e.s}) > int32_t(norb)) return false;
+    switch(line_classification(e.p, e.q, e.r, e.s)) {
+      case LineClassification::Core:
+        E_core = e.integral;
+        break;
+      case LineClassification::OneBody:
+        T(e.p - 1, e.q - 1, e.integral);
+        break;
+      case LineClassification::TwoBody:
+        V(e.p - 1, e.q - 1, e.r - 1, e.s - 1, e.integral);
+        break;
+      default:
+        break;
     }
-  }
-  return 0.0;
+    return true;
+  });
+  return E_core;
+}
+
+auto fcidump_1body_functor(macis::col_major_span<double, 2> T) {
+  return [=](int p, int q, double integral) {
+    T(p, q) = integral;
+    T(q, p) = integral;
+  };
+}
+
+auto fcidump_2body_functor(macis::col_major_span<double, 4> V) {
+  return [=](int p, int q, int r, int s, double integral) {
+    V(p, q, r, s) = integral;  // (pq|rs)
+    V(p, q, s, r) = integral;  // (pq|sr)
+    V(q, p, r, s) = integral;  // (qp|rs)
+    V(q, p, s, r) = integral;  // (qp|sr)
+
+    V(r, s, p, q) = integral;  // (rs|pq)
+    V(s, r, p, q) = integral;  // (sr|pq)
+    V(r, s, q, p) = integral;  // (rs|qp)
+    V(s, r, q, p) = integral;  // (sr|qp)
+  };
+}
+
+auto fcidump_2body_functor(macis::packed_eri_span<double> V) {
+  return [=](int p, int q, int r, int s, double integral) {
+    V.data_handle()[V.index(p, q, r, s)] = integral;
+  };
+}
+
+constexpr auto fcidump_ignore = [](auto&&...) {};
+
+}  // namespace
+
+namespace macis {
+
+FCIDumpHeader read_fcidump_header(std::string fname) {
+  mapped_file file(fname);
+  const char* body;
+  auto header = fcidump_header(file.begin(), file.end(), body);
+  header.norb = fcidump_norb(header, body, file.end());
+  return header;
+}
+
+uint32_t read_fcidump_norb(std::string fname) {
+  return read_fcidump_header(fname).norb;
+}
+
+double read_fcidump_core(std::string fname) {
+  return read_fcidump_entries(fname, 0, fcidump_ignore, fcidump_ignore);
 }
 
 void read_fcidump_1body(std::string fname, col_major_span<double, 2> T) {
   if(T.extent(0) != T.extent(1)) throw std::runtime_error("T must be square");
 
-  auto norb = read_fcidump_norb(fname);
-  if(T.extent(0) != norb)
-    throw std::runtime_error("T is of improper dimension");
-
-  std::ifstream file(fname);
-  std::string line;
-  while(std::getline(file, line)) {
-    auto tokens = split(line, " ");
-    if(tokens.size() != 5) continue;  // not a valid FCIDUMP line
-
-    auto [p, q, r, s, integral] = fcidump_line(tokens);
-    auto lc = line_classification(p, q, r, s);
-    if(lc == LineClassification::OneBody) {
-      p--;
-      q--;
-      T(p, q) = integral;
-      T(q, p) = integral;
-    }
-  }
+  read_fcidump_entries(fname, T.extent(0), fcidump_1body_functor(T),
+                       fcidump_ignore);
 }
 
 void read_fcidump_1body(std::string fname, double* T, size_t LDT) {
@@ -143,34 +370,8 @@ void read_fcidump_2body(std::string fname, col_major_span<double, 4> V) {
   if(V.extent(0) != V.extent(2)) throw std::runtime_error("V must be square");
   if(V.extent(0) != V.extent(3)) throw std::runtime_error("V must be square");
 
-  auto norb = read_fcidump_norb(fname);
-  if(V.extent(0) != norb)
-    throw std::runtime_error("V is of improper dimension");
-
-  std::ifstream file(fname);
-  std::string line;
-  while(std::getline(file, line)) {
-    auto tokens = split(line, " ");
-    if(tokens.size() != 5) continue;  // not a valid FCIDUMP line
-
-    auto [p, q, r, s, integral] = fcidump_line(tokens);
-    auto lc = line_classification(p, q, r, s);
-    if(lc == LineClassification::TwoBody) {
-      p--;
-      q--;
-      r--;
-      s--;
-      V(p, q, r, s) = integral;  // (pq|rs)
-      V(p, q, s, r) = integral;  // (pq|sr)
-      V(q, p, r, s) = integral;  // (qp|rs)
-      V(q, p, s, r) = integral;  // (qp|sr)
-
-      V(r, s, p, q) = integral;  // (rs|pq)
-      V(s, r, p, q) = integral;  // (sr|pq)
-      V(r, s, q, p) = integral;  // (rs|qp)
-      V(s, r, q, p) = integral;  // (sr|qp)
-    }
-  }
+  read_fcidump_entries(fname, V.extent(0), fcidump_ignore,
+                       fcidump_2body_functor(V));
 }
 
 void read_fcidump_2body(std::string fname, double* V, size_t LDV) {
@@ -181,6 +382,36 @@ void read_fcidump_2body(std::string fname, double* V, size_t LDV) {
       fname, KokkosEx::submdspan(V_map, sl, sl, sl, Kokkos::full_extent));
 }
 
+void read_fcidump_2body(std::string fname, packed_eri_span<double> V) {
+  read_fcidump_entries(fname, V.extent(0), fcidump_ignore,
+                       fcidump_2body_functor(V));
+}
+
+double read_fcidump(std::string fname, double* T, size_t LDT, double* V,
+                    size_t LDV) {
+  auto norb = read_fcidump_norb(fname);
+  col_major_span<double, 2> T_map(T, LDT, norb);
+  col_major_span<double, 4> V_map(V, LDV, LDV, LDV, norb);
+  auto sl = std::pair{0, norb};
+  return read_fcidump_entries(
+      fname, norb,
+      fcidump_1body_functor(
+          KokkosEx::submdspan(T_map, sl, Kokkos::full_extent)),
+      fcidump_2body_functor(
+          KokkosEx::submdspan(V_map, sl, sl, sl, Kokkos::full_extent)));
+}
+
+double read_fcidump(std::string fname, double* T, size_t LDT,
+                    packed_eri_span<double> V) {
+  const size_t norb = V.extent(0);
+  col_major_span<double, 2> T_map(T, LDT, norb);
+  return read_fcidump_entries(
+      fname, norb,
+      fcidump_1body_functor(KokkosEx::submdspan(T_map, std::pair{0, norb},
+                                                Kokkos::full_extent)),
+      fcidump_2body_functor(V));
+}
+
 void write_fcidump(std::string fname, size_t norb, const double* T, size_t LDT,
                    const double* V, size_t LDV, double E_core) {
   auto logger = spdlog::basic_logger_mt("fcidump", fname);
@@ -279,4 +510,36 @@ void write_rdms_binary(std::string fname, size_t norb, const double* ORDM,
   out_file.write((char*)raw.data(), norb * norb * norb * norb * sizeof(double));
 }
 
+void write_rdms_binary_packed(std::string fname, size_t norb,
+                              const double* ORDM, size_t LDD1,
+                              const double* TRDM) {
+  std::ofstream out_file(fname, std::ios::binary);
+  if(!out_file) throw std::runtime_error(fname + " not available");
+
+  int _norb_write = norb;
+  out_file.write((char*)&_norb_write, sizeof(int));
+
+  const size_t norb2 = norb * norb;
+  const size_t norb3 = norb2 * norb;
+  std::vector<double> raw(norb3);
+
+  // Pack and Write 1RDM
+  for(size_t i = 0; i < norb; ++i)
+    for(size_t j = 0; j < norb; ++j) {
+      raw[i + j * norb] = ORDM[i + j * LDD1];
+    }
+  out_file.write((char*)raw.data(), norb2 * sizeof(double));
+
+  // Unpack and Write 2RDM one trailing index at a time
+  for(size_t l = 0; l < norb; ++l) {
+    for(size_t k = 0; k < norb; ++k)
+      for(size_t j = 0; j < norb; ++j)
+        for(size_t i = 0; i < norb; ++i) {
+          raw[i + j * norb + k * norb2] =
+              TRDM[packed_rank4_span<const double>::index(i, j, k, l)];
+        }
+    out_file.write((char*)raw.data(), norb3 * sizeof(double));
+  }
+}
+
 }  // namespace macis
@@ -8,6 +8,7 @@
 
 #include <blas.hh>
 #include <macis/util/fock_matrices.hpp>
+#include <macis/util/packed_rdms.hpp>
 #include <vector>
 
 namespace macis {
@@ -148,6 +149,262 @@ void aux_q_matrix(NumActive _nact, NumOrbital _norb, NumInactive _ninact,
     }
 }
 
+void aux_q_matrix_packed(NumActive _nact, NumOrbital _norb,
+                         NumInactive _ninact, const double* V, size_t LDV,
+                         const double* A2RDM, double* Q, size_t LDQ) {
+  const auto norb = _norb.get();
+  const auto ninact = _ninact.get();
+  const auto nact = _nact.get();
+  const size_t npair = packed_pair_size(nact);
+
+  const size_t LDV2 = LDV * LDV;
+  const size_t LDV3 = LDV2 * LDV;
+
+  // Contract one w at a time to avoid expanding the leading (v,w) pair
+  std::vector<double> B(nact * npair), W(norb * npair);
+  for(size_t w = 0; w < nact; ++w) {
+    const size_t w_off = w + ninact;
+
+    // B(v,[xy]) = \Gamma(v,w,x,y)
+    unpack_rank4_slice(nact, A2RDM, w, B.data());
+
+    // W(p,[xy]) = V(p,w,x,y) + V(p,w,y,x) (x != y)
+    for(size_t x = 0; x < nact; ++x)
+      for(size_t y = 0; y <= x; ++y) {
+        const double fac = x == y ? 1.0 : 2.0;
+        const size_t x_off = x + ninact;
+        const size_t y_off = y + ninact;
+        auto* W_xy = W.data() + packed_pair_index(x, y) * norb;
+        for(size_t p = 0; p < norb; ++p)
+          W_xy[p] = fac * V[p + w_off * LDV + x_off * LDV2 + y_off * LDV3];
+      }
+
+    // Q(v,p) += 2 * B(v,[xy]) * W(p,[xy])
+    blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::Trans,
+               nact, norb, npair, 2.0, B.data(), nact, W.data(), norb,
+               w ? 1.0 : 0.0, Q, LDQ);
+  }
+}
+
+namespace {
+
+// B(p,q,P) = L(p + p_off, q + q_off, P) for p < np, q < nq
+std::vector<double> cholesky_block(size_t np, size_t p_off, size_t nq,
+                                   size_t q_off, size_t naux, const double* L,
+                                   size_t LDL) {
+  const size_t LDL2 = LDL * LDL;
+  std::vector<double> B(np * nq * naux);
+  for(size_t P = 0; P < naux; ++P)
+    for(size_t q = 0; q < nq; ++q)
+      for(size_t p = 0; p < np; ++p)
+        B[p + q * np + P * np * nq] =
+            L[p + p_off + (q + q_off) * LDL + P * LDL2];
+  return B;
+}
+
+}  // namespace
+
+void inactive_fock_matrix_cholesky(NumOrbital _norb, NumInactive _ninact,
+                                   NumCholeskyVector _naux, const double* T,
+                                   size_t LDT, const double* L, size_t LDL,
+                                   double* Fi, size_t LDF) {
+  const auto norb = _norb.get();
+  const auto ninact = _ninact.get();
+  const auto naux = _naux.get();
+
+  const size_t LDL2 = LDL * LDL;
+
+  // Coulomb
+  // J(p,q) = L(p,q,P) * d(P), d(P) = \sum_i L(i,i,P)
+  std::vector<double> d(naux, 0.0), J(LDL * norb, 0.0);
+  for(size_t P = 0; P < naux; ++P)
+    for(size_t i = 0; i < ninact; ++i) d[P] += L[i * (LDL + 1) + P * LDL2];
+  if(naux)
+    blas::gemv(blas::Layout::ColMajor, blas::Op::NoTrans, LDL * norb, naux,
+               1.0, L, LDL2, d.data(), 1, 0.0, J.data(), 1);
+
+  // Exchange
+  // K(p,q) = B(p,(i,P)) * B(q,(i,P)), B(p,i,P) = L(p,i,P)
+  auto B = cholesky_block(norb, 0, ninact, 0, naux, L, LDL);
+  std::vector<double> K(norb * norb);
+  blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::Trans, norb,
+             norb, ninact * naux, 1.0, B.data(), norb, B.data(), norb, 0.0,
+             K.data(), norb);
+
+  for(size_t p = 0; p < norb; ++p)
+    for(size_t q = 0; q < norb; ++q) {
+      Fi[p + q * LDF] = T[p + q * LDT] + 2 * J[p + q * LDL] - K[p + q * norb];
+    }
+}
+
+void active_subtensor_2body_cholesky(NumActive _nact, NumInactive _ninact,
+                                     NumCholeskyVector _naux, const double* L,
+                                     size_t LDL, double* V_sub, size_t LDVS) {
+  const auto ninact = _ninact.get();
+  const auto nact = _nact.get();
+  const auto naux = _naux.get();
+
+  const size_t nact2 = nact * nact;
+  const size_t LDVS2 = LDVS * LDVS;
+
+  // V((x,y),(z,w)) = La((x,y),P) * La((z,w),P)
+  auto La = cholesky_block(nact, ninact, nact, ninact, naux, L, LDL);
+  if(LDVS == nact) {
+    blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::Trans,
+               nact2, nact2, naux, 1.0, La.data(), nact2, La.data(), nact2,
+               0.0, V_sub, nact2);
+  } else {
+    std::vector<double> V(nact2 * nact2);
+    blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::Trans,
+               nact2, nact2, naux, 1.0, La.data(), nact2, La.data(), nact2,
+               0.0, V.data(), nact2);
+    for(size_t zw = 0; zw < nact2; ++zw)
+      for(size_t xy = 0; xy < nact2; ++xy) {
+        const size_t x = xy % nact, y = xy / nact;
+        const size_t z = zw % nact, w = zw / nact;
+        V_sub[x + y * LDVS + z * LDVS2 + w * LDVS2 * LDVS] =
+            V[xy + zw * nact2];
+      }
+  }
+}
+
+void active_hamiltonian_cholesky(NumOrbital norb, NumActive nact,
+                                 NumInactive ninact, NumCholeskyVector naux,
+                                 const double* T_full, size_t LDTF,
+                                 const double* L, size_t LDL, double* Fi,
+                                 size_t LDFi, double* T_active, size_t LDTA,
+                                 double* V_active, size_t LDVA) {
+  // Expand all-active subblock of V
+  active_subtensor_2body_cholesky(nact, ninact, naux, L, LDL, V_active, LDVA);
+
+  // Compute inactive Fock in full MO space
+  inactive_fock_matrix_cholesky(norb, ninact, naux, T_full, LDTF, L, LDL, Fi,
+                                LDFi);
+
+  // Set T_active as the active-active block of inactive Fock
+  active_submatrix_1body(nact, ninact, Fi, LDFi, T_active, LDTA);
+}
+
+void active_fock_matrix_cholesky(NumOrbital _norb, NumInactive _ninact,
+                                 NumActive _nact, NumCholeskyVector _naux,
+                                 const double* L, size_t LDL,
+                                 const double* A1RDM, size_t LDD, double* Fa,
+                                 size_t LDF) {
+  const auto norb = _norb.get();
+  const auto ninact = _ninact.get();
+  const auto nact = _nact.get();
+  const auto naux = _naux.get();
+
+  const size_t nact2 = nact * nact;
+  const size_t LDL2 = LDL * LDL;
+
+  // Coulomb
+  // J(p,q) = L(p,q,P) * d(P), d(P) = \sum_{vw} \gamma(v,w) * L(v,w,P)
+  auto La = cholesky_block(nact, ninact, nact, ninact, naux, L, LDL);
+  std::vector<double> d(naux, 0.0), J(LDL * norb, 0.0);
+  for(size_t P = 0; P < naux; ++P)
+    for(size_t w = 0; w < nact; ++w)
+      for(size_t v = 0; v < nact; ++v)
+        d[P] += A1RDM[v + w * LDD] * La[v + w * nact + P * nact2];
+  if(naux)
+    blas::gemv(blas::Layout::ColMajor, blas::Op::NoTrans, LDL * norb, naux,
+               1.0, L, LDL2, d.data(), 1, 0.0, J.data(), 1);
+
+  // Exchange
+  // C(p,v,P) = \sum_w B(p,w,P) * \gamma(v,w), B(p,w,P) = L(p,w,P)
+  // K(p,q)   = C(p,(v,P)) * B(q,(v,P))
+  auto B = cholesky_block(norb, 0, nact, ninact, naux, L, LDL);
+  std::vector<double> C(B.size()), K(norb * norb);
+  for(size_t P = 0; P < naux; ++P) {
+    blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::Trans,
+               norb, nact, nact, 1.0, B.data() + P * norb * nact, norb, A1RDM,
+               LDD, 0.0, C.data() + P * norb * nact, norb);
+  }
+  blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::Trans, norb,
+             norb, nact * naux, 1.0, C.data(), norb, B.data(), norb, 0.0,
+             K.data(), norb);
+
+  for(size_t p = 0; p < norb; ++p)
+    for(size_t q = 0; q < norb; ++q) {
+      Fa[p + q * LDF] = J[p + q * LDL] - 0.5 * K[p + q * norb];
+    }
+}
+
+void aux_q_matrix_cholesky(NumActive _nact, NumOrbital _norb,
+                           NumInactive _ninact, NumCholeskyVector _naux,
+                           const double* L, size_t LDL, const double* A2RDM,
+                           size_t LDD, double* Q, size_t LDQ) {
+  const auto norb = _norb.get();
+  const auto ninact = _ninact.get();
+  const auto nact = _nact.get();
+  const auto naux = _naux.get();
+
+  const size_t nact2 = nact * nact;
+  const size_t LDD2 = LDD * LDD;
+  const size_t LDD3 = LDD2 * LDD;
+
+  // G((v,w),(x,y)) = \Gamma(v,w,x,y)
+  std::vector<double> G(nact2 * nact2);
+  for(size_t y = 0; y < nact; ++y)
+    for(size_t x = 0; x < nact; ++x)
+      for(size_t w = 0; w < nact; ++w)
+        for(size_t v = 0; v < nact; ++v) {
+          G[v + w * nact + (x + y * nact) * nact2] =
+              A2RDM[v + w * LDD + x * LDD2 + y * LDD3];
+        }
+
+  // M((v,w),P) = G((v,w),(x,y)) * La((x,y),P)
+  auto La = cholesky_block(nact, ninact, nact, ninact, naux, L, LDL);
+  std::vector<double> M(nact2 * naux);
+  blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::NoTrans,
+             nact2, naux, nact2, 1.0, G.data(), nact2, La.data(), nact2, 0.0,
+             M.data(), nact2);
+
+  // Q(v,p) = 2 * M(v,(w,P)) * B(p,(w,P)), B(p,w,P) = L(p,w,P)
+  auto B = cholesky_block(norb, 0, nact, ninact, naux, L, LDL);
+  blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::Trans, nact,
+             norb, nact * naux, 2.0, M.data(), nact, B.data(), norb, 0.0, Q,
+             LDQ);
+}
+
+void aux_q_matrix_cholesky_packed(NumActive _nact, NumOrbital _norb,
+                                  NumInactive _ninact,
+                                  NumCholeskyVector _naux, const double* L,
+                                  size_t LDL, const double* A2RDM, double* Q,
+                                  size_t LDQ) {
+  const auto norb = _norb.get();
+  const auto ninact = _ninact.get();
+  const auto nact = _nact.get();
+  const auto naux = _naux.get();
+  const size_t npair = packed_pair_size(nact);
+  const size_t LDL2 = LDL * LDL;
+
+  // Lp([xy],P) = L(x,y,P) + L(y,x,P) (x != y)
+  std::vector<double> Lp(npair * naux);
+  for(size_t P = 0; P < naux; ++P)
+    for(size_t x = 0; x < nact; ++x)
+      for(size_t y = 0; y <= x; ++y) {
+        const double fac = x == y ? 1.0 : 2.0;
+        Lp[packed_pair_index(x, y) + P * npair] =
+            fac * L[x + ninact + (y + ninact) * LDL + P * LDL2];
+      }
+
+  // Contract one w at a time to avoid expanding the leading (v,w) pair
+  std::vector<double> B(nact * npair), M(nact * naux);
+  for(size_t w = 0; w < nact; ++w) {
+    // M(v,P) = \Gamma(v,w,[xy]) * Lp([xy],P)
+    unpack_rank4_slice(nact, A2RDM, w, B.data());
+    blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::NoTrans,
+               nact, naux, npair, 1.0, B.data(), nact, Lp.data(), npair, 0.0,
+               M.data(), nact);
+
+    // Q(v,p) += 2 * M(v,P) * L(p,w,P)
+    blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::Trans,
+               nact, norb, naux, 2.0, M.data(), nact, L + (w + ninact) * LDL,
+               LDL2, w ? 1.0 : 0.0, Q, LDQ);
+  }
+}
+
 void generalized_fock_matrix(NumOrbital _norb, NumInactive _ninact,
                              NumActive _nact, const double* Fi, size_t LDFi,
                              const double* Fa, size_t LDFa, const double* A1RDM,
@@ -252,4 +509,31 @@ double energy_from_generalized_fock(NumInactive _ninact, NumActive _nact,
   return 0.5 * E;
 }
 
+double energy_from_packed_rdms(NumActive _nact, const double* T, size_t LDT,
+                               const double* V, size_t LDV,
+                               const double* A1RDM, size_t LDD,
+                               const double* A2RDM) {
+  const auto nact = _nact.get();
+
+  const size_t LDV2 = LDV * LDV;
+  const size_t LDV3 = LDV2 * LDV;
+
+  double E = 0.0;
+  for(size_t x = 0; x < nact; ++x)
+    for(size_t y = 0; y < nact; ++y) E += A1RDM[x + y * LDD] * T[x + y * LDT];
+
+  // Unique elements weighted by the number of equivalent index tuples
+  using packed_type = packed_rank4_span<const double>;
+  for(size_t p = 0; p < nact; ++p)
+    for(size_t q = 0; q <= p; ++q)
+      for(size_t r = 0; r <= p; ++r)
+        for(size_t s = 0; s <= (r == p ? q : r); ++s) {
+          E += packed_type::orbit_size(p, q, r, s) *
+               A2RDM[packed_type::index(p, q, r, s)] *
+               V[p + q * LDV + r * LDV2 + s * LDV3];
+        }
+
+  return E;
+}
+
 }  // namespace macis
@@ -6,8 +6,10 @@
  * See LICENSE.txt for details
  */
 
+#include <blas.hh>
 #include <iostream>
 #include <lapack.hh>
+#include <macis/util/fock_matrices.hpp>
 #include <macis/util/moller_plesset.hpp>
 #include <macis/util/orbital_energies.hpp>
 
@@ -37,28 +39,27 @@ void mp2_t2(NumCanonicalOccupied _nocc, NumCanonicalVirtual _nvir,
         }
 }
 
-void mp2_1rdm(NumOrbital _norb, NumCanonicalOccupied _nocc,
-              NumCanonicalVirtual _nvir, const double* T, size_t LDT,
-              const double* V, size_t LDV, double* ORDM, size_t LDD) {
-  const size_t norb = _norb.get();
-  const size_t nocc = _nocc.get();
-  const size_t nvir = _nvir.get();
+namespace {
 
+// MP2 1-RDM from canonical orbital energies and V(i,a,j,b) = (ia|jb),
+// i,j occupied and a,b virtual (offset from zero)
+template <typename Functor>
+void mp2_1rdm_impl(size_t nocc, size_t nvir, const double* eps,
+                   const Functor& V, double* ORDM, size_t LDD) {
   const size_t nocc2 = nocc * nocc;
   const size_t nocc2v = nocc2 * nvir;
-  const size_t LDV2 = LDV * LDV;
-  const size_t LDV3 = LDV2 * LDV;
-
-  // Compute canonical eigenenergies
-  // XXX: This will not generally replicate full precision
-  // with respect to those returned by the eigen solver
-  std::vector<double> eps(norb);
-  canonical_orbital_energies(_norb, NumInactive(nocc), T, LDT, V, LDV,
-                             eps.data());
 
   // Compute T2
+  // T2(i,j,a,b) = (ia|jb) / (eps[i] + eps[j] - eps[a] - eps[b])
   std::vector<double> T2(nocc2v * nvir);
-  mp2_t2(_nocc, _nvir, V, LDV, eps.data(), T2.data());
+  for(auto i = 0ul; i < nocc; ++i)
+    for(auto j = 0ul; j < nocc; ++j)
+      for(auto a = 0ul; a < nvir; ++a)
+        for(auto b = 0ul; b < nvir; ++b) {
+          T2[i + j * nocc + a * nocc2 + b * nocc2v] =
+              V(i, a, j, b) /
+              (eps[i] + eps[j] - eps[a + nocc] - eps[b + nocc]);
+        }
 
   // Compute MP2 energy XXX: This is not required, just a check
   double EMP2 = 0.0;
@@ -66,10 +67,8 @@ void mp2_1rdm(NumOrbital _norb, NumCanonicalOccupied _nocc,
     for(auto j = 0ul; j < nocc; ++j)
       for(auto a = 0ul; a < nvir; ++a)
         for(auto b = 0ul; b < nvir; ++b) {
-          const auto a_off = a + nocc;
-          const auto b_off = b + nocc;
-          const double V_abij = V[a_off + i * norb + b_off * LDV2 + j * LDV3];
-          const double V_abji = V[a_off + j * norb + b_off * LDV2 + i * LDV3];
+          const double V_abij = V(i, a, j, b);
+          const double V_abji = V(j, a, i, b);
 
           const double t2_ijab = T2[i + j * nocc + a * nocc2 + b * nocc2v];
           EMP2 += t2_ijab * (2 * V_abij - V_abji);
@@ -109,6 +108,87 @@ void mp2_1rdm(NumOrbital _norb, NumCanonicalOccupied _nocc,
     }
 }
 
+// Overwrite the MP2 1-RDM in NO_C by the MP2 natural orbitals
+void mp2_natural_orbitals_from_1rdm(size_t norb, double* ON, double* NO_C,
+                                    size_t LDC) {
+  // 1. First negate to ensure diagonalization sorts eigenvalues in
+  //    decending order
+  for(size_t i = 0; i < norb; ++i)
+    for(size_t j = 0; j < norb; ++j) {
+      NO_C[i + j * LDC] *= -1.0;
+    }
+
+  // 2. Solve eigenvalue problem PC = CO
+  lapack::syev(lapack::Job::Vec, lapack::Uplo::Lower, norb, NO_C, LDC, ON);
+
+  // 3. Undo negation
+  for(size_t i = 0; i < norb; ++i) ON[i] *= -1.0;
+}
+
+}  // namespace
+
+void mp2_1rdm(NumOrbital _norb, NumCanonicalOccupied _nocc,
+              NumCanonicalVirtual _nvir, const double* T, size_t LDT,
+              const double* V, size_t LDV, double* ORDM, size_t LDD) {
+  const size_t norb = _norb.get();
+  const size_t nocc = _nocc.get();
+  const size_t nvir = _nvir.get();
+
+  const size_t LDV2 = LDV * LDV;
+  const size_t LDV3 = LDV2 * LDV;
+
+  // Compute canonical eigenenergies
+  // XXX: This will not generally replicate full precision
+  // with respect to those returned by the eigen solver
+  std::vector<double> eps(norb);
+  canonical_orbital_energies(_norb, NumInactive(nocc), T, LDT, V, LDV,
+                             eps.data());
+
+  mp2_1rdm_impl(
+      nocc, nvir, eps.data(),
+      [&](size_t i, size_t a, size_t j, size_t b) {
+        return V[i + (a + nocc) * LDV + j * LDV2 + (b + nocc) * LDV3];
+      },
+      ORDM, LDD);
+}
+
+void mp2_1rdm_cholesky(NumOrbital _norb, NumCanonicalOccupied _nocc,
+                       NumCanonicalVirtual _nvir, NumCholeskyVector _naux,
+                       const double* T, size_t LDT, const double* L,
+                       size_t LDL, double* ORDM, size_t LDD) {
+  const size_t norb = _norb.get();
+  const size_t nocc = _nocc.get();
+  const size_t nvir = _nvir.get();
+  const size_t naux = _naux.get();
+
+  const size_t nov = nocc * nvir;
+  const size_t LDL2 = LDL * LDL;
+
+  // Canonical eigenenergies from the diagonal of the Fock matrix
+  std::vector<double> eps(norb), F(norb * norb);
+  inactive_fock_matrix_cholesky(_norb, NumInactive(nocc), _naux, T, LDT, L,
+                                LDL, F.data(), norb);
+  for(size_t p = 0; p < norb; ++p) eps[p] = F[p * (norb + 1)];
+
+  // (ia|jb) = L_ov((i,a),P) * L_ov((j,b),P)
+  std::vector<double> L_ov(nov * naux), V_ovov(nov * nov);
+  for(size_t P = 0; P < naux; ++P)
+    for(size_t a = 0; a < nvir; ++a)
+      for(size_t i = 0; i < nocc; ++i) {
+        L_ov[i + a * nocc + P * nov] = L[i + (a + nocc) * LDL + P * LDL2];
+      }
+  blas::gemm(blas::Layout::ColMajor, blas::Op::NoTrans, blas::Op::Trans, nov,
+             nov, naux, 1.0, L_ov.data(), nov, L_ov.data(), nov, 0.0,
+             V_ovov.data(), nov);
+
+  mp2_1rdm_impl(
+      nocc, nvir, eps.data(),
+      [&](size_t i, size_t a, size_t j, size_t b) {
+        return V_ovov[i + a * nocc + (j + b * nocc) * nov];
+      },
+      ORDM, LDD);
+}
+
 void mp2_natural_orbitals(NumOrbital norb, NumCanonicalOccupied nocc,
                           NumCanonicalVirtual nvir, const double* T, size_t LDT,
                           const double* V, size_t LDV, double* ON, double* NO_C,
@@ -117,20 +197,19 @@ void mp2_natural_orbitals(NumOrbital norb, NumCanonicalOccupied nocc,
   mp2_1rdm(norb, nocc, nvir, T, LDT, V, LDV, NO_C, LDC);
 
   // Compute MP2 Natural Orbitals
+  mp2_natural_orbitals_from_1rdm(norb.get(), ON, NO_C, LDC);
+}
 
-  // 1. First negate to ensure diagonalization sorts eigenvalues in
-  //    decending order
-  for(size_t i = 0; i < norb.get(); ++i)
-    for(size_t j = 0; j < norb.get(); ++j) {
-      NO_C[i + j * LDC] *= -1.0;
-    }
-
-  // 2. Solve eigenvalue problem PC = CO
-  lapack::syev(lapack::Job::Vec, lapack::Uplo::Lower, norb.get(), NO_C, LDC,
-               ON);
+void mp2_natural_orbitals_cholesky(NumOrbital norb, NumCanonicalOccupied nocc,
+                                   NumCanonicalVirtual nvir,
+                                   NumCholeskyVector naux, const double* T,
+                                   size_t LDT, const double* L, size_t LDL,
+                                   double* ON, double* NO_C, size_t LDC) {
+  // Compute MP2 1-RDM
+  mp2_1rdm_cholesky(norb, nocc, nvir, naux, T, LDT, L, LDL, NO_C, LDC);
 
-  // 3. Undo negation
-  for(size_t i = 0; i < norb.get(); ++i) ON[i] *= -1.0;
+  // Compute MP2 Natural Orbitals
+  mp2_natural_orbitals_from_1rdm(norb.get(), ON, NO_C, LDC);
 }
 
 }  // namespace macis
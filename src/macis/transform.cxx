@@ -7,7 +7,9 @@
  */
 
 #include <blas.hh>
+#include <macis/util/packed_rdms.hpp>
 #include <macis/util/transform.hpp>
+#include <vector>
 
 #define FOUR_IDX(arr, i, j, k, l, LDA1, LDA2, LDA3) \
   arr[i + j * LDA1 + k * LDA1 * LDA2 + l * LDA1 * LDA2 * LDA3]
@@ -117,4 +119,45 @@ void four_index_transform(size_t norb_old, size_t norb_new, const double* X,
 #endif
 }
 
+void four_index_transform_packed(size_t norb, double* P, const double* C,
+                                 size_t LDC) {
+  const size_t npair = packed_pair_size(norb);
+  std::vector<double> H(npair * npair), X(norb * norb), Y(norb * norb);
+
+  // 1st Half
+  // H([pq],[kl]) = C(i,p) * P(i,j,[kl]) * C(j,q)
+  for(size_t kl = 0; kl < npair; ++kl) {
+    for(size_t j = 0; j < norb; ++j)
+      for(size_t i = 0; i < norb; ++i)
+        X[i + j * norb] = P[packed_pair_index(packed_pair_index(i, j), kl)];
+    two_index_transform(norb, norb, X.data(), norb, C, LDC, Y.data(), norb);
+    auto* H_kl = H.data() + kl * npair;
+    for(size_t p = 0, pq = 0; p < norb; ++p)
+      for(size_t q = 0; q <= p; ++q, ++pq) H_kl[pq] = Y[p + q * norb];
+  }
+
+  // 2nd Half
+  // P([pq],[rs]) = C(k,r) * H([pq],k,l) * C(l,s), [rs] <= [pq]
+  for(size_t pq = 0; pq < npair; ++pq) {
+    for(size_t l = 0; l < norb; ++l)
+      for(size_t k = 0; k < norb; ++k)
+        X[k + l * norb] = H[pq + packed_pair_index(k, l) * npair];
+    two_index_transform(norb, norb, X.data(), norb, C, LDC, Y.data(), norb);
+    for(size_t r = 0, rs = 0; rs <= pq; ++r)
+      for(size_t s = 0; s <= r and rs <= pq; ++s, ++rs)
+        P[packed_pair_index(pq, rs)] = Y[r + s * norb];
+  }
+}
+
+void cholesky_transform(size_t norb_old, size_t norb_new, size_t naux,
+                        const double* X, size_t LDX, const double* C,
+                        size_t LDC, double* Y, size_t LDY) {
+  // Each Cholesky vector transforms as a 1-body operator
+  // O(norb^3 * naux) vs O(norb^5) for the 4-index transform
+  for(size_t P = 0; P < naux; ++P) {
+    two_index_transform(norb_old, norb_new, X + P * LDX * LDX, LDX, C, LDC,
+                        Y + P * LDY * LDY, LDY);
+  }
+}
+
 }  // namespace macis
@@ -0,0 +1,391 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sparsexx/matrix_types/csr_matrix.hpp>
+#include <sparsexx/matrix_types/dist_sparse_matrix.hpp>
+#include <sparsexx/spblas/pspmbv.hpp>
+#include <stdexcept>
+#include <string>
+
+namespace sparsexx {
+
+namespace detail {
+
+/**
+ *  @brief Fixed-size header of a per-rank dist_sparse_matrix checkpoint.
+ *
+ *  The header is followed by a sequence of arrays, each stored as a
+ *  64-bit element count followed by the raw elements, with every count and
+ *  array starting on a `checkpoint_alignment` byte boundary.
+ */
+struct dist_checkpoint_header {
+  char magic[8];
+  uint64_t version;
+  uint64_t value_size;
+  uint64_t index_size;
+  int64_t comm_size;
+  int64_t comm_rank;
+  int64_t global_m;
+  int64_t global_n;
+  int64_t tile_m[2];  ///< Diagonal / off-diagonal tile rows (-1 if absent)
+  int64_t tile_n[2];  ///< Diagonal / off-diagonal tile cols
+  int64_t has_spmv_info;
+  uint64_t fingerprint;  ///< Caller-defined fingerprint of the matrix inputs
+};
+
+inline constexpr char dist_checkpoint_magic[8] = "SPXXDCK";
+inline constexpr uint64_t dist_checkpoint_version = 2;
+inline constexpr size_t checkpoint_alignment = 64;
+
+inline std::string dist_checkpoint_fname(const std::string& prefix,
+                                         int rank) {
+  return prefix + "." + std::to_string(rank) + ".bin";
+}
+
+inline void checkpoint_pad(std::ofstream& file) {
+  static const char zeros[checkpoint_alignment] = {};
+  const size_t pos = file.tellp();
+  const size_t npad = (checkpoint_alignment - pos % checkpoint_alignment) %
+                      checkpoint_alignment;
+  file.write(zeros, npad);
+}
+
+template <typename U, typename Alloc>
+void checkpoint_write_array(std::ofstream& file,
+                            const std::vector<U, Alloc>& x) {
+  const uint64_t n = x.size();
+  checkpoint_pad(file);
+  file.write(reinterpret_cast<const char*>(&n), sizeof(n));
+  checkpoint_pad(file);
+  file.write(reinterpret_cast<const char*>(x.data()), n * sizeof(U));
+}
+
+/// Sequential reader of checkpoint arrays over a memory mapped file
+class checkpoint_mmap_reader {
+  int fd_ = -1;
+  const char* base_ = nullptr;
+  size_t size_ = 0;
+  size_t pos_ = 0;
+
+  void align() {
+    pos_ += (checkpoint_alignment - pos_ % checkpoint_alignment) %
+            checkpoint_alignment;
+  }
+
+  size_t remaining() const { return pos_ < size_ ? size_ - pos_ : 0; }
+
+  const char* advance(size_t nbytes) {
+    if(nbytes > remaining())
+      throw std::runtime_error("Checkpoint File Truncated");
+    const char* ptr = base_ + pos_;
+    pos_ += nbytes;
+    return ptr;
+  }
+
+ public:
+  checkpoint_mmap_reader(const std::string& fname) {
+    fd_ = open(fname.c_str(), O_RDONLY);
+    if(fd_ < 0) throw std::runtime_error("Could Not Open " + fname);
+
+    struct stat st;
+    if(fstat(fd_, &st)) {
+      close(fd_);
+      throw std::runtime_error("Could Not Stat " + fname);
+    }
+    size_ = st.st_size;
+
+    void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if(ptr == MAP_FAILED) {
+      close(fd_);
+      throw std::runtime_error("Could Not Map " + fname);
+    }
+    base_ = static_cast<const char*>(ptr);
+    madvise(ptr, size_, MADV_SEQUENTIAL);
+  }
+
+  ~checkpoint_mmap_reader() noexcept {
+    munmap(const_cast<char*>(base_), size_);
+    close(fd_);
+  }
+
+  checkpoint_mmap_reader(const checkpoint_mmap_reader&) = delete;
+  checkpoint_mmap_reader& operator=(const checkpoint_mmap_reader&) = delete;
+
+  template <typename U>
+  U read_value() {
+    U x;
+    std::memcpy(&x, advance(sizeof(U)), sizeof(U));
+    return x;
+  }
+
+  template <typename U>
+  std::vector<U> read_array() {
+    align();
+    const auto n = read_value<uint64_t>();
+    align();
+    // Checked before forming the byte count, which may overflow
+    if(n > remaining() / sizeof(U))
+      throw std::runtime_error("Checkpoint File Truncated");
+    const auto* ptr = reinterpret_cast<const U*>(advance(n * sizeof(U)));
+    return std::vector<U>(ptr, ptr + n);
+  }
+};
+
+/**
+ *  @brief Check that the arrays of a checkpointed CSR tile form a valid
+ *  (0-based) m x n CSR matrix, such that the tile may be used without
+ *  further bounds checks.
+ */
+template <typename index_t, typename T>
+bool checkpoint_valid_csr(const std::vector<index_t>& rowptr,
+                          const std::vector<index_t>& colind,
+                          const std::vector<T>& nzval, int64_t m, int64_t n) {
+  if(m < 0 or n < 0 or rowptr.size() != size_t(m + 1) or rowptr.front() != 0)
+    return false;
+  for(int64_t i = 0; i < m; ++i)
+    if(rowptr[i] > rowptr[i + 1]) return false;
+  if(size_t(rowptr.back()) != colind.size() or colind.size() != nzval.size())
+    return false;
+  return std::all_of(colind.begin(), colind.end(),
+                     [=](auto j) { return j >= 0 and j < n; });
+}
+
+/**
+ *  @brief Check that checkpointed SpMV communication info is consistent with
+ *  the communicator and the local row extent, i.e. that every message lies
+ *  within the packed index arrays and every index within the local rows
+ *  (send) or the global columns (recv).
+ */
+template <typename index_t>
+bool checkpoint_valid_spmv_info(const spblas::spmv_info<index_t>& info,
+                                int comm_size, int64_t local_m,
+                                int64_t global_n) {
+  const size_t np = comm_size;
+  if(info.send_offsets.size() != np or info.recv_offsets.size() != np or
+     info.send_counts.size() != np or info.recv_counts.size() != np)
+    return false;
+  auto in_bounds = [=](const auto& offsets, const auto& counts, size_t n) {
+    for(size_t i = 0; i < np; ++i)
+      if(counts[i] > n or offsets[i] > n - counts[i]) return false;
+    return true;
+  };
+  auto in_range = [](const auto& x, int64_t n) {
+    return std::all_of(x.begin(), x.end(),
+                       [=](auto j) { return j >= 0 and j < n; });
+  };
+  return in_bounds(info.send_offsets, info.send_counts,
+                   info.send_indices.size()) and
+         in_bounds(info.recv_offsets, info.recv_counts,
+                   info.recv_indices.size()) and
+         in_range(info.send_indices, local_m) and
+         in_range(info.recv_indices, global_n);
+}
+
+}  // namespace detail
+
+/**
+ *  @brief Write a per-rank binary checkpoint of a distributed CSR matrix.
+ *
+ *  Each rank writes its row extents, diagonal and off-diagonal tiles and
+ *  (optionally) SpMV communication info to `<prefix>.<rank>.bin`. The data
+ *  is stored in native binary layout such that it may be reloaded without
+ *  parsing by read_dist_checkpoint on the same number of ranks. Each file
+ *  is written to `<prefix>.<rank>.bin.tmp` and renamed once complete, such
+ *  that an interrupted write never leaves a partial checkpoint behind.
+ *
+ *  @param[in] prefix      Path prefix of the checkpoint files
+ *  @param[in] A           Distributed matrix to write
+ *  @param[in] info        SpMV communication info of A (optional)
+ *  @param[in] fingerprint Fingerprint of the inputs from which A was
+ *                         generated (e.g. macis::hamiltonian_fingerprint),
+ *                         checked by read_dist_checkpoint
+ */
+template <typename T, typename index_t, typename Alloc>
+void write_dist_checkpoint(
+    const std::string& prefix,
+    const dist_sparse_matrix<csr_matrix<T, index_t, Alloc>>& A,
+    const spblas::spmv_info<index_t>* info = nullptr,
+    uint64_t fingerprint = 0) {
+  const auto comm = A.comm();
+  const int comm_size = detail::get_mpi_size(comm);
+  const int comm_rank = detail::get_mpi_rank(comm);
+
+  detail::dist_checkpoint_header header = {};
+  std::memcpy(header.magic, detail::dist_checkpoint_magic, 8);
+  header.version = detail::dist_checkpoint_version;
+  header.value_size = sizeof(T);
+  header.index_size = sizeof(index_t);
+  header.comm_size = comm_size;
+  header.comm_rank = comm_rank;
+  header.global_m = A.m();
+  header.global_n = A.n();
+
+  const csr_matrix<T, index_t, Alloc>* tiles[2] = {
+      A.diagonal_tile_ptr().get(), A.off_diagonal_tile_ptr().get()};
+  for(int t = 0; t < 2; ++t) {
+    header.tile_m[t] = tiles[t] ? tiles[t]->m() : -1;
+    header.tile_n[t] = tiles[t] ? tiles[t]->n() : -1;
+  }
+  header.has_spmv_info = info != nullptr;
+  header.fingerprint = fingerprint;
+
+  const auto fname = detail::dist_checkpoint_fname(prefix, comm_rank);
+  const auto tmp_fname = fname + ".tmp";
+  std::ofstream file(tmp_fname, std::ios::binary);
+  if(!file) throw std::runtime_error("Could Not Open " + tmp_fname);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  std::vector<int64_t> row_extents(2 * comm_size);
+  for(int i = 0; i < comm_size; ++i) {
+    auto [row_st, row_en] = A.row_bounds(i);
+    row_extents[2 * i] = row_st;
+    row_extents[2 * i + 1] = row_en;
+  }
+  detail::checkpoint_write_array(file, row_extents);
+
+  for(int t = 0; t < 2; ++t)
+    if(tiles[t]) {
+      detail::checkpoint_write_array(file, tiles[t]->rowptr());
+      detail::checkpoint_write_array(file, tiles[t]->colind());
+      detail::checkpoint_write_array(file, tiles[t]->nzval());
+    }
+
+  if(info) {
+    detail::checkpoint_write_array(file, info->send_indices);
+    detail::checkpoint_write_array(file, info->recv_indices);
+    detail::checkpoint_write_array(file, info->send_offsets);
+    detail::checkpoint_write_array(file, info->recv_offsets);
+    detail::checkpoint_write_array(file, info->send_counts);
+    detail::checkpoint_write_array(file, info->recv_counts);
+  }
+
+  file.close();
+  if(!file) throw std::runtime_error("Failed Writing " + tmp_fname);
+  if(std::rename(tmp_fname.c_str(), fname.c_str()))
+    throw std::runtime_error("Could Not Rename " + tmp_fname);
+}
+
+/**
+ *  @brief Reload a distributed CSR matrix from a per-rank binary checkpoint.
+ *
+ *  The checkpoint file of the local rank is memory mapped and its arrays are
+ *  copied directly into the tiles (no parsing). Must be called on a
+ *  communicator of the same size as the one used to write the checkpoint.
+ *  Throws if the fingerprint differs from the one stored with the
+ *  checkpoint, if the stored row extents are inconsistent with the tiles or
+ *  if a tile or the SpMV info is malformed (e.g. out of range indices).
+ *
+ *  @param[in]  prefix      Path prefix of the checkpoint files
+ *  @param[in]  comm        MPI communicator
+ *  @param[out] info        SpMV communication info (optional). Throws if
+ *                          requested but not stored in the checkpoint.
+ *  @param[in]  fingerprint Expected fingerprint (see write_dist_checkpoint)
+ */
+template <typename SpMatType>
+detail::enable_if_csr_matrix_t<SpMatType, dist_sparse_matrix<SpMatType>>
+read_dist_checkpoint(
+    const std::string& prefix, MPI_Comm comm,
+    spblas::spmv_info<detail::index_type_t<SpMatType>>* info = nullptr,
+    uint64_t fingerprint = 0) {
+  using value_type = detail::value_type_t<SpMatType>;
+  using index_type = detail::index_type_t<SpMatType>;
+
+  const int comm_size = detail::get_mpi_size(comm);
+  const int comm_rank = detail::get_mpi_rank(comm);
+
+  detail::checkpoint_mmap_reader reader(
+      detail::dist_checkpoint_fname(prefix, comm_rank));
+
+  const auto header = reader.read_value<detail::dist_checkpoint_header>();
+  if(std::memcmp(header.magic, detail::dist_checkpoint_magic, 8) or
+     header.version != detail::dist_checkpoint_version)
+    throw std::runtime_error("Invalid Checkpoint File");
+  if(header.value_size != sizeof(value_type) or
+     header.index_size != sizeof(index_type))
+    throw std::runtime_error("Checkpoint Type Mismatch");
+  if(header.comm_size != comm_size or header.comm_rank != comm_rank)
+    throw std::runtime_error("Checkpoint Communicator Mismatch");
+  if(header.fingerprint != fingerprint)
+    throw std::runtime_error("Checkpoint Fingerprint Mismatch");
+
+  // Row extents must tile [0, M) contiguously and match the local tiles
+  auto row_extents = reader.read_array<int64_t>();
+  bool valid_extents = row_extents.size() == size_t(2 * comm_size) and
+                       row_extents.front() == 0 and
+                       row_extents.back() == header.global_m;
+  for(int i = 0; valid_extents and i < comm_size; ++i) {
+    valid_extents = row_extents[2 * i] <= row_extents[2 * i + 1];
+    if(i + 1 < comm_size)
+      valid_extents = valid_extents and
+                      row_extents[2 * i + 1] == row_extents[2 * i + 2];
+  }
+  if(valid_extents) {
+    const auto local_m =
+        row_extents[2 * comm_rank + 1] - row_extents[2 * comm_rank];
+    for(int t = 0; t < 2; ++t)
+      if(header.tile_m[t] >= 0)
+        valid_extents = valid_extents and header.tile_m[t] == local_m;
+  }
+  if(!valid_extents)
+    throw std::runtime_error("Invalid Checkpoint Row Extents");
+
+  using extent_type = typename dist_sparse_matrix<SpMatType>::extent_type;
+  std::vector<extent_type> row_tiles(comm_size);
+  for(int i = 0; i < comm_size; ++i)
+    row_tiles[i] = extent_type(row_extents[2 * i], row_extents[2 * i + 1]);
+
+  dist_sparse_matrix<SpMatType> A(comm, header.global_m, header.global_n,
+                                  row_tiles);
+
+  for(int t = 0; t < 2; ++t)
+    if(header.tile_m[t] >= 0) {
+      auto rowptr = reader.read_array<index_type>();
+      auto colind = reader.read_array<index_type>();
+      auto nzval = reader.read_array<value_type>();
+      if(header.tile_n[t] > header.global_n or
+         !detail::checkpoint_valid_csr(rowptr, colind, nzval,
+                                       header.tile_m[t], header.tile_n[t]))
+        throw std::runtime_error("Invalid Checkpoint Tile");
+      SpMatType tile(header.tile_m[t], header.tile_n[t], std::move(rowptr),
+                     std::move(colind), std::move(nzval));
+      if(t == 0)
+        A.set_diagonal_tile(std::move(tile));
+      else
+        A.set_off_diagonal_tile(std::move(tile));
+    }
+
+  if(info) {
+    if(!header.has_spmv_info)
+      throw std::runtime_error("Checkpoint Has No SpMV Info");
+    info->comm = comm;
+    info->send_indices = reader.read_array<index_type>();
+    info->recv_indices = reader.read_array<index_type>();
+    info->send_offsets = reader.read_array<size_t>();
+    info->recv_offsets = reader.read_array<size_t>();
+    info->send_counts = reader.read_array<size_t>();
+    info->recv_counts = reader.read_array<size_t>();
+    if(!detail::checkpoint_valid_spmv_info(*info, comm_size,
+                                           A.local_row_extent(), A.n()))
+      throw std::runtime_error("Invalid Checkpoint SpMV Info");
+  }
+
+  return A;
+}
+
+}  // namespace sparsexx
@@ -0,0 +1,239 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <sparsexx/matrix_types/csr_matrix.hpp>
+#include <sparsexx/matrix_types/dist_sparse_matrix.hpp>
+#include <sparsexx/matrix_types/type_fwd.hpp>
+#include <type_traits>
+
+namespace sparsexx {
+
+/**
+ *  @brief A CSR matrix with compressed column indices.
+ *
+ *  The column indices of each row are delta encoded: the first column index
+ *  of the row is stored in full as the row base and each element stores the
+ *  (unsigned, typically 8 or 16 bit) gap to the column of the preceding
+ *  element of the row, the first element storing a gap of zero. This reduces
+ *  the index traffic of SpMV for matrices with clustered column indices
+ *  (e.g. determinant ordered Hamiltonians), at the cost of two additional
+ *  indices per row.
+ *
+ *  Gaps which are not representable by offset_t (or negative gaps of
+ *  unsorted rows) are escaped individually: the element stores the largest
+ *  value of offset_t and its column index is stored in full in a separate
+ *  array, from which the gaps of the following elements of the row are
+ *  measured. The element order (and hence the order of accumulation of
+ *  SpMV) of the source matrix is preserved.
+ *
+ *  @tparam T        Field over which the elements of the sparse matrix are
+ *                   defined
+ *  @tparam index_t  Signed integer type for the row pointers and row bases
+ *  @tparam offset_t Unsigned integer type for the column gaps
+ */
+template <typename T, typename index_t, typename offset_t>
+class compressed_csr_matrix {
+  static_assert(std::is_unsigned_v<offset_t>, "Offsets Must Be Unsigned");
+  static_assert(std::is_signed_v<index_t>, "Indices Must Be Signed");
+
+ public:
+  using value_type = T;  ///< Field over which the matrix elements are defined
+  using index_type = index_t;    ///< Sparse index type
+  using offset_type = offset_t;  ///< Column gap type
+  using size_type = int64_t;     ///< Size type
+
+  /// Gap of elements whose column index is stored in full
+  static constexpr offset_t escape = std::numeric_limits<offset_t>::max();
+
+ protected:
+  size_type m_ = 0;         ///< Number of rows in the sparse matrix
+  size_type n_ = 0;         ///< Number of cols in the sparse matrix
+  size_type nnz_ = 0;       ///< Number of non-zeros in the sparse matrix
+  size_type indexing_ = 0;  ///< Indexing base (0 or 1)
+
+  std::vector<T> nzval_;          ///< Storage of the non-zero values
+  std::vector<offset_t> coloff_;  ///< Column gaps to the preceding element
+  std::vector<index_t> rowbase_;  ///< First column index of each row
+  std::vector<index_t> rowptr_;   ///< Starting indices of each row
+  std::vector<index_t> escptr_;   ///< Starting escaped element of each row
+  std::vector<index_t> esccol_;   ///< Column indices of escaped elements
+
+  static bool gap_fits(int64_t gap) {
+    return gap >= 0 and uint64_t(gap) < escape;
+  }
+
+ public:
+  compressed_csr_matrix() = default;
+
+  /**
+   *  @brief Compress the column indices of a CSR matrix.
+   *
+   *  Elements whose gap is not representable by offset_t are escaped.
+   */
+  template <typename Alloc>
+  explicit compressed_csr_matrix(const csr_matrix<T, index_t, Alloc>& A)
+      : m_(A.m()),
+        n_(A.n()),
+        nnz_(A.nnz()),
+        indexing_(A.indexing()),
+        nzval_(A.nzval().begin(), A.nzval().end()),
+        coloff_(A.nnz()),
+        rowbase_(A.m()),
+        rowptr_(A.rowptr().begin(), A.rowptr().end()),
+        escptr_(A.m() + 1) {
+    const auto& Aci = A.colind();
+    escptr_[0] = 0;
+    for(size_type i = 0; i < m_; ++i) {
+      const auto j_st = rowptr_[i] - indexing_;
+      const auto j_en = rowptr_[i + 1] - indexing_;
+      rowbase_[i] = j_st == j_en ? index_t(indexing_) : Aci[j_st];
+
+      int64_t col = rowbase_[i];
+      for(auto j = j_st; j < j_en; ++j) {
+        const int64_t gap = int64_t(Aci[j]) - col;
+        if(gap_fits(gap)) {
+          coloff_[j] = gap;
+        } else {
+          coloff_[j] = escape;
+          esccol_.emplace_back(Aci[j]);
+        }
+        col = Aci[j];
+      }
+      escptr_[i + 1] = esccol_.size();
+    }
+    esccol_.shrink_to_fit();
+  }
+
+  /**
+   *  @brief Check whether the column indices of a CSR matrix are
+   *  representable with offset_t, i.e. whether no element is escaped
+   */
+  template <typename Alloc>
+  static bool fits(const csr_matrix<T, index_t, Alloc>& A) {
+    const auto& Aci = A.colind();
+    for(int64_t i = 0; i < A.m(); ++i) {
+      const auto j_st = A.rowptr()[i] - A.indexing();
+      const auto j_en = A.rowptr()[i + 1] - A.indexing();
+      for(auto j = j_st + 1; j < j_en; ++j)
+        if(!gap_fits(int64_t(Aci[j]) - Aci[j - 1])) return false;
+    }
+    return true;
+  }
+
+  size_type m() const { return m_; };
+  size_type n() const { return n_; };
+  size_type nnz() const { return nnz_; };
+  size_type indexing() const { return indexing_; }
+
+  const auto& nzval() const { return nzval_; };
+  const auto& coloff() const { return coloff_; };
+  const auto& rowbase() const { return rowbase_; };
+  const auto& rowptr() const { return rowptr_; };
+  const auto& escptr() const { return escptr_; };
+  const auto& esccol() const { return esccol_; };
+  size_type nescaped() const { return esccol_.size(); }
+
+  /// Decode the column indices of the matrix
+  std::vector<index_t> colind() const {
+    std::vector<index_t> ci(nnz_);
+    for(size_type i = 0; i < m_; ++i) {
+      const auto j_st = rowptr_[i] - indexing_;
+      const auto j_en = rowptr_[i + 1] - indexing_;
+      auto esc = esccol_.begin() + escptr_[i];
+      index_t col = rowbase_[i];
+      for(auto j = j_st; j < j_en; ++j) {
+        col = coloff_[j] == escape ? *esc++ : col + coloff_[j];
+        ci[j] = col;
+      }
+    }
+    return ci;
+  }
+
+  /// Decompress into a standard CSR matrix
+  csr_matrix<T, index_t> decompress() const {
+    return csr_matrix<T, index_t>(m_, n_, std::vector<index_t>(rowptr_),
+                                  colind(), std::vector<T>(nzval_));
+  }
+
+  size_type mem_footprint() const noexcept {
+    return nzval_.capacity() * sizeof(T) +
+           coloff_.capacity() * sizeof(offset_t) +
+           rowbase_.capacity() * sizeof(index_t) +
+           rowptr_.capacity() * sizeof(index_t) +
+           escptr_.capacity() * sizeof(index_t) +
+           esccol_.capacity() * sizeof(index_t);
+  }
+};  // class compressed_csr_matrix
+
+namespace detail {
+
+template <typename SpMatType>
+struct is_compressed_csr_matrix : public std::false_type {};
+
+template <typename T, typename index_t, typename offset_t>
+struct is_compressed_csr_matrix<compressed_csr_matrix<T, index_t, offset_t>>
+    : public std::true_type {};
+
+template <typename SpMatType>
+inline constexpr bool is_compressed_csr_matrix_v =
+    is_compressed_csr_matrix<SpMatType>::value;
+
+}  // namespace detail
+
+template <typename T, typename index_t, typename offset_t>
+std::vector<T> extract_diagonal_elements(
+    const compressed_csr_matrix<T, index_t, offset_t>& A) {
+  const auto M = A.m();
+  const auto indexing = A.indexing();
+  const auto& Arp = A.rowptr();
+  const auto& Arb = A.rowbase();
+  const auto& Aco = A.coloff();
+  const auto& Aep = A.escptr();
+  const auto& Aec = A.esccol();
+  const auto& Anz = A.nzval();
+  constexpr auto escape = compressed_csr_matrix<T, index_t, offset_t>::escape;
+
+  std::vector<T> D(M, T(0));
+  for(int64_t i = 0; i < M; ++i) {
+    auto esc = Aec.begin() + Aep[i];
+    index_t col = Arb[i];
+    for(auto j = Arp[i] - indexing; j < Arp[i + 1] - indexing; ++j) {
+      col = Aco[j] == escape ? *esc++ : col + Aco[j];
+      if(col == i + indexing) {
+        D[i] = Anz[j];
+        break;
+      }
+    }
+  }
+  return D;
+}
+
+/**
+ *  @brief Compress the tiles of a distributed CSR matrix.
+ */
+template <typename offset_t, typename T, typename index_t, typename Alloc>
+dist_sparse_matrix<compressed_csr_matrix<T, index_t, offset_t>>
+compress_dist_csr(const dist_sparse_matrix<csr_matrix<T, index_t, Alloc>>& A) {
+  const int comm_size = detail::get_mpi_size(A.comm());
+  std::vector<std::pair<index_t, index_t>> row_tiles(comm_size);
+  for(int i = 0; i < comm_size; ++i) row_tiles[i] = A.row_bounds(i);
+
+  using tile_type = compressed_csr_matrix<T, index_t, offset_t>;
+  dist_sparse_matrix<tile_type> A_c(A.comm(), A.m(), A.n(), row_tiles);
+  if(A.diagonal_tile_ptr())
+    A_c.set_diagonal_tile(tile_type(A.diagonal_tile()));
+  if(A.off_diagonal_tile_ptr())
+    A_c.set_off_diagonal_tile(tile_type(A.off_diagonal_tile()));
+  return A_c;
+}
+
+}  // namespace sparsexx
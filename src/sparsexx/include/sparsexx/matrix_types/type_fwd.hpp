@@ -26,4 +26,8 @@ template <typename T, typename index_t = int64_t,
           typename Alloc = std::allocator<T> >
 class coo_matrix;
 
+template <typename T, typename index_t = int64_t,
+          typename offset_t = uint32_t>
+class compressed_csr_matrix;
+
 }  // namespace sparsexx
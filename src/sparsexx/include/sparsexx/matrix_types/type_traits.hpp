@@ -66,14 +66,11 @@ struct enable_if_coo_matrix {
 };
 
 template <typename SpMatType, typename U = void>
-using enable_if_csr_matrix_t =
-    typename enable_if_csr_matrix<SpMatType, U>::type;
+using enable_if_csr_matrix_t = std::enable_if_t<is_csr_matrix_v<SpMatType>, U>;
 template <typename SpMatType, typename U = void>
-using enable_if_csc_matrix_t =
-    typename enable_if_csc_matrix<SpMatType, U>::type;
+using enable_if_csc_matrix_t = std::enable_if_t<is_csc_matrix_v<SpMatType>, U>;
 template <typename SpMatType, typename U = void>
-using enable_if_coo_matrix_t =
-    typename enable_if_coo_matrix<SpMatType, U>::type;
+using enable_if_coo_matrix_t = std::enable_if_t<is_coo_matrix_v<SpMatType>, U>;
 
 template <typename SpMatType>
 using value_type_t = typename SpMatType::value_type;
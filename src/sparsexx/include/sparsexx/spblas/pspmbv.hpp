@@ -82,8 +82,10 @@ auto generate_spmv_comm_info(const DistSpMatrixType& A) {
   std::set<index_type> unique_elements_set;
   if(off_diagonal_tile) {
     assert(off_diagonal_tile->indexing() == 0);
-    unique_elements_set.insert(off_diagonal_tile->colind().begin(),
-                               off_diagonal_tile->colind().end());
+    // Bind by reference as colind() may return a (decoded) temporary
+    const auto& off_diagonal_colind = off_diagonal_tile->colind();
+    unique_elements_set.insert(off_diagonal_colind.begin(),
+                               off_diagonal_colind.end());
   }
 
   // Place unique col indices into contiguous memory
@@ -286,4 +288,175 @@ void pgespmv(detail::type_identity_t<ScalarType> ALPHA, const DistSpMatType& A,
   //   std::chrono::duration<double,std::milli>(en_wait2 - st_wait2).count());
 }
 
+/**
+ *  @brief Distributed symmetric sparse matrix - vector product.
+ *
+ *  AV = ALPHA * A * V + BETA * AV
+ *
+ *  A is a distributed symmetric matrix of which only the upper triangle is
+ *  stored, i.e. the diagonal tile holds the upper triangle of the local
+ *  diagonal block and the off-diagonal tile only holds the columns to the
+ *  right of the local row block (see macis::make_dist_csr_hamiltonian_upper).
+ *
+ *  The direct part proceeds as in pgespmv. The transposed contributions of
+ *  the off-diagonal tile target rows owned by the ranks from which the
+ *  remote elements of V were received, so they are accumulated into the
+ *  corresponding packed buffer and returned to their owners by reversing
+ *  the communication pattern of spmv_info.
+ */
+template <typename DistSpMatType,
+          typename ScalarType = detail::value_type_t<DistSpMatType>,
+          typename IndexType = detail::index_type_t<DistSpMatType>>
+void psyspmv(detail::type_identity_t<ScalarType> ALPHA, const DistSpMatType& A,
+             const detail::type_identity_t<ScalarType>* V,
+             detail::type_identity_t<ScalarType> BETA,
+             detail::type_identity_t<ScalarType>* AV,
+             const spmv_info<detail::type_identity_t<IndexType>>& spmv_info) {
+  using value_type = ScalarType;
+
+  const auto N = A.n();
+  const auto N_local = A.local_row_extent();
+  const auto comm = spmv_info.comm;
+  const int comm_size = spmv_info.send_offsets.size();
+
+  const auto& recv_indices = spmv_info.recv_indices;
+  const auto& send_indices = spmv_info.send_indices;
+
+  size_t nrecv_pack = recv_indices.size();
+  size_t nsend_pack = send_indices.size();
+  auto V_recv_pack = detail::no_init_array<value_type>(nrecv_pack);
+  auto V_send_pack = detail::no_init_array<value_type>(nsend_pack);
+  auto V_remote = detail::no_init_array<value_type>(N);
+
+  // Exchange remote elements of V
+  auto recv_reqs = spmv_info.post_remote_recv(V_recv_pack.get());
+  sparsexx::permute_vector(nsend_pack, V, send_indices.data(),
+                           V_send_pack.get(),
+                           sparsexx::PermuteDirection::Backward);
+  auto send_reqs = spmv_info.post_remote_send(V_send_pack.get());
+
+  /***** Diagonal Matvec *****/
+  syspmbv(1, ALPHA, A.diagonal_tile(), V, N_local, BETA, AV, N_local);
+
+  detail::mpi_waitall_ignore_status(recv_reqs);
+  sparsexx::permute_vector(nrecv_pack, V_recv_pack.get(), recv_indices.data(),
+                           V_remote.get(), sparsexx::PermuteDirection::Forward);
+  detail::mpi_waitall_ignore_status(send_reqs);
+
+  if(!A.off_diagonal_tile_ptr()) return;
+  const auto& U = A.off_diagonal_tile();
+
+  /***** Off-diagonal Matvec (direct) *****/
+  gespmbv(1, ALPHA, U, V_remote.get(), N, 1., AV, N_local);
+
+  /***** Off-diagonal Matvec (transposed) *****/
+  // Z(j) = ALPHA * sum_i U(i,j) * V(i) for the remote columns j. Each thread
+  // accumulates a packed partial Z over a contiguous range of the local rows
+  // which are subsequently reduced into V_recv_pack
+  std::vector<IndexType> pack_index(N);
+  for(size_t i = 0; i < nrecv_pack; ++i) pack_index[recv_indices[i]] = i;
+
+#ifdef _OPENMP
+  const size_t nthreads = omp_get_max_threads();
+#else
+  const size_t nthreads = 1;
+#endif
+  std::vector<value_type> Z(nthreads * nrecv_pack, 0.);
+
+  const auto* Unz = U.nzval().data();
+  const auto* Urp = U.rowptr().data();
+  const auto* Uci = U.colind().data();
+  const auto indexing = U.indexing();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+#ifdef _OPENMP
+    auto* Z_t = Z.data() + omp_get_thread_num() * nrecv_pack;
+#pragma omp for schedule(static)
+#else
+    auto* Z_t = Z.data();
+#endif
+    for(int64_t i = 0; i < N_local; ++i) {
+      const value_type av_i = ALPHA * V[i];
+      for(auto j = Urp[i] - indexing; j < Urp[i + 1] - indexing; ++j)
+        Z_t[pack_index[Uci[j] - indexing]] += Unz[j] * av_i;
+    }
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(size_t i = 0; i < nrecv_pack; ++i) {
+      value_type z = 0.;
+      for(size_t t = 0; t < nthreads; ++t) z += Z[i + t * nrecv_pack];
+      V_recv_pack[i] = z;
+    }
+  }
+
+  // Return the transposed contributions to their owners
+  std::vector<MPI_Request> t_recv_reqs, t_send_reqs;
+  for(int i = 0; i < comm_size; ++i) {
+    if(spmv_info.send_counts[i])
+      t_recv_reqs.emplace_back(detail::mpi_irecv(
+          V_send_pack.get() + spmv_info.send_offsets[i],
+          spmv_info.send_counts[i], i, 1, comm));
+    if(spmv_info.recv_counts[i])
+      t_send_reqs.emplace_back(detail::mpi_isend(
+          V_recv_pack.get() + spmv_info.recv_offsets[i],
+          spmv_info.recv_counts[i], i, 1, comm));
+  }
+  detail::mpi_waitall_ignore_status(t_recv_reqs);
+
+  for(size_t i = 0; i < nsend_pack; ++i) AV[send_indices[i]] += V_send_pack[i];
+
+  detail::mpi_waitall_ignore_status(t_send_reqs);
+}
+
+/**
+ *  @brief Distributed mixed-precision sparse matrix - vector product.
+ *
+ *  AV = ALPHA * (A + diag(D)) * V + BETA * AV
+ *
+ *  The tiles of A may be stored in a lower precision than V / AV, the
+ *  communication of V and all accumulation is performed in the precision of
+ *  V / AV (see mixed_gespmbv). D is the local part of an explicit diagonal
+ *  which is kept in the precision of V / AV (may be null).
+ */
+template <typename DistSpMatType, typename T, typename IndexType>
+void mixed_pgespmv(T ALPHA, const DistSpMatType& A, const T* D, const T* V,
+                   T BETA, T* AV, const spmv_info<IndexType>& spmv_info) {
+  const auto N = A.n();
+  const auto N_local = A.local_row_extent();
+
+  const auto& recv_indices = spmv_info.recv_indices;
+  const auto& send_indices = spmv_info.send_indices;
+
+  size_t nrecv_pack = recv_indices.size();
+  size_t nsend_pack = send_indices.size();
+  auto V_recv_pack = detail::no_init_array<T>(nrecv_pack);
+  auto V_send_pack = detail::no_init_array<T>(nsend_pack);
+  auto V_remote = detail::no_init_array<T>(N);
+
+  // Exchange remote elements of V
+  auto recv_reqs = spmv_info.post_remote_recv(V_recv_pack.get());
+  sparsexx::permute_vector(nsend_pack, V, send_indices.data(),
+                           V_send_pack.get(),
+                           sparsexx::PermuteDirection::Backward);
+  auto send_reqs = spmv_info.post_remote_send(V_send_pack.get());
+
+  /***** Diagonal Matvec *****/
+  mixed_gespmbv(1, ALPHA, A.diagonal_tile(), D, V, N_local, BETA, AV, N_local);
+
+  detail::mpi_waitall_ignore_status(recv_reqs);
+  sparsexx::permute_vector(nrecv_pack, V_recv_pack.get(), recv_indices.data(),
+                           V_remote.get(), sparsexx::PermuteDirection::Forward);
+
+  /***** Off-diagonal Matvec *****/
+  if(A.off_diagonal_tile_ptr())
+    mixed_gespmbv(1, ALPHA, A.off_diagonal_tile(), (const T*)nullptr,
+                  V_remote.get(), N, T(1), AV, N_local);
+
+  detail::mpi_waitall_ignore_status(send_reqs);
+}
+
 }  // namespace sparsexx::spblas
@@ -8,8 +8,16 @@
 
 #pragma once
 
+#include <algorithm>
+#include <sparsexx/matrix_types/compressed_csr_matrix.hpp>
 #include <sparsexx/sparsexx_config.hpp>
 #include <sparsexx/spblas/type_traits.hpp>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace sparsexx::spblas {
 
@@ -127,6 +135,247 @@ gespmbv(int64_t K, ALPHAT ALPHA, const SpMatType& A,
     }
 }
 
+/**
+ *  @brief Compressed column-index CSR sparse matrix - dense block vector
+ *  product.
+ *
+ *  AV = ALPHA * A * V + BETA * AV
+ *
+ *  Column indices are decoded on the fly from the per-row base and the
+ *  (narrow) column gaps, or read directly for escaped elements, see
+ *  compressed_csr_matrix.
+ *
+ *  @param[in]     K      Number of columns in V/AV
+ *  @param[in]     ALPHA  First scaling factor
+ *  @param[in]     A      Sparse matrix in compressed CSR format
+ *  @param[in]     V      Input block vector stored in column major format
+ *  @param[in]     LDV    Leading dimension of V
+ *  @param[in]     BETA   Second scaling factor
+ *  @param[in/out] AV     Output block vector stored in column major format
+ *  @param[in]     LDAV   Leading dimension of AV
+ */
+template <typename T, typename index_t, typename offset_t, typename ALPHAT,
+          typename BETAT>
+void gespmbv(int64_t K, ALPHAT ALPHA,
+             const compressed_csr_matrix<T, index_t, offset_t>& A, const T* V,
+             int64_t LDV, BETAT BETA, T* AV, int64_t LDAV) {
+  const T alpha = ALPHA;
+  const T beta = BETA;
+
+  const auto M = A.m();
+  const auto* Anz = A.nzval().data();
+  const auto* Arp = A.rowptr().data();
+  const auto* Arb = A.rowbase().data();
+  const auto* Aco = A.coloff().data();
+  const auto* Aep = A.escptr().data();
+  const auto* Aec = A.esccol().data();
+  const auto indexing = A.indexing();
+  constexpr auto escape = compressed_csr_matrix<T, index_t, offset_t>::escape;
+
+#ifdef _OPENMP
+#pragma omp parallel for collapse(2)
+#endif
+  for(int64_t k = 0; k < K; ++k)
+    for(int64_t i = 0; i < M; ++i) {
+      const auto j_st = Arp[i] - indexing;
+      const auto j_en = Arp[i + 1] - indexing;
+      const auto j_ext = j_en - j_st;
+      const auto* Anz_st = Anz + j_st;
+      const auto* Aco_st = Aco + j_st;
+      const auto* Aec_st = Aec + Aep[i];
+      const auto* V_k = V + k * LDV - indexing;
+
+      T av = 0.;
+      index_t col = Arb[i];
+      for(int64_t j = 0; j < j_ext; ++j) {
+        col = Aco_st[j] == escape ? *Aec_st++ : col + Aco_st[j];
+        av += Anz_st[j] * V_k[col];
+      }
+
+      AV[i + k * LDAV] = alpha * av + beta * AV[i + k * LDAV];
+    }
+}
+
+/**
+ *  @brief Mixed-precision CSR sparse matrix - dense block vector product.
+ *
+ *  AV = ALPHA * (A + diag(D)) * V + BETA * AV
+ *
+ *  The elements of A may be stored in a lower precision than V / AV (e.g.
+ *  float vs double). All products are accumulated in the precision of V / AV
+ *  and the (optional) explicit diagonal D is kept in that precision.
+ *
+ *  @tparam SpMatType Sparse matrix type s.t. is_csr_matrix_v is true
+ *  @tparam T         Type of V / AV / D and of the accumulation
+ *
+ *  @param[in]     K      Number of columns in V/AV
+ *  @param[in]     ALPHA  First scaling factor
+ *  @param[in]     A      Sparse matrix in CSR format
+ *  @param[in]     D      Explicit diagonal of length A.m() (may be null)
+ *  @param[in]     V      Input block vector stored in column major format
+ *  @param[in]     LDV    Leading dimension of V
+ *  @param[in]     BETA   Second scaling factor
+ *  @param[in/out] AV     Output block vector stored in column major format
+ *  @param[in]     LDAV   Leading dimension of AV
+ */
+template <typename SpMatType, typename T>
+std::enable_if_t<sparsexx::detail::is_csr_matrix_v<SpMatType> > mixed_gespmbv(
+    int64_t K, T ALPHA, const SpMatType& A, const T* D, const T* V,
+    int64_t LDV, T BETA, T* AV, int64_t LDAV) {
+  const auto M = A.m();
+  const auto* Anz = A.nzval().data();
+  const auto* Arp = A.rowptr().data();
+  const auto* Aci = A.colind().data();
+  const auto indexing = A.indexing();
+
+#ifdef _OPENMP
+#pragma omp parallel for collapse(2)
+#endif
+  for(int64_t k = 0; k < K; ++k)
+    for(int64_t i = 0; i < M; ++i) {
+      const auto j_st = Arp[i] - indexing;
+      const auto j_en = Arp[i + 1] - indexing;
+
+      const auto* V_k = V + k * LDV - indexing;
+
+      T av = D ? D[i] * V_k[i + indexing] : T(0);
+      for(auto j = j_st; j < j_en; ++j) {
+        av += T(Anz[j]) * V_k[Aci[j]];
+      }
+
+      AV[i + k * LDAV] = ALPHA * av + BETA * AV[i + k * LDAV];
+    }
+}
+
+/**
+ *  @brief Symmetric CSR sparse matrix - dense block vector product.
+ *
+ *  AV = ALPHA * A * V + BETA * AV
+ *
+ *  A is a square symmetric matrix of which only the upper triangle
+ *  (including the diagonal) is stored with sorted column indices.
+ *
+ *  Rows are partitioned into contiguous blocks, one per thread. The direct
+ *  (upper) contributions of each block are formed first. The transposed
+ *  (strictly lower) contributions are then scattered in rounds: in round s,
+ *  row block b scatters its elements which lie in column block b + s. Each
+ *  column block is hence targeted by a single row block per round, such
+ *  that no thread-private copies of AV are required. Each row keeps a
+ *  cursor to its next unscattered element and is queued for the round of
+ *  the column block of that element, such that a row is only visited in
+ *  rounds in which it contributes, i.e. O(nnz + M) work in total.
+ *
+ *  @tparam SpMatType Sparse matrix type s.t. is_csr_matrix_v is true
+ *  @tparam ALPHAT    Type of ALPHA, must be convertible to
+ * SpMatType::value_type
+ *  @tparam BETAT     Type of BETA, must be convertible to SpMatType::value_type
+ *
+ *  @param[in]     K      Number of columns in V/AV
+ *  @param[in]     ALPHA  First scaling factor
+ *  @param[in]     A      Upper triangle of a symmetric matrix in CSR format
+ *  @param[in]     V      Input block vector stored in column major format
+ *  @param[in]     LDV    Leading dimension of V
+ *  @param[in]     BETA   Second scaling factor
+ *  @param[in/out] AV     Output block vector stored in column major format
+ *  @param[in]     LDAV   Leading dimension of AV
+ */
+template <typename SpMatType, typename ALPHAT, typename BETAT>
+std::enable_if_t<detail::spmbv_uses_generic_csr_v<SpMatType, ALPHAT, BETAT> >
+syspmbv(int64_t K, ALPHAT ALPHA, const SpMatType& A,
+        const typename SpMatType::value_type* V, int64_t LDV, BETAT BETA,
+        typename SpMatType::value_type* AV, int64_t LDAV) {
+  using value_type = typename SpMatType::value_type;
+
+  const value_type alpha = ALPHA;
+  const value_type beta = BETA;
+
+  if(A.m() != A.n())
+    throw std::runtime_error("SYSPMBV: Matrix Must Be Square");
+
+  const int64_t M = A.m();
+  const auto* Anz = A.nzval().data();
+  const auto* Arp = A.rowptr().data();
+  const auto* Aci = A.colind().data();
+  const auto indexing = A.indexing();
+
+#ifdef _OPENMP
+  const int64_t nblocks = std::min<int64_t>(M, omp_get_max_threads());
+#else
+  const int64_t nblocks = std::min<int64_t>(M, 1);
+#endif
+  if(!nblocks) return;
+
+  auto block_st = [&](int64_t b) { return (b * M) / nblocks; };
+  auto block_of = [&](int64_t c) { return ((c + 1) * nblocks - 1) / M; };
+
+  // Next unscattered element of each row and, per row block, the rows
+  // queued for each column block
+  std::vector<int64_t> cursor(M);
+  std::vector<std::vector<std::vector<int64_t>>> queue(nblocks);
+
+  // Scatter the transposed elements of row i in column block t and queue
+  // the row for the column block of its next element
+  auto scatter = [&](int64_t b, int64_t t, int64_t i) {
+    const int64_t c_en = block_st(t + 1);
+    const int64_t j_en = Arp[i + 1] - indexing;
+    auto j = cursor[i];
+    for(; j < j_en and Aci[j] - indexing < c_en; ++j) {
+      const int64_t c = Aci[j] - indexing;
+      for(int64_t k = 0; k < K; ++k)
+        AV[c + k * LDAV] += alpha * Anz[j] * V[i + k * LDV];
+    }
+    cursor[i] = j;
+    if(j < j_en) queue[b][block_of(Aci[j] - indexing)].emplace_back(i);
+  };
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    // Direct contributions, followed by the transposed contributions within
+    // the diagonal block
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int64_t b = 0; b < nblocks; ++b) {
+      const int64_t i_st = block_st(b);
+      const int64_t i_en = block_st(b + 1);
+      queue[b].resize(nblocks);
+
+      for(int64_t i = i_st; i < i_en; ++i) {
+        const int64_t j_st = Arp[i] - indexing;
+        const int64_t j_en = Arp[i + 1] - indexing;
+        for(int64_t k = 0; k < K; ++k) {
+          const auto* V_k = V + k * LDV;
+          value_type av = 0.;
+          for(auto j = j_st; j < j_en; ++j) {
+            av += Anz[j] * V_k[Aci[j] - indexing];
+          }
+          AV[i + k * LDAV] = alpha * av + beta * AV[i + k * LDAV];
+        }
+
+        // Skip the diagonal
+        auto j = j_st;
+        while(j < j_en and Aci[j] - indexing <= i) ++j;
+        cursor[i] = j;
+      }
+
+      for(int64_t i = i_st; i < i_en; ++i) scatter(b, b, i);
+    }
+
+    // Transposed contributions of row block b to column block b + s
+    for(int64_t s = 1; s < nblocks; ++s) {
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for(int64_t b = 0; b < nblocks - s; ++b) {
+        auto rows = std::move(queue[b][b + s]);
+        for(auto i : rows) scatter(b, b + s, i);
+      }
+    }
+  }
+}
+
 #if SPARSEXX_ENABLE_MKL
 /**
  *  @brief Optimized sparse matrix - dense block vector product.
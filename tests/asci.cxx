@@ -7,7 +7,9 @@
  */
 
 #include <iostream>
+#include <random>
 #include <macis/asci/determinant_contributions.hpp>
+#include <macis/asci/determinant_sort.hpp>
 #include <macis/bitset_operations.hpp>
 #include <macis/sd_operations.hpp>
 #include <macis/types.hpp>
@@ -198,3 +200,41 @@ TEST_CASE("Triplets") {
 
   REQUIRE(quad_hist == new_quad_hist);
 }
+
+TEST_CASE("Locality Ordering") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  auto dets = macis::generate_hilbert_space<64>(6, 2, 2);
+  const size_t ndets = dets.size();
+  const size_t nkeep = 10;
+
+  // Scramble the determinants and tag the coefficients with the
+  // determinants they belong to
+  std::mt19937 gen(1234);
+  std::shuffle(dets.begin(), dets.end(), gen);
+  std::vector<double> C(ndets);
+  for(size_t i = 0; i < ndets; ++i) C[i] = dets[i].to_ullong();
+  auto ref_dets = dets;
+
+  macis::reorder_ci_on_strings(dets, C, nkeep);
+  REQUIRE(dets.size() == ndets);
+
+  // Leading determinants are kept in place
+  for(size_t i = 0; i < nkeep; ++i) REQUIRE(dets[i] == ref_dets[i]);
+
+  // Remaining determinants are ordered by alpha, then beta string
+  macis::wfn_string_order_comparator<64> comparator;
+  REQUIRE(std::is_sorted(dets.begin() + nkeep, dets.end(), comparator));
+  for(size_t i = nkeep + 1; i < ndets; ++i) {
+    auto alpha = macis::bitset_lo_word(dets[i]);
+    auto prev_alpha = macis::bitset_lo_word(dets[i - 1]);
+    REQUIRE_FALSE(macis::bitset_less(alpha, prev_alpha));
+  }
+
+  // Coefficients follow their determinants
+  for(size_t i = 0; i < ndets; ++i) REQUIRE(C[i] == dets[i].to_ullong());
+  std::sort(dets.begin(), dets.end(), macis::bitset_less_comparator<64>{});
+  std::sort(ref_dets.begin(), ref_dets.end(),
+            macis::bitset_less_comparator<64>{});
+  REQUIRE(dets == ref_dets);
+}
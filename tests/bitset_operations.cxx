@@ -8,6 +8,8 @@
 
 #include <iostream>
 #include <macis/bitset_operations.hpp>
+#include <macis/util/wfn_width.hpp>
+#include <random>
 
 #include "ut_common.hpp"
 
@@ -39,6 +41,22 @@ void uint128_conversion_test() {
 template <size_t N>
 using bs = std::bitset<N>;
 
+template <size_t N>
+void popcount_between_test() {
+  std::mt19937_64 gen(N);
+  for(int trial = 0; trial < 4; ++trial) {
+    std::bitset<N> bits;
+    for(size_t i = 0; i < N; ++i) bits[i] = gen() & 1;
+    for(unsigned p = 0; p < N; ++p)
+      for(unsigned q = 0; q < N; ++q) {
+        uint32_t ref = 0;
+        for(unsigned i = std::min(p, q) + 1; i < std::max(p, q); ++i)
+          ref += bits[i];
+        REQUIRE(macis::popcount_between(bits, p, q) == ref);
+      }
+  }
+}
+
 TEST_CASE("Bitset Operations") {
   ROOT_ONLY(MPI_COMM_WORLD);
 
@@ -103,6 +121,13 @@ TEST_CASE("Bitset Operations") {
     REQUIRE(macis::fls(d << 128) == 31 + 128);
   }
 
+  SECTION("Popcount Between") {
+    SECTION("32 bit") { popcount_between_test<32>(); }
+    SECTION("64 bit") { popcount_between_test<64>(); }
+    SECTION("128 bit") { popcount_between_test<128>(); }
+    SECTION("256 bit") { popcount_between_test<256>(); }
+  }
+
   SECTION("Indices") {
     bs<128> one(1);
     bs<128> a = (one << 4) | (one << 67) | (one << 118) | (one << 31);
@@ -111,6 +136,38 @@ TEST_CASE("Bitset Operations") {
     REQUIRE(ind == ref);
   }
 
+  SECTION("Multiword") {
+    bs<256> one(1);
+    bs<256> a = (one << 4) | (one << 67) | (one << 130) | (one << 255);
+
+    REQUIRE(macis::ffs(a) == 5);
+    REQUIRE(macis::ffs(a >> 100) == 31);
+    REQUIRE(macis::fls(a) == 255);
+    REQUIRE(macis::fls(a >> 200) == 55);
+
+    std::vector<uint32_t> ref = {4, 67, 130, 255};
+    REQUIRE(macis::bits_to_indices(a) == ref);
+
+    bs<128> one_128(1);
+    REQUIRE(macis::bitset_lo_word(a) == ((one_128 << 4) | (one_128 << 67)));
+    REQUIRE(macis::bitset_hi_word(a) == ((one_128 << 2) | (one_128 << 127)));
+
+    auto words = macis::bitset_to_words(a);
+    REQUIRE(words[0] == (1ull << 4));
+    REQUIRE(words[1] == (1ull << 3));
+    REQUIRE(words[2] == (1ull << 2));
+    REQUIRE(words[3] == (1ull << 63));
+    REQUIRE(macis::words_to_bitset<256>(words) == a);
+
+    REQUIRE(macis::truncate_bitset<128>(a) ==
+            ((one_128 << 4) | (one_128 << 67)));
+    REQUIRE(macis::expand_bitset<512>(a).count() == 4);
+    REQUIRE(macis::fls(macis::expand_bitset<512>(a)) == 255);
+
+    REQUIRE(macis::full_mask<128, 256>() == (~bs<256>(0) >> 128));
+    REQUIRE(macis::full_mask<192, 256>() == (~bs<256>(0) >> 64));
+  }
+
   SECTION("Truncate") {
     bs<64> a_64(0xCCCCCCCCDEADDEAD);
     bs<32> ref(0xDEADDEAD);
@@ -150,3 +207,18 @@ TEST_CASE("Bitset Operations") {
     }
   }
 }
+
+TEST_CASE("Determinant Width Selection") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  REQUIRE(macis::select_wfn_width(8) == 64);
+  REQUIRE(macis::select_wfn_width(32) == 64);
+  REQUIRE(macis::select_wfn_width(33) == 128);
+  REQUIRE(macis::select_wfn_width(100) == 256);
+  REQUIRE(macis::select_wfn_width(256) == 512);
+  REQUIRE_THROWS_AS(macis::select_wfn_width(257), std::runtime_error);
+
+  auto nbits = macis::dispatch_wfn_width(
+      80, [](auto w) { return macis::wfn_t<decltype(w)::value>().size(); });
+  REQUIRE(nbits == 256);
+}
@@ -0,0 +1,189 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#include <spdlog/sinks/null_sink.h>
+#include <spdlog/spdlog.h>
+
+#include <macis/util/cholesky.hpp>
+#include <macis/util/detail/rdm_files.hpp>
+#include <macis/util/fcidump.hpp>
+#include <macis/util/fock_matrices.hpp>
+#include <macis/util/mcscf.hpp>
+#include <macis/util/moller_plesset.hpp>
+#include <macis/util/packed_rdms.hpp>
+#include <macis/util/transform.hpp>
+
+#include "ut_common.hpp"
+
+TEST_CASE("Cholesky ERIs") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  const size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  const size_t norb2 = norb * norb;
+  const size_t norb4 = norb2 * norb2;
+
+  using macis::NumActive;
+  using macis::NumCholeskyVector;
+  using macis::NumInactive;
+  using macis::NumOrbital;
+  using macis::NumVirtual;
+
+  std::vector<double> T(norb2), V(norb4);
+  auto E_core = macis::read_fcidump_core(water_ccpvdz_fcidump);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  const double tol = 1e-10;
+  auto L = macis::cholesky_decompose_eris(NumOrbital(norb), V.data(), norb,
+                                          tol);
+  const size_t naux = L.size() / norb2;
+  REQUIRE(L.size() == naux * norb2);
+  REQUIRE(naux > 0);
+  REQUIRE(naux < norb * (norb + 1) / 2);
+
+  NumInactive ninact(1);
+  NumActive nact(8);
+  const size_t na = nact.get();
+  const size_t na2 = na * na;
+  const size_t na4 = na2 * na2;
+
+  SECTION("Decomposition") {
+    std::vector<double> V_chol(norb4);
+    macis::cholesky_to_eris(NumOrbital(norb), NumCholeskyVector(naux),
+                            L.data(), norb, V_chol.data(), norb);
+    for(size_t i = 0; i < norb4; ++i)
+      REQUIRE(V_chol[i] == Approx(V[i]).margin(10 * tol));
+
+    // Packed source (from FCIDUMP)
+    std::vector<double> V_packed(macis::packed_rank4_size(norb));
+    macis::read_fcidump_2body(
+        water_ccpvdz_fcidump,
+        macis::packed_eri_span<double>(V_packed.data(), norb));
+    auto L_packed = macis::cholesky_decompose_packed_eris(
+        NumOrbital(norb), V_packed.data(), tol);
+    REQUIRE(L_packed.size() == L.size());
+    for(size_t i = 0; i < L.size(); ++i)
+      REQUIRE(L_packed[i] == Approx(L[i]).margin(1e-12));
+  }
+
+  SECTION("Active Space Hamiltonian") {
+    std::vector<double> Fi_ref(norb2), T_act_ref(na2), V_act_ref(na4);
+    macis::active_hamiltonian(NumOrbital(norb), nact, ninact, T.data(), norb,
+                              V.data(), norb, Fi_ref.data(), norb,
+                              T_act_ref.data(), na, V_act_ref.data(), na);
+
+    std::vector<double> Fi(norb2), T_act(na2), V_act(na4);
+    macis::active_hamiltonian_cholesky(
+        NumOrbital(norb), nact, ninact, NumCholeskyVector(naux), T.data(),
+        norb, L.data(), norb, Fi.data(), norb, T_act.data(), na, V_act.data(),
+        na);
+
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(Fi[i] == Approx(Fi_ref[i]).margin(1e-9));
+    for(size_t i = 0; i < na2; ++i)
+      REQUIRE(T_act[i] == Approx(T_act_ref[i]).margin(1e-9));
+    for(size_t i = 0; i < na4; ++i)
+      REQUIRE(V_act[i] == Approx(V_act_ref[i]).margin(1e-9));
+
+    // Packed active ERIs directly from the Cholesky vectors
+    std::vector<double> V_packed(macis::packed_rank4_size(na)),
+        V_packed_ref(V_packed.size());
+    macis::pack_eris(na, V_act_ref.data(), na, V_packed_ref.data());
+    macis::cholesky_to_packed_eris(NumOrbital(na), NumCholeskyVector(naux),
+                                   L.data() + ninact.get() * (norb + 1), norb,
+                                   V_packed.data());
+    for(size_t i = 0; i < V_packed.size(); ++i)
+      REQUIRE(V_packed[i] == Approx(V_packed_ref[i]).margin(1e-9));
+  }
+
+  SECTION("Active Fock + Auxillary Q") {
+    std::vector<double> active_1rdm(na2), active_2rdm(na4);
+    macis::read_rdms_binary(water_ccpvdz_rdms_fname, na, active_1rdm.data(),
+                            na, active_2rdm.data(), na);
+
+    std::vector<double> Fa_ref(norb2), Fa(norb2);
+    macis::active_fock_matrix(NumOrbital(norb), ninact, nact, V.data(), norb,
+                              active_1rdm.data(), na, Fa_ref.data(), norb);
+    macis::active_fock_matrix_cholesky(
+        NumOrbital(norb), ninact, nact, NumCholeskyVector(naux), L.data(),
+        norb, active_1rdm.data(), na, Fa.data(), norb);
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(Fa[i] == Approx(Fa_ref[i]).margin(1e-9));
+
+    std::vector<double> Q_ref(na * norb), Q(na * norb);
+    macis::aux_q_matrix(nact, NumOrbital(norb), ninact, V.data(), norb,
+                        active_2rdm.data(), na, Q_ref.data(), na);
+    macis::aux_q_matrix_cholesky(nact, NumOrbital(norb), ninact,
+                                 NumCholeskyVector(naux), L.data(), norb,
+                                 active_2rdm.data(), na, Q.data(), na);
+    for(size_t i = 0; i < Q.size(); ++i)
+      REQUIRE(Q[i] == Approx(Q_ref[i]).margin(1e-9));
+
+    std::vector<double> packed_2rdm(macis::packed_rank4_size(na));
+    macis::pack_rank4(na, active_2rdm.data(), na, packed_2rdm.data());
+    macis::aux_q_matrix_cholesky_packed(nact, NumOrbital(norb), ninact,
+                                        NumCholeskyVector(naux), L.data(),
+                                        norb, packed_2rdm.data(), Q.data(), na);
+    for(size_t i = 0; i < Q.size(); ++i)
+      REQUIRE(Q[i] == Approx(Q_ref[i]).margin(1e-9));
+  }
+
+  SECTION("MP2 + Transform") {
+    const size_t nocc = 5;
+    const size_t nvir = norb - nocc;
+
+    std::vector<double> ON_ref(norb), C_ref(norb2, 0.0);
+    macis::mp2_natural_orbitals(
+        NumOrbital(norb), macis::NumCanonicalOccupied(nocc),
+        macis::NumCanonicalVirtual(nvir), T.data(), norb, V.data(), norb,
+        ON_ref.data(), C_ref.data(), norb);
+
+    std::vector<double> ON(norb), C(norb2, 0.0);
+    macis::mp2_natural_orbitals_cholesky(
+        NumOrbital(norb), macis::NumCanonicalOccupied(nocc),
+        macis::NumCanonicalVirtual(nvir), NumCholeskyVector(naux), T.data(),
+        norb, L.data(), norb, ON.data(), C.data(), norb);
+    for(size_t i = 0; i < norb; ++i)
+      REQUIRE(ON[i] == Approx(ON_ref[i]).margin(1e-9));
+
+    // Rotate into the MP2 natural orbitals
+    std::vector<double> V_ref(norb4);
+    macis::four_index_transform(norb, norb, V.data(), norb, C_ref.data(), norb,
+                                V_ref.data(), norb);
+
+    std::vector<double> L_rot(L.size()), V_rot(norb4);
+    macis::cholesky_transform(norb, norb, naux, L.data(), norb, C_ref.data(),
+                              norb, L_rot.data(), norb);
+    macis::cholesky_to_eris(NumOrbital(norb), NumCholeskyVector(naux),
+                            L_rot.data(), norb, V_rot.data(), norb);
+    for(size_t i = 0; i < norb4; ++i)
+      REQUIRE(V_rot[i] == Approx(V_ref[i]).margin(1e-9));
+  }
+
+  SECTION("CASSCF") {
+    spdlog::null_logger_mt("davidson");
+    spdlog::null_logger_mt("ci_solver");
+    spdlog::null_logger_mt("diis");
+    spdlog::null_logger_mt("mcscf");
+
+    NumVirtual nvirt(norb - ninact.get() - na);
+    macis::NumElectron nalpha(4);
+    std::vector<double> active_ordm(na2), active_trdm(na4);
+    macis::MCSCFSettings settings;
+
+    auto E = macis::casscf_diis_cholesky(
+        settings, nalpha, nalpha, NumOrbital(norb), ninact, nact, nvirt,
+        E_core, T.data(), norb, NumCholeskyVector(naux), L.data(), norb,
+        active_ordm.data(), na, active_trdm.data(), na,
+        MPI_COMM_SELF /*b/c root only*/);
+
+    REQUIRE(E == Approx(-76.1114493227).margin(1e-7));
+
+    spdlog::drop_all();
+  }
+}
@@ -6,12 +6,20 @@
  * See LICENSE.txt for details
  */
 
+#include <unistd.h>
+
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <random>
 #include <macis/csr_hamiltonian.hpp>
 #include <macis/hamiltonian_generator/double_loop.hpp>
+#include <macis/hamiltonian_generator/residue_arrays.hpp>
+#include <macis/hamiltonian_generator/string_factored.hpp>
+#include <macis/incremental_hamiltonian.hpp>
 #include <macis/util/fcidump.hpp>
+#include <sparsexx/io/dist_checkpoint.hpp>
 
 #include "ut_common.hpp"
 
@@ -70,6 +78,45 @@ TEST_CASE("CSR Hamiltonian") {
   }
 }
 
+TEST_CASE("Wide Determinant CSR Hamiltonian") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::matrix_span<double> T_span(T.data(), norb, norb);
+  macis::rank4_span<double> V_span(V.data(), norb, norb, norb, norb);
+
+  // 64-bit reference
+  macis::DoubleLoopHamiltonianGenerator<64> ham_gen_64(T_span, V_span);
+  auto dets_64 = macis::generate_cisd_hilbert_space(
+      norb, macis::canonical_hf_determinant<64>(nocc, nocc));
+  auto H_ref = macis::make_csr_hamiltonian_block<int32_t>(
+      dets_64.begin(), dets_64.end(), dets_64.begin(), dets_64.end(),
+      ham_gen_64, 1e-16);
+
+  // Multiword determinants must produce the same matrix
+  macis::DoubleLoopHamiltonianGenerator<256> ham_gen_256(T_span, V_span);
+  auto dets_256 = macis::generate_cisd_hilbert_space(
+      norb, macis::canonical_hf_determinant<256>(nocc, nocc));
+  REQUIRE(dets_256.size() == dets_64.size());
+  auto H = macis::make_csr_hamiltonian_block<int32_t>(
+      dets_256.begin(), dets_256.end(), dets_256.begin(), dets_256.end(),
+      ham_gen_256, 1e-16);
+
+  REQUIRE(H.rowptr() == H_ref.rowptr());
+  REQUIRE(H.colind() == H_ref.colind());
+  const size_t nnz = H.nnz();
+  for(auto i = 0ul; i < nnz; ++i) {
+    REQUIRE(H.nzval()[i] == Approx(H_ref.nzval()[i]));
+  }
+}
+
 TEST_CASE("Distributed CSR Hamiltonian") {
   MPI_Barrier(MPI_COMM_WORLD);
   size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
@@ -133,3 +180,456 @@ TEST_CASE("Distributed CSR Hamiltonian") {
 
   MPI_Barrier(MPI_COMM_WORLD);
 }
+
+TEST_CASE("Off-Diagonal CSR Hamiltonian Tile") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::matrix_span<double> T_span(T.data(), norb, norb);
+  macis::rank4_span<double> V_span(V.data(), norb, norb, norb, norb);
+  macis::DoubleLoopHamiltonianGenerator<64> ref_gen(T_span, V_span);
+
+  // Generate configuration space
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+  const size_t ndets = dets.size();
+
+  auto H = macis::make_csr_hamiltonian_block<int32_t>(
+      dets.begin(), dets.end(), dets.begin(), dets.end(), ref_gen, 1e-16);
+
+  // The off-diagonal tile must only couple the local rows to the remote
+  // (outside of [bra_st, bra_en)) determinants
+  auto check_tile = [&](macis::HamiltonianGenerator<64>& ham_gen,
+                        size_t bra_st, size_t bra_en) {
+    std::vector<int32_t> rowptr_ref = {0}, colind_ref;
+    std::vector<double> nzval_ref;
+    for(size_t i = bra_st; i < bra_en; ++i) {
+      for(auto j = H.rowptr()[i]; j < H.rowptr()[i + 1]; ++j) {
+        const size_t col = H.colind()[j];
+        if(col >= bra_st and col < bra_en) continue;
+        colind_ref.push_back(col);
+        nzval_ref.push_back(H.nzval()[j]);
+      }
+      rowptr_ref.push_back(colind_ref.size());
+    }
+
+    auto H_od = macis::make_csr_hamiltonian_offdiag_block<int32_t>(
+        dets.begin(), dets.end(), bra_st, bra_en, ham_gen, 1e-16);
+    REQUIRE(size_t(H_od.m()) == bra_en - bra_st);
+    REQUIRE(size_t(H_od.n()) == ndets);
+    REQUIRE(H_od.rowptr() == rowptr_ref);
+    REQUIRE(H_od.colind() == colind_ref);
+    for(size_t i = 0; i < nzval_ref.size(); ++i)
+      REQUIRE(H_od.nzval()[i] == Approx(nzval_ref[i]));
+  };
+
+  auto check_generator = [&](macis::HamiltonianGenerator<64>& ham_gen) {
+    // Interior, leading and trailing local ranges
+    check_tile(ham_gen, ndets / 3, 2 * ndets / 3);
+    check_tile(ham_gen, 0, ndets / 2);
+    check_tile(ham_gen, ndets / 2, ndets);
+
+    // No remote determinants
+    check_tile(ham_gen, 0, ndets);
+  };
+
+  SECTION("Double Loop") { check_generator(ref_gen); }
+
+  SECTION("String Factored") {
+    macis::StringFactoredHamiltonianGenerator<64> ham_gen(T_span, V_span);
+    check_generator(ham_gen);
+  }
+
+  SECTION("Residue Arrays") {
+    macis::ResidueArraysHamiltonianGenerator<64> ham_gen(T_span, V_span);
+    check_generator(ham_gen);
+  }
+}
+
+TEST_CASE("Incremental CSR Hamiltonian") {
+  MPI_Barrier(MPI_COMM_WORLD);
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::DoubleLoopHamiltonianGenerator<64> ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // Generate configuration space (replicated shuffle)
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+  std::mt19937 gen(1234);
+  std::shuffle(dets.begin(), dets.end(), gen);
+
+  auto check_equal = [](const auto& A, const auto& B) {
+    REQUIRE(A.local_row_start() == B.local_row_start());
+    REQUIRE(A.diagonal_tile().rowptr() == B.diagonal_tile().rowptr());
+    REQUIRE(A.diagonal_tile().colind() == B.diagonal_tile().colind());
+    REQUIRE(A.diagonal_tile().nzval() == B.diagonal_tile().nzval());
+    REQUIRE(bool(A.off_diagonal_tile_ptr()) ==
+            bool(B.off_diagonal_tile_ptr()));
+    if(A.off_diagonal_tile_ptr()) {
+      REQUIRE(A.off_diagonal_tile().rowptr() ==
+              B.off_diagonal_tile().rowptr());
+      REQUIRE(A.off_diagonal_tile().colind() ==
+              B.off_diagonal_tile().colind());
+      REQUIRE(A.off_diagonal_tile().nzval() == B.off_diagonal_tile().nzval());
+    }
+  };
+
+  macis::IncrementalHamiltonian<64> H_cache(MPI_COMM_WORLD);
+  REQUIRE(H_cache.empty());
+
+  // Initial space: everything is generated
+  const size_t nfirst = 2 * dets.size() / 3;
+  std::vector<macis::wfn_t<64>> wfn(dets.begin(), dets.begin() + nfirst);
+  {
+    const auto& H = H_cache.update(wfn.begin(), wfn.end(), ham_gen, 1e-16);
+    auto H_ref = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, wfn.begin(), wfn.end(), ham_gen, 1e-16);
+    REQUIRE(H_cache.nreused_rows() == 0);
+    REQUIRE(H_cache.nnew_dets() == wfn.size());
+    check_equal(H, H_ref);
+  }
+
+  // Drop some determinants, add new ones and reorder
+  const size_t ndrop = wfn.size() / 10;
+  const size_t nadd = dets.size() - nfirst;
+  wfn.erase(wfn.begin(), wfn.begin() + ndrop);
+  wfn.insert(wfn.end(), dets.begin() + nfirst, dets.end());
+  std::shuffle(wfn.begin(), wfn.end(), gen);
+  {
+    const auto& H = H_cache.update(wfn.begin(), wfn.end(), ham_gen, 1e-16);
+    auto H_ref = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, wfn.begin(), wfn.end(), ham_gen, 1e-16);
+    REQUIRE(H_cache.nreused_rows() == nfirst - ndrop);
+    REQUIRE(H_cache.nnew_dets() == nadd);
+    check_equal(H, H_ref);
+  }
+
+  // Same space: everything is reused
+  {
+    const auto& H = H_cache.update(wfn.begin(), wfn.end(), ham_gen, 1e-16);
+    auto H_ref = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, wfn.begin(), wfn.end(), ham_gen, 1e-16);
+    REQUIRE(H_cache.nreused_rows() == wfn.size());
+    REQUIRE(H_cache.nnew_dets() == 0);
+    check_equal(H, H_ref);
+  }
+
+  H_cache.reset();
+  REQUIRE(H_cache.empty());
+
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+TEST_CASE("Distributed CSR Hamiltonian Checkpoint") {
+  MPI_Barrier(MPI_COMM_WORLD);
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::DoubleLoopHamiltonianGenerator<64> ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // Generate configuration space
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+
+  auto H = macis::make_dist_csr_hamiltonian<int32_t>(
+      MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16);
+  auto spmv_info = sparsexx::spblas::generate_spmv_comm_info(H);
+
+  // Unique (per run) prefix shared by all ranks
+  int pid = getpid();
+  MPI_Bcast(&pid, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  const auto prefix = (std::filesystem::temp_directory_path() /
+                       ("macis_h_checkpoint." + std::to_string(pid)))
+                          .string();
+  const auto fname = sparsexx::detail::dist_checkpoint_fname(
+      prefix, macis::comm_rank(MPI_COMM_WORLD));
+  const auto fingerprint =
+      macis::hamiltonian_fingerprint(dets.begin(), dets.end(), ham_gen, 1e-16);
+  sparsexx::write_dist_checkpoint(prefix, H, &spmv_info, fingerprint);
+  MPI_Barrier(MPI_COMM_WORLD);
+  REQUIRE(std::filesystem::exists(fname));
+  REQUIRE(!std::filesystem::exists(fname + ".tmp"));
+
+  using tile_type = typename decltype(H)::tile_type;
+  decltype(spmv_info) spmv_info_rl;
+  auto H_rl = sparsexx::read_dist_checkpoint<tile_type>(
+      prefix, MPI_COMM_WORLD, &spmv_info_rl, fingerprint);
+
+  REQUIRE(H_rl.m() == H.m());
+  REQUIRE(H_rl.n() == H.n());
+  REQUIRE(H_rl.local_row_start() == H.local_row_start());
+  REQUIRE(H_rl.local_row_extent() == H.local_row_extent());
+  REQUIRE(H_rl.diagonal_tile() == H.diagonal_tile());
+  REQUIRE(bool(H_rl.off_diagonal_tile_ptr()) ==
+          bool(H.off_diagonal_tile_ptr()));
+  if(H.off_diagonal_tile_ptr())
+    REQUIRE(H_rl.off_diagonal_tile() == H.off_diagonal_tile());
+
+  REQUIRE(spmv_info_rl.send_indices == spmv_info.send_indices);
+  REQUIRE(spmv_info_rl.recv_indices == spmv_info.recv_indices);
+  REQUIRE(spmv_info_rl.send_offsets == spmv_info.send_offsets);
+  REQUIRE(spmv_info_rl.recv_offsets == spmv_info.recv_offsets);
+  REQUIRE(spmv_info_rl.send_counts == spmv_info.send_counts);
+  REQUIRE(spmv_info_rl.recv_counts == spmv_info.recv_counts);
+
+  // Reloaded matrix is usable for SpMV
+  std::vector<double> X(H.local_row_extent()), AX(X.size()), AX_rl(X.size());
+  for(size_t i = 0; i < X.size(); ++i)
+    X[i] = 1. / (H.local_row_start() + i + 1);
+  sparsexx::spblas::pgespmv(1., H, X.data(), 0., AX.data(), spmv_info);
+  sparsexx::spblas::pgespmv(1., H_rl, X.data(), 0., AX_rl.data(),
+                            spmv_info_rl);
+  REQUIRE(AX_rl == AX);
+
+  // Mismatched types are rejected
+  using tile64_type = sparsexx::csr_matrix<double, int64_t>;
+  REQUIRE_THROWS_AS(sparsexx::read_dist_checkpoint<tile64_type>(
+                        prefix, MPI_COMM_WORLD, nullptr, fingerprint),
+                    std::runtime_error);
+
+  // Checkpoints of a different Hamiltonian are rejected
+  const auto fingerprint_thresh =
+      macis::hamiltonian_fingerprint(dets.begin(), dets.end(), ham_gen, 1e-12);
+  REQUIRE(fingerprint_thresh != fingerprint);
+  REQUIRE(macis::hamiltonian_fingerprint(dets.begin(), dets.end() - 1,
+                                         ham_gen, 1e-16) != fingerprint);
+  REQUIRE_THROWS_AS(sparsexx::read_dist_checkpoint<tile_type>(
+                        prefix, MPI_COMM_WORLD, nullptr, fingerprint_thresh),
+                    std::runtime_error);
+
+  // Byte offsets of the count and the data of the k-th array of the local
+  // checkpoint, given the element sizes of the preceding arrays
+  auto array_offsets = [&](const std::vector<size_t>& elem_sizes) {
+    auto align = [](size_t x) {
+      constexpr auto a = sparsexx::detail::checkpoint_alignment;
+      return (x + a - 1) / a * a;
+    };
+    std::ifstream file(fname, std::ios::binary);
+    size_t pos = sizeof(sparsexx::detail::dist_checkpoint_header);
+    for(size_t k = 0;; ++k) {
+      const size_t count_pos = align(pos);
+      const size_t data_pos = align(count_pos + sizeof(uint64_t));
+      if(k == elem_sizes.size()) return std::make_pair(count_pos, data_pos);
+      uint64_t n;
+      file.seekg(count_pos);
+      file.read(reinterpret_cast<char*>(&n), sizeof(n));
+      pos = data_pos + n * elem_sizes[k];
+    }
+  };
+  auto corrupt = [&](size_t pos, auto value) {
+    {
+      std::fstream file(fname, std::ios::binary | std::ios::in | std::ios::out);
+      file.seekp(pos);
+      file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+  };
+  auto read_checkpoint = [&]() {
+    decltype(spmv_info) info;
+    return sparsexx::read_dist_checkpoint<tile_type>(prefix, MPI_COMM_WORLD,
+                                                     &info, fingerprint);
+  };
+  auto rewrite_checkpoint = [&]() {
+    sparsexx::write_dist_checkpoint(prefix, H, &spmv_info, fingerprint);
+    MPI_Barrier(MPI_COMM_WORLD);
+    REQUIRE_NOTHROW(read_checkpoint());
+  };
+
+  // Arrays: row extents, rowptr / colind / nzval of each tile and SpMV info
+  const size_t ntile_arrays = H.off_diagonal_tile_ptr() ? 6 : 3;
+  std::vector<size_t> elem_sizes = {sizeof(int64_t)};
+  for(size_t t = 0; t < ntile_arrays / 3; ++t)
+    elem_sizes.insert(elem_sizes.end(),
+                      {sizeof(int32_t), sizeof(int32_t), sizeof(double)});
+  auto prefix_sizes = [&](size_t k) {
+    return std::vector<size_t>(elem_sizes.begin(), elem_sizes.begin() + k);
+  };
+  elem_sizes.insert(elem_sizes.end(), {sizeof(int32_t), sizeof(int32_t),
+                                       sizeof(size_t), sizeof(size_t)});
+
+  // Corrupted row extents are rejected
+  corrupt(array_offsets({}).second +
+              (2 * macis::comm_size(MPI_COMM_WORLD) - 1) * sizeof(int64_t),
+          int64_t(H.m() + 1));
+  REQUIRE_THROWS_AS(read_checkpoint(), std::runtime_error);
+
+  // Array lengths whose byte count overflows are rejected
+  rewrite_checkpoint();
+  corrupt(array_offsets(prefix_sizes(1)).first, uint64_t(1) << 62);
+  REQUIRE_THROWS_AS(read_checkpoint(), std::runtime_error);
+
+  // Inconsistent row pointers are rejected
+  rewrite_checkpoint();
+  corrupt(array_offsets(prefix_sizes(1)).second, int32_t(1));
+  REQUIRE_THROWS_AS(read_checkpoint(), std::runtime_error);
+
+  // Out of range column indices are rejected
+  rewrite_checkpoint();
+  corrupt(array_offsets(prefix_sizes(2)).second,
+          int32_t(H.diagonal_tile().n()));
+  REQUIRE_THROWS_AS(read_checkpoint(), std::runtime_error);
+
+  // Out of range SpMV messages are rejected
+  rewrite_checkpoint();
+  corrupt(array_offsets(prefix_sizes(ntile_arrays + 3)).second,
+          size_t(1) << 40);
+  REQUIRE_THROWS_AS(read_checkpoint(), std::runtime_error);
+
+  // Truncated checkpoints are rejected
+  rewrite_checkpoint();
+  std::filesystem::resize_file(fname,
+                               std::filesystem::file_size(fname) - 1);
+  MPI_Barrier(MPI_COMM_WORLD);
+  REQUIRE_THROWS_AS(read_checkpoint(), std::runtime_error);
+
+  // The checkpointed builder regenerates H for the corrupted checkpoint and
+  // reuses the rewritten one
+  MPI_Barrier(MPI_COMM_WORLD);
+  for(int i = 0; i < 2; ++i) {
+    decltype(spmv_info) spmv_info_ck;
+    auto H_ck = macis::make_dist_csr_hamiltonian_checkpointed<int32_t>(
+        prefix, MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, {},
+        false, &spmv_info_ck);
+    REQUIRE(spmv_info_ck.send_indices == spmv_info.send_indices);
+    REQUIRE(spmv_info_ck.recv_indices == spmv_info.recv_indices);
+    REQUIRE(spmv_info_ck.send_counts == spmv_info.send_counts);
+    REQUIRE(spmv_info_ck.recv_counts == spmv_info.recv_counts);
+    REQUIRE(H_ck.local_row_start() == H.local_row_start());
+    REQUIRE(H_ck.local_row_extent() == H.local_row_extent());
+    REQUIRE(H_ck.diagonal_tile() == H.diagonal_tile());
+    if(H.off_diagonal_tile_ptr())
+      REQUIRE(H_ck.off_diagonal_tile() == H.off_diagonal_tile());
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+  REQUIRE_NOTHROW(sparsexx::read_dist_checkpoint<tile_type>(
+      prefix, MPI_COMM_WORLD, nullptr, macis::hash_mix64(fingerprint)));
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  std::filesystem::remove(fname);
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+TEST_CASE("NNZ-Balanced CSR Hamiltonian") {
+  MPI_Barrier(MPI_COMM_WORLD);
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::DoubleLoopHamiltonianGenerator<64> ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // Generate configuration space
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+  const size_t ndets = dets.size();
+
+  auto row_tiles = macis::make_nnz_balanced_row_tiles<int32_t>(
+      MPI_COMM_WORLD, dets.begin(), dets.end());
+
+  // Tiles are contiguous and non-empty
+  const size_t world_size = macis::comm_size(MPI_COMM_WORLD);
+  REQUIRE(row_tiles.size() == world_size);
+  REQUIRE(row_tiles.front().first == 0);
+  REQUIRE(size_t(row_tiles.back().second) == ndets);
+  for(size_t i = 0; i < world_size; ++i) {
+    REQUIRE(row_tiles[i].first < row_tiles[i].second);
+    if(i) REQUIRE(row_tiles[i].first == row_tiles[i - 1].second);
+  }
+
+  auto H_dist = macis::make_dist_csr_hamiltonian<int32_t>(
+      MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, row_tiles);
+
+  // Compare to the replicated matrix distributed over the same tiles
+  auto H = macis::make_csr_hamiltonian_block<int32_t>(
+      dets.begin(), dets.end(), dets.begin(), dets.end(), ham_gen, 1e-16);
+  decltype(H_dist) H_dist_ref(MPI_COMM_WORLD, H, row_tiles);
+
+  REQUIRE(H_dist.local_row_start() == H_dist_ref.local_row_start());
+  REQUIRE(H_dist.diagonal_tile().rowptr() ==
+          H_dist_ref.diagonal_tile().rowptr());
+  REQUIRE(H_dist.diagonal_tile().colind() ==
+          H_dist_ref.diagonal_tile().colind());
+  if(world_size > 1) {
+    REQUIRE(H_dist.off_diagonal_tile().rowptr() ==
+            H_dist_ref.off_diagonal_tile().rowptr());
+    REQUIRE(H_dist.off_diagonal_tile().colind() ==
+            H_dist_ref.off_diagonal_tile().colind());
+
+    // Nonzeros are at least as balanced as with the uniform tiling
+    auto H_uniform = macis::make_dist_csr_hamiltonian<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16);
+    auto imbalance = [](size_t nnz) {
+      auto max_nnz = macis::allreduce(nnz, MPI_MAX, MPI_COMM_WORLD);
+      auto avg_nnz = macis::allreduce(nnz, MPI_SUM, MPI_COMM_WORLD) /
+                     double(macis::comm_size(MPI_COMM_WORLD));
+      return max_nnz / avg_nnz;
+    };
+    REQUIRE(imbalance(H_dist.nnz()) <= imbalance(H_uniform.nnz()));
+  }
+
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+#ifdef _OPENMP
+TEST_CASE("Threaded CSR Hamiltonian") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb * norb * norb * norb);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::DoubleLoopHamiltonianGenerator<64> ham_gen(
+      macis::matrix_span<double>(T.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // Generate configuration space
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+
+  // Serial reference
+  const int nthreads = omp_get_max_threads();
+  omp_set_num_threads(1);
+  auto H_ref = macis::make_csr_hamiltonian_block<int32_t>(
+      dets.begin(), dets.end(), dets.begin(), dets.end(), ham_gen, 1e-16);
+
+  // Threaded build must be bitwise identical
+  omp_set_num_threads(std::max(nthreads, 4));
+  auto H = macis::make_csr_hamiltonian_block<int32_t>(
+      dets.begin(), dets.end(), dets.begin(), dets.end(), ham_gen, 1e-16);
+  omp_set_num_threads(nthreads);
+
+  REQUIRE(H.rowptr() == H_ref.rowptr());
+  REQUIRE(H.colind() == H_ref.colind());
+  REQUIRE(H.nzval() == H_ref.nzval());
+}
+#endif
@@ -11,6 +11,8 @@
 #include <macis/csr_hamiltonian.hpp>
 #include <macis/hamiltonian_generator/double_loop.hpp>
 #include <macis/solvers/davidson.hpp>
+#include <macis/solvers/direct_hamiltonian_operator.hpp>
+#include <macis/solvers/selected_ci_diag.hpp>
 #include <macis/util/fcidump.hpp>
 
 #include "ut_common.hpp"
@@ -65,6 +67,40 @@ TEST_CASE("Davidson") {
     sparsexx::spblas::gespmbv(1, 1., H, X.data(), H.n(), 0., AX.data(), H.n());
     REQUIRE(blas::dot(X.size(), X.data(), 1, AX.data(), 1) == Approx(E0));
   }
+
+  SECTION("Symmetric Storage") {
+    auto H_upper = macis::make_csr_hamiltonian_upper_block<int32_t>(
+        dets.begin(), dets.end(), ham_gen, 1e-16);
+
+    // Upper triangle of the full matrix
+    size_t nnz_diag = 0;
+    for(size_t i = 0; i < size_t(H.m()); ++i)
+      for(auto j = H.rowptr()[i]; j < H.rowptr()[i + 1]; ++j)
+        nnz_diag += H.colind()[j] == int32_t(i);
+    REQUIRE(size_t(2 * H_upper.nnz()) == H.nnz() + nnz_diag);
+
+    // Symmetric SpMV (block of two vectors)
+    const size_t n = H.n();
+    std::vector<double> X(2 * n), AX(2 * n, 1.), AX_ref(2 * n, 1.);
+    for(size_t i = 0; i < n; ++i) {
+      X[i] = 1. / (i + 1);
+      X[i + n] = std::cos(i);
+    }
+    sparsexx::spblas::gespmbv(2, 2., H, X.data(), n, 0.5, AX_ref.data(), n);
+    sparsexx::spblas::syspmbv(2, 2., H_upper, X.data(), n, 0.5, AX.data(), n);
+    for(size_t i = 0; i < 2 * n; ++i)
+      REQUIRE(AX[i] == Approx(AX_ref[i]).margin(1e-12));
+
+    X.resize(n);
+    std::fill(X.begin(), X.end(), 0.);
+    macis::diagonal_guess(H_upper.n(), H_upper, X.data());
+    auto D = sparsexx::extract_diagonal_elements(H_upper);
+    auto [niter, E0] =
+        macis::davidson(H_upper.n(), 15,
+                        macis::SymmetricSparseMatrixOperator(H_upper), D.data(),
+                        1e-8, X.data());
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+  }
 }
 
 TEST_CASE("Parallel Davidson") {
@@ -127,6 +163,269 @@ TEST_CASE("Parallel Davidson") {
     REQUIRE(inner == Approx(E0));
   }
 
+  SECTION("Symmetric Storage") {
+    auto H_upper = macis::make_dist_csr_hamiltonian_upper<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16);
+    macis::SymmetricSparseMatrixOperator op(H_upper);
+
+    std::vector<double> X_local(H.local_row_extent());
+    for(size_t i = 0; i < X_local.size(); ++i)
+      X_local[i] = 1. / (i + H.local_row_start() + 1);
+
+    std::vector<double> AX_local(X_local.size()), AX_ref(X_local.size());
+    op.operator_action(1, 1., X_local.data(), X_local.size(), 0.,
+                       AX_local.data(), X_local.size());
+    sparsexx::spblas::pgespmv(1., H, X_local.data(), 0., AX_ref.data(),
+                              spmv_info);
+    for(size_t i = 0; i < X_local.size(); ++i)
+      REQUIRE(AX_local[i] == Approx(AX_ref[i]).margin(1e-12));
+
+    macis::p_diagonal_guess(X_local.size(), H_upper, X_local.data());
+    auto D_local = sparsexx::extract_diagonal_elements(H_upper.diagonal_tile());
+    auto [niter, E0] =
+        macis::p_davidson(X_local.size(), 15, op, D_local.data(), 1e-8,
+                          X_local.data(), MPI_COMM_WORLD);
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+
+    // Selected CI with upper triangular storage (optionally NNZ-balanced)
+    if(!spdlog::get("ci_solver")) spdlog::null_logger_mt("ci_solver");
+    auto balance_nnz = GENERATE(false, true);
+    std::vector<double> C_local;
+    auto E_sci = macis::selected_ci_diag<64, int32_t>(
+        dets.begin(), dets.end(), ham_gen, 1e-16, 15, 1e-8, C_local,
+        MPI_COMM_WORLD, true, nullptr, balance_nnz, true);
+    REQUIRE(E_sci + E_core == Approx(E0_ref));
+  }
+
+  SECTION("Mixed Precision") {
+    // Tiles are generated in row batches
+    auto nbatch = GENERATE(1ul, 8ul, 1000ul);
+    auto H_mixed = macis::make_dist_csr_hamiltonian_mixed<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, nbatch);
+    REQUIRE(H_mixed.nnz() == size_t(H.nnz()));
+    REQUIRE(H_mixed.mem_footprint() < size_t(H.mem_footprint()));
+
+    auto D_ref = sparsexx::extract_diagonal_elements(H.diagonal_tile());
+    REQUIRE(H_mixed.D_local == D_ref);
+
+    // Single precision copy of the off-diagonal elements of H
+    const auto& H_diag = H.diagonal_tile();
+    const auto& H_mixed_diag = H_mixed.H.diagonal_tile();
+    for(int64_t i = 0, k = 0; i < H_diag.m(); ++i)
+      for(auto j = H_diag.rowptr()[i]; j < H_diag.rowptr()[i + 1]; ++j) {
+        if(H_diag.colind()[j] == i) continue;
+        REQUIRE(H_mixed_diag.colind()[k] == H_diag.colind()[j]);
+        REQUIRE(H_mixed_diag.nzval()[k] == float(H_diag.nzval()[j]));
+        ++k;
+      }
+
+    macis::MixedPrecisionSparseMatrixOperator op(H_mixed.H,
+                                                 H_mixed.D_local.data());
+    std::vector<double> X_local(H.local_row_extent());
+    macis::p_diagonal_guess(X_local.size(), H_mixed.D_local.data(),
+                            X_local.data(), MPI_COMM_WORLD);
+    auto [niter, E0] =
+        macis::p_davidson(X_local.size(), 15, op, H_mixed.D_local.data(),
+                          1e-6, X_local.data(), MPI_COMM_WORLD);
+    REQUIRE(E0 + E_core == Approx(E0_ref).margin(1e-5));
+
+    // NNZ-balanced tiling
+    auto row_tiles = macis::make_nnz_balanced_row_tiles<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end());
+    auto H_bal = macis::make_dist_csr_hamiltonian_mixed<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, nbatch,
+        row_tiles);
+    auto [row_st, row_en] = row_tiles[macis::comm_rank(MPI_COMM_WORLD)];
+    REQUIRE(size_t(H_bal.local_row_start()) == size_t(row_st));
+    REQUIRE(size_t(H_bal.local_row_extent()) == size_t(row_en - row_st));
+    REQUIRE(H_bal.D_local.size() == size_t(row_en - row_st));
+
+    // Mixed precision solve with double precision refinement (optionally
+    // NNZ-balanced)
+    if(!spdlog::get("ci_solver")) spdlog::null_logger_mt("ci_solver");
+    auto balance_nnz = GENERATE(false, true);
+    std::vector<double> C_local;
+    auto E_ref = macis::selected_ci_diag<64, int32_t>(
+        dets.begin(), dets.end(), ham_gen, 1e-16, 15, 1e-8, C_local,
+        MPI_COMM_WORLD, true, nullptr, balance_nnz, false, "", false, true);
+    REQUIRE(E_ref + E_core == Approx(E0_ref));
+    const auto& H_tiled = balance_nnz ? H_bal : H_mixed;
+    REQUIRE(C_local.size() == size_t(H_tiled.local_row_extent()));
+  }
+
+  SECTION("Compressed Storage") {
+    auto H_c = macis::make_dist_csr_hamiltonian_compressed<int32_t, uint16_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16);
+    REQUIRE(H_c.nnz() == H.nnz());
+    REQUIRE(H_c.mem_footprint() < H.mem_footprint());
+    REQUIRE(H_c.diagonal_tile().colind() == H.diagonal_tile().colind());
+
+    // Conversion from an existing matrix preserves the row tiling
+    auto H_c32 = sparsexx::compress_dist_csr<uint32_t>(H);
+    REQUIRE(H_c32.local_row_start() == H.local_row_start());
+    REQUIRE(H_c32.local_row_extent() == H.local_row_extent());
+
+    // Only the gaps beyond the offsets are escaped
+    using u8_tile_type =
+        sparsexx::compressed_csr_matrix<double, int32_t, uint8_t>;
+    u8_tile_type H_c8(H.diagonal_tile());
+    REQUIRE(H_c8.nescaped() > 0);
+    REQUIRE(H_c8.nescaped() < H_c8.nnz() / 2);
+    REQUIRE(H_c8.colind() == H.diagonal_tile().colind());
+    REQUIRE(sparsexx::extract_diagonal_elements(H_c8) ==
+            sparsexx::extract_diagonal_elements(H.diagonal_tile()));
+    {
+      const size_t n = H_c8.n();
+      std::vector<double> X(n), AX(H_c8.m()), AX_ref(H_c8.m());
+      for(size_t i = 0; i < n; ++i) X[i] = 1. / (i + 1);
+      sparsexx::spblas::gespmbv(1, 1., H_c8, X.data(), n, 0., AX.data(),
+                                H_c8.m());
+      sparsexx::spblas::gespmbv(1, 1., H.diagonal_tile(), X.data(), n, 0.,
+                                AX_ref.data(), H_c8.m());
+      REQUIRE(AX == AX_ref);
+    }
+
+    // Row spanning the full width of a matrix beyond 16 bit offsets and
+    // an unsorted row
+    {
+      const int32_t n = 100000;
+      sparsexx::csr_matrix<double, int32_t> A(
+          3, n, std::vector<int32_t>{0, 3, 5, 5},
+          std::vector<int32_t>{0, 1, n - 1, 70010, 70000},
+          std::vector<double>{1., 2., 3., 4., 5.});
+      sparsexx::compressed_csr_matrix<double, int32_t, uint16_t> A_c(A);
+      REQUIRE(A_c.nescaped() == 2);
+      REQUIRE(A_c.esccol() == std::vector<int32_t>{n - 1, 70000});
+      REQUIRE(A_c.escptr() == std::vector<int32_t>{0, 1, 2, 2});
+      REQUIRE(A_c.colind() == A.colind());
+      REQUIRE(A_c.decompress().rowptr() == A.rowptr());
+
+      std::vector<double> X(n), AX(3), AX_ref(3);
+      for(int32_t i = 0; i < n; ++i) X[i] = i + 1;
+      sparsexx::spblas::gespmbv(1, 1., A_c, X.data(), n, 0., AX.data(), 3);
+      sparsexx::spblas::gespmbv(1, 1., A, X.data(), n, 0., AX_ref.data(), 3);
+      REQUIRE(AX == AX_ref);
+      REQUIRE(AX[0] == 1. + 2. * 2. + 3. * n);
+    }
+
+    auto D_local = sparsexx::extract_diagonal_elements(H_c.diagonal_tile());
+    auto D_ref = sparsexx::extract_diagonal_elements(H.diagonal_tile());
+    REQUIRE(D_local == D_ref);
+
+    std::vector<double> X_local(H_c.local_row_extent());
+    macis::p_diagonal_guess(X_local.size(), H_c, X_local.data());
+    auto [niter, E0] =
+        macis::p_davidson(X_local.size(), 15, macis::SparseMatrixOperator(H_c),
+                          D_local.data(), 1e-8, X_local.data(), MPI_COMM_WORLD);
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+
+    // Decoding does not alter the order of accumulation
+    auto spmv_info_c = sparsexx::spblas::generate_spmv_comm_info(H_c);
+    std::vector<double> AX_local(X_local.size()), AX_ref(X_local.size());
+    sparsexx::spblas::pgespmv(1., H_c, X_local.data(), 0., AX_local.data(),
+                              spmv_info_c);
+    sparsexx::spblas::pgespmv(1., H, X_local.data(), 0., AX_ref.data(),
+                              spmv_info);
+    REQUIRE(AX_local == AX_ref);
+
+    // NNZ-balanced tiling
+    auto row_tiles = macis::make_nnz_balanced_row_tiles<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end());
+    auto H_bal = macis::make_dist_csr_hamiltonian_compressed<int32_t, uint16_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16, row_tiles);
+    auto [row_st, row_en] = row_tiles[macis::comm_rank(MPI_COMM_WORLD)];
+    REQUIRE(size_t(H_bal.local_row_start()) == size_t(row_st));
+    REQUIRE(size_t(H_bal.local_row_extent()) == size_t(row_en - row_st));
+    REQUIRE(macis::allreduce(size_t(H_bal.nnz()), MPI_SUM, MPI_COMM_WORLD) ==
+            macis::allreduce(size_t(H.nnz()), MPI_SUM, MPI_COMM_WORLD));
+
+    // Selected CI with compressed storage (optionally NNZ-balanced)
+    if(!spdlog::get("ci_solver")) spdlog::null_logger_mt("ci_solver");
+    auto balance_nnz = GENERATE(false, true);
+    std::vector<double> C_local;
+    auto E_sci = macis::selected_ci_diag<64, int32_t>(
+        dets.begin(), dets.end(), ham_gen, 1e-16, 15, 1e-8, C_local,
+        MPI_COMM_WORLD, true, nullptr, balance_nnz, false, "", false, false,
+        true);
+    REQUIRE(E_sci + E_core == Approx(E0_ref));
+    REQUIRE(C_local.size() ==
+            size_t(balance_nnz ? row_en - row_st : H.local_row_extent()));
+  }
+
+  SECTION("NNZ-Balanced Tiling") {
+    if(!spdlog::get("ci_solver")) spdlog::null_logger_mt("ci_solver");
+    std::vector<double> C_local;
+    auto E0 = macis::selected_ci_diag<64, int32_t>(
+        dets.begin(), dets.end(), ham_gen, 1e-16, 15, 1e-8, C_local,
+        MPI_COMM_WORLD, false, nullptr, true);
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+
+    // Eigenvector follows the balanced tiling
+    auto row_tiles = macis::make_nnz_balanced_row_tiles<int32_t>(
+        MPI_COMM_WORLD, dets.begin(), dets.end());
+    auto [row_st, row_en] = row_tiles[macis::comm_rank(MPI_COMM_WORLD)];
+    REQUIRE(C_local.size() == size_t(row_en - row_st));
+
+    auto C = macis::allgatherv(C_local, MPI_COMM_WORLD);
+    REQUIRE(C.size() == dets.size());
+    REQUIRE(blas::nrm2(C.size(), C.data(), 1) == Approx(1.0));
+  }
+
+  SECTION("Direct Operator") {
+    macis::DirectHamiltonianOperator<64> op(MPI_COMM_WORLD, dets.begin(),
+                                            dets.end(), ham_gen, 1e-16, true,
+                                            100);
+    REQUIRE(op.local_row_extent() == size_t(H.local_row_extent()));
+    REQUIRE(op.local_row_start() == size_t(H.local_row_start()));
+
+    // Diagonal matches the CSR Hamiltonian (up to roundoff of the
+    // incremental evaluation)
+    auto D_local = op.diagonal();
+    auto D_ref = sparsexx::extract_diagonal_elements(H.diagonal_tile());
+    REQUIRE(D_local.size() == D_ref.size());
+    for(size_t i = 0; i < D_ref.size(); ++i)
+      REQUIRE(D_local[i] == Approx(D_ref[i]));
+
+    std::vector<double> X_local(op.local_row_extent());
+    macis::p_diagonal_guess(X_local.size(), D_local.data(), X_local.data(),
+                            MPI_COMM_WORLD);
+    auto [niter, E0] =
+        macis::p_davidson(X_local.size(), 15, op, D_local.data(), 1e-8,
+                          X_local.data(), MPI_COMM_WORLD);
+    REQUIRE(E0 + E_core == Approx(E0_ref));
+
+    // H*X matches the stored Hamiltonian
+    std::vector<double> AX_local(X_local.size()), AX_ref(X_local.size());
+    op.operator_action(1, 1., X_local.data(), X_local.size(), 0.,
+                       AX_local.data(), X_local.size());
+    sparsexx::spblas::pgespmv(1., H, X_local.data(), 0., AX_ref.data(),
+                              spmv_info);
+    for(size_t i = 0; i < X_local.size(); ++i)
+      REQUIRE(AX_local[i] == Approx(AX_ref[i]).margin(1e-12));
+
+    // Matrix-free selected CI (optionally NNZ-balanced) matches the CSR
+    // solver
+    if(!spdlog::get("ci_solver")) spdlog::null_logger_mt("ci_solver");
+    auto balance_nnz = GENERATE(false, true);
+    std::vector<double> C_ref, C_local;
+    auto E_ref = macis::selected_ci_diag<64, int32_t>(
+        dets.begin(), dets.end(), ham_gen, 1e-16, 15, 1e-8, C_ref,
+        MPI_COMM_WORLD, true, nullptr, balance_nnz);
+    auto E_sci = macis::selected_ci_diag<64, int32_t>(
+        dets.begin(), dets.end(), ham_gen, 1e-16, 15, 1e-8, C_local,
+        MPI_COMM_WORLD, true, nullptr, balance_nnz, false, "", true);
+    REQUIRE(E_sci == Approx(E_ref));
+    REQUIRE(C_local.size() == C_ref.size());
+
+    // The stored H cannot be combined with the direct solver
+    auto direct_upper = [&]() {
+      return macis::selected_ci_diag<64, int32_t>(
+          dets.begin(), dets.end(), ham_gen, 1e-16, 15, 1e-8, C_local,
+          MPI_COMM_WORLD, true, nullptr, balance_nnz, true, "", true);
+    };
+    REQUIRE_THROWS_AS(direct_upper(), std::runtime_error);
+  }
+
   MPI_Barrier(MPI_COMM_WORLD);
   spdlog::drop_all();
 }
@@ -86,6 +86,140 @@ TEST_CASE("Double Loop") {
     }
   }
 
+  SECTION("Incremental Diagonals") {
+    // Open-shell reference determinant
+    auto ref = hf_det;
+    ref.flip(2).flip(nocc + 1).flip(4 + 32).flip(nocc + 3 + 32);
+    const auto ref_occ_alpha =
+        macis::bits_to_indices(macis::bitset_lo_word(ref));
+    const auto ref_occ_beta =
+        macis::bits_to_indices(macis::bitset_hi_word(ref));
+    const auto E_ref = ham_gen.matrix_element(ref, ref);
+
+    auto dets = macis::generate_cisd_hilbert_space(norb, ref);
+
+    // Triple excitation (evaluated from scratch)
+    auto triple = ref;
+    triple.flip(0).flip(1).flip(3);
+    triple.flip(nocc + 2).flip(nocc + 4).flip(nocc + 5);
+    dets.emplace_back(triple);
+
+    for(auto det : dets) {
+      auto fast_E =
+          ham_gen.fast_diag(ref, det, ref_occ_alpha, ref_occ_beta, E_ref);
+      REQUIRE(fast_E == Approx(ham_gen.matrix_element(det, det)));
+    }
+
+    std::vector<double> D(dets.size());
+    ham_gen.diagonal_elements(dets.begin(), dets.end(), D.data());
+    for(size_t i = 0; i < dets.size(); ++i)
+      REQUIRE(D[i] == Approx(ham_gen.matrix_element(dets[i], dets[i])));
+  }
+
+  SECTION("Packed ERIs") {
+    std::vector<double> V_packed(macis::packed_rank4_size(norb));
+    macis::pack_eris(norb, V.data(), norb, V_packed.data());
+
+    // Round trip
+    std::vector<double> V_unpacked(V.size());
+    macis::unpack_eris(norb, V_packed.data(), V_unpacked.data(), norb);
+    for(size_t i = 0; i < V.size(); ++i) REQUIRE(V_unpacked[i] == V[i]);
+
+    // Separate copy of T, rotations are performed in place
+    std::vector<double> T_packed(T);
+    generator_type packed_gen(
+        macis::matrix_span<double>(T_packed.data(), norb, norb),
+        macis::packed_eri_span<double>(V_packed.data(), norb));
+    REQUIRE(packed_gen.packed_eris());
+    REQUIRE_FALSE(ham_gen.packed_eris());
+
+    for(size_t i = 0; i < norb3; ++i) {
+      REQUIRE(packed_gen.G_red()[i] == Approx(ham_gen.G_red()[i]));
+      REQUIRE(packed_gen.V_red()[i] == Approx(ham_gen.V_red()[i]));
+    }
+
+    // Open-shell reference to exercise all excitation types
+    auto ref = hf_det;
+    ref.flip(2).flip(nocc + 1).flip(4 + 32).flip(nocc + 3 + 32);
+    auto dets = macis::generate_cisd_hilbert_space(norb, ref);
+
+    auto check_elements = [&]() {
+      for(auto det : dets) {
+        REQUIRE(packed_gen.matrix_element(ref, det) ==
+                Approx(ham_gen.matrix_element(ref, det)).margin(1e-12));
+        REQUIRE(packed_gen.matrix_element(det, det) ==
+                Approx(ham_gen.matrix_element(det, det)));
+      }
+    };
+    check_elements();
+
+    // Natural orbital rotation
+    std::vector<double> ordm(norb2, 0.0);
+    std::vector<double> C(dets.size(), 0.0);
+    C[0] = 0.9;
+    C[1] = 0.3;
+    C[dets.size() - 1] = 0.2;
+    ham_gen.form_rdms(dets.begin(), dets.end(), dets.begin(), dets.end(),
+                      C.data(),
+                      macis::matrix_span<double>(ordm.data(), norb, norb),
+                      macis::rank4_span<double>(nullptr, 0, 0, 0, 0));
+
+    ham_gen.rotate_hamiltonian_ordm(ordm.data());
+    packed_gen.rotate_hamiltonian_ordm(ordm.data());
+    REQUIRE(packed_gen.packed_eris());
+    check_elements();
+  }
+
+  SECTION("Node-Shared ERIs") {
+    macis::mpi_node_comm node_comm(MPI_COMM_SELF /*b/c root only*/);
+    REQUIRE(node_comm.is_leader());
+
+    macis::mpi_shared_buffer<double> V_shared(V.size(), node_comm);
+    REQUIRE(V_shared.size() == V.size());
+    std::copy(V.begin(), V.end(), V_shared.begin());
+    node_comm.barrier();
+
+    // Separate copy of T, rotations are performed in place
+    std::vector<double> T_shared(T);
+    generator_type shared_gen(
+        macis::matrix_span<double>(T_shared.data(), norb, norb),
+        macis::rank4_span<double>(V_shared.data(), norb, norb, norb, norb),
+        node_comm);
+    REQUIRE(shared_gen.node_shared_eris());
+    REQUIRE_FALSE(ham_gen.node_shared_eris());
+
+    const size_t norb4 = norb2 * norb2;
+    for(size_t i = 0; i < norb4; ++i)
+      REQUIRE(shared_gen.G()[i] == ham_gen.G()[i]);
+    for(size_t i = 0; i < norb3; ++i) {
+      REQUIRE(shared_gen.G_red()[i] == ham_gen.G_red()[i]);
+      REQUIRE(shared_gen.V_red()[i] == ham_gen.V_red()[i]);
+    }
+
+    auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+    auto check_elements = [&]() {
+      for(auto det : dets)
+        REQUIRE(shared_gen.matrix_element(hf_det, det) ==
+                Approx(ham_gen.matrix_element(hf_det, det)).margin(1e-12));
+    };
+    check_elements();
+
+    // Natural orbital rotation
+    std::vector<double> ordm(norb2, 0.0);
+    std::vector<double> C(dets.size(), 0.0);
+    C[0] = 0.9;
+    C[1] = 0.3;
+    C[dets.size() - 1] = 0.2;
+    ham_gen.form_rdms(dets.begin(), dets.end(), dets.begin(), dets.end(),
+                      C.data(),
+                      macis::matrix_span<double>(ordm.data(), norb, norb),
+                      macis::rank4_span<double>(nullptr, 0, 0, 0, 0));
+
+    ham_gen.rotate_hamiltonian_ordm(ordm.data());
+    shared_gen.rotate_hamiltonian_ordm(ordm.data());
+    check_elements();
+  }
+
   SECTION("Brilloin") {
     // Alpha -> Alpha
     for(size_t i = 0; i < nocc; ++i)
@@ -271,3 +405,216 @@ TEST_CASE("RDMS") {
 #endif
   }
 }
+
+TEST_CASE("Distributed RDMS") {
+  const size_t norb = 8;
+  const size_t norb2 = norb * norb;
+  const size_t norb4 = norb2 * norb2;
+
+  std::vector<double> T(norb2, 0.0);
+  std::vector<double> V(norb4, 0.0);
+  macis::matrix_span<double> T_span(T.data(), norb, norb);
+  macis::rank4_span<double> V_span(V.data(), norb, norb, norb, norb);
+
+  using generator_type = macis::DoubleLoopHamiltonianGenerator<64>;
+  generator_type ham_gen(T_span, V_span);
+
+  // Full CI space with an arbitrary normalized CI vector
+  auto dets = macis::generate_hilbert_space<64>(norb, 3, 3);
+  std::vector<double> C(dets.size());
+  for(size_t i = 0; i < C.size(); ++i) C[i] = std::cos(0.1 * i) / (i + 1);
+  auto c_nrm = blas::nrm2(C.size(), C.data(), 1);
+  blas::scal(C.size(), 1. / c_nrm, C.data(), 1);
+
+  // Contributions of bra i against all kets
+  auto accumulate_row = [&](size_t i, auto ordm, auto trdm) {
+    const auto bra = dets[i];
+    const auto bra_alpha = macis::bitset_lo_word(bra);
+    const auto bra_beta = macis::bitset_hi_word(bra);
+    std::vector<uint32_t> occ_alpha, occ_beta;
+    macis::bits_to_indices(bra_alpha, occ_alpha);
+    macis::bits_to_indices(bra_beta, occ_beta);
+    for(size_t j = 0; j < dets.size(); ++j) {
+      const auto ex = bra ^ dets[j];
+      if(ex.count() > 4) continue;
+      macis::rdm_contributions(
+          bra_alpha, macis::bitset_lo_word(dets[j]), macis::bitset_lo_word(ex),
+          bra_beta, macis::bitset_hi_word(dets[j]), macis::bitset_hi_word(ex),
+          occ_alpha, occ_beta, C[i] * C[j], ordm, trdm);
+    }
+  };
+
+  // All-pairs reference
+  std::vector<double> ordm_ref(norb2, 0.0), trdm_ref(norb4, 0.0);
+  for(size_t i = 0; i < dets.size(); ++i)
+    accumulate_row(
+        i, macis::matrix_span<double>(ordm_ref.data(), norb, norb),
+        macis::rank4_span<double>(trdm_ref.data(), norb, norb, norb, norb));
+
+  double trace_ordm = 0.;
+  for(size_t p = 0; p < norb; ++p) trace_ordm += ordm_ref[p * (norb + 1)];
+  REQUIRE(trace_ordm == Approx(6.0));
+
+  SECTION("1+2 RDM") {
+    // Prior contents are overwritten
+    std::vector<double> ordm(norb2, 1.0), trdm(norb4, 1.0);
+    ham_gen.form_rdms(
+        dets.begin(), dets.end(), C.data(),
+        macis::matrix_span<double>(ordm.data(), norb, norb),
+        macis::rank4_span<double>(trdm.data(), norb, norb, norb, norb),
+        MPI_COMM_WORLD);
+
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(ordm[i] == Approx(ordm_ref[i]).margin(1e-12));
+    for(size_t i = 0; i < norb4; ++i)
+      REQUIRE(trdm[i] == Approx(trdm_ref[i]).margin(1e-12));
+  }
+
+  SECTION("Block") {
+    std::vector<double> ordm(norb2, 0.0), trdm(norb4, 0.0);
+    ham_gen.form_rdms(
+        dets.begin(), dets.end(), dets.begin(), dets.end(), C.data(),
+        macis::matrix_span<double>(ordm.data(), norb, norb),
+        macis::rank4_span<double>(trdm.data(), norb, norb, norb, norb));
+
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(ordm[i] == Approx(ordm_ref[i]).margin(1e-12));
+    for(size_t i = 0; i < norb4; ++i)
+      REQUIRE(trdm[i] == Approx(trdm_ref[i]).margin(1e-12));
+  }
+
+  SECTION("Bounded Thread Buffers") {
+    // No thread-private 2-RDM buffers (atomic accumulation)
+    auto make_row_gen = [&]() { return accumulate_row; };
+
+    std::vector<double> ordm(norb2, 0.0), trdm(norb4, 0.0);
+    macis::accumulate_rdms_by_rows(
+        dets.size(), macis::matrix_span<double>(ordm.data(), norb, norb),
+        macis::rank4_span<double>(trdm.data(), norb, norb, norb, norb),
+        make_row_gen, 0);
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(ordm[i] == Approx(ordm_ref[i]).margin(1e-12));
+    for(size_t i = 0; i < norb4; ++i)
+      REQUIRE(trdm[i] == Approx(trdm_ref[i]).margin(1e-12));
+
+    std::vector<double> trdm_packed(macis::packed_rank4_size(norb), 0.0),
+        trdm_ref_packed(trdm_packed.size());
+    std::fill(ordm.begin(), ordm.end(), 0.0);
+    macis::accumulate_rdms_by_rows(
+        dets.size(), macis::matrix_span<double>(ordm.data(), norb, norb),
+        macis::packed_rank4_span<double>(trdm_packed.data(), norb),
+        make_row_gen, 0);
+    macis::pack_rank4(norb, trdm_ref.data(), norb, trdm_ref_packed.data());
+    for(size_t i = 0; i < trdm_packed.size(); ++i)
+      REQUIRE(trdm_packed[i] == Approx(trdm_ref_packed[i]).margin(1e-12));
+  }
+
+  SECTION("1RDM Only") {
+    std::vector<double> ordm(norb2, 1.0);
+    ham_gen.form_ordm(dets.begin(), dets.end(), C.data(),
+                      macis::matrix_span<double>(ordm.data(), norb, norb),
+                      MPI_COMM_WORLD);
+
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(ordm[i] == Approx(ordm_ref[i]).margin(1e-12));
+  }
+
+  SECTION("Packed 2RDM") {
+    std::vector<double> ordm(norb2, 1.0),
+        trdm(macis::packed_rank4_size(norb), 1.0);
+    ham_gen.form_rdms(dets.begin(), dets.end(), C.data(),
+                      macis::matrix_span<double>(ordm.data(), norb, norb),
+                      macis::packed_rank4_span<double>(trdm.data(), norb),
+                      MPI_COMM_WORLD);
+
+    std::vector<double> trdm_ref_packed(trdm.size());
+    macis::pack_rank4(norb, trdm_ref.data(), norb, trdm_ref_packed.data());
+
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(ordm[i] == Approx(ordm_ref[i]).margin(1e-12));
+    for(size_t i = 0; i < trdm.size(); ++i)
+      REQUIRE(trdm[i] == Approx(trdm_ref_packed[i]).margin(1e-12));
+  }
+}
+
+TEST_CASE("Distributed Node-Shared ERIs") {
+  auto norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  const size_t norb2 = norb * norb;
+  const size_t norb4 = norb2 * norb2;
+  const size_t nocc = 5;
+
+  std::vector<double> T(norb2), V(norb4);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  // All ranks of a single-host run share one node
+  macis::mpi_node_comm node_comm(MPI_COMM_WORLD);
+
+  using generator_type = macis::DoubleLoopHamiltonianGenerator<64>;
+  std::vector<double> T_ref(T), T_shared(T);
+  generator_type ham_gen(
+      macis::matrix_span<double>(T_ref.data(), norb, norb),
+      macis::rank4_span<double>(V.data(), norb, norb, norb, norb));
+
+  // Arbitrary rotation
+  std::vector<double> ordm(norb2, 0.0);
+  for(size_t p = 0; p < norb; ++p) ordm[p * (norb + 1)] = 2.0 / (p + 1);
+  ordm[1] = ordm[norb] = 0.1;
+  ordm[2 + 5 * norb] = ordm[5 + 2 * norb] = -0.05;
+
+  auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+  auto check_elements = [&](const generator_type& shared_gen) {
+    for(auto det : dets) {
+      REQUIRE(shared_gen.matrix_element(hf_det, det) ==
+              Approx(ham_gen.matrix_element(hf_det, det)).margin(1e-12));
+      REQUIRE(shared_gen.matrix_element(det, det) ==
+              Approx(ham_gen.matrix_element(det, det)));
+    }
+  };
+
+  SECTION("Dense") {
+    macis::mpi_shared_buffer<double> V_shared(norb4, node_comm);
+    if(node_comm.is_leader())
+      std::copy(V.begin(), V.end(), V_shared.begin());
+    node_comm.barrier();
+
+    generator_type shared_gen(
+        macis::matrix_span<double>(T_shared.data(), norb, norb),
+        macis::rank4_span<double>(V_shared.data(), norb, norb, norb, norb),
+        node_comm);
+    REQUIRE(shared_gen.node_shared_eris());
+    check_elements(shared_gen);
+
+    ham_gen.rotate_hamiltonian_ordm(ordm.data());
+    shared_gen.rotate_hamiltonian_ordm(ordm.data());
+    check_elements(shared_gen);
+    for(size_t i = 0; i < norb4; ++i)
+      REQUIRE(shared_gen.G()[i] == Approx(ham_gen.G()[i]).margin(1e-12));
+  }
+
+  SECTION("Packed") {
+    macis::mpi_shared_buffer<double> V_shared(macis::packed_rank4_size(norb),
+                                              node_comm);
+    if(node_comm.is_leader())
+      macis::pack_eris(norb, V.data(), norb, V_shared.data());
+    node_comm.barrier();
+
+    generator_type shared_gen(
+        macis::matrix_span<double>(T_shared.data(), norb, norb),
+        macis::packed_eri_span<double>(V_shared.data(), norb), node_comm);
+    REQUIRE(shared_gen.node_shared_eris());
+    REQUIRE(shared_gen.packed_eris());
+    check_elements(shared_gen);
+
+    ham_gen.rotate_hamiltonian_ordm(ordm.data());
+    shared_gen.rotate_hamiltonian_ordm(ordm.data());
+    check_elements(shared_gen);
+    for(size_t i = 0; i < norb2 * norb; ++i) {
+      REQUIRE(shared_gen.G_red()[i] ==
+              Approx(ham_gen.G_red()[i]).margin(1e-12));
+      REQUIRE(shared_gen.V_red()[i] ==
+              Approx(ham_gen.V_red()[i]).margin(1e-12));
+    }
+  }
+}
@@ -6,6 +6,10 @@
  * See LICENSE.txt for details
  */
 
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <macis/util/fcidump.hpp>
@@ -42,6 +46,81 @@ TEST_CASE("FCIDUMP") {
       REQUIRE(sum == Approx(2.701609068389e+02));
     }
 
+    SECTION("Single Pass") {
+      const size_t norb2 = norb_ref * norb_ref;
+      std::vector<double> T_ref(norb2), V_ref(norb2 * norb2);
+      macis::read_fcidump_1body(water_ccpvdz_fcidump, T_ref.data(), norb_ref);
+      macis::read_fcidump_2body(water_ccpvdz_fcidump, V_ref.data(), norb_ref);
+
+      std::vector<double> T(norb2), V(norb2 * norb2);
+      auto coreE = macis::read_fcidump(water_ccpvdz_fcidump, T.data(),
+                                       norb_ref, V.data(), norb_ref);
+      REQUIRE(coreE == Approx(9.191200742618042));
+      REQUIRE(T == T_ref);
+      REQUIRE(V == V_ref);
+
+      std::vector<double> T_packed(norb2);
+      std::vector<double> V_packed(macis::packed_rank4_size(norb_ref));
+      macis::read_fcidump(
+          water_ccpvdz_fcidump, T_packed.data(), norb_ref,
+          macis::packed_eri_span<double>(V_packed.data(), norb_ref));
+      REQUIRE(T_packed == T_ref);
+      macis::packed_eri_span<double> V_span(V_packed.data(), norb_ref);
+      for(size_t i = 0; i < norb_ref; ++i)
+        for(size_t j = 0; j < norb_ref; ++j)
+          for(size_t k = 0; k < norb_ref; ++k)
+            for(size_t l = 0; l < norb_ref; ++l)
+              REQUIRE(V_span(i, j, k, l) ==
+                      V_ref[i + j * norb_ref + k * norb2 +
+                            l * norb2 * norb_ref]);
+    }
+
+    SECTION("Header") {
+      auto header = macis::read_fcidump_header(water_ccpvdz_fcidump);
+      REQUIRE(header.norb == norb_ref);
+      REQUIRE(header.nelec == 0);
+
+      // Namelist header, integral-first lines and Fortran exponents
+      const auto fname = (std::filesystem::temp_directory_path() /
+                          ("macis_fcidump_header." + std::to_string(getpid())))
+                             .string();
+      {
+        std::ofstream file(fname);
+        file << " &FCI NORB=   3,NELEC= 2,MS2=0,\n";
+        file << "  ORBSYM=1,1,1,\n";
+        file << "  ISYM=1,\n";
+        file << " &END\n";
+        file << "  0.5D+00   1   1   2   2\n";
+        file << "  2.5D-01   3   3   1   1\n";
+        file << " -1.25E+00   1   1   0   0\n";
+        file << "\t0.75\t2   1   0   0\n";
+        file << "  1.0D+01   0   0   0   0\n";
+      }
+
+      header = macis::read_fcidump_header(fname);
+      REQUIRE(header.norb == 3);
+      REQUIRE(header.nelec == 2);
+      REQUIRE(header.ms2 == 0);
+
+      std::vector<double> T(9), V(81);
+      auto coreE = macis::read_fcidump(fname, T.data(), 3, V.data(), 3);
+      REQUIRE(coreE == 10.0);
+      REQUIRE(T[0] == -1.25);
+      REQUIRE(T[1] == 0.75);
+      REQUIRE(T[3] == 0.75);
+      REQUIRE(V[0 + 0 * 3 + 1 * 9 + 1 * 27] == 0.5);
+      REQUIRE(V[1 + 1 * 3 + 0 * 9 + 0 * 27] == 0.5);
+      REQUIRE(V[0 + 0 * 3 + 2 * 9 + 2 * 27] == 0.25);
+      REQUIRE(V[2 + 2 * 3 + 0 * 9 + 0 * 27] == 0.25);
+
+      // Dimension mismatch with NORB
+      std::vector<double> V2(16);
+      REQUIRE_THROWS(macis::read_fcidump_2body(
+          fname, macis::col_major_span<double, 4>(V2.data(), 2, 2, 2, 2)));
+
+      std::filesystem::remove(fname);
+    }
+
     SECTION("Validity Checks") {
       auto norb = norb_ref;
       size_t nocc = 5;
@@ -6,10 +6,12 @@
  * See LICENSE.txt for details
  */
 
+#include <filesystem>
 #include <iomanip>
 #include <macis/util/detail/rdm_files.hpp>
 #include <macis/util/fcidump.hpp>
 #include <macis/util/fock_matrices.hpp>
+#include <macis/util/packed_rdms.hpp>
 
 #include "ut_common.hpp"
 
@@ -226,4 +228,68 @@ TEST_CASE("Fock Matrices") {
                                                  F.data(), norb);
     REQUIRE(E == Approx(-8.5250440649419417e+01));
   }
+
+  SECTION("Packed 2RDM") {
+    NumInactive ninact(1);
+    NumActive nact(8);
+    const size_t na = nact.get();
+    const size_t ni = ninact.get();
+
+    // Read RDMs
+    size_t na2 = na * na;
+    size_t na4 = na2 * na2;
+    std::vector<double> active_1rdm(na2), active_2rdm(na4);
+    macis::read_rdms_binary(water_ccpvdz_rdms_fname, na, active_1rdm.data(),
+                            na, active_2rdm.data(), na);
+
+    std::vector<double> packed_2rdm(macis::packed_rank4_size(na));
+    macis::pack_rank4(na, active_2rdm.data(), na, packed_2rdm.data());
+
+    SECTION("Auxillary Q") {
+      std::vector<double> Q(na * norb), Q_ref(na * norb);
+      macis::aux_q_matrix(nact, NumOrbital(norb), ninact, V.data(), norb,
+                          active_2rdm.data(), na, Q_ref.data(), na);
+      macis::aux_q_matrix_packed(nact, NumOrbital(norb), ninact, V.data(),
+                                 norb, packed_2rdm.data(), Q.data(), na);
+      for(size_t i = 0; i < Q.size(); ++i)
+        REQUIRE(Q[i] == Approx(Q_ref[i]).margin(1e-12));
+    }
+
+    SECTION("Energy") {
+      const double* T_act = T.data() + ni * (norb + 1);
+      const double* V_act =
+          V.data() + ni * (1 + norb + norb2 + norb2 * norb);
+      double E_ref = 0.0;
+      for(size_t i = 0; i < na; ++i)
+        for(size_t j = 0; j < na; ++j) {
+          E_ref += active_1rdm[i + j * na] * T_act[i + j * norb];
+          for(size_t k = 0; k < na; ++k)
+            for(size_t l = 0; l < na; ++l)
+              E_ref += active_2rdm[i + j * na + k * na2 + l * na2 * na] *
+                       V_act[i + j * norb + k * norb2 + l * norb2 * norb];
+        }
+
+      auto E = macis::energy_from_packed_rdms(nact, T_act, norb, V_act, norb,
+                                              active_1rdm.data(), na,
+                                              packed_2rdm.data());
+      REQUIRE(E == Approx(E_ref));
+    }
+
+    SECTION("Binary File") {
+      auto fname = (std::filesystem::temp_directory_path() /
+                    "macis_packed_rdms.bin")
+                       .string();
+      macis::write_rdms_binary_packed(fname, na, active_1rdm.data(), na,
+                                      packed_2rdm.data());
+
+      std::vector<double> ordm(na2), trdm(na4), trdm_ref(na4);
+      macis::read_rdms_binary(fname, na, ordm.data(), na, trdm.data(), na);
+      // The file holds the permutation-averaged 2-RDM
+      macis::unpack_rank4(na, packed_2rdm.data(), trdm_ref.data(), na);
+      std::filesystem::remove(fname);
+
+      REQUIRE(ordm == active_1rdm);
+      REQUIRE(trdm == trdm_ref);
+    }
+  }
 }
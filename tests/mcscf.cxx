@@ -76,5 +76,15 @@ TEST_CASE("MCSCF") {
     REQUIRE(E == Approx(ref_E).margin(1e-7));
   }
 
+  SECTION("CASSCF - NNZ-Balanced CI") {
+    settings.ci_balance_nnz = true;
+    auto E = macis::casscf_diis(
+        settings, nalpha, nalpha, NumOrbital(norb), ninact, nact, nvirt, E_core,
+        T.data(), norb, V.data(), norb, active_ordm.data(), n_active,
+        active_trdm.data(), n_active, MPI_COMM_SELF /*b/c root only*/);
+
+    REQUIRE(E == Approx(ref_E).margin(1e-7));
+  }
+
   spdlog::drop_all();
 }
@@ -0,0 +1,158 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#include <macis/csr_hamiltonian.hpp>
+#include <macis/hamiltonian_generator/double_loop.hpp>
+#include <macis/hamiltonian_generator/residue_arrays.hpp>
+#include <macis/util/fcidump.hpp>
+#include <macis/util/rdms.hpp>
+
+#include "ut_common.hpp"
+
+TEST_CASE("Residue Arrays") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  size_t norb = macis::read_fcidump_norb(water_ccpvdz_fcidump);
+  const auto norb2 = norb * norb;
+  const auto norb4 = norb2 * norb2;
+  size_t nocc = 5;
+
+  std::vector<double> T(norb * norb);
+  std::vector<double> V(norb4);
+  macis::read_fcidump_1body(water_ccpvdz_fcidump, T.data(), norb);
+  macis::read_fcidump_2body(water_ccpvdz_fcidump, V.data(), norb);
+
+  macis::matrix_span<double> T_span(T.data(), norb, norb);
+  macis::rank4_span<double> V_span(V.data(), norb, norb, norb, norb);
+
+  macis::DoubleLoopHamiltonianGenerator<64> ref_gen(T_span, V_span);
+  macis::ResidueArraysHamiltonianGenerator<64> ham_gen(T_span, V_span);
+
+  // Generate configuration space
+  const auto hf_det = macis::canonical_hf_determinant<64>(nocc, nocc);
+  auto dets = macis::generate_cisd_hilbert_space(norb, hf_det);
+
+  auto H_ref = macis::make_csr_hamiltonian_block<int32_t>(
+      dets.begin(), dets.end(), dets.begin(), dets.end(), ref_gen, 1e-16);
+
+  SECTION("CSR Hamiltonian") {
+    // Batch the ket residues to exercise the column concatenation
+    auto max_res = GENERATE(1ul << 24, 1ul << 14);
+    ham_gen.set_max_residues(max_res);
+
+    auto H = macis::make_csr_hamiltonian_block<int32_t>(
+        dets.begin(), dets.end(), dets.begin(), dets.end(), ham_gen, 1e-16);
+
+    REQUIRE(H.m() == H_ref.m());
+    REQUIRE(H.n() == H_ref.n());
+    REQUIRE(H.rowptr() == H_ref.rowptr());
+    REQUIRE(H.colind() == H_ref.colind());
+    REQUIRE(H.nzval() == H_ref.nzval());
+  }
+
+  SECTION("Off-Diagonal Block") {
+    // Zeroed dets carry no connections
+    auto ket_dets = dets;
+    const size_t nbra = dets.size() / 3;
+    std::fill(ket_dets.begin(), ket_dets.begin() + nbra, 0);
+
+    auto H = macis::make_csr_hamiltonian_block<int64_t>(
+        dets.begin(), dets.begin() + nbra, ket_dets.begin(), ket_dets.end(),
+        ham_gen, 1e-16);
+    auto H_ref_blk = macis::make_csr_hamiltonian_block<int64_t>(
+        dets.begin(), dets.begin() + nbra, ket_dets.begin(), ket_dets.end(),
+        ref_gen, 1e-16);
+
+    REQUIRE(H.rowptr() == H_ref_blk.rowptr());
+    REQUIRE(H.colind() == H_ref_blk.colind());
+    REQUIRE(H.nzval() == H_ref_blk.nzval());
+  }
+
+  SECTION("Cached Connectivity") {
+    ham_gen.cache_connectivity(dets.begin(), dets.end(), dets.begin(),
+                               dets.end());
+
+    // Blocks within the cached ranges reuse the cached connectivity
+    const size_t ndets = dets.size();
+    const size_t bra_st = ndets / 4, bra_en = ndets / 2;
+    const size_t ket_st = ndets / 3;
+    for(int i = 0; i < 2; ++i) {
+      auto H = macis::make_csr_hamiltonian_block<int32_t>(
+          dets.begin() + bra_st, dets.begin() + bra_en, dets.begin() + ket_st,
+          dets.end(), ham_gen, 1e-16);
+      auto H_ref_blk = macis::make_csr_hamiltonian_block<int32_t>(
+          dets.begin() + bra_st, dets.begin() + bra_en, dets.begin() + ket_st,
+          dets.end(), ref_gen, 1e-16);
+
+      REQUIRE(H.rowptr() == H_ref_blk.rowptr());
+      REQUIRE(H.colind() == H_ref_blk.colind());
+      REQUIRE(H.nzval() == H_ref_blk.nzval());
+    }
+
+    // Blocks outside of the cached ranges are generated on the fly
+    auto ket_dets = dets;
+    auto H = macis::make_csr_hamiltonian_block<int32_t>(
+        dets.begin(), dets.end(), ket_dets.begin(), ket_dets.end(), ham_gen,
+        1e-16);
+    REQUIRE(H.rowptr() == H_ref.rowptr());
+    REQUIRE(H.colind() == H_ref.colind());
+    REQUIRE(H.nzval() == H_ref.nzval());
+
+    ham_gen.release_connectivity();
+  }
+
+  SECTION("RDM") {
+    std::vector<double> C(dets.size());
+    for(size_t i = 0; i < C.size(); ++i) C[i] = 1. / (i + 1);
+    auto c_nrm = blas::nrm2(C.size(), C.data(), 1);
+    blas::scal(C.size(), 1. / c_nrm, C.data(), 1);
+
+    std::vector<double> ordm(norb2, 0.0), trdm(norb4, 0.0);
+    std::vector<double> ordm_ref(norb2, 0.0), trdm_ref(norb4, 0.0);
+
+    ham_gen.set_max_residues(1ul << 14);
+    ham_gen.form_rdms(
+        dets.begin(), dets.end(), dets.begin(), dets.end(), C.data(),
+        macis::matrix_span<double>(ordm.data(), norb, norb),
+        macis::rank4_span<double>(trdm.data(), norb, norb, norb, norb));
+
+    // All-pairs reference
+    macis::matrix_span<double> ordm_ref_span(ordm_ref.data(), norb, norb);
+    macis::rank4_span<double> trdm_ref_span(trdm_ref.data(), norb, norb, norb,
+                                            norb);
+    for(size_t i = 0; i < dets.size(); ++i) {
+      const auto bra = dets[i];
+      const auto bra_alpha = macis::bitset_lo_word(bra);
+      const auto bra_beta = macis::bitset_hi_word(bra);
+      std::vector<uint32_t> occ_alpha, occ_beta;
+      macis::bits_to_indices(bra_alpha, occ_alpha);
+      macis::bits_to_indices(bra_beta, occ_beta);
+      for(size_t j = 0; j < dets.size(); ++j) {
+        const auto ex = bra ^ dets[j];
+        if(ex.count() > 4) continue;
+        macis::rdm_contributions(
+            bra_alpha, macis::bitset_lo_word(dets[j]),
+            macis::bitset_lo_word(ex), bra_beta,
+            macis::bitset_hi_word(dets[j]), macis::bitset_hi_word(ex),
+            occ_alpha, occ_beta, C[i] * C[j], ordm_ref_span, trdm_ref_span);
+      }
+    }
+
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(ordm[i] == Approx(ordm_ref[i]).margin(1e-12));
+    for(size_t i = 0; i < norb4; ++i)
+      REQUIRE(trdm[i] == Approx(trdm_ref[i]).margin(1e-12));
+
+    // 1RDM only
+    ham_gen.form_ordm(dets.begin(), dets.end(), C.data(),
+                      macis::matrix_span<double>(ordm.data(), norb, norb),
+                      MPI_COMM_SELF);
+    for(size_t i = 0; i < norb2; ++i)
+      REQUIRE(ordm[i] == Approx(ordm_ref[i]).margin(1e-12));
+  }
+}
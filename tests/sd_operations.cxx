@@ -84,6 +84,25 @@ TEST_CASE("Slater Det Operations") {
     }
   }
 
+  SECTION("Excitation Sign") {
+    std::bitset<128> state(0b10110);
+    REQUIRE(macis::single_excitation_sign(state, 0, 5) == -1.0);
+    REQUIRE(macis::single_excitation_sign(state, 4, 1) == -1.0);
+    REQUIRE(macis::single_excitation_sign(state, 1, 2) == 1.0);
+    REQUIRE(macis::single_excitation_sign(state, 0, 4) == 1.0);
+    REQUIRE(macis::single_excitation_sign(state << 60, 60, 65) == -1.0);
+    REQUIRE(macis::single_excitation_sign(state << 60, 64, 61) == -1.0);
+
+    std::bitset<64> ket(0b0011), bra(0b1100);
+    auto [o1, v1, o2, v2, sign] =
+        macis::doubles_sign_indices(bra, ket, bra ^ ket);
+    REQUIRE(o1 == 0);
+    REQUIRE(v1 == 2);
+    REQUIRE(o2 == 1);
+    REQUIRE(v2 == 3);
+    REQUIRE(sign == 1.0);
+  }
+
   SECTION("Doubles") {
     SECTION("Single Spin") {
       std::vector<std::bitset<64>> ref_doubles = {
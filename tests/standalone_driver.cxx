@@ -17,8 +17,9 @@
 #include <iostream>
 #include <macis/asci/grow.hpp>
 #include <macis/asci/refine.hpp>
-#include <macis/hamiltonian_generator/double_loop.hpp>
+#include <macis/hamiltonian_generator/dispatch.hpp>
 #include <macis/util/cas.hpp>
+#include <macis/util/cholesky.hpp>
 #include <macis/util/detail/rdm_files.hpp>
 #include <macis/util/fcidump.hpp>
 #include <macis/util/fock_matrices.hpp>
@@ -26,6 +27,7 @@
 #include <macis/util/moller_plesset.hpp>
 #include <macis/util/mpi.hpp>
 #include <macis/util/transform.hpp>
+#include <macis/util/wfn_width.hpp>
 #include <macis/wavefunction_io.hpp>
 #include <map>
 #include <sparsexx/io/write_dist_mm.hpp>
@@ -35,6 +37,7 @@
 using macis::NumActive;
 using macis::NumCanonicalOccupied;
 using macis::NumCanonicalVirtual;
+using macis::NumCholeskyVector;
 using macis::NumElectron;
 using macis::NumInactive;
 using macis::NumOrbital;
@@ -49,9 +52,10 @@ std::map<std::string, Job> job_map = {{"CI", Job::CI}, {"MCSCF", Job::MCSCF}};
 std::map<std::string, CIExpansion> ci_exp_map = {{"CAS", CIExpansion::CAS},
                                                  {"ASCI", CIExpansion::ASCI}};
 
-template <typename T>
-T vec_sum(const std::vector<T>& x) {
-  return std::accumulate(x.begin(), x.end(), T(0));
+template <typename Container>
+auto vec_sum(const Container& x) {
+  using value_type = typename Container::value_type;
+  return std::accumulate(x.begin(), x.end(), value_type(0));
 }
 
 int main(int argc, char** argv) {
@@ -62,8 +66,6 @@ int main(int argc, char** argv) {
   spdlog::cfg::load_env_levels();
   spdlog::set_pattern("[%n] %v");
 
-  constexpr size_t nwfn_bits = 64;
-
   MPI_Init(&argc, &argv);
 
   auto world_rank = macis::comm_rank(MPI_COMM_WORLD);
@@ -93,12 +95,6 @@ int main(int argc, char** argv) {
     size_t norb3 = norb2 * norb;
     size_t norb4 = norb2 * norb2;
 
-    // XXX: Consider reading this into shared memory to avoid replication
-    std::vector<double> T(norb2), V(norb4);
-    auto E_core = macis::read_fcidump_core(fcidump_fname);
-    macis::read_fcidump_1body(fcidump_fname, T.data(), norb);
-    macis::read_fcidump_2body(fcidump_fname, V.data(), norb);
-
 #define OPT_KEYWORD(STR, RES, DTYPE) \
   if(input.containsData(STR)) {      \
     RES = input.getData<DTYPE>(STR); \
@@ -142,7 +138,52 @@ int main(int argc, char** argv) {
     OPT_KEYWORD("CI.RDMFILE", rdm_fname, std::string);
     OPT_KEYWORD("CI.FCIDUMP_OUT", fci_out_fname, std::string);
 
-    if(n_active > nwfn_bits / 2) throw std::runtime_error("Not Enough Bits");
+    // 8-fold symmetry packed active space ERIs (ASCI)
+    bool packed_eris = false;
+    OPT_KEYWORD("CI.PACKED_ERIS", packed_eris, bool);
+
+    // Cholesky decomposed ERIs (decomposition threshold, 0 = dense ERIs)
+    double cholesky_tol = 0.0;
+    OPT_KEYWORD("CI.CHOLESKY_TOL", cholesky_tol, double);
+    const bool cholesky = cholesky_tol > 0.0;
+
+    // Two-body integrals are held in node-shared memory, which is only
+    // written by the node leaders
+    macis::mpi_node_comm node_comm(MPI_COMM_WORLD);
+
+    // Read integrals on the node leaders, the two-body integrals either
+    // dense or as Cholesky vectors decomposed from the 8-fold symmetry
+    // packed ERIs. One-body integrals are replicated on every rank.
+    std::vector<double> T(norb2);
+    double E_core = 0.0;
+    macis::mpi_shared_buffer<double> V, L;
+    size_t naux = 0;
+    if(cholesky) {
+      std::vector<double> L_leader;
+      if(node_comm.is_leader()) {
+        std::vector<double> V_packed(macis::packed_rank4_size(norb));
+        E_core = macis::read_fcidump(
+            fcidump_fname, T.data(), norb,
+            macis::packed_eri_span<double>(V_packed.data(), norb));
+        L_leader = macis::cholesky_decompose_packed_eris(
+            NumOrbital(norb), V_packed.data(), cholesky_tol);
+        naux = L_leader.size() / norb2;
+      }
+      macis::bcast(&naux, 1, 0, node_comm.node());
+      L = macis::mpi_shared_buffer<double>(naux * norb2, node_comm);
+      std::copy(L_leader.begin(), L_leader.end(), L.begin());
+    } else {
+      V = macis::mpi_shared_buffer<double>(norb4, node_comm);
+      if(node_comm.is_leader())
+        E_core = macis::read_fcidump(fcidump_fname, T.data(), norb, V.data(),
+                                     norb);
+    }
+    macis::bcast(T.data(), norb2, 0, node_comm.node());
+    macis::bcast(&E_core, 1, 0, node_comm.node());
+    node_comm.barrier();
+
+    // Smallest determinant width which holds the active space
+    const size_t wfn_width = macis::select_wfn_width(n_active);
 
     // MCSCF Settings
     macis::MCSCFSettings mcscf_settings;
@@ -160,6 +201,16 @@ int main(int argc, char** argv) {
     OPT_KEYWORD("MCSCF.CI_RES_TOL", mcscf_settings.ci_res_tol, double);
     OPT_KEYWORD("MCSCF.CI_MAX_SUB", mcscf_settings.ci_max_subspace, size_t);
     OPT_KEYWORD("MCSCF.CI_MATEL_TOL", mcscf_settings.ci_matel_tol, double);
+    OPT_KEYWORD("MCSCF.CI_BALANCE_NNZ", mcscf_settings.ci_balance_nnz, bool);
+    OPT_KEYWORD("MCSCF.CI_UPPER_H", mcscf_settings.ci_upper_h, bool);
+    OPT_KEYWORD("MCSCF.CI_DIRECT_H", mcscf_settings.ci_direct_h, bool);
+    OPT_KEYWORD("MCSCF.CI_MIXED_H", mcscf_settings.ci_mixed_h, bool);
+    OPT_KEYWORD("MCSCF.CI_COMPRESSED_H", mcscf_settings.ci_compressed_h, bool);
+    OPT_KEYWORD("MCSCF.CI_H_CHECKPOINT", mcscf_settings.ci_h_checkpoint,
+                std::string);
+    std::string ham_gen_str = "DOUBLE_LOOP";
+    OPT_KEYWORD("MCSCF.CI_HAM_GEN", ham_gen_str, std::string);
+    mcscf_settings.ci_ham_gen = macis::hamiltonian_generator_type(ham_gen_str);
 
     // ASCI Settings
     macis::ASCISettings asci_settings;
@@ -177,6 +228,7 @@ int main(int argc, char** argv) {
     OPT_KEYWORD("ASCI.REFINE_ETOL", asci_settings.refine_energy_tol, double);
     OPT_KEYWORD("ASCI.GROW_WITH_ROT", asci_settings.grow_with_rot, bool);
     OPT_KEYWORD("ASCI.ROT_SIZE_START", asci_settings.rot_size_start, size_t);
+    OPT_KEYWORD("ASCI.LOCALITY_ORDER", asci_settings.locality_order, bool);
     // OPT_KEYWORD("ASCI.DIST_TRIP_RAND",  asci_settings.dist_triplet_random,
     // bool );
     OPT_KEYWORD("ASCI.CONSTRAINT_LVL", asci_settings.constraint_level, int);
@@ -194,10 +246,17 @@ int main(int argc, char** argv) {
       console->info("[Wavefunction Data]:");
       console->info("  * JOB     = {}", job_str);
       console->info("  * CIEXP   = {}", ciexp_str);
+      console->info("  * HAM_GEN = {}", ham_gen_str);
       console->info("  * FCIDUMP = {}", fcidump_fname);
       if(fci_out_fname.size())
         console->info("  * FCIDUMP_OUT = {}", fci_out_fname);
       console->info("  * MP2_GUESS = {}", mp2_guess);
+      console->info("  * NWFN_BITS = {}", wfn_width);
+      console->info("  * PACKED_ERIS = {}", packed_eris);
+      if(cholesky) {
+        console->info("  * CHOLESKY_TOL = {:.2e}", cholesky_tol);
+        console->info("  * NCHOLESKY = {}", naux);
+      }
 
       console->debug("READ {} 1-body integrals and {} 2-body integrals",
                      T.size(), V.size());
@@ -206,6 +265,7 @@ int main(int argc, char** argv) {
       console->debug("VSUM  = {:.12f}", vec_sum(V));
       console->info("TMEM   = {:.2e} GiB", macis::to_gib(T));
       console->info("VMEM   = {:.2e} GiB", macis::to_gib(V));
+      if(cholesky) console->info("LMEM   = {:.2e} GiB", macis::to_gib(L));
     }
 
     // Setup printing
@@ -237,31 +297,96 @@ int main(int argc, char** argv) {
       // Compute MP2 Natural Orbitals
       std::vector<double> MP2_RDM(norb * norb, 0.0);
       std::vector<double> W_occ(norb);
-      macis::mp2_natural_orbitals(
-          NumOrbital(norb), NumCanonicalOccupied(nocc_canon),
-          NumCanonicalVirtual(nvir_canon), T.data(), norb, V.data(), norb,
-          W_occ.data(), MP2_RDM.data(), norb);
-
-      // Transform Hamiltonian
+      if(cholesky)
+        macis::mp2_natural_orbitals_cholesky(
+            NumOrbital(norb), NumCanonicalOccupied(nocc_canon),
+            NumCanonicalVirtual(nvir_canon), NumCholeskyVector(naux),
+            T.data(), norb, L.data(), norb, W_occ.data(), MP2_RDM.data(),
+            norb);
+      else
+        macis::mp2_natural_orbitals(
+            NumOrbital(norb), NumCanonicalOccupied(nocc_canon),
+            NumCanonicalVirtual(nvir_canon), T.data(), norb, V.data(), norb,
+            W_occ.data(), MP2_RDM.data(), norb);
+
+      // Transform Hamiltonian (node-shared integrals by the node leaders)
       macis::two_index_transform(norb, norb, T.data(), norb, MP2_RDM.data(),
                                  norb, T.data(), norb);
-      macis::four_index_transform(norb, norb, V.data(), norb, MP2_RDM.data(),
-                                  norb, V.data(), norb);
+      node_comm.barrier();
+      if(node_comm.is_leader()) {
+        if(cholesky)
+          macis::cholesky_transform(norb, norb, naux, L.data(), norb,
+                                    MP2_RDM.data(), norb, L.data(), norb);
+        else
+          macis::four_index_transform(norb, norb, V.data(), norb,
+                                      MP2_RDM.data(), norb, V.data(), norb);
+      }
+      node_comm.barrier();
     }
 
-    // Copy integrals into active subsets
+    // Copy integrals into active subsets. ASCI with packed ERIs never forms
+    // the dense active ERIs, they are packed directly from the full integrals
+    const bool packed_active =
+        packed_eris and job == Job::CI and ci_exp != CIExpansion::CAS;
     std::vector<double> T_active(n_active * n_active);
-    std::vector<double> V_active(n_active * n_active * n_active * n_active);
-
-    // Compute active-space Hamiltonian and inactive Fock matrix
+    macis::mpi_shared_buffer<double> V_active, V_packed;
+    if(packed_active)
+      V_packed = macis::mpi_shared_buffer<double>(
+          macis::packed_rank4_size(n_active), node_comm);
+    else
+      V_active = macis::mpi_shared_buffer<double>(
+          n_active * n_active * n_active * n_active, node_comm);
+
+    // Compute inactive Fock matrix and active-space Hamiltonian, the active
+    // ERIs are extracted by the node leaders
     std::vector<double> F_inactive(norb2);
-    macis::active_hamiltonian(NumOrbital(norb), NumActive(n_active),
-                              NumInactive(n_inactive), T.data(), norb, V.data(),
-                              norb, F_inactive.data(), norb, T_active.data(),
-                              n_active, V_active.data(), n_active);
+    if(cholesky)
+      macis::inactive_fock_matrix_cholesky(
+          NumOrbital(norb), NumInactive(n_inactive), NumCholeskyVector(naux),
+          T.data(), norb, L.data(), norb, F_inactive.data(), norb);
+    else
+      macis::inactive_fock_matrix(NumOrbital(norb), NumInactive(n_inactive),
+                                  T.data(), norb, V.data(), norb,
+                                  F_inactive.data(), norb);
+    macis::active_submatrix_1body(NumActive(n_active), NumInactive(n_inactive),
+                                  F_inactive.data(), norb, T_active.data(),
+                                  n_active);
+    if(node_comm.is_leader()) {
+      if(packed_active) {
+        if(cholesky)
+          macis::cholesky_to_packed_eris(
+              NumOrbital(n_active), NumCholeskyVector(naux),
+              L.data() + n_inactive * (norb + 1), norb, V_packed.data());
+        else {
+          const size_t act_off =
+              n_inactive * (1 + norb + norb2 + norb2 * norb);
+          macis::pack_eris(n_active, V.data() + act_off, norb,
+                           V_packed.data());
+        }
+      } else if(cholesky)
+        macis::active_subtensor_2body_cholesky(
+            NumActive(n_active), NumInactive(n_inactive),
+            NumCholeskyVector(naux), L.data(), norb, V_active.data(),
+            n_active);
+      else
+        macis::active_subtensor_2body(NumActive(n_active),
+                                      NumInactive(n_inactive), V.data(), norb,
+                                      V_active.data(), n_active);
+    }
+    node_comm.barrier();
+
+    // The full two-body integrals are only needed past this point to write
+    // the FCIDUMP, release them beside the packed active ERIs
+    if(packed_active and fci_out_fname.empty()) {
+      V = macis::mpi_shared_buffer<double>();
+      L = macis::mpi_shared_buffer<double>();
+    }
 
     console->debug("FINACTIVE_SUM = {:.12f}", vec_sum(F_inactive));
-    console->debug("VACTIVE_SUM   = {:.12f}", vec_sum(V_active));
+    if(packed_active)
+      console->debug("VPACKED_SUM   = {:.12f}", vec_sum(V_packed));
+    else
+      console->debug("VACTIVE_SUM   = {:.12f}", vec_sum(V_active));
     console->debug("TACTIVE_SUM   = {:.12f}", vec_sum(T_active));
 
     // Compute Inactive energy
@@ -277,102 +402,137 @@ int main(int argc, char** argv) {
 
     // CI
     if(job == Job::CI) {
-      using generator_t = macis::DoubleLoopHamiltonianGenerator<nwfn_bits>;
-      if(ci_exp == CIExpansion::CAS) {
-        std::vector<double> C_local;
-        // TODO: VERIFY MPI + CAS
-        E0 = macis::CASRDMFunctor<generator_t>::rdms(
-            mcscf_settings, NumOrbital(n_active), nalpha, nbeta,
-            T_active.data(), V_active.data(), active_ordm.data(),
-            active_trdm.data(), C_local, MPI_COMM_WORLD);
-        E0 += E_inactive + E_core;
-
-        if(print_determinants) {
-          auto det_logger = world_rank
-                                ? spdlog::null_logger_mt("determinants")
-                                : spdlog::stdout_color_mt("determinants");
-          det_logger->info("Print leading determinants > {:.12f}",
-                           determinants_threshold);
-          auto dets = macis::generate_hilbert_space<generator_t::nbits>(
-              n_active, nalpha, nbeta);
-          for(size_t i = 0; i < dets.size(); ++i) {
-            if(std::abs(C_local[i]) > determinants_threshold) {
-              det_logger->info("{:>16.12f}   {}", C_local[i],
-                               macis::to_canonical_string(dets[i]));
+      auto run_ci = [&](auto gen) {
+        using generator_t = typename decltype(gen)::type;
+        constexpr size_t nwfn_bits = generator_t::nbits;
+        if(ci_exp == CIExpansion::CAS) {
+          std::vector<double> C_local;
+          // TODO: VERIFY MPI + CAS
+          E0 = macis::CASRDMFunctor<generator_t>::rdms(
+              mcscf_settings, NumOrbital(n_active), nalpha, nbeta,
+              T_active.data(), V_active.data(), active_ordm.data(),
+              active_trdm.data(), C_local, MPI_COMM_WORLD);
+          E0 += E_inactive + E_core;
+
+          if(print_determinants) {
+            auto det_logger = world_rank
+                                  ? spdlog::null_logger_mt("determinants")
+                                  : spdlog::stdout_color_mt("determinants");
+            det_logger->info("Print leading determinants > {:.12f}",
+                             determinants_threshold);
+            auto dets = macis::generate_hilbert_space<generator_t::nbits>(
+                n_active, nalpha, nbeta);
+            for(size_t i = 0; i < dets.size(); ++i) {
+              if(std::abs(C_local[i]) > determinants_threshold) {
+                det_logger->info("{:>16.12f}   {}", C_local[i],
+                                 macis::to_canonical_string(dets[i]));
+              }
             }
           }
-        }
 
-      } else {
-        // Generate the Hamiltonian Generator
-        generator_t ham_gen(
-            macis::matrix_span<double>(T_active.data(), n_active, n_active),
-            macis::rank4_span<double>(V_active.data(), n_active, n_active,
-                                      n_active, n_active));
-
-        std::vector<macis::wfn_t<nwfn_bits>> dets;
-        std::vector<double> C;
-        if(asci_wfn_fname.size()) {
-          // Read wave function from standard file
-          console->info("Reading Guess Wavefunction From {}", asci_wfn_fname);
-          macis::read_wavefunction(asci_wfn_fname, dets, C);
-          // std::cout << dets[0].to_ullong() << std::endl;
-          if(compute_asci_E0) {
-            console->info("*  Calculating E0");
-            E0 = 0;
-            for(auto ii = 0; ii < dets.size(); ++ii) {
-              double tmp = 0.0;
-              for(auto jj = 0; jj < dets.size(); ++jj) {
-                tmp += ham_gen.matrix_element(dets[ii], dets[jj]) * C[jj];
+        } else {
+          // Generate the Hamiltonian Generator (over node-shared ERIs)
+          macis::matrix_span<double> T_span(T_active.data(), n_active,
+                                            n_active);
+          generator_t ham_gen =
+              packed_active
+                  ? generator_t(T_span,
+                                macis::packed_eri_span<double>(V_packed.data(),
+                                                               n_active),
+                                node_comm)
+                  : generator_t(T_span,
+                                macis::rank4_span<double>(
+                                    V_active.data(), n_active, n_active,
+                                    n_active, n_active),
+                                node_comm);
+
+          std::vector<macis::wfn_t<nwfn_bits>> dets;
+          std::vector<double> C;
+          if(asci_wfn_fname.size()) {
+            // Read wave function from standard file
+            console->info("Reading Guess Wavefunction From {}", asci_wfn_fname);
+            macis::read_wavefunction(asci_wfn_fname, dets, C);
+            // std::cout << dets[0].to_ullong() << std::endl;
+            if(mcscf_settings.ci_h_checkpoint.size()) {
+              // Restart: rediagonalize in the read determinant space, the
+              // Hamiltonian is reloaded from the checkpoint if it matches
+              console->info("*  Rediagonalizing (H_CHECKPOINT = {})",
+                            mcscf_settings.ci_h_checkpoint);
+              std::vector<double> C_local;
+              E0 = macis::selected_ci_diag<nwfn_bits, int32_t>(
+                  dets.begin(), dets.end(), ham_gen,
+                  mcscf_settings.ci_matel_tol, mcscf_settings.ci_max_subspace,
+                  mcscf_settings.ci_res_tol, C_local, MPI_COMM_WORLD, false,
+                  nullptr, mcscf_settings.ci_balance_nnz,
+                  mcscf_settings.ci_upper_h, mcscf_settings.ci_h_checkpoint,
+                  mcscf_settings.ci_direct_h, mcscf_settings.ci_mixed_h,
+                  mcscf_settings.ci_compressed_h);
+              C = world_size > 1 ? macis::allgatherv(C_local, MPI_COMM_WORLD)
+                                 : std::move(C_local);
+            } else if(compute_asci_E0) {
+              console->info("*  Calculating E0");
+              E0 = 0;
+              for(auto ii = 0; ii < dets.size(); ++ii) {
+                double tmp = 0.0;
+                for(auto jj = 0; jj < dets.size(); ++jj) {
+                  tmp += ham_gen.matrix_element(dets[ii], dets[jj]) * C[jj];
+                }
+                E0 += C[ii] * tmp;
               }
-              E0 += C[ii] * tmp;
+            } else {
+              console->info("*  Reading E0");
+              E0 = asci_E0 - E_core - E_inactive;
             }
           } else {
-            console->info("*  Reading E0");
-            E0 = asci_E0 - E_core - E_inactive;
+            // HF Guess
+            console->info("Generating HF Guess for ASCI");
+            dets = {macis::canonical_hf_determinant<nwfn_bits>(nalpha, nalpha)};
+            // std::cout << dets[0].to_ullong() << std::endl;
+            E0 = ham_gen.matrix_element(dets[0], dets[0]);
+            C = {1.0};
           }
-        } else {
-          // HF Guess
-          console->info("Generating HF Guess for ASCI");
-          dets = {macis::canonical_hf_determinant<nwfn_bits>(nalpha, nalpha)};
-          // std::cout << dets[0].to_ullong() << std::endl;
-          E0 = ham_gen.matrix_element(dets[0], dets[0]);
-          C = {1.0};
-        }
-        console->info("ASCI Guess Size = {}", dets.size());
-        console->info("ASCI E0 = {:.10e}", E0 + E_core + E_inactive);
+          console->info("ASCI Guess Size = {}", dets.size());
+          console->info("ASCI E0 = {:.10e}", E0 + E_core + E_inactive);
 
-        // Perform the ASCI calculation
-        auto asci_st = hrt_t::now();
+          // Perform the ASCI calculation
+          auto asci_st = hrt_t::now();
 
-        // Growth phase
-        std::tie(E0, dets, C) =
-            macis::asci_grow(asci_settings, mcscf_settings, E0, std::move(dets),
-                             std::move(C), ham_gen, n_active, MPI_COMM_WORLD);
-
-        // Refinement phase
-        if(asci_settings.max_refine_iter) {
-          std::tie(E0, dets, C) = macis::asci_refine(
+          // Growth phase
+          std::tie(E0, dets, C) = macis::asci_grow(
               asci_settings, mcscf_settings, E0, std::move(dets), std::move(C),
               ham_gen, n_active, MPI_COMM_WORLD);
-        }
-        E0 += E_inactive + E_core;
-        auto asci_en = hrt_t::now();
-        dur_t asci_dur = asci_en - asci_st;
-        console->info("* ASCI_DUR = {:.2e} ms", asci_dur.count());
-
-        if(asci_wfn_out_fname.size() and !world_rank) {
-          console->info("Writing ASCI Wavefunction to {}", asci_wfn_out_fname);
-          macis::write_wavefunction(asci_wfn_out_fname, n_active, dets, C);
-        }
 
-        // Dump Hamiltonian
-        if(0) {
-          auto H = macis::make_dist_csr_hamiltonian<int64_t>(
-              MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16);
-          sparsexx::write_dist_mm("ham.mtx", H, 1);
+          // Refinement phase
+          if(asci_settings.max_refine_iter) {
+            std::tie(E0, dets, C) = macis::asci_refine(
+                asci_settings, mcscf_settings, E0, std::move(dets),
+                std::move(C), ham_gen, n_active, MPI_COMM_WORLD);
+          }
+          E0 += E_inactive + E_core;
+          auto asci_en = hrt_t::now();
+          dur_t asci_dur = asci_en - asci_st;
+          console->info("* ASCI_DUR = {:.2e} ms", asci_dur.count());
+
+          if(asci_wfn_out_fname.size() and !world_rank) {
+            console->info("Writing ASCI Wavefunction to {}",
+                          asci_wfn_out_fname);
+            macis::write_wavefunction(asci_wfn_out_fname, n_active, dets, C);
+          }
+
+          // Dump Hamiltonian
+          if(0) {
+            auto H = macis::make_dist_csr_hamiltonian<int64_t>(
+                MPI_COMM_WORLD, dets.begin(), dets.end(), ham_gen, 1e-16);
+            sparsexx::write_dist_mm("ham.mtx", H, 1);
+          }
         }
-      }
+      };
+
+      // Smallest determinant width which holds the active space
+      macis::dispatch_wfn_width(n_active, [&](auto nbits) {
+        macis::dispatch_hamiltonian_generator<decltype(nbits)::value>(
+            mcscf_settings.ci_ham_gen, run_ci);
+      });
 
       // MCSCF
     } else if(job == Job::MCSCF) {
@@ -398,20 +558,36 @@ int main(int argc, char** argv) {
       }
 
       // CASSCF
-      E0 = macis::casscf_diis(mcscf_settings, NumElectron(nalpha),
-                              NumElectron(nbeta), NumOrbital(norb),
-                              NumInactive(n_inactive), NumActive(n_active),
-                              NumVirtual(n_virtual), E_core, T.data(), norb,
-                              V.data(), norb, active_ordm.data(), n_active,
-                              active_trdm.data(), n_active, MPI_COMM_WORLD);
+      if(cholesky)
+        E0 = macis::casscf_diis_cholesky(
+            mcscf_settings, NumElectron(nalpha), NumElectron(nbeta),
+            NumOrbital(norb), NumInactive(n_inactive), NumActive(n_active),
+            NumVirtual(n_virtual), E_core, T.data(), norb,
+            NumCholeskyVector(naux), L.data(), norb, active_ordm.data(),
+            n_active, active_trdm.data(), n_active, MPI_COMM_WORLD);
+      else
+        E0 = macis::casscf_diis(mcscf_settings, NumElectron(nalpha),
+                                NumElectron(nbeta), NumOrbital(norb),
+                                NumInactive(n_inactive), NumActive(n_active),
+                                NumVirtual(n_virtual), E_core, T.data(), norb,
+                                V.data(), norb, active_ordm.data(), n_active,
+                                active_trdm.data(), n_active, MPI_COMM_WORLD);
     }
 
     console->info("E(CI)  = {:.12f} Eh", E0);
 
     // Write FCIDUMP file if requested
-    if(fci_out_fname.size())
+    if(fci_out_fname.size()) {
+      if(cholesky) {
+        V = macis::mpi_shared_buffer<double>(norb4, node_comm);
+        if(node_comm.is_leader())
+          macis::cholesky_to_eris(NumOrbital(norb), NumCholeskyVector(naux),
+                                  L.data(), norb, V.data(), norb);
+        node_comm.barrier();
+      }
       macis::write_fcidump(fci_out_fname, norb, T.data(), norb, V.data(), norb,
                            E_core);
+    }
 
   }  // MPI Scope
 
@@ -7,6 +7,7 @@
  */
 
 #include <algorithm>
+#include <macis/util/packed_eris.hpp>
 #include <macis/util/transform.hpp>
 
 #include "ut_common.hpp"
@@ -186,3 +187,26 @@ TEST_CASE("Four Index Transform") {
     for(auto i = 0; i < m4; ++i) REQUIRE(B[i] == Approx(refB[i]));
   }
 }
+
+TEST_CASE("Packed Four Index Transform") {
+  size_t n = 4;
+  size_t n2 = n * n;
+  size_t n4 = n2 * n2;
+
+  // 8-fold symmetric tensor
+  std::vector<double> P(macis::packed_rank4_size(n)), A(n4);
+  std::iota(P.begin(), P.end(), 1);
+  macis::unpack_eris(n, P.data(), A.data(), n);
+
+  // General (non-orthogonal) transformation
+  std::vector<double> C(n2);
+  for(size_t i = 0; i < n; ++i)
+    for(size_t j = 0; j < n; ++j) TWO_IDX(C, i, j, n) = 0.1 * (i + 2 * j) - 0.3;
+
+  std::vector<double> B(n4), refP(P.size());
+  macis::four_index_transform(n, n, A.data(), n, C.data(), n, B.data(), n);
+  macis::pack_eris(n, B.data(), n, refP.data());
+
+  macis::four_index_transform_packed(n, P.data(), C.data(), n);
+  for(size_t i = 0; i < P.size(); ++i) REQUIRE(P[i] == Approx(refP[i]));
+}
@@ -0,0 +1,54 @@
+/*
+ * MACIS Copyright (c) 2023, The Regents of the University of California,
+ * through Lawrence Berkeley National Laboratory (subject to receipt of
+ * any required approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * See LICENSE.txt for details
+ */
+
+#include <macis/sd_operations.hpp>
+#include <macis/wfn_index_map.hpp>
+
+#include "ut_common.hpp"
+
+template <size_t N>
+void wfn_index_map_test() {
+  auto dets = macis::generate_hilbert_space<N>(8, 3, 3);
+  macis::wfn_index_map<N> index(dets);
+  REQUIRE(index.size() == dets.size());
+  REQUIRE(index.capacity() >= 2 * dets.size());
+
+  for(size_t i = 0; i < dets.size(); ++i)
+    REQUIRE(size_t(index.find(dets[i])) == i);
+
+  // Determinants outside of the list
+  auto absent = macis::canonical_hf_determinant<N>(4, 3);
+  REQUIRE(index.find(absent) == index.npos);
+  REQUIRE_FALSE(index.contains(absent));
+  REQUIRE_FALSE(index.contains(macis::wfn_t<N>(0)));
+}
+
+TEST_CASE("Determinant Index Map") {
+  ROOT_ONLY(MPI_COMM_WORLD);
+
+  SECTION("64 bit") { wfn_index_map_test<64>(); }
+  SECTION("128 bit") { wfn_index_map_test<128>(); }
+  SECTION("256 bit") { wfn_index_map_test<256>(); }
+
+  SECTION("Duplicates") {
+    auto dets = macis::generate_hilbert_space<64>(6, 2, 2);
+    const size_t ndets = dets.size();
+    dets.insert(dets.end(), dets.begin(), dets.end());
+    macis::wfn_index_map<64> index(dets);
+    for(size_t i = 0; i < ndets; ++i) {
+      REQUIRE(size_t(index.find(dets[i])) == i);
+      REQUIRE(size_t(index.find(dets[i + ndets])) == i);
+    }
+  }
+
+  SECTION("Empty") {
+    macis::wfn_index_map<64> index;
+    REQUIRE(index.size() == 0);
+    REQUIRE(index.find(macis::wfn_t<64>(1)) == index.npos);
+  }
+}